@@ -0,0 +1,80 @@
+// Writes synthetic .kicad_pcb files for the parser benchmarks.
+//
+//   BoardGenerator out.kicad_pcb [--size MB] [--footprints N] [--pads N]
+//                  [--segments N] [--vias N] [--zones N] [--zone-points N]
+//                  [--nets N] [--layers N] [--seed N]
+//
+// With --size the other counts set the mix of elements and are scaled
+// together until the file is about that many megabytes.
+
+#include "SyntheticBoard.h"
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+namespace {
+    void printUsage()
+    {
+        std::cerr << "Usage: BoardGenerator <output.kicad_pcb> [--size MB] [--footprints N] [--pads N]\n"
+                     "                      [--segments N] [--vias N] [--zones N] [--zone-points N]\n"
+                     "                      [--nets N] [--layers N] [--seed N]" << std::endl;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        printUsage();
+        return 1;
+    }
+
+    SyntheticBoardSpec spec;
+    std::string outputPath;
+    double sizeMB = 0.0;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg.rfind("--", 0) != 0) {
+            outputPath = arg;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            printUsage();
+            return 1;
+        }
+        const char* value = argv[++i];
+        const unsigned long long number = std::strtoull(value, nullptr, 10);
+        if (arg == "--size") sizeMB = std::atof(value);
+        else if (arg == "--footprints") spec.footprints = number;
+        else if (arg == "--pads") spec.padsPerFootprint = static_cast<uint32_t>(number);
+        else if (arg == "--segments") spec.segments = number;
+        else if (arg == "--vias") spec.vias = number;
+        else if (arg == "--zones") spec.zones = number;
+        else if (arg == "--zone-points") spec.zonePoints = static_cast<uint32_t>(number);
+        else if (arg == "--nets") spec.nets = number;
+        else if (arg == "--layers") spec.copperLayers = static_cast<uint32_t>(number);
+        else if (arg == "--seed") spec.seed = static_cast<uint32_t>(number);
+        else {
+            printUsage();
+            return 1;
+        }
+    }
+    if (outputPath.empty()) {
+        printUsage();
+        return 1;
+    }
+
+    if (sizeMB > 0.0) {
+        spec = spec.scaledToSize(static_cast<uint64_t>(sizeMB * 1024 * 1024));
+    }
+
+    if (!writeSyntheticBoard(spec, outputPath)) {
+        std::cerr << "Could not write " << outputPath << std::endl;
+        return 1;
+    }
+
+    std::cout << "Wrote " << outputPath << ": " << spec.footprints << " footprints, "
+              << spec.footprints * spec.padsPerFootprint << " pads, " << spec.segments << " segments, "
+              << spec.vias << " vias, " << spec.zones << " zones, " << spec.nets << " nets." << std::endl;
+    return 0;
+}
@@ -0,0 +1,300 @@
+// Times the stages of loading a board separately:
+//
+//   sexp tree      SexpParser::parse of the mapped file into a full tree
+//   extract <mode> PcbParser::parseFile in each ParseMode
+//   PcbData build  Adding already-extracted elements to a fresh PcbData
+//
+// For each stage it reports the best time over the iterations, throughput
+// in MB/s and items/s (tree nodes for the first stage, board elements for
+// the others), the heap allocations of one run and the process's peak RSS
+// so far. Peak RSS only ever grows, so use --stage to measure one stage
+// per process when comparing memory.
+//
+//   ParserBenchmark [--iterations N] [--threads N] [--stage NAME]
+//                   [--generate MB] [--keep] [board.kicad_pcb ...]
+//
+// --generate benchmarks a synthetic board of about that size, written to
+// the temp directory and removed afterwards unless --keep is given.
+
+#include "SyntheticBoard.h"
+#include "core/PcbData.h"
+#include "core/PcbParser.h"
+#include "kicad/MappedFile.h"
+#include "kicad/SexpParser.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+// Every heap allocation in the process goes through here so the stages
+// can report how many they make.
+namespace {
+    std::atomic<uint64_t> g_allocationCount{0};
+}
+
+void* operator new(std::size_t size)
+{
+    g_allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+namespace {
+    double peakRssMB()
+    {
+#ifdef _WIN32
+        PROCESS_MEMORY_COUNTERS counters;
+        if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+            return counters.PeakWorkingSetSize / (1024.0 * 1024.0);
+        }
+        return 0.0;
+#else
+        rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+        return usage.ru_maxrss / (1024.0 * 1024.0); // bytes
+#else
+        return usage.ru_maxrss / 1024.0; // kilobytes
+#endif
+#endif
+    }
+
+    // The parsers report progress on std::cout; keep it out of the timings and the table.
+    class QuietStdout {
+    public:
+        QuietStdout() : m_saved(std::cout.rdbuf(m_sink.rdbuf())) {}
+        ~QuietStdout() { std::cout.rdbuf(m_saved); }
+
+    private:
+        std::ostringstream m_sink;
+        std::streambuf* m_saved;
+    };
+
+    struct StageResult {
+        double bestMs = 0.0;
+        uint64_t items = 0;
+        uint64_t allocations = 0;
+    };
+
+    // Runs a stage the given number of times and keeps the fastest run.
+    // The stage returns the number of items it processed, or 0 on failure.
+    bool runStage(int iterations, const std::function<uint64_t()>& stage, StageResult& result)
+    {
+        result.bestMs = 0.0;
+        for (int i = 0; i < iterations; ++i) {
+            uint64_t items;
+            const uint64_t allocationsBefore = g_allocationCount.load();
+            const auto start = std::chrono::steady_clock::now();
+            {
+                QuietStdout quiet;
+                items = stage();
+            }
+            const auto end = std::chrono::steady_clock::now();
+            if (items == 0) {
+                return false;
+            }
+            const double ms = std::chrono::duration<double, std::milli>(end - start).count();
+            if (i == 0 || ms < result.bestMs) {
+                result.bestMs = ms;
+            }
+            result.items = items;
+            result.allocations = g_allocationCount.load() - allocationsBefore;
+        }
+        return true;
+    }
+
+    void printRow(const std::string& name, double fileMB, const StageResult& result)
+    {
+        const double seconds = result.bestMs / 1000.0;
+        std::printf("%-20s %10.1f %10.1f %14.0f %12llu %10.1f\n", name.c_str(), result.bestMs,
+                    fileMB / seconds, result.items / seconds,
+                    static_cast<unsigned long long>(result.allocations), peakRssMB());
+        std::fflush(stdout);
+    }
+
+    uint64_t countNodes(const SexpNode& node)
+    {
+        uint64_t count = 1;
+        if (node.isList()) {
+            for (const SexpNode& child : node.getList()) {
+                count += countNodes(child);
+            }
+        }
+        return count;
+    }
+
+    uint64_t elementCount(const PcbData& data)
+    {
+        return data.GetLines().size() + data.GetPads().size() + data.GetVias().size() + data.GetZones().size();
+    }
+
+    bool benchmarkBoard(const std::string& path, int iterations, unsigned threads, const std::string& only)
+    {
+        std::error_code error;
+        const double fileMB = std::filesystem::file_size(path, error) / (1024.0 * 1024.0);
+        if (error) {
+            std::cerr << "Cannot read " << path << std::endl;
+            return false;
+        }
+
+        std::printf("\n%s (%.1f MB, best of %d)\n", path.c_str(), fileMB, iterations);
+        std::printf("%-20s %10s %10s %14s %12s %10s\n", "stage", "ms", "MB/s", "items/s", "allocations", "peak MB");
+
+        auto wanted = [&](const std::string& name) { return only.empty() || only == name; };
+        StageResult result;
+        bool ok = true;
+
+        if (wanted("sexp")) {
+            MappedFile source;
+            if (!source.open(path)) {
+                std::cerr << "Cannot map " << path << std::endl;
+                return false;
+            }
+            ok &= runStage(iterations, [&]() -> uint64_t {
+                try {
+                    SexpDocument document = SexpParser::parse(source.view());
+                    return countNodes(document.getRoot());
+                } catch (const std::runtime_error& e) {
+                    std::cerr << "Parse error: " << e.what() << std::endl;
+                    return 0;
+                }
+            }, result);
+            printRow("sexp tree", fileMB, result);
+        }
+
+        const std::pair<const char*, PcbParser::ParseMode> modes[] = {
+            {"tree", PcbParser::ParseMode::Tree},
+            {"streaming", PcbParser::ParseMode::Streaming},
+            {"parallel", PcbParser::ParseMode::Parallel},
+            {"chunked", PcbParser::ParseMode::Chunked},
+        };
+        std::shared_ptr<PcbData> extracted;
+        for (const auto& [name, mode] : modes) {
+            const bool needed = wanted(name) || (wanted("build") && !extracted && mode == PcbParser::ParseMode::Streaming);
+            if (!needed) {
+                continue;
+            }
+            PcbParser parser;
+            parser.setParseMode(mode);
+            parser.setThreadCount(threads);
+            ok &= runStage(wanted(name) ? iterations : 1, [&]() -> uint64_t {
+                extracted = parser.parseFile(path);
+                return extracted ? elementCount(*extracted) : 0;
+            }, result);
+            if (wanted(name)) {
+                printRow(std::string("extract ") + name, fileMB, result);
+            }
+        }
+
+        if (wanted("build") && extracted) {
+            // Copies of the elements, so the stage measures only PcbData itself.
+            const std::vector<PcbLine> lines(extracted->GetLines().begin(), extracted->GetLines().end());
+            const std::vector<PcbPad> pads(extracted->GetPads().begin(), extracted->GetPads().end());
+            const std::vector<PcbVia> vias(extracted->GetVias().begin(), extracted->GetVias().end());
+            std::vector<std::pair<PcbZone, std::vector<PcbPoint>>> zones;
+            for (const auto& zone : extracted->GetZones()) {
+                zones.emplace_back(zone, std::vector<PcbPoint>(zone.polygon.begin(), zone.polygon.end()));
+            }
+            for (auto& zone : zones) {
+                zone.first.polygon = PcbPointSpan(zone.second);
+            }
+            std::vector<std::pair<int, std::string>> nets;
+            for (size_t i = 0; i < extracted->GetNets().size(); ++i) {
+                nets.emplace_back(extracted->GetNetNumber(static_cast<int>(i)), extracted->GetNets()[i]);
+            }
+            const std::vector<PcbLayer> layers = extracted->GetLayers();
+            extracted.reset();
+            ok &= runStage(iterations, [&]() -> uint64_t {
+                PcbData data;
+                for (const auto& layer : layers) data.AddLayer(layer); // Keeps the copied layer ids valid
+                for (const auto& net : nets) data.AddNet(net.first, net.second);
+                for (const auto& line : lines) data.AddLine(line);
+                for (const auto& pad : pads) data.AddPad(pad);
+                for (const auto& via : vias) data.AddVia(via);
+                for (const auto& zone : zones) data.AddZone(zone.first);
+                data.BuildNetIndex();
+                return elementCount(data);
+            }, result);
+            printRow("PcbData build", fileMB, result);
+        }
+
+        return ok;
+    }
+
+    void printUsage()
+    {
+        std::cerr << "Usage: ParserBenchmark [--iterations N] [--threads N] [--stage sexp|tree|streaming|parallel|chunked|build]\n"
+                     "                       [--generate MB] [--keep] [board.kicad_pcb ...]" << std::endl;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    int iterations = 3;
+    unsigned threads = 0;
+    double generateMB = 0.0;
+    bool keep = false;
+    std::string stage;
+    std::vector<std::string> boards;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--iterations" && hasValue) iterations = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--threads" && hasValue) threads = static_cast<unsigned>(std::atoi(argv[++i]));
+        else if (arg == "--generate" && hasValue) generateMB = std::atof(argv[++i]);
+        else if (arg == "--stage" && hasValue) stage = argv[++i];
+        else if (arg == "--keep") keep = true;
+        else if (arg.rfind("--", 0) == 0) {
+            printUsage();
+            return 1;
+        } else {
+            boards.push_back(arg);
+        }
+    }
+
+    std::string generated;
+    if (generateMB > 0.0) {
+        std::ostringstream name;
+        name << "synthetic_" << generateMB << "MB.kicad_pcb";
+        generated = (std::filesystem::temp_directory_path() / name.str()).string();
+        const SyntheticBoardSpec spec = SyntheticBoardSpec().scaledToSize(static_cast<uint64_t>(generateMB * 1024 * 1024));
+        if (!writeSyntheticBoard(spec, generated)) {
+            std::cerr << "Could not write " << generated << std::endl;
+            return 1;
+        }
+        boards.push_back(generated);
+    }
+    if (boards.empty()) {
+        printUsage();
+        return 1;
+    }
+
+    bool ok = true;
+    for (const std::string& board : boards) {
+        ok &= benchmarkBoard(board, iterations, threads, stage);
+    }
+
+    if (!generated.empty() && !keep) {
+        std::filesystem::remove(generated);
+    }
+    return ok ? 0 : 1;
+}
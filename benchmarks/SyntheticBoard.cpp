@@ -0,0 +1,200 @@
+#include "SyntheticBoard.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <streambuf>
+#include <vector>
+
+namespace {
+    // printf-style output to a stream through a reused line buffer, which is
+    // much faster than formatting doubles with operator<<.
+    class BoardWriter {
+    public:
+        explicit BoardWriter(std::ostream& out) : m_out(out) {}
+
+        void print(const char* format, ...) {
+            va_list args;
+            va_start(args, format);
+            int length = std::vsnprintf(m_line, sizeof(m_line), format, args);
+            va_end(args);
+            m_out.write(m_line, std::min<int>(length, sizeof(m_line) - 1));
+        }
+
+    private:
+        std::ostream& m_out;
+        char m_line[1024];
+    };
+
+    // Counts what is written without storing it.
+    class CountingBuffer : public std::streambuf {
+    public:
+        uint64_t count = 0;
+
+    protected:
+        int_type overflow(int_type c) override {
+            count++;
+            return c;
+        }
+        std::streamsize xsputn(const char*, std::streamsize n) override {
+            count += n;
+            return n;
+        }
+    };
+
+    std::vector<std::string> copperLayerNames(uint32_t count) {
+        count = std::clamp<uint32_t>(count, 2, 32);
+        std::vector<std::string> names{"F.Cu"};
+        for (uint32_t i = 1; i + 1 < count; ++i) {
+            names.push_back("In" + std::to_string(i) + ".Cu");
+        }
+        names.push_back("B.Cu");
+        return names;
+    }
+}
+
+SyntheticBoardSpec SyntheticBoardSpec::scaledToSize(uint64_t bytes) const
+{
+    // Measure a sample with the same mix, then scale linearly.
+    SyntheticBoardSpec sample = *this;
+    const double sampleScale = 1000.0 / std::max<uint64_t>(footprints, 1);
+    auto scale = [](uint64_t count, double factor) {
+        return static_cast<uint64_t>(std::llround(count * factor));
+    };
+    sample.footprints = 1000;
+    sample.segments = scale(segments, sampleScale);
+    sample.vias = scale(vias, sampleScale);
+    sample.zones = scale(zones, sampleScale);
+    sample.nets = std::max<uint64_t>(1, scale(nets, sampleScale));
+
+    CountingBuffer counter;
+    std::ostream sink(&counter);
+    writeSyntheticBoard(sample, sink);
+
+    const double factor = static_cast<double>(bytes) / std::max<uint64_t>(counter.count, 1);
+    SyntheticBoardSpec scaled = sample;
+    scaled.footprints = std::max<uint64_t>(1, scale(sample.footprints, factor));
+    scaled.segments = scale(sample.segments, factor);
+    scaled.vias = scale(sample.vias, factor);
+    scaled.zones = scale(sample.zones, factor);
+    scaled.nets = std::max<uint64_t>(1, scale(sample.nets, factor));
+    return scaled;
+}
+
+void writeSyntheticBoard(const SyntheticBoardSpec& spec, std::ostream& out)
+{
+    BoardWriter writer(out);
+    std::mt19937 rng(spec.seed);
+    const std::vector<std::string> copper = copperLayerNames(spec.copperLayers);
+    const uint64_t netCount = std::max<uint64_t>(spec.nets, 1);
+
+    // Footprints sit on a 5 mm grid; everything else is spread over the same area.
+    const double pitch = 5.0;
+    const uint64_t columns = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(std::sqrt(static_cast<double>(spec.footprints)))));
+    const double side = (columns + 1) * pitch;
+    std::uniform_real_distribution<double> coordinate(pitch / 2, side - pitch / 2);
+    std::uniform_int_distribution<uint64_t> anyNet(1, netCount);
+    std::uniform_int_distribution<size_t> anyLayer(0, copper.size() - 1);
+    uint64_t tstamp = 0;
+
+    writer.print("(kicad_pcb (version 20211014) (generator pcbnew)\n\n");
+    writer.print("  (general\n    (thickness 1.6)\n  )\n\n");
+    writer.print("  (paper \"A4\")\n");
+    writer.print("  (layers\n");
+    for (size_t i = 0; i < copper.size(); ++i) {
+        const int number = (i + 1 == copper.size()) ? 31 : static_cast<int>(i);
+        writer.print("    (%d \"%s\" signal)\n", number, copper[i].c_str());
+    }
+    writer.print("    (36 \"B.SilkS\" user \"B.Silkscreen\")\n    (37 \"F.SilkS\" user \"F.Silkscreen\")\n");
+    writer.print("    (38 \"B.Mask\" user)\n    (39 \"F.Mask\" user)\n    (44 \"Edge.Cuts\" user)\n  )\n\n");
+    writer.print("  (setup\n    (pad_to_mask_clearance 0)\n  )\n\n");
+
+    writer.print("  (net 0 \"\")\n");
+    for (uint64_t net = 1; net <= netCount; ++net) {
+        writer.print("  (net %llu \"Net-%llu\")\n", static_cast<unsigned long long>(net), static_cast<unsigned long long>(net));
+    }
+
+    // Board outline.
+    const double corners[5][2] = {{0, 0}, {side, 0}, {side, side}, {0, side}, {0, 0}};
+    for (int i = 0; i < 4; ++i) {
+        writer.print("  (gr_line (start %.4f %.4f) (end %.4f %.4f) (layer \"Edge.Cuts\") (width 0.1) (tstamp %08llx-0000-0000-0000-000000000000))\n",
+                     corners[i][0], corners[i][1], corners[i + 1][0], corners[i + 1][1], static_cast<unsigned long long>(++tstamp));
+    }
+
+    for (uint64_t i = 0; i < spec.footprints; ++i) {
+        const double x = (i % columns + 1) * pitch;
+        const double y = (i / columns + 1) * pitch;
+        const bool bottom = (i % 7) == 6;
+        writer.print("  (footprint \"Synthetic:DIP-%u\" (layer \"%s\")\n", spec.padsPerFootprint, bottom ? "B.Cu" : "F.Cu");
+        writer.print("    (tstamp %08llx-0000-0000-0000-000000000000)\n", static_cast<unsigned long long>(++tstamp));
+        writer.print("    (at %.4f %.4f%s)\n", x, y, (i % 4 == 1) ? " 90" : "");
+        writer.print("    (property \"Sheetfile\" \"synthetic.kicad_sch\")\n");
+        writer.print("    (fp_text reference \"U%llu\" (at 0 -2) (layer \"%s\")\n      (effects (font (size 1 1) (thickness 0.15)))\n    )\n",
+                     static_cast<unsigned long long>(i + 1), bottom ? "B.SilkS" : "F.SilkS");
+        writer.print("    (fp_line (start -2 -1.5) (end 2 -1.5) (layer \"F.SilkS\") (width 0.12))\n");
+        writer.print("    (fp_line (start -2 1.5) (end 2 1.5) (layer \"F.SilkS\") (width 0.12))\n");
+        for (uint32_t pad = 0; pad < spec.padsPerFootprint; ++pad) {
+            const double padX = -1.5 + 3.0 * (pad % 2);
+            const double padY = -1.0 + 0.5 * (pad / 2);
+            const unsigned long long net = anyNet(rng);
+            if (pad % 2 == 0) {
+                writer.print("    (pad \"%u\" smd roundrect (at %.4f %.4f) (size 0.9 0.4) (layers \"%s\" \"F.Paste\" \"F.Mask\") (roundrect_rratio 0.25) (net %llu \"Net-%llu\") (tstamp %08llx-0000-0000-0000-000000000000))\n",
+                             pad + 1, padX, padY, bottom ? "B.Cu" : "F.Cu", net, net, static_cast<unsigned long long>(++tstamp));
+            } else {
+                writer.print("    (pad \"%u\" thru_hole circle (at %.4f %.4f) (size 0.8 0.8) (drill 0.4) (layers \"*.Cu\" \"*.Mask\") (net %llu \"Net-%llu\") (tstamp %08llx-0000-0000-0000-000000000000))\n",
+                             pad + 1, padX, padY, net, net, static_cast<unsigned long long>(++tstamp));
+            }
+        }
+        writer.print("    (model \"${KICAD6_3DMODEL_DIR}/Package_DIP.3dshapes/DIP.wrl\"\n      (offset (xyz 0 0 0)) (scale (xyz 1 1 1)) (rotate (xyz 0 0 0))\n    )\n  )\n");
+    }
+
+    for (uint64_t i = 0; i < spec.segments; ++i) {
+        const double x = coordinate(rng);
+        const double y = coordinate(rng);
+        const bool horizontal = (i % 2) == 0;
+        writer.print("  (segment (start %.4f %.4f) (end %.4f %.4f) (width 0.25) (layer \"%s\") (net %llu) (tstamp %08llx-0000-0000-0000-000000000000))\n",
+                     x, y, horizontal ? x + 2.5 : x, horizontal ? y : y + 2.5, copper[anyLayer(rng)].c_str(),
+                     static_cast<unsigned long long>(anyNet(rng)), static_cast<unsigned long long>(++tstamp));
+    }
+
+    for (uint64_t i = 0; i < spec.vias; ++i) {
+        writer.print("  (via (at %.4f %.4f) (size 0.8) (drill 0.4) (layers \"%s\" \"%s\") (net %llu) (tstamp %08llx-0000-0000-0000-000000000000))\n",
+                     coordinate(rng), coordinate(rng), copper.front().c_str(), copper.back().c_str(),
+                     static_cast<unsigned long long>(anyNet(rng)), static_cast<unsigned long long>(++tstamp));
+    }
+
+    const uint32_t zonePoints = std::max<uint32_t>(spec.zonePoints, 3);
+    for (uint64_t i = 0; i < spec.zones; ++i) {
+        const unsigned long long net = anyNet(rng);
+        const double cx = coordinate(rng);
+        const double cy = coordinate(rng);
+        const double radius = side / 8;
+        writer.print("  (zone (net %llu) (net_name \"Net-%llu\") (layer \"%s\") (tstamp %08llx-0000-0000-0000-000000000000) (hatch edge 0.508)\n",
+                     net, net, copper[i % copper.size()].c_str(), static_cast<unsigned long long>(++tstamp));
+        writer.print("    (connect_pads (clearance 0.508))\n    (min_thickness 0.254)\n    (fill (thermal_gap 0.508) (thermal_bridge_width 0.508))\n");
+        writer.print("    (polygon\n      (pts\n");
+        for (uint32_t p = 0; p < zonePoints; ++p) {
+            const double angle = 2 * 3.14159265358979323846 * p / zonePoints;
+            writer.print("        (xy %.4f %.4f)\n", cx + radius * std::cos(angle), cy + radius * std::sin(angle));
+        }
+        writer.print("      )\n    )\n  )\n");
+    }
+
+    writer.print(")\n");
+}
+
+bool writeSyntheticBoard(const SyntheticBoardSpec& spec, const std::string& path)
+{
+    std::vector<char> buffer(1 << 20);
+    std::ofstream out;
+    out.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+    out.open(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        return false;
+    }
+    writeSyntheticBoard(spec, out);
+    out.flush();
+    return static_cast<bool>(out);
+}
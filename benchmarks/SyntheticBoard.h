@@ -0,0 +1,45 @@
+#ifndef SYNTHETIC_BOARD_H
+#define SYNTHETIC_BOARD_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// Parameters for a generated .kicad_pcb. The defaults describe a small
+// two-layer board; scaledToSize() grows every count together so the mix of
+// element types stays the same from a few megabytes to a gigabyte.
+struct SyntheticBoardSpec {
+    uint64_t footprints = 1000;
+    uint32_t padsPerFootprint = 4;
+    uint64_t segments = 2000;
+    uint64_t vias = 200;
+    uint64_t zones = 4;
+    uint32_t zonePoints = 64;    // Outline vertices per zone
+    uint64_t nets = 300;
+    uint32_t copperLayers = 2;   // 2 to 32
+    uint32_t seed = 1;
+
+    /**
+     * @brief Returns a copy with all element counts scaled so the written
+     *        file is roughly the given size.
+     */
+    SyntheticBoardSpec scaledToSize(uint64_t bytes) const;
+};
+
+/**
+ * @brief Writes a syntactically valid KiCad board with the given contents.
+ *
+ * The output is deterministic for a given spec (including its seed).
+ * Footprints are placed on a grid, each with silkscreen, pads (alternating
+ * SMD and through-hole), a 3D model and a property; segments, vias and
+ * zones are spread over the copper layers and nets.
+ */
+void writeSyntheticBoard(const SyntheticBoardSpec& spec, std::ostream& out);
+
+/**
+ * @brief Writes a synthetic board to a file.
+ * @return false if the file could not be written.
+ */
+bool writeSyntheticBoard(const SyntheticBoardSpec& spec, const std::string& path);
+
+#endif // SYNTHETIC_BOARD_H
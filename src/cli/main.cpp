@@ -0,0 +1,70 @@
+// Loads a board, routes every net and prints the routing metrics as JSON,
+// like the GUI's --test-mode but without starting wxWidgets.
+//
+//   AutorouterCli --pcb board.kicad_pcb [--out routed.kicad_pcb] [--cache-dir dir]
+//
+// With --out the board is also written back out with the routed tracks
+// and vias added. Only the JSON goes to stdout; progress messages go to
+// stderr. The PcbData cache is off unless --cache-dir names a directory
+// for its snapshots, so nothing is written next to the input board.
+
+#include "core/AutorouterCore.h"
+#include "core/PcbData.h"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+int main(int argc, char* argv[])
+{
+    std::string pcbFile;
+    std::string outFile;
+    std::string cacheDir;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--pcb" && i + 1 < argc) pcbFile = argv[++i];
+        else if (arg == "--out" && i + 1 < argc) outFile = argv[++i];
+        else if (arg == "--cache-dir" && i + 1 < argc) cacheDir = argv[++i];
+    }
+    if (pcbFile.empty()) {
+        std::fprintf(stderr, "Error: --pcb argument is required.\n");
+        return 2;
+    }
+
+    AutorouterCore core;
+    core.setCacheEnabled(!cacheDir.empty());
+    if (!cacheDir.empty()) core.setCacheDirectory(cacheDir);
+    if (!core.loadPcbFile(pcbFile)) {
+        std::fprintf(stderr, "Error: Failed to load PCB file '%s'.\n", pcbFile.c_str());
+        return 1;
+    }
+
+    RoutingSettings settings;
+    std::vector<int> netsToRoute; // Route all nets for now
+    const auto& allNets = core.getPcbData()->GetNets();
+    for (size_t i = 0; i < allNets.size(); ++i) {
+        netsToRoute.push_back(static_cast<int>(i));
+    }
+
+    RoutingResult result = core.Route(settings, netsToRoute);
+    if (!outFile.empty() && !core.writePcbFile(outFile, core.getRoutedLines(), core.getRoutedVias())) {
+        std::fprintf(stderr, "Error: Failed to write '%s'.\n", outFile.c_str());
+        return 1;
+    }
+
+    // The same fields as the GUI's test mode, so either can feed the same tools.
+    std::printf("{\n");
+    std::printf("  \"success\": %s,\n", result.success ? "true" : "false");
+    std::printf("  \"routing_time_ms\": %.2f,\n", result.time_ms);
+    std::printf("  \"nets_total\": %d,\n", result.nets_total);
+    std::printf("  \"nets_routed\": %d,\n", result.nets_routed);
+    if (result.nets_total > 0)
+        std::printf("  \"completion_rate_pct\": %.2f,\n", (double)result.nets_routed / result.nets_total * 100.0);
+    else
+        std::printf("  \"completion_rate_pct\": 0.0,\n");
+    std::printf("  \"total_track_length_mm\": %.2f,\n", result.total_track_length);
+    std::printf("  \"via_count\": %d,\n", result.via_count);
+    std::printf("  \"connections_total\": %d,\n", result.connections_total);
+    std::printf("  \"nets_complete\": %d\n", result.nets_complete);
+    std::printf("}\n");
+    return 0;
+}
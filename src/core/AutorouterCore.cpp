@@ -1,27 +1,371 @@
 #include "core/AutorouterCore.h"
+#include "core/Connectivity.h"
 #include "core/PcbData.h"
 #include "core/PcbParser.h"
+#include "core/PcbDataCache.h"
+#include "core/PcbDataVersions.h"
+#include "core/PcbWriter.h"
+#include "core/RoutingGrid.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
 
-AutorouterCore::AutorouterCore() : m_parser(std::make_unique<PcbParser>()) {}
+namespace {
+    // Grids beyond this many cells (over all planes) are made coarser.
+    const double MaxGridCells = 64.0 * 1024 * 1024;
+
+    // The copper layers a connection can start or end on at an element.
+    PcbLayerSet itemCopper(const PcbData& data, PcbItemRef item) {
+        switch (item.kind) {
+        case PcbItemKind::Line: return LayerBit(data.GetLines()[item.index].layer);
+        case PcbItemKind::Pad: {
+            const PcbPad pad = data.GetPads()[item.index];
+            return (pad.layers | LayerBit(pad.layer)) & data.GetCopperLayers();
+        }
+        case PcbItemKind::Via: return data.GetVias()[item.index].layers;
+        case PcbItemKind::Zone: return LayerBit(data.GetZones()[item.index].layer);
+        }
+        return 0;
+    }
+
+    // The pad count of the footprint an item is a pad of; 0 for other items.
+    size_t footprintPads(const PcbData& data, PcbItemRef item) {
+        if (item.kind != PcbItemKind::Pad) {
+            return 0;
+        }
+        const uint32_t footprint = data.GetPads().columns().footprint[item.index];
+        return data.GetFootprintDefs()[data.GetFootprints().columns().def[footprint]]->pads.size();
+    }
+
+    int firstPlane(const RoutingGrid& grid, PcbLayerSet layers) {
+        for (int plane = 0; plane < grid.GetLayerCount(); ++plane) {
+            const PcbLayerId layer = grid.GetLayerId(plane);
+            if (layer == PcbNoLayer || (layers & LayerBit(layer))) {
+                return plane;
+            }
+        }
+        return -1;
+    }
+
+    // What blocks every net, built once per Route(): the board edge,
+    // keepouts, every pad, and every track and via grown by the clearance.
+    void addBoardObstacles(RoutingGrid& grid, const PcbData& data, PcbCoord clearance) {
+        grid.AddBoardOutline(data);
+        grid.AddKeepoutZones(data);
+        grid.AddFootprintObstacles(data);
+        for (const PcbLine& line : data.GetLines()) {
+            grid.AddLineObstacle(line, clearance);
+        }
+        for (const PcbVia& via : data.GetVias()) {
+            grid.AddViaObstacle(via, clearance);
+        }
+    }
+
+    // Turns the board grid into one net's, inside an overlay: its own
+    // copper is open and other nets' zones are obstacles.
+    void openNet(RoutingGrid& grid, const PcbData& data, int netIndex) {
+        const int netNumber = data.GetNetNumber(netIndex);
+        for (size_t line : data.GetNetLines(netIndex)) {
+            grid.OpenLine(data.GetLines()[line]);
+        }
+        for (size_t via : data.GetNetVias(netIndex)) {
+            grid.OpenVia(data.GetVias()[via]);
+        }
+        grid.AddCopperZones(data, netNumber);
+        const PcbPadView pads = data.GetPads();
+        for (size_t pad : data.GetNetPads(netIndex)) {
+            grid.AddPadObstacle(pads[pad], true);
+        }
+    }
+
+    // Turns a grid path into one track per straight run and a via per
+    // layer change. The ends are moved onto the exact points they join.
+    double appendRoute(const std::vector<GridPoint>& path, const PcbConnection& connection, const RoutingGrid& grid,
+                       const PcbData& data, const RoutingSettings& settings,
+                       std::vector<PcbLine>& lines, std::vector<PcbVia>& vias) {
+        const int netNumber = data.GetNetNumber(connection.netIndex);
+        const PcbCoord width = MillimetresToCoord(settings.track_width);
+        auto position = [&](size_t i) {
+            if (i == 0) return connection.fromPos;
+            if (i == path.size() - 1) return connection.toPos;
+            return grid.GridToWorld(path[i]);
+        };
+        double length = 0.0;
+        auto addTrack = [&](size_t from, size_t to) {
+            const PcbPoint start = position(from);
+            const PcbPoint end = from == to ? connection.toPos : position(to);
+            if (start == end) return;
+            lines.push_back({start, end, width, grid.GetLayerId(path[from].layer), netNumber});
+            length += std::hypot(CoordToMillimetres(end.x - start.x), CoordToMillimetres(end.y - start.y));
+        };
+
+        size_t runStart = 0;
+        for (size_t i = 1; i < path.size(); ++i) {
+            if (path[i].layer != path[i - 1].layer) {
+                if (i - 1 > runStart) addTrack(runStart, i - 1);
+                const uint32_t planes = grid.GetViaPlanes(path[i - 1].layer, path[i].layer);
+                int top = 0, bottom = grid.GetLayerCount() - 1;
+                while (!(planes & (uint32_t(1) << top))) ++top;
+                while (!(planes & (uint32_t(1) << bottom))) --bottom;
+                PcbVia via;
+                via.pos = position(i);
+                via.size = MillimetresToCoord(settings.via_diameter);
+                via.drill = MillimetresToCoord(settings.via_drill);
+                via.fromLayer = grid.GetLayerId(top);
+                via.toLayer = grid.GetLayerId(bottom);
+                via.layers = data.GetCopperSpan(via.fromLayer, via.toLayer);
+                via.netId = netNumber;
+                vias.push_back(via);
+                runStart = i;
+            } else if (i - 1 > runStart &&
+                       (path[i].x - path[i - 1].x != path[i - 1].x - path[i - 2].x ||
+                        path[i].y - path[i - 1].y != path[i - 1].y - path[i - 2].y)) {
+                addTrack(runStart, i - 1); // The direction changes here
+                runStart = i - 1;
+            }
+        }
+        addTrack(runStart, path.size() - 1);
+        return length;
+    }
+} // anonymous namespace
+
+AutorouterCore::AutorouterCore()
+    : m_parser(std::make_unique<PcbParser>()),
+      m_cache(std::make_unique<PcbDataCache>()),
+      m_versions(std::make_unique<PcbDataVersions>()) {}
 
 AutorouterCore::~AutorouterCore() {}
 
 bool AutorouterCore::loadPcbFile(const std::string& filePath) {
-    m_pcbData = m_parser->parseFile(filePath);
-    return m_pcbData != nullptr;
+    m_filePath = filePath;
+    m_items.clear();
+    m_writer.reset();
+    m_loadedFromCache = false;
+
+    m_sourceKey = PcbDataCache::Key();
+    const bool useCache = PcbDataCache::computeKey(filePath, m_sourceKey) && m_cacheEnabled;
+    if (useCache) {
+        auto pcbData = m_cache->load(filePath, m_sourceKey);
+        if (pcbData) {
+            std::clog << "Loaded " << filePath << " from the PCB cache." << std::endl;
+            m_versions->Commit(std::move(pcbData));
+            m_loadedFromCache = true;
+            return true;
+        }
+    }
+
+    auto pcbData = m_parser->parseFile(filePath, m_items);
+    if (!pcbData) {
+        m_versions->Clear();
+        return false;
+    }
+    if (useCache) {
+        m_cache->store(filePath, m_sourceKey, *pcbData);
+    }
+    m_versions->Commit(std::move(pcbData));
+    return true;
+}
+
+bool AutorouterCore::readNetNames(const std::string& filePath, std::vector<std::string>& netNames) {
+    return m_parser->parseNetNames(filePath, netNames);
+}
+
+bool AutorouterCore::reloadPcbFile(PcbChangeSet* changes) {
+    const std::shared_ptr<const PcbData> current = m_versions->Current();
+    if (m_filePath.empty() || !current) {
+        return false;
+    }
+
+    PcbChangeSet localChanges;
+    PcbChangeSet& result = changes ? *changes : localChanges;
+    m_writer.reset();
+    m_sourceKey = PcbDataCache::Key();
+    PcbDataCache::computeKey(m_filePath, m_sourceKey);
+
+    if (m_items.empty()) {
+        // Loaded from a snapshot (or an empty board): nothing to diff against.
+        auto pcbData = m_parser->parseFile(m_filePath, m_items);
+        if (!pcbData) {
+            return false;
+        }
+        m_versions->Commit(std::move(pcbData));
+        result = PcbChangeSet();
+        result.fullReload = true;
+        return true;
+    }
+
+    // The snapshot is left as it is; the next loadPcbFile() of the new
+    // contents misses the cache and writes a fresh one.
+    PcbData next = *current;
+    if (!m_parser->reloadFile(m_filePath, next, m_items, result)) {
+        return false;
+    }
+    if (!result.empty()) {
+        m_versions->Commit(std::move(next));
+    }
+    return true;
+}
+
+void AutorouterCore::setCacheDirectory(const std::string& directory) {
+    m_cache->setDirectory(directory);
+}
+
+std::shared_ptr<const PcbData> AutorouterCore::getPcbData() const {
+    return m_versions->Current();
+}
+
+uint64_t AutorouterCore::commitTracks(const std::vector<PcbLine>& lines, const std::vector<PcbVia>& vias) {
+    const std::shared_ptr<const PcbData> current = m_versions->Current();
+    if (!current) {
+        return 0;
+    }
+    PcbData next = *current;
+    for (const PcbLine& line : lines) {
+        next.AddLine(line);
+    }
+    for (const PcbVia& via : vias) {
+        next.AddVia(via);
+    }
+    next.BuildNetIndex();
+    // The items no longer describe the board; the next reload starts over.
+    m_items.clear();
+    return m_versions->Commit(std::move(next));
 }
 
-std::shared_ptr<PcbData> AutorouterCore::getPcbData() const {
-    return m_pcbData;
+bool AutorouterCore::writePcbFile(const std::string& outPath, const std::vector<PcbLine>& lines, const std::vector<PcbVia>& vias) {
+    const std::shared_ptr<const PcbData> current = m_versions->Current();
+    if (m_filePath.empty() || !current) {
+        return false;
+    }
+    // The writer keeps the extents it was opened with, which describe the
+    // file rather than a version. Without them (after a cache hit or a
+    // commit) it finds the end of the board itself.
+    if (!m_writer) {
+        auto writer = std::make_unique<PcbWriter>();
+        if (!writer->open(m_filePath, m_items, m_sourceKey)) {
+            return false;
+        }
+        m_writer = std::move(writer);
+    }
+    return m_writer->write(outPath, *current, lines, vias);
 }
 
-RoutingResult AutorouterCore::Route(const RoutingSettings& settings, const wxArrayInt& netsToRoute)
+RoutingResult AutorouterCore::Route(const RoutingSettings& settings, const std::vector<int>& netsToRoute)
 {
-    // This is a stub implementation.
-    // The actual routing logic will go here.
     RoutingResult result;
-    result.success = false; // Not implemented yet
-    result.nets_total = netsToRoute.GetCount();
-    // Other fields default to 0
+    result.nets_total = static_cast<int>(netsToRoute.size());
+    m_routedLines.clear();
+    m_routedVias.clear();
+    const std::shared_ptr<const PcbData> pcbData = getPcbData();
+    if (!pcbData) {
+        return result;
+    }
+    const PcbData& data = *pcbData;
+
+    // Work out what is left to route. Copper already on the board is kept,
+    // so only the connections between its islands need new tracks.
+    const auto start = std::chrono::steady_clock::now();
+    Connectivity connectivity;
+    connectivity.Build(data, netsToRoute);
+    result.connections_total = static_cast<int>(connectivity.GetConnections().size());
+
+    // One grid over the board's extent, with a plane per copper layer.
+    const PcbBox& bounds = data.GetBounds();
+    const int layerCount = std::max<int>(1, static_cast<int>(std::count_if(data.GetLayers().begin(), data.GetLayers().end(),
+                                                                            [](const PcbLayer& layer) { return layer.IsCopper(); })));
+    double resolution = settings.grid_resolution;
+    if (!bounds.IsEmpty()) {
+        const double cells = (CoordToMillimetres(bounds.maxX - bounds.minX) / resolution + 1) *
+                             (CoordToMillimetres(bounds.maxY - bounds.minY) / resolution + 1) * layerCount;
+        if (cells > MaxGridCells) {
+            resolution *= std::sqrt(cells / MaxGridCells);
+        }
+    }
+    ViaRules viaRules;
+    viaRules.cost = settings.via_cost;
+    viaRules.diameter = settings.via_diameter;
+    viaRules.clearance = settings.via_clearance;
+    viaRules.allowBlind = settings.allow_blind_vias;
+    viaRules.allowBuried = settings.allow_buried_vias;
+
+    // One grid for all nets. Each net opens its own copper in an overlay
+    // that is reverted afterwards, and what it routed then joins the
+    // obstacles, so nothing is rasterized twice.
+    const PcbCoord clearance = MillimetresToCoord(settings.track_width / 2 + settings.track_clearance);
+    std::unique_ptr<RoutingGrid> board;
+    if (result.connections_total > 0) {
+        board = std::make_unique<RoutingGrid>(static_cast<int>(std::ceil(CoordToMillimetres(bounds.maxX - bounds.minX) / resolution)) + 1,
+                                              static_cast<int>(std::ceil(CoordToMillimetres(bounds.maxY - bounds.minY) / resolution)) + 1,
+                                              resolution, data);
+        board->SetOrigin({bounds.minX, bounds.minY});
+        board->SetViaRules(viaRules);
+        board->SetOpenListPolicy(settings.open_list);
+        board->SetSearchMode(settings.search_mode);
+        addBoardObstacles(*board, data, clearance);
+    }
+
+    bool allRouted = true;
+    SearchWorkspace workspace;
+    for (int net : netsToRoute) {
+        const PcbSpan<PcbConnection> connections = connectivity.GetNetConnections(net);
+        if (connectivity.IsComplete(net)) {
+            ++result.nets_complete;
+        }
+        if (connections.empty()) {
+            ++result.nets_routed; // Existing copper already joins it
+            continue;
+        }
+
+        RoutingGrid& grid = *board;
+        grid.BeginOverlay();
+        openNet(grid, data, net);
+        const size_t firstLine = m_routedLines.size();
+        const size_t firstVia = m_routedVias.size();
+
+        bool netRouted = true;
+        for (const PcbConnection& connection : connections) {
+            const PcbLayerSet fromLayers = itemCopper(data, connection.from);
+            const PcbLayerSet toLayers = itemCopper(data, connection.to);
+            // Stay on one layer if both ends have one in common.
+            const int shared = firstPlane(grid, fromLayers & toLayers);
+            GridPoint from = grid.WorldToGrid(connection.fromPos);
+            GridPoint to = grid.WorldToGrid(connection.toPos);
+            from.layer = shared >= 0 ? shared : firstPlane(grid, fromLayers);
+            to.layer = shared >= 0 ? shared : firstPlane(grid, toLayers);
+
+            // Ends inside a large footprint's pin field are found faster
+            // from both sides.
+            const size_t minPads = static_cast<size_t>(std::max(0, settings.bidirectional_min_pads));
+            const bool pinField = minPads > 0 && (footprintPads(data, connection.from) >= minPads ||
+                                                  footprintPads(data, connection.to) >= minPads);
+            const std::vector<GridPoint> path = grid.FindPath(from, to, workspace, pinField ? SearchMode::Bidirectional : settings.search_mode);
+            if (path.empty()) {
+                netRouted = false;
+                continue;
+            }
+            const size_t viaCount = m_routedVias.size();
+            result.total_track_length += appendRoute(path, connection, grid, data, settings, m_routedLines, m_routedVias);
+            result.via_count += static_cast<int>(m_routedVias.size() - viaCount);
+        }
+        grid.RevertOverlay();
+        for (size_t i = firstLine; i < m_routedLines.size(); ++i) {
+            grid.AddLineObstacle(m_routedLines[i], clearance);
+        }
+        for (size_t i = firstVia; i < m_routedVias.size(); ++i) {
+            grid.AddViaObstacle(m_routedVias[i], clearance);
+        }
+        if (netRouted) {
+            ++result.nets_routed;
+        } else {
+            allRouted = false;
+        }
+    }
+
+    if (!m_routedLines.empty() || !m_routedVias.empty()) {
+        commitTracks(m_routedLines, m_routedVias);
+    }
+    result.success = allRouted;
+    result.time_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
     return result;
-}
\ No newline at end of file
+}
@@ -1,28 +1,55 @@
 #ifndef AUTOROUTER_CORE_H
 #define AUTOROUTER_CORE_H
 
+#include "PcbDataCache.h"
+#include "RoutingGrid.h"
+#include <cstdint>
 #include <memory>
 #include <string>
-
-// For wxArrayInt
-#include <wx/dynarray.h>
-int WX_DECLARE_ARRAY_INT(int, wxArrayInt);
+#include <vector>
 
 class PcbData;
+class PcbDataVersions;
 class PcbParser;
+class PcbWriter;
+struct PcbChangeSet;
+struct PcbItemExtent;
+struct PcbLine;
+struct PcbVia;
 
 struct RoutingSettings {
     int routing_passes = 10;
-    // Other settings like track width, clearance, etc. can be added here.
+    double grid_resolution = 0.1; // mm per routing grid cell
+    double track_width = 0.25;    // mm
+    double via_diameter = 0.6;    // mm
+    double via_drill = 0.3;       // mm
+    double via_clearance = 0.2;   // mm from a via to other copper
+    double track_clearance = 0.2; // mm from a track to other nets' tracks and vias
+    float via_cost = 10.0f;       // What a layer change adds to a route, in grid steps
+    // Vias that stop short of the outer layers; otherwise every via is
+    // drilled through the board.
+    bool allow_blind_vias = false;
+    bool allow_buried_vias = false;
+    // The searches' open set. The bucket queue is O(1) per operation; the
+    // binary heap is kept for comparison.
+    OpenListPolicy open_list = OpenListPolicy::Buckets;
+    // Jump point search only prunes single-layer boards; with more
+    // layers it searches as A* does.
+    SearchMode search_mode = SearchMode::AStar;
+    // Connections to a footprint with at least this many pads, such as a
+    // BGA, search from both ends instead; 0 turns that off.
+    int bidirectional_min_pads = 64;
 };
 
 struct RoutingResult {
     bool success = false;
     double time_ms = 0.0;
     int nets_total = 0;
-    int nets_routed = 0;
+    int nets_routed = 0;       // Selected nets that are complete afterwards, nets_complete included
     double total_track_length = 0.0;
     int via_count = 0;
+    int connections_total = 0; // Island-to-island connections the selected nets still need
+    int nets_complete = 0;     // Selected nets whose pads existing copper already joins
 };
 
 class AutorouterCore {
@@ -32,18 +59,95 @@ public:
 
     /**
      * @brief Loads a PCB from a file.
+     *
+     * If the binary cache is enabled and holds a snapshot made from the
+     * file's current contents, that snapshot is used instead of parsing.
+     * Otherwise the file is parsed and a new snapshot is written.
      * @param filePath The path to the PCB file.
      * @return true on success, false on failure.
      */
     bool loadPcbFile(const std::string& filePath);
 
-    std::shared_ptr<PcbData> getPcbData() const;
+    /**
+     * @brief Lists the nets of a PCB file without loading its geometry.
+     *
+     * The names are in the order getPcbData()->GetNets() will have once the
+     * file is loaded, so they can be offered for selection before that.
+     */
+    bool readNetNames(const std::string& filePath, std::vector<std::string>& netNames);
+
+    /**
+     * @brief Re-reads the loaded PCB file after it changed on disk.
+     *
+     * Only the top-level items that were added, removed or edited are
+     * re-extracted, into a copy of the current version that is then
+     * committed as the next one; boards returned by getPcbData() before
+     * the reload don't change. The first reload after a cache hit is a
+     * full parse, since snapshots don't record per-item extents.
+     * @param changes If not null, receives what changed.
+     * @return true on success, false if no file is loaded or it can't be parsed.
+     */
+    bool reloadPcbFile(PcbChangeSet* changes = nullptr);
+
+    // Enables or disables the binary PcbData cache (enabled by default).
+    void setCacheEnabled(bool enabled) { m_cacheEnabled = enabled; }
+
+    // Stores cache snapshots in this directory instead of the per-user
+    // cache directory; an empty string stores them next to the board file.
+    void setCacheDirectory(const std::string& directory);
+
+    // Whether the last loadPcbFile() was served from a cache snapshot.
+    bool loadedFromCache() const { return m_loadedFromCache; }
+
+    // The current version of the loaded board, or null if none is loaded.
+    // Holding the pointer pins that version; it is never modified.
+    std::shared_ptr<const PcbData> getPcbData() const;
+
+    /**
+     * @brief Adds routed tracks and vias to the board as a new version.
+     *
+     * Readers holding an earlier version keep seeing it unchanged.
+     * @return The new version number, or 0 if no board is loaded.
+     */
+    uint64_t commitTracks(const std::vector<PcbLine>& lines, const std::vector<PcbVia>& vias);
+
+    /**
+     * @brief Writes the loaded board file with routed tracks and vias added.
+     *
+     * The file's own text is copied unchanged and the new nodes are spliced
+     * in (see PcbWriter), so KiCad can open the result directly. The
+     * output may be the loaded file itself; reload it before writing again.
+     * @return false if no file is loaded, it changed on disk since it was
+     *         loaded or reloaded, or the output can't be written.
+     */
+    bool writePcbFile(const std::string& outPath, const std::vector<PcbLine>& lines, const std::vector<PcbVia>& vias);
+
+    /**
+     * @brief Routes the connections the selected nets still need.
+     *
+     * Each connection is searched for on a grid with one plane per copper
+     * layer, changing layers through vias. What is routed is committed as
+     * a new version (see commitTracks()).
+     * @param netsToRoute Net indices into getPcbData()->GetNets().
+     */
+    RoutingResult Route(const RoutingSettings& settings, const std::vector<int>& netsToRoute);
 
-    RoutingResult Route(const RoutingSettings& settings, const wxArrayInt& netsToRoute);
+    // The tracks and vias the last Route() added, e.g. for writePcbFile().
+    const std::vector<PcbLine>& getRoutedLines() const { return m_routedLines; }
+    const std::vector<PcbVia>& getRoutedVias() const { return m_routedVias; }
 
 private:
     std::unique_ptr<PcbParser> m_parser;
-    std::shared_ptr<PcbData> m_pcbData;
+    std::unique_ptr<PcbDataCache> m_cache;
+    bool m_cacheEnabled = true;
+    bool m_loadedFromCache = false;
+    std::unique_ptr<PcbDataVersions> m_versions;
+    std::string m_filePath;
+    std::vector<PcbItemExtent> m_items; // Per-item extents of the current version, for reloadPcbFile()
+    PcbDataCache::Key m_sourceKey;      // Contents m_items were recorded from
+    std::unique_ptr<PcbWriter> m_writer; // Opened on the first writePcbFile() after a (re)load
+    std::vector<PcbLine> m_routedLines;
+    std::vector<PcbVia> m_routedVias;
 };
 
 #endif // AUTOROUTER_CORE_H
\ No newline at end of file
@@ -0,0 +1,703 @@
+#include "Connectivity.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <thread>
+#include <utility>
+
+namespace {
+    // Nets with more anchor points than this use a Delaunay triangulation
+    // instead of comparing every pair.
+    const size_t DelaunayThreshold = 64;
+
+    // Copper closer than this (in nanometres) counts as touching, to absorb
+    // rounding in coordinates that were converted from millimetres.
+    const double ContactTolerance = 1.0;
+
+    const double DegreesToRadians = 3.14159265358979323846 / 180.0;
+
+    struct Vec {
+        double x = 0.0, y = 0.0;
+    };
+
+    Vec toVec(PcbPoint p) { return {double(p.x), double(p.y)}; }
+
+    double distanceSquared(Vec a, Vec b) { return (a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y); }
+
+    double pointSegmentDistance(Vec p, Vec a, Vec b)
+    {
+        const double dx = b.x - a.x, dy = b.y - a.y;
+        const double lengthSquared = dx * dx + dy * dy;
+        double t = 0.0;
+        if (lengthSquared > 0.0) {
+            t = std::clamp(((p.x - a.x) * dx + (p.y - a.y) * dy) / lengthSquared, 0.0, 1.0);
+        }
+        return std::sqrt(distanceSquared(p, {a.x + t * dx, a.y + t * dy}));
+    }
+
+    double cross(Vec o, Vec a, Vec b) { return (a.x - o.x) * (b.y - o.y) - (a.y - o.y) * (b.x - o.x); }
+
+    bool segmentsIntersect(Vec a, Vec b, Vec c, Vec d)
+    {
+        const double d1 = cross(c, d, a), d2 = cross(c, d, b);
+        const double d3 = cross(a, b, c), d4 = cross(a, b, d);
+        return ((d1 > 0) != (d2 > 0)) && ((d3 > 0) != (d4 > 0)) && d1 != 0 && d2 != 0 && d3 != 0 && d4 != 0;
+    }
+
+    double segmentDistance(Vec a, Vec b, Vec c, Vec d)
+    {
+        if (segmentsIntersect(a, b, c, d)) {
+            return 0.0;
+        }
+        return std::min({pointSegmentDistance(a, c, d), pointSegmentDistance(b, c, d),
+                         pointSegmentDistance(c, a, b), pointSegmentDistance(d, a, b)});
+    }
+
+    // Distance from a segment to an axis-aligned box centred on the origin.
+    double segmentBoxDistance(Vec a, Vec b, double halfWidth, double halfHeight)
+    {
+        // Clip the segment against the box (Liang-Barsky); anything left over is inside.
+        double t0 = 0.0, t1 = 1.0;
+        const double dx = b.x - a.x, dy = b.y - a.y;
+        const double p[4] = {-dx, dx, -dy, dy};
+        const double q[4] = {a.x + halfWidth, halfWidth - a.x, a.y + halfHeight, halfHeight - a.y};
+        bool inside = true;
+        for (int i = 0; i < 4 && inside; ++i) {
+            if (p[i] == 0.0) {
+                inside = q[i] >= 0.0;
+            } else if (p[i] < 0.0) {
+                t0 = std::max(t0, q[i] / p[i]);
+            } else {
+                t1 = std::min(t1, q[i] / p[i]);
+            }
+        }
+        if (inside && t0 <= t1) {
+            return 0.0;
+        }
+        auto pointDistance = [&](Vec v) {
+            return std::hypot(std::max(std::abs(v.x) - halfWidth, 0.0), std::max(std::abs(v.y) - halfHeight, 0.0));
+        };
+        const Vec corners[4] = {{-halfWidth, -halfHeight}, {halfWidth, -halfHeight}, {halfWidth, halfHeight}, {-halfWidth, halfHeight}};
+        double distance = std::min(pointDistance(a), pointDistance(b));
+        for (const Vec& corner : corners) {
+            distance = std::min(distance, pointSegmentDistance(corner, a, b));
+        }
+        return distance;
+    }
+
+    bool pointInPolygon(Vec p, PcbPointSpan polygon)
+    {
+        bool inside = false;
+        for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++) {
+            const Vec a = toVec(polygon[i]), b = toVec(polygon[j]);
+            if ((a.y > p.y) != (b.y > p.y) && p.x < (b.x - a.x) * (p.y - a.y) / (b.y - a.y) + a.x) {
+                inside = !inside;
+            }
+        }
+        return inside;
+    }
+
+    // The copper of one element. Tracks, vias and round or oval pads are
+    // capsules (a segment widened by a radius); other pads are rotated
+    // rectangles; zones are polygons.
+    struct Shape {
+        enum Kind { Capsule, Box, Polygon };
+
+        Kind kind = Capsule;
+        PcbItemRef item;
+        PcbLayerSet layers = 0;
+        PcbBox box;
+        Vec a, b;          // Capsule segment, or box centre in a
+        double radius = 0; // Capsule radius
+        double halfWidth = 0, halfHeight = 0, cosAngle = 1, sinAngle = 0;
+        PcbPointSpan polygon;
+
+        // A point in the box's own frame, where it is axis-aligned at the origin.
+        Vec ToLocal(Vec p) const
+        {
+            const double x = p.x - a.x, y = p.y - a.y;
+            return {x * cosAngle + y * sinAngle, -x * sinAngle + y * cosAngle};
+        }
+
+        Vec Corner(int i) const
+        {
+            const double x = (i == 1 || i == 2) ? halfWidth : -halfWidth;
+            const double y = (i >= 2) ? halfHeight : -halfHeight;
+            return {a.x + x * cosAngle - y * sinAngle, a.y + x * sinAngle + y * cosAngle};
+        }
+    };
+
+    Shape lineShape(const PcbData& data, uint32_t index)
+    {
+        const PcbLine line = data.GetLines()[index];
+        Shape shape;
+        shape.item = {PcbItemKind::Line, index};
+        shape.layers = LayerBit(line.layer);
+        shape.a = toVec(line.start);
+        shape.b = toVec(line.end);
+        shape.radius = line.width / 2.0;
+        return shape;
+    }
+
+    Shape viaShape(const PcbData& data, uint32_t index)
+    {
+        const PcbVia via = data.GetVias()[index];
+        Shape shape;
+        shape.item = {PcbItemKind::Via, index};
+        shape.layers = via.layers | LayerBit(via.fromLayer) | LayerBit(via.toLayer);
+        shape.a = shape.b = toVec(via.pos);
+        shape.radius = via.size / 2.0;
+        return shape;
+    }
+
+    Shape padShape(const PcbData& data, uint32_t index)
+    {
+        const PcbPad pad = data.GetPads()[index];
+        Shape shape;
+        shape.item = {PcbItemKind::Pad, index};
+        // Only copper connects; the paste and mask layers in the pad's set don't.
+        shape.layers = (pad.layers | LayerBit(pad.layer)) & data.GetCopperLayers();
+        const double angle = pad.rotation * DegreesToRadians;
+        const double cosAngle = std::cos(angle), sinAngle = std::sin(angle);
+        const Vec centre = toVec(pad.pos);
+        if (pad.shape == PcbPadShape::Circle || pad.shape == PcbPadShape::Oval) {
+            // An oval is a capsule along its longer side.
+            const bool wide = pad.size.x >= pad.size.y;
+            const double reach = std::abs(pad.size.x - pad.size.y) / 2.0;
+            const Vec axis = wide ? Vec{cosAngle, sinAngle} : Vec{-sinAngle, cosAngle};
+            shape.a = {centre.x - axis.x * reach, centre.y - axis.y * reach};
+            shape.b = {centre.x + axis.x * reach, centre.y + axis.y * reach};
+            shape.radius = std::min(pad.size.x, pad.size.y) / 2.0;
+        } else {
+            shape.kind = Shape::Box;
+            shape.a = centre;
+            shape.halfWidth = pad.size.x / 2.0;
+            shape.halfHeight = pad.size.y / 2.0;
+            shape.cosAngle = cosAngle;
+            shape.sinAngle = sinAngle;
+        }
+        return shape;
+    }
+
+    Shape zoneShape(const PcbData& data, uint32_t index)
+    {
+        const PcbZone zone = data.GetZones()[index];
+        Shape shape;
+        shape.kind = Shape::Polygon;
+        shape.item = {PcbItemKind::Zone, index};
+        shape.layers = LayerBit(zone.layer);
+        shape.polygon = zone.polygon;
+        return shape;
+    }
+
+    PcbBox boundsOf(const Shape& shape)
+    {
+        PcbBox box;
+        auto add = [&box](Vec p, double margin) {
+            box.Union(static_cast<PcbCoord>(std::floor(p.x - margin)), static_cast<PcbCoord>(std::floor(p.y - margin)),
+                      static_cast<PcbCoord>(std::ceil(p.x + margin)), static_cast<PcbCoord>(std::ceil(p.y + margin)));
+        };
+        switch (shape.kind) {
+            case Shape::Capsule:
+                add(shape.a, shape.radius + ContactTolerance);
+                add(shape.b, shape.radius + ContactTolerance);
+                break;
+            case Shape::Box:
+                for (int i = 0; i < 4; ++i) {
+                    add(shape.Corner(i), ContactTolerance);
+                }
+                break;
+            case Shape::Polygon:
+                for (const PcbPoint& pt : shape.polygon) {
+                    add(toVec(pt), ContactTolerance);
+                }
+                break;
+        }
+        return box;
+    }
+
+    bool touchesPolygon(const Shape& zone, const Shape& other)
+    {
+        if (zone.polygon.size() < 3) {
+            return false;
+        }
+        switch (other.kind) {
+            case Shape::Capsule:
+                if (pointInPolygon(other.a, zone.polygon) || pointInPolygon(other.b, zone.polygon)) {
+                    return true;
+                }
+                for (size_t i = 0, j = zone.polygon.size() - 1; i < zone.polygon.size(); j = i++) {
+                    if (segmentDistance(other.a, other.b, toVec(zone.polygon[j]), toVec(zone.polygon[i])) <= other.radius + ContactTolerance) {
+                        return true;
+                    }
+                }
+                return false;
+            case Shape::Box:
+                if (pointInPolygon(other.a, zone.polygon)) {
+                    return true;
+                }
+                for (size_t i = 0, j = zone.polygon.size() - 1; i < zone.polygon.size(); j = i++) {
+                    if (segmentBoxDistance(other.ToLocal(toVec(zone.polygon[j])), other.ToLocal(toVec(zone.polygon[i])),
+                                           other.halfWidth, other.halfHeight) <= ContactTolerance) {
+                        return true;
+                    }
+                }
+                return false;
+            case Shape::Polygon:
+                for (const PcbPoint& pt : other.polygon) {
+                    if (pointInPolygon(toVec(pt), zone.polygon)) {
+                        return true;
+                    }
+                }
+                return !zone.polygon.empty() && other.polygon.size() >= 3 && pointInPolygon(toVec(zone.polygon[0]), other.polygon);
+        }
+        return false;
+    }
+
+    bool touches(const Shape& first, const Shape& second)
+    {
+        if (first.kind == Shape::Polygon) {
+            return touchesPolygon(first, second);
+        }
+        if (second.kind == Shape::Polygon) {
+            return touchesPolygon(second, first);
+        }
+        if (first.kind == Shape::Capsule && second.kind == Shape::Capsule) {
+            return segmentDistance(first.a, first.b, second.a, second.b) <= first.radius + second.radius + ContactTolerance;
+        }
+        if (first.kind == Shape::Box && second.kind == Shape::Box) {
+            // Overlapping rectangles either cross edges or one holds the other's centre.
+            for (int i = 0; i < 4; ++i) {
+                if (segmentBoxDistance(first.ToLocal(second.Corner(i)), first.ToLocal(second.Corner((i + 1) % 4)),
+                                       first.halfWidth, first.halfHeight) <= ContactTolerance) {
+                    return true;
+                }
+            }
+            return segmentBoxDistance(second.ToLocal(first.a), second.ToLocal(first.a), second.halfWidth, second.halfHeight) <= ContactTolerance;
+        }
+        const Shape& box = first.kind == Shape::Box ? first : second;
+        const Shape& capsule = first.kind == Shape::Box ? second : first;
+        return segmentBoxDistance(box.ToLocal(capsule.a), box.ToLocal(capsule.b), box.halfWidth, box.halfHeight) <= capsule.radius + ContactTolerance;
+    }
+
+    class UnionFind {
+    public:
+        explicit UnionFind(size_t size) : m_parent(size)
+        {
+            std::iota(m_parent.begin(), m_parent.end(), 0);
+        }
+
+        uint32_t Find(uint32_t i)
+        {
+            while (m_parent[i] != i) {
+                m_parent[i] = m_parent[m_parent[i]];
+                i = m_parent[i];
+            }
+            return i;
+        }
+
+        bool Unite(uint32_t a, uint32_t b)
+        {
+            a = Find(a);
+            b = Find(b);
+            if (a == b) {
+                return false;
+            }
+            m_parent[std::max(a, b)] = std::min(a, b);
+            return true;
+        }
+
+    private:
+        std::vector<uint32_t> m_parent;
+    };
+
+    // A point the ratsnest may start or end at: a pad or via centre, or a
+    // track end.
+    struct Anchor {
+        Vec pos;
+        PcbPoint point;
+        PcbItemRef item;
+        uint32_t island = 0;
+    };
+
+    // Edges of the Delaunay triangulation of points sorted by x, with no
+    // two points equal. Uses Bowyer-Watson insertion; triangles whose
+    // circumcircle lies wholly left of the sweep can't change any more and
+    // are set aside, which keeps the working set small.
+    std::vector<std::pair<uint32_t, uint32_t>> delaunayEdges(const std::vector<Vec>& points)
+    {
+        struct Triangle {
+            uint32_t v[3];
+            Vec centre;
+            double radiusSquared;
+        };
+
+        const uint32_t count = static_cast<uint32_t>(points.size());
+        std::vector<Vec> vertices = points;
+        double minX = vertices[0].x, maxX = minX, minY = vertices[0].y, maxY = minY;
+        for (const Vec& p : vertices) {
+            minX = std::min(minX, p.x);
+            maxX = std::max(maxX, p.x);
+            minY = std::min(minY, p.y);
+            maxY = std::max(maxY, p.y);
+        }
+        // Work relative to the centre so the circumcircles stay precise.
+        const Vec mid{(minX + maxX) / 2, (minY + maxY) / 2};
+        const double extent = std::max({maxX - minX, maxY - minY, 1.0});
+        for (Vec& p : vertices) {
+            p = {(p.x - mid.x) / extent, (p.y - mid.y) / extent};
+        }
+        vertices.push_back({-20.0, -10.0});
+        vertices.push_back({0.0, 20.0});
+        vertices.push_back({20.0, -10.0});
+
+        auto makeTriangle = [&vertices](uint32_t a, uint32_t b, uint32_t c) {
+            Triangle t{{a, b, c}, {}, std::numeric_limits<double>::infinity()};
+            const Vec& p = vertices[a];
+            const Vec& q = vertices[b];
+            const Vec& r = vertices[c];
+            const double d = 2 * (p.x * (q.y - r.y) + q.x * (r.y - p.y) + r.x * (p.y - q.y));
+            if (std::abs(d) > 1e-18) {
+                const double p2 = p.x * p.x + p.y * p.y, q2 = q.x * q.x + q.y * q.y, r2 = r.x * r.x + r.y * r.y;
+                t.centre = {(p2 * (q.y - r.y) + q2 * (r.y - p.y) + r2 * (p.y - q.y)) / d,
+                            (p2 * (r.x - q.x) + q2 * (p.x - r.x) + r2 * (q.x - p.x)) / d};
+                t.radiusSquared = distanceSquared(t.centre, p);
+            }
+            // A degenerate triangle has an infinite circumcircle and is
+            // replaced by the next point inserted.
+            return t;
+        };
+
+        std::vector<Triangle> open{makeTriangle(count, count + 1, count + 2)};
+        std::vector<Triangle> closed;
+        std::vector<std::pair<uint32_t, uint32_t>> boundary;
+        for (uint32_t i = 0; i < count; ++i) {
+            const Vec& p = vertices[i];
+            boundary.clear();
+            for (size_t t = 0; t < open.size();) {
+                const Triangle& triangle = open[t];
+                const double dx = p.x - triangle.centre.x;
+                if (dx > 0 && dx * dx > triangle.radiusSquared) {
+                    closed.push_back(triangle);
+                } else if (distanceSquared(p, triangle.centre) <= triangle.radiusSquared) {
+                    for (int e = 0; e < 3; ++e) {
+                        const uint32_t a = triangle.v[e], b = triangle.v[(e + 1) % 3];
+                        boundary.emplace_back(std::min(a, b), std::max(a, b));
+                    }
+                } else {
+                    ++t;
+                    continue;
+                }
+                open[t] = open.back();
+                open.pop_back();
+            }
+            // Edges shared by two removed triangles are inside the cavity.
+            std::sort(boundary.begin(), boundary.end());
+            for (size_t e = 0; e < boundary.size(); ++e) {
+                if (e + 1 < boundary.size() && boundary[e] == boundary[e + 1]) {
+                    while (e + 1 < boundary.size() && boundary[e] == boundary[e + 1]) {
+                        ++e;
+                    }
+                    continue;
+                }
+                open.push_back(makeTriangle(boundary[e].first, boundary[e].second, i));
+            }
+        }
+
+        std::vector<std::pair<uint32_t, uint32_t>> edges;
+        auto addEdges = [&](const Triangle& triangle) {
+            for (int e = 0; e < 3; ++e) {
+                const uint32_t a = triangle.v[e], b = triangle.v[(e + 1) % 3];
+                // Edges to the super-triangle's corners are dropped; edges
+                // between real points of its triangles are kept, which is
+                // what connects collinear points.
+                if (a < count && b < count) {
+                    edges.emplace_back(std::min(a, b), std::max(a, b));
+                }
+            }
+        };
+        std::for_each(open.begin(), open.end(), addEdges);
+        std::for_each(closed.begin(), closed.end(), addEdges);
+        std::sort(edges.begin(), edges.end());
+        edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+        return edges;
+    }
+
+    // Candidate ratsnest edges between anchors of different islands.
+    std::vector<std::pair<uint32_t, uint32_t>> candidateEdges(const std::vector<Anchor>& anchors)
+    {
+        std::vector<std::pair<uint32_t, uint32_t>> edges;
+        const uint32_t count = static_cast<uint32_t>(anchors.size());
+        if (anchors.size() <= DelaunayThreshold) {
+            for (uint32_t i = 0; i < count; ++i) {
+                for (uint32_t j = i + 1; j < count; ++j) {
+                    if (anchors[i].island != anchors[j].island) {
+                        edges.emplace_back(i, j);
+                    }
+                }
+            }
+            return edges;
+        }
+
+        // Triangulate the distinct positions; anchors at the same spot as
+        // another are joined to it directly.
+        std::vector<uint32_t> order(count);
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&anchors](uint32_t a, uint32_t b) {
+            return std::make_pair(anchors[a].pos.x, anchors[a].pos.y) < std::make_pair(anchors[b].pos.x, anchors[b].pos.y);
+        });
+        std::vector<Vec> points;
+        std::vector<uint32_t> pointAnchors;
+        for (uint32_t i : order) {
+            if (!points.empty() && points.back().x == anchors[i].pos.x && points.back().y == anchors[i].pos.y) {
+                if (anchors[pointAnchors.back()].island != anchors[i].island) {
+                    edges.emplace_back(pointAnchors.back(), i);
+                }
+                continue;
+            }
+            points.push_back(anchors[i].pos);
+            pointAnchors.push_back(i);
+        }
+        if (points.size() > 1) {
+            for (const auto& edge : delaunayEdges(points)) {
+                const uint32_t a = pointAnchors[edge.first], b = pointAnchors[edge.second];
+                if (anchors[a].island != anchors[b].island) {
+                    edges.emplace_back(a, b);
+                }
+            }
+        }
+        return edges;
+    }
+
+    // Joins islands with the shortest candidate edges (Kruskal). Returns the
+    // number of islands still apart.
+    size_t spanIslands(const std::vector<Anchor>& anchors, std::vector<std::pair<uint32_t, uint32_t>> edges,
+                       UnionFind& islands, size_t islandsApart, int netIndex, std::vector<PcbConnection>& connections)
+    {
+        auto length = [&anchors](const std::pair<uint32_t, uint32_t>& edge) {
+            return distanceSquared(anchors[edge.first].pos, anchors[edge.second].pos);
+        };
+        std::sort(edges.begin(), edges.end(), [&length](const auto& a, const auto& b) {
+            const double la = length(a), lb = length(b);
+            return la != lb ? la < lb : a < b;
+        });
+        for (const auto& edge : edges) {
+            if (islandsApart <= 1) {
+                break;
+            }
+            const Anchor& from = anchors[edge.first];
+            const Anchor& to = anchors[edge.second];
+            if (islands.Unite(from.island, to.island)) {
+                connections.push_back({netIndex, from.item, to.item, from.point, to.point, std::sqrt(length(edge))});
+                --islandsApart;
+            }
+        }
+        return islandsApart;
+    }
+
+    struct NetWork {
+        int islandCount = 0;
+        std::vector<std::pair<PcbItemRef, int>> islands;
+        std::vector<PcbConnection> connections;
+    };
+
+    void connectNet(const PcbData& data, int netIndex, const std::vector<uint32_t>& zones, NetWork& work)
+    {
+        std::vector<Shape> shapes;
+        for (uint32_t i : data.GetNetPads(netIndex)) shapes.push_back(padShape(data, i));
+        for (uint32_t i : data.GetNetLines(netIndex)) shapes.push_back(lineShape(data, i));
+        for (uint32_t i : data.GetNetVias(netIndex)) shapes.push_back(viaShape(data, i));
+        for (uint32_t i : zones) shapes.push_back(zoneShape(data, i));
+        for (Shape& shape : shapes) {
+            shape.box = boundsOf(shape);
+        }
+
+        // Sweep along x: only elements whose x extents overlap are compared.
+        const uint32_t count = static_cast<uint32_t>(shapes.size());
+        std::vector<uint32_t> order(count);
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&shapes](uint32_t a, uint32_t b) { return shapes[a].box.minX < shapes[b].box.minX; });
+        UnionFind copper(count);
+        for (uint32_t i = 0; i < count; ++i) {
+            const Shape& first = shapes[order[i]];
+            for (uint32_t j = i + 1; j < count && shapes[order[j]].box.minX <= first.box.maxX; ++j) {
+                const Shape& second = shapes[order[j]];
+                if ((first.layers & second.layers) && first.box.minY <= second.box.maxY && second.box.minY <= first.box.maxY &&
+                    copper.Find(order[i]) != copper.Find(order[j]) && touches(first, second)) {
+                    copper.Unite(order[i], order[j]);
+                }
+            }
+        }
+
+        // Number the islands, those with pads first. Pads come first in
+        // shapes, so their roots are seen before any other.
+        std::vector<int> islandOfRoot(count, -1);
+        int islandCount = 0;
+        for (int pass = 0; pass < 2; ++pass) {
+            for (uint32_t i = 0; i < count; ++i) {
+                const uint32_t root = copper.Find(i);
+                const bool hasPad = shapes[i].item.kind == PcbItemKind::Pad;
+                if (islandOfRoot[root] < 0 && hasPad == (pass == 0)) {
+                    islandOfRoot[root] = islandCount++;
+                }
+            }
+            if (pass == 0) {
+                work.islandCount = islandCount;
+            }
+        }
+        work.islands.reserve(count);
+        for (uint32_t i = 0; i < count; ++i) {
+            work.islands.emplace_back(shapes[i].item, islandOfRoot[copper.Find(i)]);
+        }
+        if (work.islandCount <= 1) {
+            return;
+        }
+
+        std::vector<Anchor> anchors;
+        for (uint32_t i = 0; i < count; ++i) {
+            const int island = islandOfRoot[copper.Find(i)];
+            if (island >= work.islandCount || shapes[i].kind == Shape::Polygon) {
+                continue;
+            }
+            auto addAnchor = [&](PcbPoint point) {
+                anchors.push_back({toVec(point), point, shapes[i].item, static_cast<uint32_t>(island)});
+            };
+            switch (shapes[i].item.kind) {
+                case PcbItemKind::Pad: addAnchor(data.GetPads()[shapes[i].item.index].pos); break;
+                case PcbItemKind::Via: addAnchor(data.GetVias()[shapes[i].item.index].pos); break;
+                case PcbItemKind::Line:
+                    addAnchor(data.GetLines()[shapes[i].item.index].start);
+                    addAnchor(data.GetLines()[shapes[i].item.index].end);
+                    break;
+                case PcbItemKind::Zone: break;
+            }
+        }
+
+        UnionFind islands(work.islandCount);
+        size_t islandsApart = spanIslands(anchors, candidateEdges(anchors), islands, work.islandCount, netIndex, work.connections);
+        if (islandsApart > 1) {
+            // Only reachable if rounding broke the triangulation; compare every pair.
+            std::vector<std::pair<uint32_t, uint32_t>> edges;
+            for (uint32_t i = 0; i < anchors.size(); ++i) {
+                for (uint32_t j = i + 1; j < anchors.size(); ++j) {
+                    if (islands.Find(anchors[i].island) != islands.Find(anchors[j].island)) {
+                        edges.emplace_back(i, j);
+                    }
+                }
+            }
+            spanIslands(anchors, std::move(edges), islands, islandsApart, netIndex, work.connections);
+        }
+    }
+}
+
+void Connectivity::Clear()
+{
+    m_nets.clear();
+    m_connections.clear();
+    m_lineIslands.clear();
+    m_padIslands.clear();
+    m_viaIslands.clear();
+    m_zoneIslands.clear();
+}
+
+void Connectivity::Build(const PcbData& data, const std::vector<int>& netIndices)
+{
+    Clear();
+    const int netCount = static_cast<int>(data.GetNets().size());
+    std::vector<int> nets;
+    for (int net : netIndices) {
+        if (net >= 0 && net < netCount) {
+            nets.push_back(net);
+        }
+    }
+    if (netIndices.empty()) {
+        nets.resize(netCount);
+        std::iota(nets.begin(), nets.end(), 0);
+    }
+
+    // Zones aren't part of the per-net lists; group them here.
+    std::vector<std::vector<uint32_t>> zonesByNet(netCount);
+    for (uint32_t i = 0; i < data.GetZones().size(); ++i) {
+        const int net = data.GetNetIndex(data.GetZones()[i].netId);
+        if (net >= 0) {
+            zonesByNet[net].push_back(i);
+        }
+    }
+
+    // Each worker takes the next net; a net's results go to its own slot.
+    std::vector<NetWork> work(nets.size());
+    std::atomic<size_t> nextNet{0};
+    auto worker = [&]() {
+        size_t i;
+        while ((i = nextNet.fetch_add(1)) < nets.size()) {
+            connectNet(data, nets[i], zonesByNet[nets[i]], work[i]);
+        }
+    };
+    unsigned threadCount = m_threadCount ? m_threadCount : std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::thread> threads;
+    for (unsigned i = 1; i < std::min<size_t>(threadCount, nets.size()); ++i) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    m_nets.assign(netCount, {});
+    m_lineIslands.assign(data.GetLines().size(), -1);
+    m_padIslands.assign(data.GetPads().size(), -1);
+    m_viaIslands.assign(data.GetVias().size(), -1);
+    m_zoneIslands.assign(data.GetZones().size(), -1);
+    for (size_t i = 0; i < nets.size(); ++i) {
+        NetResult& net = m_nets[nets[i]];
+        net.islandCount = work[i].islandCount;
+        net.firstConnection = m_connections.size();
+        net.connectionCount = work[i].connections.size();
+        m_connections.insert(m_connections.end(), work[i].connections.begin(), work[i].connections.end());
+        for (const auto& [item, island] : work[i].islands) {
+            switch (item.kind) {
+                case PcbItemKind::Line: m_lineIslands[item.index] = island; break;
+                case PcbItemKind::Pad: m_padIslands[item.index] = island; break;
+                case PcbItemKind::Via: m_viaIslands[item.index] = island; break;
+                case PcbItemKind::Zone: m_zoneIslands[item.index] = island; break;
+            }
+        }
+    }
+}
+
+PcbSpan<PcbConnection> Connectivity::GetNetConnections(int netIndex) const
+{
+    if (netIndex < 0 || netIndex >= static_cast<int>(m_nets.size())) {
+        return {};
+    }
+    const NetResult& net = m_nets[netIndex];
+    return PcbSpan<PcbConnection>(m_connections.data() + net.firstConnection, net.connectionCount);
+}
+
+int Connectivity::GetIslandCount(int netIndex) const
+{
+    if (netIndex < 0 || netIndex >= static_cast<int>(m_nets.size())) {
+        return -1;
+    }
+    return m_nets[netIndex].islandCount;
+}
+
+bool Connectivity::IsComplete(int netIndex) const
+{
+    const int islands = GetIslandCount(netIndex);
+    return islands == 0 || islands == 1;
+}
+
+int Connectivity::GetIsland(PcbItemRef item) const
+{
+    const std::vector<int>* islands = nullptr;
+    switch (item.kind) {
+        case PcbItemKind::Line: islands = &m_lineIslands; break;
+        case PcbItemKind::Pad: islands = &m_padIslands; break;
+        case PcbItemKind::Via: islands = &m_viaIslands; break;
+        case PcbItemKind::Zone: islands = &m_zoneIslands; break;
+    }
+    return item.index < islands->size() ? (*islands)[item.index] : -1;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "PcbData.h"
+#include "SpatialIndex.h"
+#include <vector>
+
+// Two elements of a net that the router still has to join, one in each of
+// two islands of copper that don't touch yet.
+struct PcbConnection {
+    int netIndex = -1;
+    PcbItemRef from;
+    PcbItemRef to;
+    PcbPoint fromPos;
+    PcbPoint toPos;
+    double length = 0.0; // Straight-line distance in board units
+};
+
+// Works out which pads, tracks, vias and zones of each net already touch,
+// grouping them into islands with a union-find, and the ratsnest: the
+// shortest set of connections (a minimum spanning tree over the islands)
+// that joins the rest. Copper that is already there is reused, so a net
+// whose pads are all joined needs no connections at all.
+//
+// Nets are independent and are processed in parallel. Small nets consider
+// every pair of islands; large ones only the edges of a Delaunay
+// triangulation of their anchor points, which contains the minimum
+// spanning tree.
+//
+// Zones count as filled outlines. Islands without a pad (stray tracks,
+// unconnected vias) get island numbers but take no part in the ratsnest.
+class Connectivity
+{
+public:
+    Connectivity() = default;
+
+    /**
+     * @brief Computes the islands and the ratsnest of some nets, replacing the current results.
+     * @param netIndices Indices into data.GetNets(); empty for every net.
+     *
+     * Uses the board's per-net element lists, so PcbData::BuildNetIndex()
+     * must be current.
+     */
+    void Build(const PcbData& data, const std::vector<int>& netIndices = {});
+    void Clear();
+
+    // Worker threads for Build(); 0 picks one per core.
+    void SetThreadCount(unsigned count) { m_threadCount = count; }
+
+    // Every connection still to route, grouped by net in the order given to
+    // Build() and shortest first within a net.
+    const std::vector<PcbConnection>& GetConnections() const { return m_connections; }
+    PcbSpan<PcbConnection> GetNetConnections(int netIndex) const;
+
+    // The number of islands on a net that contain a pad, or -1 if the net
+    // wasn't part of the last Build(). A net with one island is complete.
+    int GetIslandCount(int netIndex) const;
+    bool IsComplete(int netIndex) const;
+
+    // The island of an element within its net, or -1 if its net wasn't
+    // built. Islands with pads are numbered first, from 0.
+    int GetIsland(PcbItemRef item) const;
+
+private:
+    struct NetResult {
+        int islandCount = -1;
+        size_t firstConnection = 0;
+        size_t connectionCount = 0;
+    };
+
+    unsigned m_threadCount = 0;
+    std::vector<NetResult> m_nets; // By net index
+    std::vector<PcbConnection> m_connections;
+    std::vector<int> m_lineIslands;
+    std::vector<int> m_padIslands;
+    std::vector<int> m_viaIslands;
+    std::vector<int> m_zoneIslands;
+};
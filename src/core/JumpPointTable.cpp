@@ -0,0 +1,161 @@
+#include "JumpPointTable.h"
+#include <algorithm>
+#include <limits>
+
+namespace {
+    // RoutingGrid's moves, by direction.
+    const int MoveX[8] = {1, 1, 0, -1, -1, -1, 0, 1};
+    const int MoveY[8] = {0, 1, 1, 1, 0, -1, -1, -1};
+
+    constexpr int MaxDistance = std::numeric_limits<int16_t>::max();
+
+    int Turn(int dir, int eighths) { return (dir + eighths) & 7; }
+}
+
+bool JumpPointTable::Blocked(const float* cells, int x, int y) const
+{
+    return x < 0 || x >= m_width || y < 0 || y >= m_height ||
+           cells[static_cast<size_t>(y) * m_width + x] == std::numeric_limits<float>::infinity();
+}
+
+bool JumpPointTable::Forced(const float* cells, int x, int y, int dir) const
+{
+    // Arriving straight, a blocked cell beside this one makes the diagonal
+    // past it a forced neighbour. Arriving diagonally, a blocked cell
+    // behind on either side makes the diagonal turned back past it one.
+    const int side = (dir & 1) ? 3 : 2;
+    auto free = [&](int turn) { return !Blocked(cells, x + MoveX[Turn(dir, turn)], y + MoveY[Turn(dir, turn)]); };
+    return (!free(side) && free(side - 1)) || (!free(-side) && free(1 - side));
+}
+
+int16_t JumpPointTable::Compute(const float* cells, int x, int y, int dir) const
+{
+    const int nx = x + MoveX[dir];
+    const int ny = y + MoveY[dir];
+    if (Blocked(cells, nx, ny)) {
+        return 0;
+    }
+    const size_t next = static_cast<size_t>(ny) * m_width + nx;
+    bool jumpPoint = Forced(cells, nx, ny, dir);
+    if (!jumpPoint && (dir & 1)) {
+        // A diagonal stops where either of its straight parts would find one.
+        jumpPoint = Distance(next, Turn(dir, -1)) > 0 || Distance(next, Turn(dir, 1)) > 0;
+    }
+    const int previous = Distance(next, dir);
+    if (jumpPoint || previous >= MaxDistance || previous <= -MaxDistance) {
+        return 1;
+    }
+    return static_cast<int16_t>(previous > 0 ? previous + 1 : previous - 1);
+}
+
+void JumpPointTable::ComputeRow(const float* cells, int y)
+{
+    int16_t* row = m_distances.data() + static_cast<size_t>(y) * m_width * 8;
+    for (int x = m_width - 1; x >= 0; --x) {
+        row[x * 8 + 0] = Compute(cells, x, y, 0);
+    }
+    for (int x = 0; x < m_width; ++x) {
+        row[x * 8 + 4] = Compute(cells, x, y, 4);
+    }
+}
+
+void JumpPointTable::ComputeColumn(const float* cells, int x)
+{
+    for (int y = m_height - 1; y >= 0; --y) {
+        m_distances[(static_cast<size_t>(y) * m_width + x) * 8 + 2] = Compute(cells, x, y, 2);
+    }
+    for (int y = 0; y < m_height; ++y) {
+        m_distances[(static_cast<size_t>(y) * m_width + x) * 8 + 6] = Compute(cells, x, y, 6);
+    }
+}
+
+void JumpPointTable::Build(const float* cells, int width, int height)
+{
+    m_width = width;
+    m_height = height;
+    m_distances.assign(static_cast<size_t>(width) * height * 8, 0);
+
+    // Straight distances first; the diagonals are built on them. Each
+    // cell's distance comes from the next cell along, so rows are walked
+    // against the direction of travel.
+    for (int y = 0; y < m_height; ++y) {
+        ComputeRow(cells, y);
+    }
+    for (int x = 0; x < m_width; ++x) {
+        ComputeColumn(cells, x);
+    }
+    for (int dir = 1; dir < 8; dir += 2) {
+        const bool down = MoveY[dir] > 0;
+        for (int i = 0; i < m_height; ++i) {
+            const int y = down ? m_height - 1 - i : i;
+            int16_t* row = m_distances.data() + static_cast<size_t>(y) * m_width * 8;
+            for (int x = 0; x < m_width; ++x) {
+                row[x * 8 + dir] = Compute(cells, x, y, dir);
+            }
+        }
+    }
+}
+
+void JumpPointTable::Update(const float* cells, const std::vector<GridRect>& changed)
+{
+    // A cell's straight distances depend on its row or column and the ones
+    // beside it, so those are rebuilt whole.
+    std::vector<uint8_t> rows(m_height), columns(m_width);
+    for (const GridRect& rect : changed) {
+        for (int y = std::max(rect.y0 - 1, 0); y <= std::min(rect.y1 + 1, m_height - 1); ++y) {
+            rows[y] = 1;
+        }
+        for (int x = std::max(rect.x0 - 1, 0); x <= std::min(rect.x1 + 1, m_width - 1); ++x) {
+            columns[x] = 1;
+        }
+    }
+    for (int y = 0; y < m_height; ++y) {
+        if (rows[y]) ComputeRow(cells, y);
+    }
+    for (int x = 0; x < m_width; ++x) {
+        if (columns[x]) ComputeColumn(cells, x);
+    }
+
+    // A diagonal distance changes when the next cell along is in one of
+    // those rows or columns, or when the next cell's distance did. Each
+    // diagonal line through them is walked back from its last such cell
+    // until past the first and its distances no longer change.
+    const int lineCount = m_width + m_height - 1;
+    std::vector<int> first(lineCount), last(lineCount);
+    for (int dir = 1; dir < 8; dir += 2) {
+        const int mx = MoveX[dir], my = MoveY[dir];
+        // Cells on one line share x * my - y * mx; lines are indexed from
+        // the smallest value at a corner.
+        const int lowest = std::min({0, (m_width - 1) * my, -(m_height - 1) * mx, (m_width - 1) * my - (m_height - 1) * mx});
+        auto key = [&](int x, int y) { return x * my - y * mx - lowest; };
+        std::fill(first.begin(), first.end(), m_height);
+        std::fill(last.begin(), last.end(), -1);
+        auto mark = [&](int x, int y) {
+            const int line = key(x, y);
+            first[line] = std::min(first[line], y);
+            last[line] = std::max(last[line], y);
+        };
+        for (int y = 0; y < m_height; ++y) {
+            if (!rows[y]) continue;
+            for (int x = 0; x < m_width; ++x) mark(x, y);
+        }
+        for (int x = 0; x < m_width; ++x) {
+            if (!columns[x]) continue;
+            for (int y = 0; y < m_height; ++y) mark(x, y);
+        }
+
+        for (int line = 0; line < lineCount; ++line) {
+            if (last[line] < 0) continue;
+            // Start at the marked cell furthest along the direction.
+            int y = my > 0 ? last[line] : first[line];
+            int x = (line + lowest + y * mx) * my;
+            for (; x >= 0 && x < m_width && y >= 0 && y < m_height; x -= mx, y -= my) {
+                int16_t& distance = m_distances[(static_cast<size_t>(y) * m_width + x) * 8 + dir];
+                const int16_t updated = Compute(cells, x, y, dir);
+                const bool past = my > 0 ? y < first[line] : y > last[line];
+                if (past && updated == distance) break;
+                distance = updated;
+            }
+        }
+    }
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Open sets for RoutingGrid's searches. Costs are integers (a straight step
+// is 10, a diagonal 14), so besides the usual binary heap a monotone bucket
+// queue can be used: with a consistent heuristic the f of the node taken
+// next never decreases, and a node pushed while expanding one with f lies
+// in [f, f + 2 * largest step]. A ring of that many buckets gives O(1)
+// push and pop.
+//
+// Neither supports decrease-key; an improved cell is pushed again and its
+// older entries are dropped as stale when they come up (see SearchStats).
+// Both keep their storage between searches.
+
+enum class OpenListPolicy : uint8_t {
+    BinaryHeap,
+    Buckets,
+};
+
+struct OpenNode {
+    uint32_t f;    // Cost so far plus the heuristic
+    uint32_t g;    // Cost so far
+    uint32_t cell;
+};
+
+// Smallest f first; among equal f the deeper node, which is nearer the goal.
+class HeapOpenList
+{
+public:
+    void Reset(uint32_t /*maxStep*/) { m_nodes.clear(); }
+    bool Empty() const { return m_nodes.empty(); }
+    size_t Size() const { return m_nodes.size(); }
+
+    void Push(const OpenNode& node)
+    {
+        m_nodes.push_back(node);
+        std::push_heap(m_nodes.begin(), m_nodes.end(), Later);
+    }
+
+    OpenNode Pop()
+    {
+        std::pop_heap(m_nodes.begin(), m_nodes.end(), Later);
+        const OpenNode node = m_nodes.back();
+        m_nodes.pop_back();
+        return node;
+    }
+
+private:
+    static bool Later(const OpenNode& a, const OpenNode& b)
+    {
+        return a.f > b.f || (a.f == b.f && a.g < b.g);
+    }
+
+    std::vector<OpenNode> m_nodes;
+};
+
+// Buckets by f in a ring; within a bucket the last node pushed comes out
+// first, which also favours the deeper nodes.
+class BucketOpenList
+{
+public:
+    // maxStep is the largest cost of a single move.
+    void Reset(uint32_t maxStep)
+    {
+        size_t count = 1;
+        while (count < 2 * static_cast<size_t>(maxStep) + 1) {
+            count <<= 1;
+        }
+        if (m_buckets.size() < count) {
+            m_buckets.resize(count);
+        }
+        for (auto& bucket : m_buckets) {
+            bucket.clear();
+        }
+        m_mask = count - 1;
+        m_size = 0;
+        m_f = 0;
+    }
+
+    bool Empty() const { return m_size == 0; }
+    size_t Size() const { return m_size; }
+
+    void Push(const OpenNode& node)
+    {
+        // Once the ring has run dry (as it does after the start node is
+        // taken) it restarts at the smallest f pushed.
+        if (m_size == 0 || node.f < m_f) {
+            m_f = node.f;
+        }
+        m_buckets[node.f & m_mask].push_back(node);
+        m_size++;
+    }
+
+    OpenNode Pop()
+    {
+        while (m_buckets[m_f & m_mask].empty()) {
+            m_f++;
+        }
+        std::vector<OpenNode>& bucket = m_buckets[m_f & m_mask];
+        const OpenNode node = bucket.back();
+        bucket.pop_back();
+        m_size--;
+        return node;
+    }
+
+private:
+    std::vector<std::vector<OpenNode>> m_buckets;
+    size_t m_mask = 0;
+    size_t m_size = 0;
+    uint32_t m_f = 0; // f of the bucket being emptied
+};
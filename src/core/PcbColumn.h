@@ -0,0 +1,167 @@
+#ifndef PCB_COLUMN_H
+#define PCB_COLUMN_H
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+// One field of every element of a kind, stored as fixed-size chunks that
+// are shared between copies. Copying a column copies only the chunk
+// pointers; writing through Mutable() first gives the column its own copy
+// of the one chunk being written, if another column still shares it.
+//
+// A column that other threads read through a published PcbData version
+// must not be written; edit a copy instead (see PcbDataVersions).
+template <typename T>
+class PcbColumn {
+public:
+    static constexpr size_t ChunkShift = 12;
+    static constexpr size_t ChunkSize = size_t(1) << ChunkShift;
+
+    using value_type = T;
+
+    class const_iterator {
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        const_iterator() = default;
+        const_iterator(const PcbColumn* column, size_t index) : m_column(column), m_index(index) {}
+
+        reference operator*() const { return (*m_column)[m_index]; }
+        reference operator[](difference_type n) const { return (*m_column)[m_index + n]; }
+        const_iterator& operator++() { ++m_index; return *this; }
+        const_iterator operator++(int) { const_iterator old = *this; ++m_index; return old; }
+        const_iterator& operator--() { --m_index; return *this; }
+        const_iterator operator--(int) { const_iterator old = *this; --m_index; return old; }
+        const_iterator& operator+=(difference_type n) { m_index += n; return *this; }
+        const_iterator& operator-=(difference_type n) { m_index -= n; return *this; }
+        const_iterator operator+(difference_type n) const { return const_iterator(m_column, m_index + n); }
+        const_iterator operator-(difference_type n) const { return const_iterator(m_column, m_index - n); }
+        difference_type operator-(const const_iterator& other) const { return difference_type(m_index) - difference_type(other.m_index); }
+        bool operator==(const const_iterator& other) const { return m_index == other.m_index; }
+        bool operator!=(const const_iterator& other) const { return m_index != other.m_index; }
+        bool operator<(const const_iterator& other) const { return m_index < other.m_index; }
+
+    private:
+        const PcbColumn* m_column = nullptr;
+        size_t m_index = 0;
+    };
+
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+
+    const T& operator[](size_t index) const { return (*m_chunks[index >> ChunkShift])[index & (ChunkSize - 1)]; }
+
+    // A writable reference, after unsharing the element's chunk.
+    T& Mutable(size_t index) { return MutableChunk(index >> ChunkShift)[index & (ChunkSize - 1)]; }
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, m_size); }
+
+    void push_back(const T& value)
+    {
+        if ((m_size & (ChunkSize - 1)) == 0) {
+            m_chunks.push_back(NewChunk());
+        }
+        MutableChunk(m_chunks.size() - 1).push_back(value);
+        ++m_size;
+    }
+
+    template <typename Iterator>
+    void append(Iterator first, Iterator last)
+    {
+        for (; first != last; ++first) {
+            push_back(*first);
+        }
+    }
+
+    void resize(size_t count, const T& value = T())
+    {
+        const size_t chunkCount = (count + ChunkSize - 1) >> ChunkShift;
+        m_chunks.resize(chunkCount);
+        for (size_t k = 0; k < chunkCount; ++k) {
+            const size_t length = std::min(ChunkSize, count - (k << ChunkShift));
+            if (!m_chunks[k]) {
+                m_chunks[k] = NewChunk();
+            }
+            if (m_chunks[k]->size() != length) {
+                MutableChunk(k).resize(length, value);
+            }
+        }
+        m_size = count;
+    }
+
+    void clear()
+    {
+        m_chunks.clear();
+        m_size = 0;
+    }
+
+    // The chunks as contiguous runs, for bulk reads and writes and for
+    // loops that need to run at array speed. Columns of the same length
+    // have the same chunk boundaries, so one loop can walk several.
+    size_t ChunkCount() const { return m_chunks.size(); }
+    const T* ChunkData(size_t chunk) const { return m_chunks[chunk]->data(); }
+    T* MutableChunkData(size_t chunk) { return MutableChunk(chunk).data(); }
+    size_t ChunkLength(size_t chunk) const { return m_chunks[chunk]->size(); }
+
+private:
+    using Chunk = std::vector<T>;
+
+    static std::shared_ptr<Chunk> NewChunk()
+    {
+        auto chunk = std::make_shared<Chunk>();
+        chunk->reserve(ChunkSize);
+        return chunk;
+    }
+
+    Chunk& MutableChunk(size_t chunk)
+    {
+        std::shared_ptr<Chunk>& shared = m_chunks[chunk];
+        if (shared.use_count() > 1) {
+            auto copy = NewChunk();
+            copy->assign(shared->begin(), shared->end());
+            shared = std::move(copy);
+        }
+        return *shared;
+    }
+
+    std::vector<std::shared_ptr<Chunk>> m_chunks;
+    size_t m_size = 0;
+};
+
+// A whole table shared between copies the same way, for tables a board
+// rarely changes once loaded (its nets, its footprint definitions). Copying
+// one copies a pointer; the first write through Mutable() after a copy
+// gives this copy its own table. The same rule about published versions
+// applies.
+template <typename T>
+class PcbShared {
+public:
+    PcbShared() : m_value(std::make_shared<T>()) {}
+
+    const T& operator*() const { return *m_value; }
+    const T* operator->() const { return m_value.get(); }
+
+    T& Mutable()
+    {
+        if (m_value.use_count() > 1) {
+            m_value = std::make_shared<T>(*m_value);
+        }
+        return *m_value;
+    }
+
+    // Replaces the table without copying the old one.
+    void Assign(T value) { m_value = std::make_shared<T>(std::move(value)); }
+
+private:
+    std::shared_ptr<T> m_value;
+};
+
+#endif // PCB_COLUMN_H
@@ -1,103 +1,653 @@
 #include "PcbData.h"
 #include <algorithm>
-#include <set>
+#include <cmath>
+#include <utility>
+
+namespace {
+    // Calls f on each column of a columns() tuple.
+    template <typename Tuple, typename F>
+    void forEachColumn(Tuple&& columns, F&& f)
+    {
+        std::apply([&](auto&... column) { (f(column), ...); }, columns);
+    }
+
+    // Calls f on matching columns of two columns() tuples.
+    template <typename TupleA, typename TupleB, typename F, size_t... I>
+    void zipColumns(TupleA&& a, TupleB&& b, F&& f, std::index_sequence<I...>)
+    {
+        (f(std::get<I>(a), std::get<I>(b)), ...);
+    }
+
+    template <typename TupleA, typename TupleB, typename F>
+    void zipColumns(TupleA&& a, TupleB&& b, F&& f)
+    {
+        zipColumns(a, b, f, std::make_index_sequence<std::tuple_size<std::decay_t<TupleA>>::value>());
+    }
+
+    // Compacts the column in one pass, keeping the survivors in order.
+    // Chunks before the first removed element stay shared.
+    template <typename T>
+    void eraseIndices(PcbColumn<T>& elements, const std::vector<size_t>& sortedIndices)
+    {
+        if (sortedIndices.empty()) {
+            return;
+        }
+        size_t out = sortedIndices.front();
+        size_t next = 0;
+        for (size_t in = out; in < elements.size(); ++in) {
+            if (next < sortedIndices.size() && sortedIndices[next] == in) {
+                ++next;
+                continue;
+            }
+            elements.Mutable(out++) = elements[in];
+        }
+        elements.resize(out);
+    }
+
+    // Rewrites the layer ids from 'first' onwards through a translation table.
+    void remapLayers(PcbColumn<PcbLayerId>& layers, size_t first, const std::vector<PcbLayerId>& table)
+    {
+        for (size_t i = first; i < layers.size(); ++i) {
+            if (layers[i] < table.size()) {
+                layers.Mutable(i) = table[layers[i]];
+            }
+        }
+    }
+
+    PcbLayerSet remapLayerSet(PcbLayerSet set, const std::vector<PcbLayerId>& table)
+    {
+        PcbLayerSet remapped = 0;
+        for (size_t layer = 0; layer < table.size() && layer < 64; ++layer) {
+            if (set & LayerBit(static_cast<PcbLayerId>(layer))) {
+                remapped |= LayerBit(table[layer]);
+            }
+        }
+        return remapped;
+    }
+
+    void remapLayerSets(PcbColumn<PcbLayerSet>& sets, size_t first, const std::vector<PcbLayerId>& table)
+    {
+        for (size_t i = first; i < sets.size(); ++i) {
+            sets.Mutable(i) = remapLayerSet(sets[i], table);
+        }
+    }
+
+    // --- Bounds of each element type, as straight loops over the columns ---
+
+    void unionBounds(PcbBox& box, const PcbLineColumns& lines)
+    {
+        const size_t count = lines.size();
+        if (count == 0) return;
+        PcbCoord minX = box.minX, minY = box.minY, maxX = box.maxX, maxY = box.maxY;
+        for (size_t chunk = 0; chunk < lines.startX.ChunkCount(); ++chunk) {
+            const PcbCoord* startX = lines.startX.ChunkData(chunk);
+            const PcbCoord* startY = lines.startY.ChunkData(chunk);
+            const PcbCoord* endX = lines.endX.ChunkData(chunk);
+            const PcbCoord* endY = lines.endY.ChunkData(chunk);
+            for (size_t i = 0; i < lines.startX.ChunkLength(chunk); ++i) {
+                minX = std::min(minX, std::min(startX[i], endX[i]));
+                maxX = std::max(maxX, std::max(startX[i], endX[i]));
+                minY = std::min(minY, std::min(startY[i], endY[i]));
+                maxY = std::max(maxY, std::max(startY[i], endY[i]));
+            }
+        }
+        box.Union(minX, minY, maxX, maxY);
+    }
+
+    void unionBounds(PcbBox& box, const PcbPad& pad)
+    {
+        box.Union(pad.pos.x - pad.size.x / 2, pad.pos.y - pad.size.y / 2,
+                  pad.pos.x + pad.size.x / 2, pad.pos.y + pad.size.y / 2);
+    }
+
+    void unionBounds(PcbBox& box, const PcbPadView& pads)
+    {
+        for (const PcbPad& pad : pads) {
+            unionBounds(box, pad);
+        }
+    }
+
+    void unionBounds(PcbBox& box, const PcbViaColumns& vias)
+    {
+        const size_t count = vias.size();
+        if (count == 0) return;
+        PcbCoord minX = box.minX, minY = box.minY, maxX = box.maxX, maxY = box.maxY;
+        for (size_t chunk = 0; chunk < vias.x.ChunkCount(); ++chunk) {
+            const PcbCoord* x = vias.x.ChunkData(chunk);
+            const PcbCoord* y = vias.y.ChunkData(chunk);
+            const PcbCoord* diameter = vias.diameter.ChunkData(chunk);
+            for (size_t i = 0; i < vias.x.ChunkLength(chunk); ++i) {
+                const PcbCoord radius = diameter[i] / 2;
+                minX = std::min(minX, x[i] - radius);
+                maxX = std::max(maxX, x[i] + radius);
+                minY = std::min(minY, y[i] - radius);
+                maxY = std::max(maxY, y[i] + radius);
+            }
+        }
+        box.Union(minX, minY, maxX, maxY);
+    }
+
+    void unionBounds(PcbBox& box, PcbPointSpan points)
+    {
+        for (const PcbPoint& pt : points) {
+            box.Union(pt.x, pt.y, pt.x, pt.y);
+        }
+    }
+
+    // The identity of a footprint definition for de-duplication: its name
+    // and the raw fields of its pads.
+    std::string footprintDefKey(const PcbFootprintDef& def)
+    {
+        std::string key = def.name;
+        key += '\0';
+        auto append = [&](const auto& value) { key.append(reinterpret_cast<const char*>(&value), sizeof(value)); };
+        for (const PcbPad& pad : def.pads) {
+            append(pad.pos.x);
+            append(pad.pos.y);
+            append(pad.size.x);
+            append(pad.size.y);
+            append(pad.shape);
+            append(pad.rotation);
+            append(pad.layer);
+            append(pad.layers);
+        }
+        return key;
+    }
+}
+
+PcbPoint RotatePoint(PcbPoint point, double degrees)
+{
+    double turns = std::fmod(degrees, 360.0);
+    if (turns < 0) turns += 360.0;
+    if (turns == 0.0) return point;
+    if (turns == 90.0) return {point.y, -point.x};
+    if (turns == 180.0) return {-point.x, -point.y};
+    if (turns == 270.0) return {-point.y, point.x};
+    const double radians = turns * (3.14159265358979323846 / 180.0);
+    const double c = std::cos(radians);
+    const double s = std::sin(radians);
+    return {static_cast<PcbCoord>(std::llround(point.x * c + point.y * s)),
+            static_cast<PcbCoord>(std::llround(point.y * c - point.x * s))};
+}
+
+PcbPad PcbPadView::operator[](size_t index) const
+{
+    const uint32_t footprint = m_pads->footprint[index];
+    PcbPad pad = GetDefPad(index);
+    const double rotation = m_footprints->rotation[footprint];
+    const PcbPoint offset = RotatePoint(pad.pos, rotation);
+    pad.pos = {m_footprints->x[footprint] + offset.x, m_footprints->y[footprint] + offset.y};
+    pad.rotation += rotation;
+    pad.netId = m_pads->netId[index];
+    return pad;
+}
+
+PcbPadShape PadShapeFromName(std::string_view name)
+{
+    if (name == "rect") return PcbPadShape::Rect;
+    if (name == "circle") return PcbPadShape::Circle;
+    if (name == "oval") return PcbPadShape::Oval;
+    if (name == "roundrect") return PcbPadShape::RoundRect;
+    if (name == "trapezoid") return PcbPadShape::Trapezoid;
+    return PcbPadShape::Custom;
+}
 
 void PcbData::Clear()
 {
-    m_lines.clear();
-    m_pads.clear();
-    m_vias.clear();
-    m_zones.clear();
-    m_nets.clear();
-    m_boundingBox = wxRect2DDouble();
+    *this = PcbData();
 }
 
 void PcbData::AddLine(const PcbLine& line)
 {
-    m_lines.push_back(line);
-    m_boundingBox.Union(line.start);
-    m_boundingBox.Union(line.end);
+    m_lines.startX.push_back(line.start.x);
+    m_lines.startY.push_back(line.start.y);
+    m_lines.endX.push_back(line.end.x);
+    m_lines.endY.push_back(line.end.y);
+    m_lines.width.push_back(line.width);
+    m_lines.layer.push_back(line.layer);
+    m_lines.netId.push_back(line.netId);
+    MarkLayerUsed(line.layer);
+    m_bounds.Union(std::min(line.start.x, line.end.x), std::min(line.start.y, line.end.y),
+                   std::max(line.start.x, line.end.x), std::max(line.start.y, line.end.y));
 }
 
 void PcbData::AddPad(const PcbPad& pad)
 {
-    m_pads.push_back(pad);
+    PcbFootprintDef def;
+    def.pads.push_back(pad);
+    def.pads.back().pos = PcbPoint();
+    def.pads.back().netId = -1;
+    PcbFootprint footprint;
+    footprint.def = AddFootprintDef(def);
+    footprint.pos = pad.pos;
+    const int32_t net = pad.netId;
+    AddFootprint(footprint, PcbSpan<int32_t>(&net, 1));
+}
+
+uint32_t PcbData::AddFootprintDef(const PcbFootprintDef& def)
+{
+    std::string key = footprintDefKey(def);
+    const auto found = m_footprintDefIndex->find(key);
+    if (found != m_footprintDefIndex->end()) {
+        return found->second;
+    }
+    const uint32_t index = static_cast<uint32_t>(m_footprintDefs->size());
+    m_footprintDefIndex.Mutable().emplace(std::move(key), index);
+    m_footprintDefs.Mutable().push_back(std::make_shared<const PcbFootprintDef>(def));
+    return index;
+}
 
-    // Update bounding box based on pad's geometry.
-    // wxRect2DDouble::Union handles being called on an uninitialized (default)
-    // rectangle correctly.
-    wxRect2DDouble padRect(pad.pos.m_x - pad.size.m_x / 2.0,
-                           pad.pos.m_y - pad.size.m_y / 2.0,
-                           pad.size.m_x,
-                           pad.size.m_y);
-    m_boundingBox.Union(padRect);
+void PcbData::AddFootprint(const PcbFootprint& footprint, PcbSpan<int32_t> padNets)
+{
+    const uint32_t index = static_cast<uint32_t>(m_footprints.size());
+    m_footprints.def.push_back(footprint.def);
+    m_footprints.x.push_back(footprint.pos.x);
+    m_footprints.y.push_back(footprint.pos.y);
+    m_footprints.rotation.push_back(footprint.rotation);
+    m_footprints.layer.push_back(footprint.layer);
+
+    const PcbFootprintDef& def = *(*m_footprintDefs)[footprint.def];
+    for (size_t i = 0; i < def.pads.size(); ++i) {
+        m_pads.footprint.push_back(index);
+        m_pads.defPad.push_back(static_cast<uint16_t>(i));
+        m_pads.netId.push_back(i < padNets.size() ? padNets[i] : -1);
+        PcbPad pad = def.pads[i];
+        const PcbPoint offset = RotatePoint(pad.pos, footprint.rotation);
+        pad.pos = {footprint.pos.x + offset.x, footprint.pos.y + offset.y};
+        MarkLayerUsed(pad.layer);
+        m_hasHoles |= pad.shape == PcbPadShape::NpThruHole;
+        unionBounds(m_bounds, pad);
+    }
 }
 
 void PcbData::AddVia(const PcbVia& via)
 {
-    m_vias.push_back(via);
-    m_boundingBox.Union(wxRect2DDouble(via.pos.m_x - via.size / 2.0,
-                                       via.pos.m_y - via.size / 2.0,
-                                       via.size, via.size));
+    m_vias.x.push_back(via.pos.x);
+    m_vias.y.push_back(via.pos.y);
+    m_vias.diameter.push_back(via.size);
+    m_vias.drill.push_back(via.drill);
+    m_vias.fromLayer.push_back(via.fromLayer);
+    m_vias.toLayer.push_back(via.toLayer);
+    m_vias.layers.push_back(via.layers);
+    m_vias.netId.push_back(via.netId);
+    m_bounds.Union(via.pos.x - via.size / 2, via.pos.y - via.size / 2,
+                   via.pos.x + via.size / 2, via.pos.y + via.size / 2);
 }
 
 void PcbData::AddZone(const PcbZone& zone)
 {
-    m_zones.push_back(zone);
-    // Update bounding box from polygon points
-    for (const auto& pt : zone.polygon) {
-        m_boundingBox.Union(pt);
+    m_zones.netId.push_back(zone.netId);
+    m_zones.layer.push_back(zone.layer);
+    MarkLayerUsed(zone.layer);
+    m_zones.firstPoint.push_back(static_cast<uint32_t>(m_zones.points->size()));
+    m_zones.pointCount.push_back(static_cast<uint32_t>(zone.polygon.size()));
+    m_zones.keepout.push_back(zone.keepout);
+    std::vector<PcbPoint>& points = m_zones.points.Mutable();
+    points.insert(points.end(), zone.polygon.begin(), zone.polygon.end());
+    unionBounds(m_bounds, zone.polygon);
+}
+
+PcbLayerId PcbData::AddLayer(const std::string& layerName)
+{
+    PcbLayer layer;
+    layer.name = layerName;
+    return AddLayer(layer);
+}
+
+PcbLayerId PcbData::AddLayer(const PcbLayer& layer)
+{
+    // Boards have a few dozen layers at most, so a scan beats hashing.
+    const PcbLayerId existing = GetLayerId(layer.name);
+    if (existing != PcbNoLayer) {
+        if (layer.number >= 0) {
+            m_layers[existing].number = layer.number;
+            m_layers[existing].type = layer.type;
+        }
+        return existing;
+    }
+    const PcbLayerId id = static_cast<PcbLayerId>(m_layers.size());
+    m_layers.push_back(layer);
+    m_layerUsed.push_back(false);
+    if (layer.IsCopper()) {
+        m_copperLayers |= LayerBit(id);
+    }
+    return id;
+}
+
+const std::string& PcbData::GetLayerName(PcbLayerId layer) const
+{
+    static const std::string noLayer;
+    return layer < m_layers.size() ? m_layers[layer].name : noLayer;
+}
+
+PcbLayerId PcbData::GetLayerId(const std::string& layerName) const
+{
+    for (size_t i = 0; i < m_layers.size(); ++i) {
+        if (m_layers[i].name == layerName) {
+            return static_cast<PcbLayerId>(i);
+        }
+    }
+    return PcbNoLayer;
+}
+
+PcbLayerSet PcbData::GetCopperSpan(PcbLayerId from, PcbLayerId to) const
+{
+    if (from > to) {
+        std::swap(from, to);
+    }
+    // Copper layers are listed in stack-up order, so the span is every
+    // copper layer between the two ids.
+    PcbLayerSet span = LayerBit(from) | LayerBit(to);
+    for (PcbLayerId layer = from; layer <= to && layer < m_layers.size(); ++layer) {
+        span |= LayerBit(layer) & m_copperLayers;
+    }
+    return span;
+}
+
+void PcbData::MarkLayerUsed(PcbLayerId layer)
+{
+    if (layer < m_layerUsed.size()) {
+        m_layerUsed[layer] = true;
+    }
+}
+
+void PcbData::RecomputeUsedLayers()
+{
+    m_layerUsed.assign(m_layers.size(), false);
+    for (PcbLayerId layer : m_lines.layer) MarkLayerUsed(layer);
+    for (PcbLayerId layer : m_zones.layer) MarkLayerUsed(layer);
+    m_hasHoles = false;
+    const PcbPadView pads = GetPads();
+    for (size_t i = 0; i < pads.size(); ++i) {
+        const PcbPad& pad = pads.GetDefPad(i);
+        MarkLayerUsed(pad.layer);
+        m_hasHoles |= pad.shape == PcbPadShape::NpThruHole;
+    }
+}
+
+void PcbData::Append(const PcbData& other)
+{
+    const size_t firstLine = m_lines.size();
+    const size_t firstPad = m_pads.size();
+    const size_t firstFootprint = m_footprints.size();
+    const size_t firstVia = m_vias.size();
+    const size_t firstZone = m_zones.size();
+    const uint32_t pointBase = static_cast<uint32_t>(m_zones.points->size());
+
+    auto appendColumn = [](auto& to, const auto& from) { to.append(from.begin(), from.end()); };
+    zipColumns(m_lines.columns(), other.m_lines.columns(), appendColumn);
+    zipColumns(m_pads.columns(), other.m_pads.columns(), appendColumn);
+    zipColumns(m_footprints.columns(), other.m_footprints.columns(), appendColumn);
+    for (size_t i = firstPad; i < m_pads.size(); ++i) {
+        m_pads.footprint.Mutable(i) += static_cast<uint32_t>(firstFootprint);
+    }
+    zipColumns(m_vias.columns(), other.m_vias.columns(), appendColumn);
+    zipColumns(m_zones.columns(), other.m_zones.columns(), appendColumn);
+    if (!other.m_zones.points->empty()) {
+        std::vector<PcbPoint>& points = m_zones.points.Mutable();
+        points.insert(points.end(), other.m_zones.points->begin(), other.m_zones.points->end());
+    }
+    for (size_t i = firstZone; i < m_zones.size(); ++i) {
+        m_zones.firstPoint.Mutable(i) += pointBase;
+    }
+
+    // The other table numbers its layers independently. Fragments of one
+    // board usually share a table, which needs no translation.
+    std::vector<PcbLayerId> layerTable;
+    bool sameTable = true;
+    for (size_t i = 0; i < other.m_layers.size(); ++i) {
+        layerTable.push_back(AddLayer(other.m_layers[i]));
+        sameTable &= layerTable.back() == i;
+        if (other.m_layerUsed[i]) {
+            m_layerUsed[layerTable.back()] = true;
+        }
+    }
+    m_hasHoles |= other.m_hasHoles;
+    if (!sameTable) {
+        remapLayers(m_lines.layer, firstLine, layerTable);
+        remapLayers(m_footprints.layer, firstFootprint, layerTable);
+        remapLayers(m_vias.fromLayer, firstVia, layerTable);
+        remapLayers(m_vias.toLayer, firstVia, layerTable);
+        remapLayerSets(m_vias.layers, firstVia, layerTable);
+        remapLayers(m_zones.layer, firstZone, layerTable);
+    }
+
+    // The other definitions join this table, translated into its layer
+    // numbering; equal ones merge.
+    std::vector<uint32_t> defTable;
+    for (const auto& shared : *other.m_footprintDefs) {
+        if (sameTable) {
+            defTable.push_back(AddFootprintDef(*shared));
+            continue;
+        }
+        PcbFootprintDef def = *shared;
+        for (PcbPad& pad : def.pads) {
+            if (pad.layer < layerTable.size()) pad.layer = layerTable[pad.layer];
+            pad.layers = remapLayerSet(pad.layers, layerTable);
+        }
+        defTable.push_back(AddFootprintDef(def));
+    }
+    for (size_t i = firstFootprint; i < m_footprints.size(); ++i) {
+        m_footprints.def.Mutable(i) = defTable[m_footprints.def[i]];
+    }
+
+    for (size_t i = 0; i < other.m_nets->names.size(); ++i) {
+        AddNet(other.m_nets->numbers[i], other.m_nets->names[i]);
     }
+    m_bounds.Union(other.m_bounds);
 }
 
-std::vector<wxString> PcbData::GetUniqueLayerNames() const
+void PcbData::RemoveElements(const std::vector<size_t>& lines, const std::vector<size_t>& pads,
+                             const std::vector<size_t>& vias, const std::vector<size_t>& zones)
 {
-    std::set<wxString> layerSet;
+    forEachColumn(m_lines.columns(), [&](auto& column) { eraseIndices(column, lines); });
+    if (!pads.empty()) {
+        forEachColumn(m_pads.columns(), [&](auto& column) { eraseIndices(column, pads); });
+        RemoveUnusedFootprints();
+    }
+    forEachColumn(m_vias.columns(), [&](auto& column) { eraseIndices(column, vias); });
+
+    if (!zones.empty()) {
+        forEachColumn(m_zones.columns(), [&](auto& column) { eraseIndices(column, zones); });
+        // Pack the surviving outlines so no dead points are left behind.
+        std::vector<PcbPoint> points;
+        for (size_t i = 0; i < m_zones.size(); ++i) {
+            const auto first = m_zones.points->begin() + m_zones.firstPoint[i];
+            m_zones.firstPoint.Mutable(i) = static_cast<uint32_t>(points.size());
+            points.insert(points.end(), first, first + m_zones.pointCount[i]);
+        }
+        m_zones.points.Assign(std::move(points));
+    }
+    RecomputeBoundingBox();
+    RecomputeUsedLayers();
+}
 
-    for (const auto& line : m_lines) {
-        layerSet.insert(line.layer);
+void PcbData::RemoveUnusedFootprints()
+{
+    std::vector<uint32_t> renumbered(m_footprints.size(), 0);
+    for (uint32_t footprint : m_pads.footprint) {
+        renumbered[footprint] = 1;
     }
-    for (const auto& pad : m_pads) {
-        // Special handling for non-copper layers
-        if (pad.shape == "np_thru_hole") {
-            layerSet.insert("Hole");
+    std::vector<size_t> unused;
+    uint32_t next = 0;
+    for (size_t i = 0; i < renumbered.size(); ++i) {
+        if (renumbered[i]) {
+            renumbered[i] = next++;
         } else {
-            layerSet.insert(pad.layer);
+            unused.push_back(i);
         }
     }
-    for (const auto& via : m_vias) {
-        // Vias are drawn as a single type for now
-        layerSet.insert("Via");
+    if (unused.empty()) {
+        return;
+    }
+    forEachColumn(m_footprints.columns(), [&](auto& column) { eraseIndices(column, unused); });
+    for (size_t i = 0; i < m_pads.size(); ++i) {
+        if (renumbered[m_pads.footprint[i]] != m_pads.footprint[i]) {
+            m_pads.footprint.Mutable(i) = renumbered[m_pads.footprint[i]];
+        }
+    }
+}
+
+void PcbData::RecomputeBoundingBox()
+{
+    // A bounding box can't shrink incrementally, so rebuild it from scratch.
+    m_bounds = PcbBox();
+    unionBounds(m_bounds, m_lines);
+    unionBounds(m_bounds, GetPads());
+    unionBounds(m_bounds, m_vias);
+    unionBounds(m_bounds, PcbPointSpan(*m_zones.points));
+}
+
+std::vector<std::string> PcbData::GetUniqueLayerNames() const
+{
+    std::vector<std::string> uniqueLayers;
+    for (size_t i = 0; i < m_layers.size(); ++i) {
+        if (m_layerUsed[i]) uniqueLayers.push_back(m_layers[i].name);
+    }
+    // Special handling for non-copper layers
+    if (m_hasHoles) {
+        uniqueLayers.push_back("Hole");
     }
-    for (const auto& zone : m_zones) {
-        layerSet.insert(zone.layer);
+    // Vias are drawn as a single type for now
+    if (m_vias.size() > 0) {
+        uniqueLayers.push_back("Via");
     }
 
-    std::vector<wxString> uniqueLayers(layerSet.begin(), layerSet.end());
     std::sort(uniqueLayers.begin(), uniqueLayers.end());
     return uniqueLayers;
 }
 
-wxRect2DDouble PcbData::GetBoundingBox() const
+PcbRect PcbData::GetBoundingBox() const
+{
+    if (m_bounds.IsEmpty()) {
+        return PcbRect();
+    }
+    return {CoordToMillimetres(m_bounds.minX), CoordToMillimetres(m_bounds.minY),
+            CoordToMillimetres(m_bounds.maxX) - CoordToMillimetres(m_bounds.minX),
+            CoordToMillimetres(m_bounds.maxY) - CoordToMillimetres(m_bounds.minY)};
+}
+
+std::vector<std::vector<PcbPoint>> PcbData::GetBoardOutline() const
 {
-    return m_boundingBox;
+    // Outline segments share endpoints exactly: KiCad writes the same text
+    // for both ends, and coordinates are integers.
+    auto key = [](PcbPoint p) { return (uint64_t(uint32_t(p.x)) << 32) | uint32_t(p.y); };
+    const PcbLayerId edgeCuts = GetLayerId("Edge.Cuts");
+    std::unordered_multimap<uint64_t, size_t> byEnd;
+    std::vector<size_t> edges;
+    for (size_t i = 0; i < m_lines.size(); ++i) {
+        if (m_lines.layer[i] == edgeCuts && edgeCuts != PcbNoLayer) {
+            byEnd.emplace(key({m_lines.startX[i], m_lines.startY[i]}), i);
+            byEnd.emplace(key({m_lines.endX[i], m_lines.endY[i]}), i);
+            edges.push_back(i);
+        }
+    }
+
+    std::vector<std::vector<PcbPoint>> rings;
+    std::vector<bool> used(m_lines.size(), false);
+    for (size_t first : edges) {
+        if (used[first]) continue;
+        used[first] = true;
+        const PcbPoint start{m_lines.startX[first], m_lines.startY[first]};
+        std::vector<PcbPoint> ring{start};
+        PcbPoint next{m_lines.endX[first], m_lines.endY[first]};
+        while (next != start) {
+            ring.push_back(next);
+            size_t found = m_lines.size();
+            const auto range = byEnd.equal_range(key(next));
+            for (auto it = range.first; it != range.second; ++it) {
+                if (!used[it->second]) {
+                    found = it->second;
+                    break;
+                }
+            }
+            if (found == m_lines.size()) break;
+            used[found] = true;
+            const PcbPoint a{m_lines.startX[found], m_lines.startY[found]};
+            next = a == next ? PcbPoint{m_lines.endX[found], m_lines.endY[found]} : a;
+        }
+        if (next == start && ring.size() >= 3) {
+            rings.push_back(std::move(ring));
+        }
+    }
+    return rings;
 }
 
-void PcbData::AddNet(const wxString& netName)
+void PcbData::AddNet(int netNumber, const std::string& netName)
 {
     // Avoid adding duplicates or empty nets
-    if (!netName.IsEmpty() && std::find(m_nets.begin(), m_nets.end(), netName) == m_nets.end())
-    {
-        m_nets.push_back(netName);
+    if (netName.empty()) {
+        return;
+    }
+    if (m_nets->indexByName.count(netName)) {
+        return;
+    }
+    PcbNetTable& nets = m_nets.Mutable();
+    const int netIndex = static_cast<int>(nets.names.size());
+    nets.indexByName.emplace(netName, netIndex);
+    nets.names.push_back(netName);
+    nets.numbers.push_back(netNumber);
+    if (netNumber >= 0) {
+        if (static_cast<size_t>(netNumber) >= nets.indexByNumber.size()) {
+            nets.indexByNumber.resize(netNumber + 1, -1);
+        }
+        nets.indexByNumber[netNumber] = netIndex;
     }
 }
 
-int PcbData::GetNetIdByName(const wxString& netName) const
+int PcbData::GetNetIdByName(const std::string& netName) const
 {
-    auto it = std::find(m_nets.begin(), m_nets.end(), netName);
-    if (it != m_nets.end())
-    {
-        return std::distance(m_nets.begin(), it);
+    auto it = m_nets->indexByName.find(netName);
+    return it != m_nets->indexByName.end() ? it->second : -1;
+}
+
+int PcbData::GetNetIndex(int netNumber) const
+{
+    if (netNumber < 0 || static_cast<size_t>(netNumber) >= m_nets->indexByNumber.size()) {
+        return -1;
+    }
+    return m_nets->indexByNumber[netNumber];
+}
+
+int PcbData::GetNetNumber(int netIndex) const
+{
+    if (netIndex < 0 || static_cast<size_t>(netIndex) >= m_nets->numbers.size()) {
+        return -1;
     }
-    return -1; // Not found
-}
\ No newline at end of file
+    return m_nets->numbers[netIndex];
+}
+
+void PcbData::BuildNetIndex()
+{
+    // A counting sort of element indices by net index. The lists are built
+    // fresh rather than edited, as copies of this PcbData may share them.
+    auto build = [&](std::shared_ptr<const PcbNetElements>& shared, const PcbColumn<int32_t>& netNumbers) {
+        auto built = std::make_shared<PcbNetElements>();
+        PcbNetElements& byNet = *built;
+        byNet.offsets.assign(m_nets->names.size() + 1, 0);
+        std::vector<int> netIndices(netNumbers.size());
+        for (size_t chunk = 0, i = 0; chunk < netNumbers.ChunkCount(); ++chunk) {
+            const int32_t* numbers = netNumbers.ChunkData(chunk);
+            for (size_t j = 0; j < netNumbers.ChunkLength(chunk); ++j, ++i) {
+                netIndices[i] = GetNetIndex(numbers[j]);
+                if (netIndices[i] >= 0) {
+                    byNet.offsets[netIndices[i] + 1]++;
+                }
+            }
+        }
+        for (size_t net = 0; net < m_nets->names.size(); ++net) {
+            byNet.offsets[net + 1] += byNet.offsets[net];
+        }
+        byNet.indices.resize(byNet.offsets.back());
+        std::vector<uint32_t> next(byNet.offsets.begin(), byNet.offsets.end() - 1);
+        for (size_t i = 0; i < netIndices.size(); ++i) {
+            if (netIndices[i] >= 0) {
+                byNet.indices[next[netIndices[i]]++] = static_cast<uint32_t>(i);
+            }
+        }
+        shared = std::move(built);
+    };
+    build(m_netPads, m_pads.netId);
+    build(m_netLines, m_lines.netId);
+    build(m_netVias, m_vias.netId);
+}
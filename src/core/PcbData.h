@@ -1,73 +1,552 @@
 #ifndef PCB_DATA_H
 #define PCB_DATA_H
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <string_view>
+#include <string>
+#include <tuple>
+#include <unordered_map>
 #include <vector>
-#include <wx/gdicmn.h>
-#include <wx/string.h>
-#include <wx/geometry.h>
+#include "core/PcbColumn.h"
 
+// Board geometry is held in integer nanometres, as KiCad does internally.
+// int32 covers +/-2.1 m and is exact for any value a .kicad_pcb can express.
+using PcbCoord = int32_t;
+
+constexpr double PcbCoordsPerMillimetre = 1e6;
+
+inline PcbCoord MillimetresToCoord(double mm) {
+    return static_cast<PcbCoord>(std::llround(mm * PcbCoordsPerMillimetre));
+}
+
+inline double CoordToMillimetres(PcbCoord coord) {
+    return coord / PcbCoordsPerMillimetre;
+}
+
+struct PcbPoint {
+    PcbCoord x = 0;
+    PcbCoord y = 0;
+
+    bool operator==(const PcbPoint& other) const { return x == other.x && y == other.y; }
+    bool operator!=(const PcbPoint& other) const { return !(*this == other); }
+};
+
+// Axis-aligned box in board coordinates; empty until something is added.
+struct PcbBox {
+    PcbCoord minX = std::numeric_limits<PcbCoord>::max();
+    PcbCoord minY = std::numeric_limits<PcbCoord>::max();
+    PcbCoord maxX = std::numeric_limits<PcbCoord>::min();
+    PcbCoord maxY = std::numeric_limits<PcbCoord>::min();
+
+    bool IsEmpty() const { return maxX < minX || maxY < minY; }
+
+    void Union(PcbCoord x0, PcbCoord y0, PcbCoord x1, PcbCoord y1) {
+        minX = std::min(minX, x0);
+        minY = std::min(minY, y0);
+        maxX = std::max(maxX, x1);
+        maxY = std::max(maxY, y1);
+    }
+
+    void Union(const PcbBox& other) {
+        if (!other.IsEmpty()) Union(other.minX, other.minY, other.maxX, other.maxY);
+    }
+};
+
+// A rectangle in millimetres, e.g. the board's extent for display.
+// src/gui turns it into a wxRect2DDouble.
+struct PcbRect {
+    double x = 0.0;
+    double y = 0.0;
+    double width = 0.0;
+    double height = 0.0;
+
+    bool IsEmpty() const { return width <= 0.0 || height <= 0.0; }
+};
+
+// Index into a PcbData's layer table (see PcbData::GetLayers()).
+using PcbLayerId = uint16_t;
+constexpr PcbLayerId PcbNoLayer = std::numeric_limits<PcbLayerId>::max();
+
+// A set of layers, one bit per PcbLayerId. Only the first 64 layers of a
+// table have a bit; KiCad lists copper and the standard layers first, so
+// only extra user layers on very large stack-ups fall outside.
+using PcbLayerSet = uint64_t;
+
+inline PcbLayerSet LayerBit(PcbLayerId layer) {
+    return layer < 64 ? PcbLayerSet(1) << layer : 0;
+}
+
+// The lowest layer in a set, or PcbNoLayer for an empty set.
+inline PcbLayerId FirstLayer(PcbLayerSet layers) {
+    for (PcbLayerId layer = 0; layer < 64; ++layer) {
+        if (layers & LayerBit(layer)) return layer;
+    }
+    return PcbNoLayer;
+}
+
+enum class PcbLayerType : uint8_t {
+    Signal,
+    Power,
+    Mixed,
+    Jumper,
+    User,
+};
+
+// One entry of the board's layer table, from its (layers ...) header.
+struct PcbLayer {
+    std::string name; // UTF-8, as are all names in PcbData
+    int number = -1; // KiCad's layer number; -1 for layers the header doesn't declare
+    PcbLayerType type = PcbLayerType::User;
+
+    bool IsCopper() const { return name.size() >= 3 && name.compare(name.size() - 3, 3, ".Cu") == 0; }
+};
+
+enum class PcbPadShape : uint8_t {
+    Rect,
+    Circle,
+    Oval,
+    RoundRect,
+    Trapezoid,
+    Custom,
+    NpThruHole, // Non-plated hole; the pad's size is the drill size.
+};
+
+// Maps a KiCad pad shape keyword ("rect", "roundrect", ...) to a shape.
+// Unknown names map to Custom.
+PcbPadShape PadShapeFromName(std::string_view name);
+
+// --- Elements ---
+// Small values assembled from PcbData's columns on access, and the
+// argument type of the Add* methods.
 
 struct PcbLine {
-    wxPoint2DDouble start;
-    wxPoint2DDouble end;
-    double width;
-    wxString layer;
+    PcbPoint start;
+    PcbPoint end;
+    PcbCoord width = 0;
+    PcbLayerId layer = PcbNoLayer;
     int netId = -1;
 };
 
 struct PcbVia {
-    wxPoint2DDouble pos;
-    double size;
-    double drill;
-    wxString fromLayer;
-    wxString toLayer;
+    PcbPoint pos;
+    PcbCoord size = 0;
+    PcbCoord drill = 0;
+    PcbLayerId fromLayer = PcbNoLayer;
+    PcbLayerId toLayer = PcbNoLayer;
+    PcbLayerSet layers = 0; // Every copper layer the via passes through
     int netId = -1;
 };
 
-struct PcbZone {
+struct PcbPad {
+    PcbPoint pos;
+    PcbPoint size;
+    PcbPadShape shape = PcbPadShape::Rect;
+    double rotation = 0.0;
+    PcbLayerId layer = PcbNoLayer; // Drawing layer: the first copper layer; PcbNoLayer for non-plated holes
+    PcbLayerSet layers = 0;        // Every layer in the pad's (layers ...), wildcards expanded
     int netId = -1;
-    wxString layer;
-    std::vector<wxPoint2DDouble> polygon;
 };
 
-struct PcbPad {
-    wxPoint2DDouble pos;
-    wxPoint2DDouble size;
-    wxString shape; // e.g., "rect", "circle", "oval"
-    double rotation = 0.0;
-    wxString layer;
+// A footprint's pads in the footprint's own frame: positions relative to
+// its origin and rotations relative to its rotation. Boards repeat a few
+// footprints many times, so a PcbData keeps one copy of each distinct
+// definition and places it once per instance. The pads' netId is unused;
+// nets belong to the instance.
+struct PcbFootprintDef {
+    std::string name; // Library id, e.g. "Resistor_SMD:R_0402"; empty for a pad added on its own
+    std::vector<PcbPad> pads;
+};
+
+// One placed instance of a footprint definition.
+struct PcbFootprint {
+    uint32_t def = 0; // Index into PcbData::GetFootprintDefs()
+    PcbPoint pos;
+    double rotation = 0.0;         // Degrees, counter-clockwise as drawn
+    PcbLayerId layer = PcbNoLayer; // The side it is mounted on, F.Cu or B.Cu
+};
+
+using PcbFootprintDefs = std::vector<std::shared_ptr<const PcbFootprintDef>>;
+
+// Turns a point about the origin as KiCad turns footprints: counter-clockwise
+// on screen, where y points down. Quarter turns are exact.
+PcbPoint RotatePoint(PcbPoint point, double degrees);
+
+// A read-only run of values owned by a PcbData or, when adding a zone, by the caller.
+template <typename T>
+class PcbSpan {
+public:
+    PcbSpan() = default;
+    PcbSpan(const T* data, size_t size) : m_data(data), m_size(size) {}
+    PcbSpan(const std::vector<T>& values) : m_data(values.data()), m_size(values.size()) {}
+
+    const T* begin() const { return m_data; }
+    const T* end() const { return m_data + m_size; }
+    const T& operator[](size_t index) const { return m_data[index]; }
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+
+private:
+    const T* m_data = nullptr;
+    size_t m_size = 0;
+};
+
+using PcbPointSpan = PcbSpan<PcbPoint>;
+using PcbIndexSpan = PcbSpan<uint32_t>;
+
+// What a keepout zone (a rule area) forbids, as bits of PcbZone::keepout.
+enum PcbKeepout : uint8_t {
+    PcbKeepoutTracks = 1 << 0,
+    PcbKeepoutVias = 1 << 1,
+    PcbKeepoutPads = 1 << 2,
+    PcbKeepoutCopperPour = 1 << 3,
+    PcbKeepoutFootprints = 1 << 4,
+};
+
+// A zone's outline is one ring. Cutouts are joined to it by a bridge there
+// and back, as KiCad fractures polygons, so by the even-odd rule they are
+// outside the zone.
+struct PcbZone {
     int netId = -1;
+    PcbLayerId layer = PcbNoLayer;
+    PcbPointSpan polygon; // Points into the owning PcbData until it is next modified.
+    uint8_t keepout = 0;  // PcbKeepout bits; 0 for a copper zone
+};
+
+// --- Column storage ---
+// One array per field, so a pass that needs a few fields (bounds, obstacle
+// rasterization, drawing one layer) streams only those. columns() lists
+// every per-element array for code that treats them all alike. The arrays
+// are chunked and shared between copies of a PcbData (see PcbColumn).
+
+struct PcbLineColumns {
+    PcbColumn<PcbCoord> startX, startY, endX, endY, width;
+    PcbColumn<PcbLayerId> layer;
+    PcbColumn<int32_t> netId;
+
+    size_t size() const { return startX.size(); }
+    PcbLine operator[](size_t i) const {
+        return {{startX[i], startY[i]}, {endX[i], endY[i]}, width[i], layer[i], netId[i]};
+    }
+    auto columns() { return std::tie(startX, startY, endX, endY, width, layer, netId); }
+    auto columns() const { return std::tie(startX, startY, endX, endY, width, layer, netId); }
+};
+
+// Pads are stored per footprint instance: the instance, which pad of its
+// definition, and the pad's own net. PcbPadView places them on access.
+// Definitions have at most 65536 pads.
+struct PcbPadColumns {
+    PcbColumn<uint32_t> footprint;
+    PcbColumn<uint16_t> defPad;
+    PcbColumn<int32_t> netId;
+
+    size_t size() const { return footprint.size(); }
+    auto columns() { return std::tie(footprint, defPad, netId); }
+    auto columns() const { return std::tie(footprint, defPad, netId); }
+};
+
+struct PcbFootprintColumns {
+    PcbColumn<uint32_t> def;
+    PcbColumn<PcbCoord> x, y;
+    PcbColumn<double> rotation;
+    PcbColumn<PcbLayerId> layer;
+
+    size_t size() const { return def.size(); }
+    PcbFootprint operator[](size_t i) const {
+        return {def[i], {x[i], y[i]}, rotation[i], layer[i]};
+    }
+    auto columns() { return std::tie(def, x, y, rotation, layer); }
+    auto columns() const { return std::tie(def, x, y, rotation, layer); }
+};
+
+struct PcbViaColumns {
+    PcbColumn<PcbCoord> x, y, diameter, drill;
+    PcbColumn<PcbLayerId> fromLayer, toLayer;
+    PcbColumn<PcbLayerSet> layers;
+    PcbColumn<int32_t> netId;
+
+    size_t size() const { return x.size(); }
+    PcbVia operator[](size_t i) const {
+        return {{x[i], y[i]}, diameter[i], drill[i], fromLayer[i], toLayer[i], layers[i], netId[i]};
+    }
+    auto columns() { return std::tie(x, y, diameter, drill, fromLayer, toLayer, layers, netId); }
+    auto columns() const { return std::tie(x, y, diameter, drill, fromLayer, toLayer, layers, netId); }
+};
+
+// Zone outlines share one point array; each zone owns a contiguous run of
+// it. Outlines are rarely edited, so the array is shared whole between
+// copies rather than chunked, and stays contiguous for PcbZone::polygon.
+struct PcbZoneColumns {
+    PcbColumn<int32_t> netId;
+    PcbColumn<PcbLayerId> layer;
+    PcbColumn<uint32_t> firstPoint, pointCount;
+    PcbColumn<uint8_t> keepout;
+    PcbShared<std::vector<PcbPoint>> points;
+
+    size_t size() const { return netId.size(); }
+    PcbZone operator[](size_t i) const {
+        return {netId[i], layer[i], PcbPointSpan(points->data() + firstPoint[i], pointCount[i]), keepout[i]};
+    }
+    auto columns() { return std::tie(netId, layer, firstPoint, pointCount, keepout); }
+    auto columns() const { return std::tie(netId, layer, firstPoint, pointCount, keepout); }
+};
+
+// Input iterator over a view's elements, which it returns by value. It
+// holds a copy of the view, so it stays valid after a temporary view is gone.
+template <typename View>
+class PcbElementIterator {
+public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = typename View::value_type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = value_type;
+
+    PcbElementIterator(const View& view, size_t index) : m_view(view), m_index(index) {}
+    value_type operator*() const { return m_view[m_index]; }
+    PcbElementIterator& operator++() { ++m_index; return *this; }
+    bool operator==(const PcbElementIterator& other) const { return m_index == other.m_index; }
+    bool operator!=(const PcbElementIterator& other) const { return m_index != other.m_index; }
+
+private:
+    View m_view;
+    size_t m_index;
+};
+
+// Read-only random-access view of one element type. Elements are gathered
+// from the columns on access and returned by value.
+template <typename Columns>
+class PcbElementView {
+public:
+    using value_type = decltype(std::declval<const Columns&>()[0]);
+    using iterator = PcbElementIterator<PcbElementView>;
+
+    explicit PcbElementView(const Columns& columns) : m_columns(&columns) {}
+
+    size_t size() const { return m_columns->size(); }
+    bool empty() const { return m_columns->size() == 0; }
+    value_type operator[](size_t index) const { return (*m_columns)[index]; }
+    iterator begin() const { return iterator(*this, 0); }
+    iterator end() const { return iterator(*this, m_columns->size()); }
+
+    // The underlying arrays, for passes that want to read a field directly.
+    const Columns& columns() const { return *m_columns; }
+
+private:
+    const Columns* m_columns;
+};
+
+// The pads as standalone values: each is its footprint definition's pad,
+// turned and moved by its instance and given its own net.
+class PcbPadView {
+public:
+    using value_type = PcbPad;
+    using iterator = PcbElementIterator<PcbPadView>;
+
+    PcbPadView(const PcbPadColumns& pads, const PcbFootprintColumns& footprints, const PcbFootprintDefs& defs)
+        : m_pads(&pads), m_footprints(&footprints), m_defs(&defs) {}
+
+    size_t size() const { return m_pads->size(); }
+    bool empty() const { return m_pads->size() == 0; }
+    PcbPad operator[](size_t index) const;
+    iterator begin() const { return iterator(*this, 0); }
+    iterator end() const { return iterator(*this, m_pads->size()); }
+
+    const PcbPadColumns& columns() const { return *m_pads; }
+
+    // A pad's definition, before placement.
+    const PcbPad& GetDefPad(size_t index) const {
+        return (*m_defs)[m_footprints->def[m_pads->footprint[index]]]->pads[m_pads->defPad[index]];
+    }
+
+private:
+    const PcbPadColumns* m_pads;
+    const PcbFootprintColumns* m_footprints;
+    const PcbFootprintDefs* m_defs;
+};
+
+// The named nets by net index, and the lookups from file net numbers and
+// from names.
+struct PcbNetTable {
+    std::vector<std::string> names;
+    std::vector<int32_t> numbers;       // By net index
+    std::vector<int32_t> indexByNumber; // By file net number; -1 for gaps
+    std::unordered_map<std::string, int> indexByName;
+};
+
+// Element indices grouped by net: those of net n are
+// indices[offsets[n] .. offsets[n + 1]).
+struct PcbNetElements {
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> indices;
+
+    PcbIndexSpan operator[](int netIndex) const {
+        if (netIndex < 0 || static_cast<size_t>(netIndex) + 1 >= offsets.size()) return PcbIndexSpan();
+        return PcbIndexSpan(indices.data() + offsets[netIndex], offsets[netIndex + 1] - offsets[netIndex]);
+    }
 };
 
+using PcbLineView = PcbElementView<PcbLineColumns>;
+using PcbFootprintView = PcbElementView<PcbFootprintColumns>;
+using PcbViaView = PcbElementView<PcbViaColumns>;
+using PcbZoneView = PcbElementView<PcbZoneColumns>;
+
+// What a reload changed in a PcbData, so derived structures (caches, the
+// canvas) can update only the affected elements. Elements that survive a
+// reload keep their relative order; new ones are appended at the end.
+struct PcbChangeSet {
+    // Everything was replaced; the index lists are empty and all derived data is stale.
+    bool fullReload = false;
+
+    // Ascending indices, from before the reload, of the elements that were removed.
+    std::vector<size_t> removedLines;
+    std::vector<size_t> removedPads;
+    std::vector<size_t> removedVias;
+    std::vector<size_t> removedZones;
+
+    // Ascending indices, from after the reload, of the elements that were added.
+    std::vector<size_t> addedLines;
+    std::vector<size_t> addedPads;
+    std::vector<size_t> addedVias;
+    std::vector<size_t> addedZones;
+
+    // Top-level board items (footprints, segments, ...) by kind of change.
+    // An item counts as changed when its tstamp/uuid survived the edit.
+    int itemsAdded = 0;
+    int itemsRemoved = 0;
+    int itemsChanged = 0;
+
+    bool empty() const {
+        return !fullReload && itemsAdded == 0 && itemsRemoved == 0 && itemsChanged == 0;
+    }
+};
+
+// A board's elements, nets and layers. Copies are cheap: the element
+// columns and net lists are shared with the original until either side
+// modifies them, and then only the chunks written are duplicated.
 class PcbData {
 public:
     PcbData() = default;
 
     void Clear();
     void AddLine(const PcbLine& line);
+    // Adds a pad that belongs to no footprint, as the only pad of a
+    // footprint placed at its position.
     void AddPad(const PcbPad& pad);
     void AddVia(const PcbVia& via);
     void AddZone(const PcbZone& zone);
-    void AddNet(const wxString& netName);
+    // Returns the index of a footprint definition, adding it if no equal
+    // definition is stored yet. Definitions are never removed.
+    uint32_t AddFootprintDef(const PcbFootprintDef& def);
+    // Places an instance of footprint.def, adding one pad per pad of the
+    // definition. padNets gives their net numbers in order; pads beyond
+    // its end get no net.
+    void AddFootprint(const PcbFootprint& footprint, PcbSpan<int32_t> padNets);
+    // Declares a net by its number in the file. Unnamed nets (net 0, "no
+    // net") and repeated names are ignored.
+    void AddNet(int netNumber, const std::string& netName);
+
+    // Returns the id of a layer name, adding it to the table if it is new.
+    PcbLayerId AddLayer(const std::string& layerName);
+    // Adds a declared layer, or fills in the number and type of one that
+    // was added by name before the header was seen.
+    PcbLayerId AddLayer(const PcbLayer& layer);
+
+    // Appends every element of another PcbData after this one's, as if its
+    // elements had been added here one by one (nets are de-duplicated and
+    // layer ids are translated into this table).
+    void Append(const PcbData& other);
+
+    // Removes elements by index (each list ascending) and recomputes the
+    // bounding box. Footprints left without pads are removed with them;
+    // nets, layers and footprint definitions are left alone.
+    void RemoveElements(const std::vector<size_t>& lines, const std::vector<size_t>& pads,
+                        const std::vector<size_t>& vias, const std::vector<size_t>& zones);
 
     // Accessors
-    const std::vector<PcbLine>& GetLines() const { return m_lines; }
-    const std::vector<PcbPad>& GetPads() const { return m_pads; }
-    const std::vector<PcbVia>& GetVias() const { return m_vias; }
-    const std::vector<PcbZone>& GetZones() const { return m_zones; }
-    const std::vector<wxString>& GetNets() const { return m_nets; }
-    std::vector<wxString> GetUniqueLayerNames() const;
-    wxRect2DDouble GetBoundingBox() const;
+    PcbLineView GetLines() const { return PcbLineView(m_lines); }
+    PcbPadView GetPads() const { return PcbPadView(m_pads, m_footprints, *m_footprintDefs); }
+    PcbViaView GetVias() const { return PcbViaView(m_vias); }
+    PcbZoneView GetZones() const { return PcbZoneView(m_zones); }
+    PcbFootprintView GetFootprints() const { return PcbFootprintView(m_footprints); }
+    const PcbFootprintDefs& GetFootprintDefs() const { return *m_footprintDefs; }
+    // Named nets in declaration order. A net's position in this list is its
+    // net index, which is what the rest of the net API takes and returns;
+    // elements store the file's net number (see GetNetIndex()).
+    const std::vector<std::string>& GetNets() const { return m_nets->names; }
+    std::vector<std::string> GetUniqueLayerNames() const;
 
-    int GetNetIdByName(const wxString& netName) const;
+    // Layer table, in the header's order. GetLayerName() returns an empty
+    // string for PcbNoLayer and GetLayerId() returns PcbNoLayer for a name
+    // that is not in the table.
+    const std::vector<PcbLayer>& GetLayers() const { return m_layers; }
+    const std::string& GetLayerName(PcbLayerId layer) const;
+    PcbLayerId GetLayerId(const std::string& layerName) const;
+    PcbLayerSet GetCopperLayers() const { return m_copperLayers; }
+    // The copper layers from one layer to another in stack-up order, both included.
+    PcbLayerSet GetCopperSpan(PcbLayerId from, PcbLayerId to) const;
+
+    // Bounds of all elements, in board coordinates and in millimetres.
+    const PcbBox& GetBounds() const { return m_bounds; }
+    PcbRect GetBoundingBox() const;
+    // The board outline: its Edge.Cuts lines (the parser breaks arcs,
+    // rectangles and polygons into lines) chained end to end into closed
+    // rings, cutouts included. Chains that don't close are left out.
+    std::vector<std::vector<PcbPoint>> GetBoardOutline() const;
+
+    // Net lookups, all O(1). Each returns -1 for an unknown net.
+    int GetNetIdByName(const std::string& netName) const;
+    int GetNetIndex(int netNumber) const;
+    int GetNetNumber(int netIndex) const;
+
+    // Indices of the pads, lines and vias on a net. The lists are built by
+    // BuildNetIndex(), which the parser and the cache call once a load is
+    // complete; Add*, Append and RemoveElements leave them stale until the
+    // next call.
+    PcbIndexSpan GetNetPads(int netIndex) const { return m_netPads ? (*m_netPads)[netIndex] : PcbIndexSpan(); }
+    PcbIndexSpan GetNetLines(int netIndex) const { return m_netLines ? (*m_netLines)[netIndex] : PcbIndexSpan(); }
+    PcbIndexSpan GetNetVias(int netIndex) const { return m_netVias ? (*m_netVias)[netIndex] : PcbIndexSpan(); }
+    void BuildNetIndex();
+
+    // The number PcbDataVersions gave this board when it was committed, or
+    // 0 if it never was.
+    uint64_t GetVersion() const { return m_version; }
 
 private:
-    std::vector<PcbLine> m_lines;
-    std::vector<PcbPad> m_pads;
-    std::vector<PcbVia> m_vias;
-    std::vector<PcbZone> m_zones;
-    std::vector<wxString> m_nets;
-    wxRect2DDouble m_boundingBox;
+    friend class PcbDataCache;    // Reads and writes the columns directly.
+    friend class PcbDataVersions; // Numbers committed versions.
+
+    void RemoveUnusedFootprints();
+    void RecomputeBoundingBox();
+    void RecomputeUsedLayers();
+    void MarkLayerUsed(PcbLayerId layer);
+
+    PcbLineColumns m_lines;
+    PcbPadColumns m_pads;
+    PcbViaColumns m_vias;
+    PcbZoneColumns m_zones;
+    PcbFootprintColumns m_footprints;
+    // Definitions are immutable once added, so copies share them; the
+    // tables below are only copied when a copy adds a definition or a net.
+    PcbShared<PcbFootprintDefs> m_footprintDefs;
+    PcbShared<std::unordered_map<std::string, uint32_t>> m_footprintDefIndex; // Keyed by the definition's contents
+    PcbShared<PcbNetTable> m_nets;
+    // Rebuilt whole by BuildNetIndex(), so shared rather than chunked.
+    std::shared_ptr<const PcbNetElements> m_netPads;
+    std::shared_ptr<const PcbNetElements> m_netLines;
+    std::shared_ptr<const PcbNetElements> m_netVias;
+    std::vector<PcbLayer> m_layers;
+    PcbLayerSet m_copperLayers = 0;
+    // Which layers (by id) and which pseudo-layers hold elements, so the
+    // layer list doesn't need a pass over the elements.
+    std::vector<bool> m_layerUsed;
+    bool m_hasHoles = false;
+    PcbBox m_bounds;
+    uint64_t m_version = 0;
 };
 
-#endif // PCB_DATA_H
\ No newline at end of file
+#endif // PCB_DATA_H
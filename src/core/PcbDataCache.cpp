@@ -0,0 +1,425 @@
+#include "core/PcbDataCache.h"
+#include "core/PcbData.h"
+#include "kicad/MappedFile.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <type_traits>
+#include <tuple>
+#include <vector>
+
+namespace {
+    const char CacheMagic[8] = {'P', 'C', 'B', 'C', 'A', 'C', 'H', 'E'};
+    // Written as a native integer; a snapshot from a machine with a different
+    // byte order reads back as a mismatch and is simply rebuilt.
+    const uint32_t ByteOrderMark = 0x01020304;
+
+    // --- On-disk layout ---
+    // The header, then the layer table (each name as length-prefixed UTF-8
+    // followed by a LayerRecord), then the net names and their numbers, then
+    // the footprint definitions (each name, then its pad count and pads),
+    // then every column of PcbData as a raw array in columns() order, then
+    // the zone points.
+
+    struct CacheHeader {
+        char magic[8];
+        uint32_t byteOrder;
+        uint32_t version;
+        uint64_t sourceHash;
+        uint64_t sourceSize;
+        uint32_t layerCount;
+        uint32_t netCount;
+        uint32_t lineCount;
+        uint32_t padCount;
+        uint32_t viaCount;
+        uint32_t zoneCount;
+        uint32_t pointCount;
+        uint32_t footprintDefCount;
+        uint32_t footprintCount;
+        int32_t bounds[4];
+        uint32_t reserved; // Zero; spells out what would be tail padding
+    };
+
+    struct LayerRecord {
+        int32_t number;
+        uint32_t type;
+    };
+
+    // PcbPad has padding between its fields, so footprint definition pads
+    // are copied field by field into this record, which has none, and the
+    // snapshot bytes depend only on the data.
+    struct PadRecord {
+        PcbPoint pos;
+        PcbPoint size;
+        double rotation;
+        PcbLayerSet layers;
+        int32_t netId;
+        PcbLayerId layer;
+        uint8_t shape;
+        uint8_t reserved;
+
+        static PadRecord From(const PcbPad& pad) {
+            return {pad.pos, pad.size, pad.rotation, pad.layers, pad.netId, pad.layer, static_cast<uint8_t>(pad.shape), 0};
+        }
+        PcbPad ToPad() const {
+            PcbPad pad;
+            pad.pos = pos;
+            pad.size = size;
+            pad.shape = static_cast<PcbPadShape>(shape);
+            pad.rotation = rotation;
+            pad.layer = layer;
+            pad.layers = layers;
+            pad.netId = netId;
+            return pad;
+        }
+    };
+
+    // Records are written as raw bytes, so they must not have padding:
+    // every byte is a field and the same data always gives the same file.
+    // Floating-point fields are the one kind of member the standard trait
+    // can't vouch for, so records holding one are checked by size.
+    template <typename T>
+    constexpr bool IsPackedRecord = std::is_floating_point<T>::value || std::has_unique_object_representations<T>::value;
+    template <>
+    constexpr bool IsPackedRecord<PadRecord> = sizeof(PadRecord) == 2 * sizeof(PcbPoint) + sizeof(double) + sizeof(PcbLayerSet) +
+                                                                      sizeof(int32_t) + sizeof(PcbLayerId) + 2 * sizeof(uint8_t);
+
+    static_assert(IsPackedRecord<CacheHeader>, "cache records must not have padding");
+    static_assert(IsPackedRecord<LayerRecord>, "cache records must not have padding");
+    static_assert(IsPackedRecord<PcbPoint>, "cache records must not have padding");
+    static_assert(IsPackedRecord<PadRecord>, "cache records must not have padding");
+
+    // Bounds-checked sequential reader over the mapped snapshot.
+    class Reader {
+    public:
+        explicit Reader(std::string_view bytes) : m_bytes(bytes), m_pos(0) {}
+
+        template <typename T>
+        bool read(T& value) {
+            if (m_bytes.size() - m_pos < sizeof(T)) return false;
+            std::memcpy(&value, m_bytes.data() + m_pos, sizeof(T));
+            m_pos += sizeof(T);
+            return true;
+        }
+
+        // Reads 'count' elements straight into a column.
+        template <typename T>
+        bool readColumn(std::vector<T>& column, size_t count) {
+            if ((m_bytes.size() - m_pos) / sizeof(T) < count) return false;
+            column.resize(count);
+            std::memcpy(column.data(), m_bytes.data() + m_pos, count * sizeof(T));
+            m_pos += count * sizeof(T);
+            return true;
+        }
+
+        // The same for a chunked column, one chunk at a time.
+        template <typename T>
+        bool readColumn(PcbColumn<T>& column, size_t count) {
+            if ((m_bytes.size() - m_pos) / sizeof(T) < count) return false;
+            column.resize(count);
+            for (size_t chunk = 0; chunk < column.ChunkCount(); ++chunk) {
+                const size_t bytes = column.ChunkLength(chunk) * sizeof(T);
+                std::memcpy(column.MutableChunkData(chunk), m_bytes.data() + m_pos, bytes);
+                m_pos += bytes;
+            }
+            return true;
+        }
+
+        bool readString(std::string& out) {
+            uint32_t length;
+            std::string_view text;
+            if (!read(length) || !readBytes(length, text)) return false;
+            out.assign(text.data(), text.size());
+            return true;
+        }
+
+        bool readBytes(size_t count, std::string_view& out) {
+            if (m_bytes.size() - m_pos < count) return false;
+            out = m_bytes.substr(m_pos, count);
+            m_pos += count;
+            return true;
+        }
+
+    private:
+        std::string_view m_bytes;
+        size_t m_pos;
+    };
+
+    template <typename T>
+    void write(std::ofstream& out, const T& value) {
+        static_assert(IsPackedRecord<T>, "cache records must not have padding");
+        out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    void writeColumn(std::ofstream& out, const std::vector<T>& column) {
+        static_assert(IsPackedRecord<T>, "cache records must not have padding");
+        out.write(reinterpret_cast<const char*>(column.data()), column.size() * sizeof(T));
+    }
+
+    template <typename T>
+    void writeColumn(std::ofstream& out, const PcbColumn<T>& column) {
+        static_assert(IsPackedRecord<T>, "cache records must not have padding");
+        for (size_t chunk = 0; chunk < column.ChunkCount(); ++chunk) {
+            out.write(reinterpret_cast<const char*>(column.ChunkData(chunk)), column.ChunkLength(chunk) * sizeof(T));
+        }
+    }
+
+    void writeString(std::ofstream& out, const std::string& text) {
+        write(out, static_cast<uint32_t>(text.size()));
+        out.write(text.data(), text.size());
+    }
+}
+
+uint64_t PcbDataCache::hashBytes(std::string_view bytes)
+{
+    // A four-lane multiply/rotate hash over 8-byte words. It only has to tell
+    // versions of the same file apart, so speed matters more than strength.
+    const uint64_t prime1 = 0x9E3779B185EBCA87ULL;
+    const uint64_t prime2 = 0xC2B2AE3D27D4EB4FULL;
+    auto rotl = [](uint64_t x, int r) { return (x << r) | (x >> (64 - r)); };
+    auto round = [&](uint64_t acc, uint64_t word) { return rotl(acc + word * prime2, 31) * prime1; };
+
+    uint64_t lanes[4] = {prime1 + prime2, prime2, 0, 0 - prime1};
+    const char* p = bytes.data();
+    size_t remaining = bytes.size();
+    while (remaining >= 32) {
+        for (int i = 0; i < 4; ++i) {
+            uint64_t word;
+            std::memcpy(&word, p + i * 8, 8);
+            lanes[i] = round(lanes[i], word);
+        }
+        p += 32;
+        remaining -= 32;
+    }
+
+    uint64_t hash = rotl(lanes[0], 1) + rotl(lanes[1], 7) + rotl(lanes[2], 12) + rotl(lanes[3], 18);
+    hash += bytes.size();
+    while (remaining > 0) {
+        uint64_t word = 0;
+        size_t n = remaining < 8 ? remaining : 8;
+        std::memcpy(&word, p, n);
+        hash = rotl(hash ^ round(0, word), 27) * prime1 + prime2;
+        p += n;
+        remaining -= n;
+    }
+
+    // Final avalanche
+    hash ^= hash >> 33;
+    hash *= prime2;
+    hash ^= hash >> 29;
+    hash *= prime1;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+bool PcbDataCache::computeKey(const std::string& sourcePath, Key& key)
+{
+    MappedFile source;
+    if (!source.open(sourcePath)) {
+        return false;
+    }
+    key.hash = hashBytes(source.view());
+    key.size = source.size();
+    return true;
+}
+
+std::string PcbDataCache::defaultDirectory()
+{
+    for (const char* variable : {"XDG_CACHE_HOME", "LOCALAPPDATA"}) {
+        const char* base = std::getenv(variable);
+        if (base && *base) {
+            return (std::filesystem::path(base) / "kicad-autorouter").string();
+        }
+    }
+    const char* home = std::getenv("HOME");
+    if (home && *home) {
+        return (std::filesystem::path(home) / ".cache" / "kicad-autorouter").string();
+    }
+    std::error_code ec;
+    const std::filesystem::path temp = std::filesystem::temp_directory_path(ec);
+    return ec ? std::string() : (temp / "kicad-autorouter-cache").string();
+}
+
+std::string PcbDataCache::snapshotPath(const std::string& sourcePath, const Key& key) const
+{
+    if (m_directory.empty()) {
+        return sourcePath + ".pcbcache";
+    }
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.pcbcache", static_cast<unsigned long long>(key.hash));
+    return (std::filesystem::path(m_directory) / name).string();
+}
+
+std::shared_ptr<PcbData> PcbDataCache::load(const std::string& sourcePath, const Key& key) const
+{
+    MappedFile file;
+    if (!file.open(snapshotPath(sourcePath, key))) {
+        return nullptr;
+    }
+
+    Reader reader(file.view());
+    CacheHeader header;
+    if (!reader.read(header) ||
+        std::memcmp(header.magic, CacheMagic, sizeof(CacheMagic)) != 0 ||
+        header.byteOrder != ByteOrderMark ||
+        header.version != FormatVersion ||
+        header.sourceHash != key.hash ||
+        header.sourceSize != key.size) {
+        return nullptr;
+    }
+
+    // Every string takes at least its length prefix.
+    if ((uint64_t(header.layerCount) + header.netCount + header.footprintDefCount) * sizeof(uint32_t) > file.size()) {
+        return nullptr;
+    }
+
+    auto data = std::make_shared<PcbData>();
+    for (uint32_t i = 0; i < header.layerCount; ++i) {
+        PcbLayer layer;
+        LayerRecord r;
+        if (!reader.readString(layer.name) || !reader.read(r)) return nullptr;
+        layer.number = r.number;
+        layer.type = static_cast<PcbLayerType>(r.type);
+        data->AddLayer(layer);
+    }
+    std::vector<std::string> netNames(header.netCount);
+    for (std::string& net : netNames) {
+        if (!reader.readString(net)) return nullptr;
+    }
+    std::vector<int32_t> netNumbers;
+    if (!reader.readColumn(netNumbers, header.netCount)) return nullptr;
+    for (size_t i = 0; i < netNames.size(); ++i) {
+        data->AddNet(netNumbers[i], netNames[i]);
+    }
+
+    for (uint32_t i = 0; i < header.footprintDefCount; ++i) {
+        PcbFootprintDef def;
+        uint32_t padCount;
+        std::vector<PadRecord> pads;
+        if (!reader.readString(def.name) || !reader.read(padCount) || !reader.readColumn(pads, padCount)) return nullptr;
+        def.pads.reserve(pads.size());
+        for (const PadRecord& pad : pads) {
+            def.pads.push_back(pad.ToPad());
+        }
+        if (data->AddFootprintDef(def) != i) return nullptr; // Stored definitions are distinct
+    }
+
+    // readColumn() checks each count against what is left of the file, so
+    // corrupt counts fail here instead of sizing huge arrays.
+    bool ok = true;
+    auto readColumns = [&](auto columns, uint32_t count) {
+        std::apply([&](auto&... column) { ((ok = ok && reader.readColumn(column, count)), ...); }, columns);
+    };
+    readColumns(data->m_lines.columns(), header.lineCount);
+    readColumns(data->m_pads.columns(), header.padCount);
+    readColumns(data->m_footprints.columns(), header.footprintCount);
+    readColumns(data->m_vias.columns(), header.viaCount);
+    readColumns(data->m_zones.columns(), header.zoneCount);
+    std::vector<PcbPoint> points;
+    if (!ok || !reader.readColumn(points, header.pointCount)) {
+        return nullptr;
+    }
+    data->m_zones.points.Assign(std::move(points));
+    for (size_t i = 0; i < data->m_zones.size(); ++i) {
+        const uint32_t first = data->m_zones.firstPoint[i];
+        if (first > header.pointCount || header.pointCount - first < data->m_zones.pointCount[i]) return nullptr;
+    }
+    for (uint32_t def : data->m_footprints.def) {
+        if (def >= header.footprintDefCount) return nullptr;
+    }
+    for (size_t i = 0; i < data->m_pads.size(); ++i) {
+        const uint32_t footprint = data->m_pads.footprint[i];
+        if (footprint >= header.footprintCount ||
+            data->m_pads.defPad[i] >= (*data->m_footprintDefs)[data->m_footprints.def[footprint]]->pads.size()) return nullptr;
+    }
+
+    data->m_bounds = {header.bounds[0], header.bounds[1], header.bounds[2], header.bounds[3]};
+    data->RecomputeUsedLayers();
+    data->BuildNetIndex();
+    return data;
+}
+
+bool PcbDataCache::store(const std::string& sourcePath, const Key& key, const PcbData& data) const
+{
+    CacheHeader header = {};
+    std::memcpy(header.magic, CacheMagic, sizeof(CacheMagic));
+    header.byteOrder = ByteOrderMark;
+    header.version = FormatVersion;
+    header.sourceHash = key.hash;
+    header.sourceSize = key.size;
+    header.layerCount = static_cast<uint32_t>(data.m_layers.size());
+    header.netCount = static_cast<uint32_t>(data.m_nets->names.size());
+    header.lineCount = static_cast<uint32_t>(data.m_lines.size());
+    header.padCount = static_cast<uint32_t>(data.m_pads.size());
+    header.viaCount = static_cast<uint32_t>(data.m_vias.size());
+    header.zoneCount = static_cast<uint32_t>(data.m_zones.size());
+    header.pointCount = static_cast<uint32_t>(data.m_zones.points->size());
+    header.footprintDefCount = static_cast<uint32_t>(data.m_footprintDefs->size());
+    header.footprintCount = static_cast<uint32_t>(data.m_footprints.size());
+    header.bounds[0] = data.m_bounds.minX;
+    header.bounds[1] = data.m_bounds.minY;
+    header.bounds[2] = data.m_bounds.maxX;
+    header.bounds[3] = data.m_bounds.maxY;
+
+    // Write to a temporary name and rename, so a reader never sees a partial snapshot.
+    const std::string path = snapshotPath(sourcePath, key);
+    const std::string tempPath = path + ".tmp";
+    if (!m_directory.empty()) {
+        std::error_code ec;
+        std::filesystem::create_directories(m_directory, ec);
+    }
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            std::cerr << "Warning: Could not write PCB cache " << tempPath << std::endl;
+            return false;
+        }
+
+        write(out, header);
+        for (const PcbLayer& layer : data.m_layers) {
+            writeString(out, layer.name);
+            write(out, LayerRecord{layer.number, static_cast<uint32_t>(layer.type)});
+        }
+        for (const std::string& net : data.m_nets->names) {
+            writeString(out, net);
+        }
+        writeColumn(out, data.m_nets->numbers);
+        for (const auto& def : *data.m_footprintDefs) {
+            writeString(out, def->name);
+            write(out, static_cast<uint32_t>(def->pads.size()));
+            std::vector<PadRecord> pads;
+            pads.reserve(def->pads.size());
+            for (const PcbPad& pad : def->pads) {
+                pads.push_back(PadRecord::From(pad));
+            }
+            writeColumn(out, pads);
+        }
+        auto writeColumns = [&](auto columns) {
+            std::apply([&](const auto&... column) { (writeColumn(out, column), ...); }, columns);
+        };
+        writeColumns(data.m_lines.columns());
+        writeColumns(data.m_pads.columns());
+        writeColumns(data.m_footprints.columns());
+        writeColumns(data.m_vias.columns());
+        writeColumns(data.m_zones.columns());
+        writeColumn(out, *data.m_zones.points);
+        if (!out) {
+            std::cerr << "Warning: Could not write PCB cache " << tempPath << std::endl;
+            out.close();
+            std::remove(tempPath.c_str());
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tempPath, path, ec);
+    if (ec) {
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,71 @@
+#ifndef PCB_DATA_CACHE_H
+#define PCB_DATA_CACHE_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+class PcbData;
+
+// A versioned binary snapshot of PcbData, keyed by a hash of the .kicad_pcb
+// it was extracted from. Loading one copies PcbData's columns straight out
+// of a memory-mapped file, which is much cheaper than re-parsing.
+//
+// Snapshots live in a cache directory as "<content hash>.pcbcache", by
+// default the per-user one from defaultDirectory(). Storing them next to
+// the source as "<board>.kicad_pcb.pcbcache" is opt-in.
+class PcbDataCache {
+public:
+    // Bump whenever the on-disk layout or the meaning of PcbData changes.
+    static constexpr uint32_t FormatVersion = 8;
+
+    // Identifies one version of a source file.
+    struct Key {
+        uint64_t hash = 0;
+        uint64_t size = 0;
+    };
+
+    PcbDataCache() : m_directory(defaultDirectory()) {}
+
+    /**
+     * @brief Sets where snapshots are stored; it is created on the first store().
+     * @param directory A directory path, or an empty string to store them next to the source.
+     */
+    void setDirectory(const std::string& directory) { m_directory = directory; }
+    const std::string& getDirectory() const { return m_directory; }
+
+    /**
+     * @brief Hashes the current contents of a board file.
+     * @return false if the file could not be read.
+     */
+    static bool computeKey(const std::string& sourcePath, Key& key);
+
+    /**
+     * @brief Loads the snapshot for a board if one exists and was made from the same contents.
+     * @param sourcePath The path to the .kicad_pcb file.
+     * @param key The key of the file's current contents, from computeKey().
+     * @return The cached data, or nullptr if there is no valid snapshot.
+     */
+    std::shared_ptr<PcbData> load(const std::string& sourcePath, const Key& key) const;
+
+    /**
+     * @brief Writes a snapshot of the data extracted from a board.
+     * @return true if the snapshot was written.
+     */
+    bool store(const std::string& sourcePath, const Key& key, const PcbData& data) const;
+
+    // $XDG_CACHE_HOME/kicad-autorouter, ~/.cache/kicad-autorouter or
+    // %LOCALAPPDATA%\kicad-autorouter, else one under the temp directory.
+    static std::string defaultDirectory();
+
+    // 64-bit content hash used for keys.
+    static uint64_t hashBytes(std::string_view bytes);
+
+private:
+    std::string snapshotPath(const std::string& sourcePath, const Key& key) const;
+
+    std::string m_directory;
+};
+
+#endif // PCB_DATA_CACHE_H
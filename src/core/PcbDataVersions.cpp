@@ -0,0 +1,28 @@
+#include "core/PcbDataVersions.h"
+#include "core/PcbData.h"
+#include <atomic>
+#include <utility>
+
+std::shared_ptr<const PcbData> PcbDataVersions::Current() const
+{
+    return std::atomic_load(&m_current);
+}
+
+uint64_t PcbDataVersions::Commit(std::shared_ptr<PcbData> data)
+{
+    std::lock_guard<std::mutex> lock(m_commitMutex);
+    data->m_version = ++m_lastVersion;
+    std::atomic_store(&m_current, std::shared_ptr<const PcbData>(std::move(data)));
+    return m_lastVersion;
+}
+
+uint64_t PcbDataVersions::Commit(PcbData&& data)
+{
+    return Commit(std::make_shared<PcbData>(std::move(data)));
+}
+
+void PcbDataVersions::Clear()
+{
+    std::lock_guard<std::mutex> lock(m_commitMutex);
+    std::atomic_store(&m_current, std::shared_ptr<const PcbData>());
+}
@@ -0,0 +1,45 @@
+#ifndef PCB_DATA_VERSIONS_H
+#define PCB_DATA_VERSIONS_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+class PcbData;
+
+// Publishes a board as a sequence of immutable versions, so the GUI and
+// analysis threads can read while the router commits tracks.
+//
+// A reader pins a version by keeping the pointer Current() returns; that
+// version never changes, however many are committed after it, and reading
+// it takes no locks. A writer copies the current version (cheap: the copy
+// shares every element chunk), edits the copy and commits it. Only the
+// chunks the edit wrote are duplicated.
+class PcbDataVersions {
+public:
+    PcbDataVersions() = default;
+
+    // The latest committed version, or null before the first commit.
+    std::shared_ptr<const PcbData> Current() const;
+
+    /**
+     * @brief Publishes a board as the next version.
+     *
+     * The board must not be modified afterwards. Writers are serialized
+     * against each other; a writer that edits a copy of an older version
+     * replaces any commits made since, so there should only be one.
+     * @return The new version number, counting from 1.
+     */
+    uint64_t Commit(std::shared_ptr<PcbData> data);
+    uint64_t Commit(PcbData&& data);
+
+    // Drops the current version. Readers that pinned it keep their copy.
+    void Clear();
+
+private:
+    std::shared_ptr<const PcbData> m_current; // Accessed only with the std::atomic_* functions
+    std::mutex m_commitMutex;                 // Taken by writers; readers never wait on it
+    uint64_t m_lastVersion = 0;
+};
+
+#endif // PCB_DATA_VERSIONS_H
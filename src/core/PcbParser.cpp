@@ -1,9 +1,22 @@
 #include "core/PcbParser.h"
 #include "core/PcbData.h"
+#include "core/PcbDataCache.h"
 #include "kicad/KicadPcb.h"
 #include "kicad/Sexp.h"
+#include "kicad/SexpKeywords.h"
+#include "kicad/SexpStreamParser.h"
+#include "kicad/SexpChunkedParser.h"
+#include "kicad/MappedFile.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <exception>
 #include <iostream>
-#include <wx/log.h>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 #include <stdexcept>
 
 PcbParser::PcbParser() : m_kicadPcb(std::make_unique<KicadPcb>()) {}
@@ -11,13 +24,47 @@ PcbParser::PcbParser() : m_kicadPcb(std::make_unique<KicadPcb>()) {}
 PcbParser::~PcbParser() = default;
 
 namespace {
-    // Helper to find a child node by its key, e.g., find (layer F.Cu) within a parent.
-    const SexpNode* findNode(const SexpNode& parent, const std::string& key) {
-        if (!parent.isList()) {
-            return nullptr;
+    // Atoms are views into the mapped file; these helpers convert them to owned values.
+    std::string toString(SexpAtom atom) {
+        return std::string(atom.data(), atom.size());
+    }
+
+    // Locale-independent number parsing. Malformed text is reported and
+    // rejected instead of throwing, so one bad element doesn't abort the load.
+    template <typename T>
+    bool parseNumber(SexpAtom atom, T& value) {
+        const char* first = atom.data();
+        const char* last = first + atom.size();
+        if (first != last && *first == '+') {
+            ++first; // from_chars doesn't accept an explicit plus sign
         }
+        auto result = std::from_chars(first, last, value);
+        if (result.ec != std::errc() || result.ptr != last) {
+            std::cerr << "Could not parse number '" << atom << "'." << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // Parses the numeric argument at 'index' of a node like (width 0.25).
+    template <typename T>
+    bool parseArgument(const SexpNode* node, size_t index, T& value) {
+        if (!node || node->getList().size() <= index || !node->getList()[index].isAtom()) return false;
+        return parseNumber(node->getList()[index].getAtom(), value);
+    }
+
+    // Parses a length in millimetres, like the 0.25 of (width 0.25), into board units.
+    bool parseCoordArgument(const SexpNode* node, size_t index, PcbCoord& value) {
+        double mm;
+        if (!parseArgument(node, index, mm)) return false;
+        value = MillimetresToCoord(mm);
+        return true;
+    }
+
+    // Helper to find a child node by its keyword, e.g., find (layer F.Cu) within a parent.
+    const SexpNode* findNode(const SexpNode& parent, SexpKeyword key) {
         for (const auto& child : parent.getList()) {
-            if (child.isList() && !child.getList().empty() && child.getList()[0].isAtom() && child.getList()[0].getAtom() == key) {
+            if (child.isList() && child.getKeyword() == key) {
                 return &child;
             }
         }
@@ -25,105 +72,347 @@ namespace {
     }
 
     // Helper to parse nodes like (at x y), (start x y), (end x y)
-    bool parsePoint(const SexpNode* node, wxPoint2DDouble& point) {
-        if (!node || !node->isList() || node->getList().size() < 3) return false;
-        try {
-            point.m_x = std::stod(node->getList()[1].getAtom());
-            point.m_y = std::stod(node->getList()[2].getAtom());
-            return true;
-        } catch (const std::invalid_argument& e) {
-            wxLogError("Could not parse point coordinate: %s", e.what());
-            return false;
-        }
+    bool parsePoint(const SexpNode* node, PcbPoint& point) {
+        return parseCoordArgument(node, 1, point.x) && parseCoordArgument(node, 2, point.y);
     }
 
     // Helper to parse nodes like (size w h)
-    bool parseSize(const SexpNode* node, wxPoint2DDouble& size) {
-        if (!node || !node->isList() || node->getList().size() < 3) return false;
-        try {
-            size.m_x = std::stod(node->getList()[1].getAtom());
-            size.m_y = std::stod(node->getList()[2].getAtom());
-            return true;
-        } catch (const std::invalid_argument& e) {
-            wxLogError("Could not parse size coordinate: %s", e.what());
-            return false;
+    bool parseSize(const SexpNode* node, PcbPoint& size) {
+        return parseCoordArgument(node, 1, size.x) && parseCoordArgument(node, 2, size.y);
+    }
+
+    // Interns the layer named by the atom at 'index' of a node like (layer F.Cu).
+    PcbLayerId layerArgument(const SexpNode& node, size_t index, PcbData& pcbData) {
+        return pcbData.AddLayer(toString(node.getList()[index].getAtom()));
+    }
+
+    // Expands one entry of a pad's (layers ...) list. "*.Cu" is every copper
+    // layer, "*.Mask" is F.Mask and B.Mask, and KiCad 5's "F&B.Cu" is the two
+    // outer layers. A wildcard that matches nothing (the board had no layer
+    // header) falls back to the front and back layers, KiCad's default.
+    PcbLayerSet layerSetFromName(SexpAtom name, PcbData& pcbData) {
+        if (name.size() > 2 && name.substr(0, 2) == "*.") {
+            const std::string suffix = toString(name.substr(1));
+            PcbLayerSet layers = 0;
+            for (size_t i = 0; i < pcbData.GetLayers().size(); ++i) {
+                const std::string& layerName = pcbData.GetLayers()[i].name;
+                if (layerName.size() >= suffix.size() &&
+                    layerName.compare(layerName.size() - suffix.size(), suffix.size(), suffix) == 0) {
+                    layers |= LayerBit(static_cast<PcbLayerId>(i));
+                }
+            }
+            if (layers == 0) {
+                layers = LayerBit(pcbData.AddLayer("F" + suffix)) | LayerBit(pcbData.AddLayer("B" + suffix));
+            }
+            return layers;
+        }
+        if (name.size() > 4 && name.substr(0, 4) == "F&B.") {
+            const std::string suffix = toString(name.substr(3));
+            return LayerBit(pcbData.AddLayer("F" + suffix)) | LayerBit(pcbData.AddLayer("B" + suffix));
+        }
+        return LayerBit(pcbData.AddLayer(toString(name)));
+    }
+
+    PcbLayerSet parseLayerSet(const SexpNode& layersNode, PcbData& pcbData) {
+        PcbLayerSet layers = 0;
+        for (size_t i = 1; i < layersNode.getList().size(); ++i) {
+            if (layersNode.getList()[i].isAtom()) {
+                layers |= layerSetFromName(layersNode.getList()[i].getAtom(), pcbData);
+            }
         }
+        return layers;
+    }
+
+    PcbLayerType layerTypeFromName(SexpAtom name) {
+        if (name == "signal") return PcbLayerType::Signal;
+        if (name == "power") return PcbLayerType::Power;
+        if (name == "mixed") return PcbLayerType::Mixed;
+        if (name == "jumper") return PcbLayerType::Jumper;
+        return PcbLayerType::User;
     }
 
     // --- Individual element parsers ---
 
+    // Reads the board's (layers (0 "F.Cu" signal) (31 "B.Cu" signal) ...)
+    // header. Pads and zones have (layers ...) children too, but theirs hold
+    // plain atoms and are skipped here.
+    void parseLayerTable(const SexpNode& node, PcbData& pcbData) {
+        for (const auto& entry : node.getList()) {
+            if (!entry.isList() || entry.getList().size() < 3 || !entry.getList()[1].isAtom()) continue;
+            PcbLayer layer;
+            if (!parseNumber(entry.getList()[0].getAtom(), layer.number)) continue;
+            layer.name = toString(entry.getList()[1].getAtom());
+            layer.type = layerTypeFromName(entry.getList()[2].getAtom());
+            pcbData.AddLayer(layer);
+        }
+    }
+
+    // Declarations, (net 3 "GND"), and the named references inside pads.
+    // Segment and via references, (net 3), carry no name and are skipped.
     void parseNet(const SexpNode& node, PcbData& pcbData) {
-        if (node.getList().size() > 2 && node.getList()[2].isAtom()) {
-            pcbData.AddNet(node.getList()[2].getAtom());
+        int number;
+        if (node.getList().size() > 2 && node.getList()[2].isAtom() && parseArgument(&node, 1, number)) {
+            pcbData.AddNet(number, toString(node.getList()[2].getAtom()));
+        }
+    }
+
+    // Outline arcs are followed by straight edges at most this far inside
+    // the true curve.
+    constexpr double ArcMaxError = 0.005 * PcbCoordsPerMillimetre;
+    constexpr double TwoPi = 6.283185307179586;
+
+    // Adds one straight piece of the board outline; GetBoardOutline()
+    // chains them into rings by their shared endpoints.
+    void addEdge(PcbPoint start, PcbPoint end, PcbCoord width, PcbData& pcbData) {
+        if (start == end) return;
+        PcbLine line;
+        line.start = start;
+        line.end = end;
+        line.width = width;
+        line.layer = pcbData.AddLayer("Edge.Cuts");
+        pcbData.AddLine(line);
+    }
+
+    // Adds the arc from start around (cx, cy) by sweep radians to end as
+    // edges. Its ends are kept exactly, so it chains with its neighbours.
+    void addArcEdges(double cx, double cy, PcbPoint start, double sweep, PcbPoint end, PcbCoord width, PcbData& pcbData) {
+        const double radius = std::hypot(start.x - cx, start.y - cy);
+        const double step = radius > ArcMaxError ? 2 * std::acos(1 - ArcMaxError / radius) : TwoPi;
+        const int count = std::clamp(static_cast<int>(std::ceil(std::abs(sweep) / step)), 1, 360);
+        const double startAngle = std::atan2(start.y - cy, start.x - cx);
+        PcbPoint from = start;
+        for (int i = 1; i < count; ++i) {
+            const double angle = startAngle + sweep * i / count;
+            const PcbPoint to{static_cast<PcbCoord>(std::llround(cx + radius * std::cos(angle))),
+                              static_cast<PcbCoord>(std::llround(cy + radius * std::sin(angle)))};
+            addEdge(from, to, width, pcbData);
+            from = to;
         }
+        addEdge(from, end, width, pcbData);
     }
 
-    void parseGrLine(const SexpNode& node, PcbData& pcbData) {
-        const SexpNode* layerNode = findNode(node, "layer");
-        // Only care about Edge.Cuts for gr_line
-        if (layerNode && layerNode->getList().size() > 1 && layerNode->getList()[1].getAtom() == "Edge.Cuts") {
-            PcbLine line;
-            const SexpNode* startNode = findNode(node, "start");
-            const SexpNode* endNode = findNode(node, "end");
-            const SexpNode* widthNode = findNode(node, "width");
+    // An arc given by three points on it, as KiCad 6 and later write them.
+    void addArcThrough(PcbPoint start, PcbPoint mid, PcbPoint end, PcbCoord width, PcbData& pcbData) {
+        const double ax = start.x, ay = start.y, bx = mid.x, by = mid.y, ex = end.x, ey = end.y;
+        const double d = 2 * (ax * (by - ey) + bx * (ey - ay) + ex * (ay - by));
+        if (std::abs(d) < 1.0) {
+            addEdge(start, end, width, pcbData); // Too flat to tell from a line
+            return;
+        }
+        const double a2 = ax * ax + ay * ay, b2 = bx * bx + by * by, e2 = ex * ex + ey * ey;
+        const double cx = (a2 * (by - ey) + b2 * (ey - ay) + e2 * (ay - by)) / d;
+        const double cy = (a2 * (ex - bx) + b2 * (ax - ex) + e2 * (bx - ax)) / d;
+        auto turn = [&](PcbPoint p) {
+            const double angle = std::atan2(p.y - cy, p.x - cx) - std::atan2(ay - cy, ax - cx);
+            return angle < 0 ? angle + TwoPi : angle;
+        };
+        // Going the positive way, the middle comes before the end or it is
+        // the other way round.
+        const double sweep = turn(end);
+        addArcEdges(cx, cy, start, turn(mid) <= sweep ? sweep : sweep - TwoPi, end, width, pcbData);
+    }
+
+    // Reads an Edge.Cuts graphic as outline edges: lines, rectangles,
+    // polygons, arcs and circles, the latter two as short straight edges.
+    // The width is (width w) before KiCad 7 and (stroke (width w) ...) since.
+    void parseEdgeCut(const SexpNode& node, PcbData& pcbData) {
+        const SexpNode* layerNode = findNode(node, SexpKeyword::layer);
+        if (!layerNode || layerNode->getList().size() < 2 || !layerNode->getList()[1].isAtom() ||
+            layerNode->getList()[1].getAtom() != "Edge.Cuts") {
+            return;
+        }
+        const SexpNode* strokeNode = findNode(node, SexpKeyword::stroke);
+        PcbCoord width = 0;
+        parseCoordArgument(findNode(strokeNode ? *strokeNode : node, SexpKeyword::width), 1, width);
 
-            if (parsePoint(startNode, line.start) &&
-                parsePoint(endNode, line.end) &&
-                widthNode && widthNode->getList().size() > 1) {
-                line.width = std::stod(widthNode->getList()[1].getAtom());
-                line.layer = "Edge.Cuts";
-                pcbData.AddLine(line);
+        PcbPoint start, end, mid;
+        const bool hasStart = parsePoint(findNode(node, SexpKeyword::start), start);
+        const bool hasEnd = parsePoint(findNode(node, SexpKeyword::end), end);
+        switch (node.getKeyword()) {
+            case SexpKeyword::gr_line:
+                if (hasStart && hasEnd) addEdge(start, end, width, pcbData);
+                break;
+            case SexpKeyword::gr_rect:
+                if (hasStart && hasEnd) {
+                    const PcbPoint corners[4] = {start, {end.x, start.y}, end, {start.x, end.y}};
+                    for (int i = 0; i < 4; ++i) {
+                        addEdge(corners[i], corners[(i + 1) % 4], width, pcbData);
+                    }
+                }
+                break;
+            case SexpKeyword::gr_arc:
+                if (!hasStart || !hasEnd) break;
+                if (parsePoint(findNode(node, SexpKeyword::mid), mid)) {
+                    addArcThrough(start, mid, end, width, pcbData);
+                } else {
+                    // KiCad 5: (start) is the centre, (end) where the arc
+                    // starts and (angle) its sweep in degrees.
+                    double degrees;
+                    if (!parseArgument(findNode(node, SexpKeyword::angle), 1, degrees)) break;
+                    const double sweep = degrees * TwoPi / 360;
+                    const double dx = end.x - start.x, dy = end.y - start.y;
+                    const PcbPoint arcEnd{static_cast<PcbCoord>(std::llround(start.x + dx * std::cos(sweep) - dy * std::sin(sweep))),
+                                          static_cast<PcbCoord>(std::llround(start.y + dx * std::sin(sweep) + dy * std::cos(sweep)))};
+                    addArcEdges(start.x, start.y, end, sweep, arcEnd, width, pcbData);
+                }
+                break;
+            case SexpKeyword::gr_circle:
+                if (parsePoint(findNode(node, SexpKeyword::center), start) && hasEnd) {
+                    addArcEdges(start.x, start.y, end, TwoPi, end, width, pcbData);
+                }
+                break;
+            case SexpKeyword::gr_poly: {
+                // (pts (xy x y) ... (arc (start) (mid) (end)) ...), closed.
+                const SexpNode* ptsNode = findNode(node, SexpKeyword::pts);
+                if (!ptsNode) break;
+                bool started = false;
+                PcbPoint first, last;
+                auto lineTo = [&](PcbPoint point) {
+                    if (started) {
+                        addEdge(last, point, width, pcbData);
+                    } else {
+                        first = point;
+                        started = true;
+                    }
+                    last = point;
+                };
+                for (const SexpNode& pt : ptsNode->getList()) {
+                    if (!pt.isList()) continue;
+                    if (pt.getKeyword() == SexpKeyword::xy && parsePoint(&pt, end)) {
+                        lineTo(end);
+                    } else if (pt.getKeyword() == SexpKeyword::arc && parsePoint(findNode(pt, SexpKeyword::start), start) &&
+                               parsePoint(findNode(pt, SexpKeyword::mid), mid) && parsePoint(findNode(pt, SexpKeyword::end), end)) {
+                        lineTo(start);
+                        addArcThrough(start, mid, end, width, pcbData);
+                        last = end;
+                    }
+                }
+                if (started) addEdge(last, first, width, pcbData);
+                break;
             }
+            default:
+                break;
         }
     }
 
-    void parsePad(const SexpNode& node, PcbData& pcbData) {
-        if (node.getList().size() < 4) return; // Not a valid pad definition
+    // Reads a pad as the file gives it: its position relative to its
+    // footprint, its rotation including the footprint's and its net number.
+    bool parsePad(const SexpNode& node, PcbData& pcbData, PcbPad& pad) {
+        if (node.getList().size() < 4) return false; // Not a valid pad definition
 
-        PcbPad pad;
-        const SexpNode* atNode = findNode(node, "at");
-        const SexpNode* sizeNode = findNode(node, "size");
-        const SexpNode* layersNode = findNode(node, "layers");
-        const SexpNode* netNode = findNode(node, "net");
-
-        const std::string& padType = node.getList()[2].getAtom();
-        if (padType == "np_thru_hole") {
-            pad.shape = "np_thru_hole"; // Use this special value for the renderer
+        const SexpNode* atNode = findNode(node, SexpKeyword::at);
+        const SexpNode* sizeNode = findNode(node, SexpKeyword::size);
+        const SexpNode* layersNode = findNode(node, SexpKeyword::layers);
+        const SexpNode* netNode = findNode(node, SexpKeyword::net);
+        if (atNode && atNode->getList().size() > 3 && !parseArgument(atNode, 3, pad.rotation)) return false;
+
+        if (node.getList()[2].getKeyword() == SexpKeyword::np_thru_hole) {
+            pad.shape = PcbPadShape::NpThruHole;
             if (parsePoint(atNode, pad.pos) && parseSize(sizeNode, pad.size)) {
-                pcbData.AddPad(pad);
+                if (layersNode) pad.layers = parseLayerSet(*layersNode, pcbData);
+                return true;
             }
-            return;
+            return false;
         }
 
         // For normal pads (smd, thru_hole)
         if (parsePoint(atNode, pad.pos) && parseSize(sizeNode, pad.size) &&
             node.getList()[3].isAtom() &&
             layersNode && layersNode->getList().size() > 1 &&
-            netNode && netNode->getList().size() > 1) {
-            
-            pad.shape = node.getList()[3].getAtom(); // Shape is the 4th element
-            pad.layer = layersNode->getList()[1].getAtom();
-            pad.netId = std::stoi(netNode->getList()[1].getAtom());
+            parseArgument(netNode, 1, pad.netId)) {
+
+            pad.shape = PadShapeFromName(node.getList()[3].getAtom()); // Shape is the 4th element
+            pad.layers = parseLayerSet(*layersNode, pcbData);
+            // Drawn on its first copper layer, e.g. F.Cu for a "*.Cu" pad.
+            const PcbLayerSet copper = pad.layers & pcbData.GetCopperLayers();
+            pad.layer = FirstLayer(copper ? copper : pad.layers);
+            return true;
+        }
+        return false;
+    }
+
+    // Collects the pads of one footprint while it is read, then adds the
+    // footprint to the board as a definition and a placed instance. The
+    // footprint's (at ...) may follow its pads, so the pads are only turned
+    // into the footprint's frame once the footprint is complete.
+    class FootprintBuilder {
+    public:
+        void begin() {
+            m_def = PcbFootprintDef();
+            m_footprint = PcbFootprint();
+            m_nets.clear();
+            m_named = false;
+        }
+
+        // The first atom of the footprint is its library id.
+        void name(SexpAtom name) {
+            if (!m_named) {
+                m_def.name = toString(name);
+                m_named = true;
+            }
+        }
+
+        // The footprint's own (at x y [rotation]) and (layer F.Cu).
+        void placement(const SexpNode& node, PcbData& pcbData) {
+            if (node.getKeyword() == SexpKeyword::at) {
+                parsePoint(&node, m_footprint.pos);
+                if (node.getList().size() > 3) parseArgument(&node, 3, m_footprint.rotation);
+            } else if (node.getKeyword() == SexpKeyword::layer && node.getList().size() > 1) {
+                m_footprint.layer = layerArgument(node, 1, pcbData);
+            }
+        }
+
+        void pad(const SexpNode& node, PcbData& pcbData) {
+            PcbPad pad;
+            if (!parsePad(node, pcbData, pad)) return;
+            m_nets.push_back(pad.netId);
+            pad.netId = -1;
+            m_def.pads.push_back(pad);
+            if (const SexpNode* netNode = findNode(node, SexpKeyword::net)) {
+                parseNet(*netNode, pcbData);
+            }
+        }
+
+        // Adds the footprint. One without pads adds nothing.
+        void finish(PcbData& pcbData) {
+            if (m_def.pads.empty()) return;
+            for (PcbPad& pad : m_def.pads) {
+                pad.rotation = std::fmod(pad.rotation - m_footprint.rotation, 360.0);
+                if (pad.rotation < 0) pad.rotation += 360.0;
+            }
+            m_footprint.def = pcbData.AddFootprintDef(m_def);
+            pcbData.AddFootprint(m_footprint, PcbSpan<int32_t>(m_nets));
+        }
+
+    private:
+        PcbFootprintDef m_def;
+        PcbFootprint m_footprint;
+        std::vector<int32_t> m_nets;
+        bool m_named = false;
+    };
+
+    // A pad outside any footprint is placed where it says.
+    void parseLonePad(const SexpNode& node, PcbData& pcbData) {
+        PcbPad pad;
+        if (parsePad(node, pcbData, pad)) {
             pcbData.AddPad(pad);
         }
     }
 
     void parseSegment(const SexpNode& node, PcbData& pcbData) {
-        const SexpNode* layerNode = findNode(node, "layer");
+        const SexpNode* layerNode = findNode(node, SexpKeyword::layer);
         if (layerNode && layerNode->getList().size() > 1) {
             PcbLine segment;
-            const SexpNode* startNode = findNode(node, "start");
-            const SexpNode* endNode = findNode(node, "end");
-            const SexpNode* widthNode = findNode(node, "width");
-            const SexpNode* netNode = findNode(node, "net");
+            const SexpNode* startNode = findNode(node, SexpKeyword::start);
+            const SexpNode* endNode = findNode(node, SexpKeyword::end);
+            const SexpNode* widthNode = findNode(node, SexpKeyword::width);
+            const SexpNode* netNode = findNode(node, SexpKeyword::net);
 
             if (parsePoint(startNode, segment.start) &&
                 parsePoint(endNode, segment.end) &&
-                widthNode && widthNode->getList().size() > 1 &&
-                netNode && netNode->getList().size() > 1) {
-                segment.width = std::stod(widthNode->getList()[1].getAtom());
-                segment.layer = layerNode->getList()[1].getAtom();
-                segment.netId = std::stoi(netNode->getList()[1].getAtom());
+                parseCoordArgument(widthNode, 1, segment.width) &&
+                parseArgument(netNode, 1, segment.netId)) {
+                segment.layer = layerArgument(*layerNode, 1, pcbData);
                 pcbData.AddLine(segment);
             }
         }
@@ -131,45 +420,124 @@ namespace {
 
     void parseVia(const SexpNode& node, PcbData& pcbData) {
         PcbVia via;
-        const SexpNode* atNode = findNode(node, "at");
-        const SexpNode* sizeNode = findNode(node, "size");
-        const SexpNode* drillNode = findNode(node, "drill");
-        const SexpNode* layersNode = findNode(node, "layers");
-        const SexpNode* netNode = findNode(node, "net");
+        const SexpNode* atNode = findNode(node, SexpKeyword::at);
+        const SexpNode* sizeNode = findNode(node, SexpKeyword::size);
+        const SexpNode* drillNode = findNode(node, SexpKeyword::drill);
+        const SexpNode* layersNode = findNode(node, SexpKeyword::layers);
+        const SexpNode* netNode = findNode(node, SexpKeyword::net);
 
         if (parsePoint(atNode, via.pos) &&
-            sizeNode && sizeNode->getList().size() > 1 &&
-            drillNode && drillNode->getList().size() > 1 &&
+            parseCoordArgument(sizeNode, 1, via.size) &&
+            parseCoordArgument(drillNode, 1, via.drill) &&
             layersNode && layersNode->getList().size() > 2 &&
-            netNode && netNode->getList().size() > 1) {
-            via.size = std::stod(sizeNode->getList()[1].getAtom());
-            via.drill = std::stod(drillNode->getList()[1].getAtom());
-            via.fromLayer = layersNode->getList()[1].getAtom();
-            via.toLayer = layersNode->getList()[2].getAtom();
-            via.netId = std::stoi(netNode->getList()[1].getAtom());
+            parseArgument(netNode, 1, via.netId)) {
+            via.fromLayer = layerArgument(*layersNode, 1, pcbData);
+            via.toLayer = layerArgument(*layersNode, 2, pcbData);
+            via.layers = pcbData.GetCopperSpan(via.fromLayer, via.toLayer);
             pcbData.AddVia(via);
         }
     }
 
+    bool parseRing(const SexpNode& polygonNode, std::vector<PcbPoint>& ring) {
+        const SexpNode* ptsNode = findNode(polygonNode, SexpKeyword::pts);
+        if (ptsNode) {
+            for (const auto& ptNode : ptsNode->getList()) {
+                PcbPoint pt;
+                if (ptNode.getKeyword() == SexpKeyword::xy && ptNode.isList() && parsePoint(&ptNode, pt)) {
+                    ring.push_back(pt);
+                }
+            }
+        }
+        return !ring.empty();
+    }
+
+    // (keepout (tracks not_allowed) (vias allowed) ...) as PcbKeepout bits.
+    uint8_t parseKeepout(const SexpNode& keepoutNode) {
+        uint8_t keepout = 0;
+        for (const auto& rule : keepoutNode.getList()) {
+            if (!rule.isList() || rule.getList().size() < 2 ||
+                rule.getList()[1].getKeyword() != SexpKeyword::not_allowed) continue;
+            switch (rule.getKeyword()) {
+                case SexpKeyword::tracks:     keepout |= PcbKeepoutTracks; break;
+                case SexpKeyword::vias:       keepout |= PcbKeepoutVias; break;
+                case SexpKeyword::pads:       keepout |= PcbKeepoutPads; break;
+                case SexpKeyword::copperpour: keepout |= PcbKeepoutCopperPour; break;
+                case SexpKeyword::footprints: keepout |= PcbKeepoutFootprints; break;
+                default: break;
+            }
+        }
+        return keepout;
+    }
+
+    // A zone on several layers, e.g. a rule area on (layers "F.Cu" "B.Cu"),
+    // is added once per layer. Its first (polygon ...) is the outline and
+    // any further ones are cutouts, which are bridged into the outline.
     void parseZone(const SexpNode& node, PcbData& pcbData) {
         PcbZone zone;
-        const SexpNode* layerNode = findNode(node, "layer");
-        const SexpNode* netNode = findNode(node, "net");
-        const SexpNode* polygonNode = findNode(node, "polygon");
-
-        if (layerNode && layerNode->getList().size() > 1 && netNode && netNode->getList().size() > 1 && polygonNode) {
-            zone.layer = layerNode->getList()[1].getAtom();
-            zone.netId = std::stoi(netNode->getList()[1].getAtom());
-            const SexpNode* ptsNode = findNode(*polygonNode, "pts");
-            if (ptsNode && ptsNode->isList()) {
-                for (const auto& ptNode : ptsNode->getList()) {
-                    if (ptNode.isList() && !ptNode.getList().empty() && ptNode.getList()[0].getAtom() == "xy" && ptNode.getList().size() > 2) {
-                        zone.polygon.emplace_back(std::stod(ptNode.getList()[1].getAtom()), std::stod(ptNode.getList()[2].getAtom()));
-                    }
-                }
+        const SexpNode* layerNode = findNode(node, SexpKeyword::layer);
+        const SexpNode* layersNode = findNode(node, SexpKeyword::layers);
+        const SexpNode* netNode = findNode(node, SexpKeyword::net);
+        const SexpNode* keepoutNode = findNode(node, SexpKeyword::keepout);
+        if (keepoutNode) {
+            zone.keepout = parseKeepout(*keepoutNode);
+        }
+
+        // Rule areas may have no net at all.
+        if (!netNode && !keepoutNode) return;
+        zone.netId = 0;
+        if (netNode && !parseArgument(netNode, 1, zone.netId)) return;
+        PcbLayerSet layers = 0;
+        if (layerNode && layerNode->getList().size() > 1) {
+            layers = LayerBit(layerArgument(*layerNode, 1, pcbData));
+        } else if (layersNode) {
+            layers = parseLayerSet(*layersNode, pcbData);
+        }
+
+        std::vector<PcbPoint> polygon;
+        for (const auto& child : node.getList()) {
+            if (!child.isList() || child.getKeyword() != SexpKeyword::polygon) continue;
+            std::vector<PcbPoint> ring;
+            if (!parseRing(child, ring)) continue;
+            if (polygon.empty()) {
+                polygon = std::move(ring);
+                continue;
+            }
+            // Close the outline, go round the cutout and come back.
+            if (polygon.back() != polygon.front()) polygon.push_back(polygon.front());
+            const PcbPoint anchor = polygon.front();
+            polygon.insert(polygon.end(), ring.begin(), ring.end());
+            polygon.push_back(ring.front());
+            polygon.push_back(anchor);
+        }
+        if (polygon.empty()) return;
+
+        zone.polygon = PcbPointSpan(polygon);
+        for (; layers != 0; layers &= layers - 1) {
+            zone.layer = FirstLayer(layers);
+            pcbData.AddZone(zone);
+        }
+    }
+
+    void recursiveExtract(const SexpNode& node, PcbData& pcbData);
+
+    // Footprints ("module" before KiCad 6) are read as a unit so their pads
+    // can be placed; anything else inside them is extracted as usual.
+    void parseFootprint(const SexpNode& node, PcbData& pcbData) {
+        FootprintBuilder footprint;
+        footprint.begin();
+        if (node.getList().size() > 1 && node.getList()[1].isAtom()) {
+            footprint.name(node.getList()[1].getAtom());
+        }
+        for (const auto& child : node.getList()) {
+            if (!child.isList() || child.getList().empty()) continue;
+            switch (child.getKeyword()) {
+                case SexpKeyword::at:
+                case SexpKeyword::layer: footprint.placement(child, pcbData); break;
+                case SexpKeyword::pad:   footprint.pad(child, pcbData); break;
+                default:                 recursiveExtract(child, pcbData); break;
             }
-            if (!zone.polygon.empty()) pcbData.AddZone(zone);
         }
+        footprint.finish(pcbData);
     }
 
     // --- The recursive traversal function ---
@@ -179,21 +547,21 @@ namespace {
         }
 
         // Check the type of the current node
-        if (node.getList()[0].isAtom()) {
-            const std::string& nodeType = node.getList()[0].getAtom();
-            if (nodeType == "net") {
-                parseNet(node, pcbData);
-            } else if (nodeType == "gr_line") {
-                parseGrLine(node, pcbData);
-            } else if (nodeType == "pad") {
-                parsePad(node, pcbData);
-            } else if (nodeType == "segment") {
-                parseSegment(node, pcbData);
-            } else if (nodeType == "via") {
-                parseVia(node, pcbData);
-            } else if (nodeType == "zone") {
-                parseZone(node, pcbData);
-            }
+        switch (node.getKeyword()) {
+            case SexpKeyword::footprint:
+            case SexpKeyword::module:  parseFootprint(node, pcbData); return;
+            case SexpKeyword::layers:  parseLayerTable(node, pcbData); break;
+            case SexpKeyword::net:     parseNet(node, pcbData); break;
+            case SexpKeyword::gr_line:
+            case SexpKeyword::gr_rect:
+            case SexpKeyword::gr_arc:
+            case SexpKeyword::gr_circle:
+            case SexpKeyword::gr_poly: parseEdgeCut(node, pcbData); return;
+            case SexpKeyword::pad:     parseLonePad(node, pcbData); return;
+            case SexpKeyword::segment: parseSegment(node, pcbData); break;
+            case SexpKeyword::via:     parseVia(node, pcbData); break;
+            case SexpKeyword::zone:    parseZone(node, pcbData); break;
+            default: break;
         }
 
         // Recurse into children
@@ -201,15 +569,289 @@ namespace {
             recursiveExtract(child, pcbData);
         }
     }
+
+    // --- Streaming extraction ---
+    // Captures each element recursiveExtract knows about as a small tree and
+    // skips subtrees that can never contain one without tokenizing them.
+    // Footprints are descended into rather than captured, so their graphics
+    // can still be skipped; their placement and pads are gathered on the way.
+    class PcbExtractHandler : public SexpEventHandler {
+    public:
+        explicit PcbExtractHandler(PcbData& pcbData) : m_pcbData(pcbData) {}
+
+        Action enterList(SexpAtom head) override {
+            const SexpKeyword keyword = lookupKeyword(head);
+            if (m_footprintDepth != 0 && m_depth == m_footprintDepth &&
+                (keyword == SexpKeyword::at || keyword == SexpKeyword::layer)) {
+                return Action::Capture;
+            }
+            switch (keyword) {
+                case SexpKeyword::footprint:
+                case SexpKeyword::module:
+                    m_footprint.begin();
+                    m_footprintDepth = ++m_depth;
+                    return Action::Descend;
+
+                case SexpKeyword::layers:
+                case SexpKeyword::net:
+                case SexpKeyword::gr_line:
+                case SexpKeyword::gr_rect:
+                case SexpKeyword::gr_arc:
+                case SexpKeyword::gr_circle:
+                case SexpKeyword::gr_poly:
+                case SexpKeyword::pad:
+                case SexpKeyword::segment:
+                case SexpKeyword::via:
+                case SexpKeyword::zone:
+                    return Action::Capture;
+
+                case SexpKeyword::fp_text:
+                case SexpKeyword::fp_text_box:
+                case SexpKeyword::fp_line:
+                case SexpKeyword::fp_arc:
+                case SexpKeyword::fp_circle:
+                case SexpKeyword::fp_rect:
+                case SexpKeyword::fp_poly:
+                case SexpKeyword::fp_curve:
+                case SexpKeyword::model:
+                case SexpKeyword::property:
+                case SexpKeyword::title_block:
+                case SexpKeyword::setup:
+                case SexpKeyword::general:
+                case SexpKeyword::paper:
+                case SexpKeyword::gr_text:
+                case SexpKeyword::gr_text_box:
+                case SexpKeyword::gr_curve:
+                case SexpKeyword::dimension:
+                case SexpKeyword::effects:
+                    return Action::Skip;
+
+                default:
+                    ++m_depth;
+                    return Action::Descend;
+            }
+        }
+
+        void atom(SexpAtom value) override {
+            if (m_footprintDepth != 0 && m_depth == m_footprintDepth) {
+                m_footprint.name(value);
+            }
+        }
+
+        void leaveList() override {
+            if (m_footprintDepth != 0 && m_depth == m_footprintDepth) {
+                m_footprint.finish(m_pcbData);
+                m_footprintDepth = 0;
+            }
+            --m_depth;
+        }
+
+        void capturedList(const SexpNode& node) override {
+            if (m_footprintDepth != 0) {
+                switch (node.getKeyword()) {
+                    case SexpKeyword::at:
+                    case SexpKeyword::layer: m_footprint.placement(node, m_pcbData); return;
+                    case SexpKeyword::pad:   m_footprint.pad(node, m_pcbData); return;
+                    default: break;
+                }
+            }
+            recursiveExtract(node, m_pcbData);
+        }
+
+    private:
+        PcbData& m_pcbData;
+        FootprintBuilder m_footprint;
+        int m_depth = 0;          // Lists descended into and not yet left
+        int m_footprintDepth = 0; // m_depth inside the current footprint; 0 outside one
+    };
+
+    // Captures only the net declarations directly inside the root list.
+    class NetListHandler : public SexpEventHandler {
+    public:
+        explicit NetListHandler(PcbData& pcbData) : m_pcbData(pcbData) {}
+
+        Action enterList(SexpAtom head) override {
+            if (m_depth == 0) {
+                m_depth++;
+                return Action::Descend;
+            }
+            return lookupKeyword(head) == SexpKeyword::net ? Action::Capture : Action::Skip;
+        }
+
+        void leaveList() override { m_depth--; }
+
+        void capturedList(const SexpNode& node) override { parseNet(node, m_pcbData); }
+
+    private:
+        PcbData& m_pcbData;
+        int m_depth = 0;
+    };
+
+    // Reads the unquoted atom or the quoted string at pos.
+    std::string_view leadingToken(std::string_view text, size_t pos) {
+        while (pos < text.size() && isspace(static_cast<unsigned char>(text[pos]))) {
+            pos++;
+        }
+        if (pos < text.size() && text[pos] == '"') {
+            const size_t end = text.find('"', pos + 1);
+            return end == std::string_view::npos ? std::string_view() : text.substr(pos + 1, end - pos - 1);
+        }
+        size_t end = pos;
+        while (end < text.size() && !isspace(static_cast<unsigned char>(text[end])) && text[end] != '(' && text[end] != ')') {
+            end++;
+        }
+        return text.substr(pos, end - pos);
+    }
+
+    // The board's layer header; every other item's layer ids depend on it.
+    bool isLayerTable(std::string_view item) {
+        return lookupKeyword(leadingToken(item, 1)) == SexpKeyword::layers;
+    }
+
+    // Starts a fragment off with another PcbData's layer table, so they
+    // number layers alike and wildcard pad layers expand the same way.
+    void copyLayerTable(const PcbData& from, PcbData& to) {
+        for (const PcbLayer& layer : from.GetLayers()) {
+            to.AddLayer(layer);
+        }
+    }
+
+    // Names a top-level item by its head keyword and its (tstamp ...) or
+    // (uuid ...) child, so an edited item can be told apart from a new one.
+    std::string itemIdentity(std::string_view item) {
+        const std::string_view head = leadingToken(item, 1);
+        for (std::string_view child : SexpStreamParser::findTopLevelLists(item)) {
+            const std::string_view childHead = leadingToken(child, 1);
+            const SexpKeyword keyword = lookupKeyword(childHead);
+            if (keyword == SexpKeyword::tstamp || keyword == SexpKeyword::uuid) {
+                const size_t valueStart = childHead.data() + childHead.size() - child.data();
+                std::string identity(head);
+                identity += ':';
+                identity += leadingToken(child, valueStart);
+                return identity;
+            }
+        }
+        return std::string();
+    }
+
+    // Extracts one top-level item into data and records what it produced.
+    PcbItemExtent extractItem(std::string_view item, PcbExtractHandler& handler, const PcbData& data) {
+        PcbItemExtent extent;
+        extent.firstLine = static_cast<uint32_t>(data.GetLines().size());
+        extent.firstPad = static_cast<uint32_t>(data.GetPads().size());
+        extent.firstVia = static_cast<uint32_t>(data.GetVias().size());
+        extent.firstZone = static_cast<uint32_t>(data.GetZones().size());
+        const size_t netCount = data.GetNets().size();
+
+        SexpStreamParser::parse(item, handler);
+
+        extent.lineCount = static_cast<uint32_t>(data.GetLines().size()) - extent.firstLine;
+        extent.padCount = static_cast<uint32_t>(data.GetPads().size()) - extent.firstPad;
+        extent.viaCount = static_cast<uint32_t>(data.GetVias().size()) - extent.firstVia;
+        extent.zoneCount = static_cast<uint32_t>(data.GetZones().size()) - extent.firstZone;
+        extent.netsAdded = static_cast<uint32_t>(data.GetNets().size() - netCount);
+        extent.hash = PcbDataCache::hashBytes(item);
+        extent.identity = itemIdentity(item);
+        return extent;
+    }
+
+    // Moves an extent's element ranges by the given element counts.
+    void offsetExtent(PcbItemExtent& extent, const PcbData& base) {
+        extent.firstLine += static_cast<uint32_t>(base.GetLines().size());
+        extent.firstPad += static_cast<uint32_t>(base.GetPads().size());
+        extent.firstVia += static_cast<uint32_t>(base.GetVias().size());
+        extent.firstZone += static_cast<uint32_t>(base.GetZones().size());
+    }
+
+    // Records where item lies within file, so writers can copy around it.
+    void setByteRange(PcbItemExtent& extent, std::string_view item, std::string_view file) {
+        extent.byteOffset = static_cast<uint64_t>(item.data() - file.data());
+        extent.byteSize = item.size();
+    }
+
+    void appendRange(std::vector<size_t>& indices, uint32_t first, uint32_t count) {
+        for (uint32_t i = 0; i < count; ++i) {
+            indices.push_back(first + i);
+        }
+    }
+
+    // Number of removed indices below index, i.e. how far a survivor moves down.
+    uint32_t removedBefore(const std::vector<size_t>& removed, uint32_t index) {
+        return static_cast<uint32_t>(std::lower_bound(removed.begin(), removed.end(), index) - removed.begin());
+    }
 } // anonymous namespace
 
 std::shared_ptr<PcbData> PcbParser::parseFile(const std::string& filePath) {
+    if (m_parseMode == ParseMode::Chunked || SexpChunkedParser::isCompressedPath(filePath)) {
+        return parseChunked(filePath);
+    }
+    if (m_parseMode == ParseMode::Streaming) {
+        return parseStreaming(filePath);
+    }
+    if (m_parseMode == ParseMode::Parallel) {
+        return parseParallel(filePath, nullptr);
+    }
+    return parseTree(filePath);
+}
+
+std::shared_ptr<PcbData> PcbParser::parseFile(const std::string& filePath, std::vector<PcbItemExtent>& items) {
+    if (SexpChunkedParser::isCompressedPath(filePath)) {
+        items.clear();
+        return parseChunked(filePath);
+    }
+    return parseParallel(filePath, &items);
+}
+
+bool PcbParser::parseNetNames(const std::string& filePath, std::vector<std::string>& netNames) {
+    if (SexpChunkedParser::isCompressedPath(filePath)) {
+        // Can't be mapped; stream it, skipping everything but the nets.
+        SexpChunkedParser reader(m_chunkSize);
+        if (!reader.open(filePath)) {
+            std::cerr << "PcbParser failed to load file: " << filePath << std::endl;
+            return false;
+        }
+        PcbData nets;
+        NetListHandler handler(nets);
+        try {
+            reader.parse(handler);
+        } catch (const std::runtime_error& e) {
+            std::cerr << "Error parsing KiCad PCB file: " << e.what() << std::endl;
+            return false;
+        }
+        netNames = nets.GetNets();
+        return true;
+    }
+
+    if (!m_kicadPcb->loadFromFile(filePath, true)) {
+        std::cerr << "PcbParser failed to load file: " << filePath << std::endl;
+        return false;
+    }
+
+    // Net declarations are direct children of the root. Only they are
+    // expanded; everything else stays an unread span.
+    PcbData nets;
+    try {
+        for (const SexpNode& child : m_kicadPcb->getRootNode().getList()) {
+            if (child.getKeyword() == SexpKeyword::net) {
+                parseNet(child, nets);
+            }
+        }
+    } catch (const std::runtime_error& e) {
+        std::cerr << "Error parsing KiCad PCB file: " << e.what() << std::endl;
+        return false;
+    }
+
+    netNames = nets.GetNets();
+    return true;
+}
+
+std::shared_ptr<PcbData> PcbParser::parseTree(const std::string& filePath) {
     if (!m_kicadPcb->loadFromFile(filePath)) {
         std::cerr << "PcbParser failed to load file: " << filePath << std::endl;
         return nullptr;
     }
 
-    std::cout << "File successfully parsed by KicadPcb. Now extracting data..." << std::endl;
+    std::clog << "File successfully parsed by KicadPcb. Now extracting data..." << std::endl;
 
     auto pcbData = std::make_shared<PcbData>();
     pcbData->Clear();
@@ -219,7 +861,335 @@ std::shared_ptr<PcbData> PcbParser::parseFile(const std::string& filePath) {
     // --- Extract Data using recursion ---
     recursiveExtract(root, *pcbData);
 
-    std::cout << "PcbData populated: " << pcbData->GetLines().size() << " lines/traces, " << pcbData->GetPads().size() << " pads, " << pcbData->GetVias().size() << " vias, " << pcbData->GetZones().size() << " zones." << std::endl;
+    pcbData->BuildNetIndex();
+    std::clog << "PcbData populated: " << pcbData->GetLines().size() << " lines/traces, " << pcbData->GetPads().size() << " pads, " << pcbData->GetVias().size() << " vias, " << pcbData->GetZones().size() << " zones." << std::endl;
 
     return pcbData;
-}
\ No newline at end of file
+}
+
+std::shared_ptr<PcbData> PcbParser::parseStreaming(const std::string& filePath) {
+    MappedFile source;
+    if (!source.open(filePath)) {
+        std::cerr << "PcbParser failed to load file: " << filePath << std::endl;
+        return nullptr;
+    }
+
+    auto pcbData = std::make_shared<PcbData>();
+    pcbData->Clear();
+
+    PcbExtractHandler handler(*pcbData);
+    try {
+        SexpStreamParser::parse(source.view(), handler);
+    } catch (const std::runtime_error& e) {
+        std::cerr << "Error parsing KiCad PCB file: " << e.what() << std::endl;
+        return nullptr;
+    }
+
+    pcbData->BuildNetIndex();
+    std::clog << "PcbData populated: " << pcbData->GetLines().size() << " lines/traces, " << pcbData->GetPads().size() << " pads, " << pcbData->GetVias().size() << " vias, " << pcbData->GetZones().size() << " zones." << std::endl;
+
+    return pcbData;
+}
+
+std::shared_ptr<PcbData> PcbParser::parseChunked(const std::string& filePath) {
+    SexpChunkedParser reader(m_chunkSize);
+    if (!reader.open(filePath)) {
+        std::cerr << "PcbParser failed to load file: " << filePath << std::endl;
+        return nullptr;
+    }
+
+    auto pcbData = std::make_shared<PcbData>();
+    pcbData->Clear();
+
+    PcbExtractHandler handler(*pcbData);
+    try {
+        reader.parse(handler);
+    } catch (const std::runtime_error& e) {
+        std::cerr << "Error parsing KiCad PCB file: " << e.what() << std::endl;
+        return nullptr;
+    }
+
+    pcbData->BuildNetIndex();
+    std::clog << "PcbData populated: " << pcbData->GetLines().size() << " lines/traces, " << pcbData->GetPads().size() << " pads, " << pcbData->GetVias().size() << " vias, " << pcbData->GetZones().size() << " zones." << std::endl;
+
+    return pcbData;
+}
+
+std::shared_ptr<PcbData> PcbParser::parseParallel(const std::string& filePath, std::vector<PcbItemExtent>* itemExtents) {
+    // Below this size thread start-up costs more than it saves.
+    const size_t minParallelBytes = 1024 * 1024;
+
+    MappedFile source;
+    if (!source.open(filePath)) {
+        std::cerr << "PcbParser failed to load file: " << filePath << std::endl;
+        return nullptr;
+    }
+
+    unsigned threadCount = m_threadCount;
+    if (threadCount == 0) {
+        threadCount = source.size() < minParallelBytes ? 1 : std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // Pre-scan for the byte ranges of the top-level items (footprints, segments, ...).
+    std::vector<std::string_view> items;
+    try {
+        items = SexpStreamParser::findTopLevelLists(source.view());
+    } catch (const std::runtime_error& e) {
+        std::cerr << "Error parsing KiCad PCB file: " << e.what() << std::endl;
+        return nullptr;
+    }
+
+    // Split the items into contiguous chunks of roughly equal size. Several
+    // chunks per thread keeps the workers busy when item sizes are uneven.
+    const size_t chunkCount = std::max<size_t>(1, std::min<size_t>(items.size(), threadCount * 4));
+    size_t totalBytes = 0;
+    for (const auto& item : items) {
+        totalBytes += item.size();
+    }
+    std::vector<size_t> chunkStarts{0};
+    size_t chunkBytes = 0;
+    for (size_t i = 0; i < items.size(); ++i) {
+        if (chunkStarts.size() < chunkCount && chunkBytes >= totalBytes / chunkCount) {
+            chunkStarts.push_back(i);
+            chunkBytes = 0;
+        }
+        chunkBytes += items[i].size();
+    }
+    chunkStarts.push_back(items.size());
+
+    // Each chunk extracts into its own fragment, so workers share nothing but
+    // the counter. All of them start from the board's layer table.
+    PcbData layerTable;
+    try {
+        PcbExtractHandler handler(layerTable);
+        for (const auto& item : items) {
+            if (isLayerTable(item)) {
+                SexpStreamParser::parse(item, handler);
+                break;
+            }
+        }
+    } catch (const std::runtime_error& e) {
+        std::cerr << "Error parsing KiCad PCB file: " << e.what() << std::endl;
+        return nullptr;
+    }
+    const size_t fragmentCount = chunkStarts.size() - 1;
+    std::vector<PcbData> fragments(fragmentCount);
+    for (PcbData& fragment : fragments) {
+        copyLayerTable(layerTable, fragment);
+    }
+    std::vector<std::exception_ptr> errors(fragmentCount);
+    std::atomic<size_t> nextChunk{0};
+
+    // Extents are recorded relative to their fragment and rebased while merging.
+    std::vector<PcbItemExtent> extents(itemExtents ? items.size() : 0);
+
+    auto worker = [&]() {
+        size_t chunk;
+        while ((chunk = nextChunk.fetch_add(1)) < fragmentCount) {
+            try {
+                PcbExtractHandler handler(fragments[chunk]);
+                for (size_t i = chunkStarts[chunk]; i < chunkStarts[chunk + 1]; ++i) {
+                    if (itemExtents) {
+                        extents[i] = extractItem(items[i], handler, fragments[chunk]);
+                    } else {
+                        SexpStreamParser::parse(items[i], handler);
+                    }
+                }
+            } catch (...) {
+                errors[chunk] = std::current_exception();
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned i = 1; i < std::min<size_t>(threadCount, fragmentCount); ++i) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    // Merging in document order gives the same element order and net
+    // numbering as the serial path.
+    auto pcbData = std::make_shared<PcbData>();
+    pcbData->Clear();
+    for (size_t i = 0; i < fragmentCount; ++i) {
+        if (errors[i]) {
+            try {
+                std::rethrow_exception(errors[i]);
+            } catch (const std::exception& e) {
+                std::cerr << "Error parsing KiCad PCB file: " << e.what() << std::endl;
+                return nullptr;
+            }
+        }
+        if (itemExtents) {
+            for (size_t item = chunkStarts[i]; item < chunkStarts[i + 1]; ++item) {
+                offsetExtent(extents[item], *pcbData);
+            }
+        }
+        pcbData->Append(fragments[i]);
+    }
+    if (itemExtents) {
+        for (size_t i = 0; i < items.size(); ++i) {
+            setByteRange(extents[i], items[i], source.view());
+        }
+        *itemExtents = std::move(extents);
+    }
+
+    pcbData->BuildNetIndex();
+    std::clog << "PcbData populated: " << pcbData->GetLines().size() << " lines/traces, " << pcbData->GetPads().size() << " pads, " << pcbData->GetVias().size() << " vias, " << pcbData->GetZones().size() << " zones." << std::endl;
+
+    return pcbData;
+}
+
+bool PcbParser::reloadFile(const std::string& filePath, PcbData& data, std::vector<PcbItemExtent>& items, PcbChangeSet& changes) {
+    changes = PcbChangeSet();
+
+    MappedFile source;
+    if (!source.open(filePath)) {
+        std::cerr << "PcbParser failed to load file: " << filePath << std::endl;
+        return false;
+    }
+
+    std::vector<std::string_view> spans;
+    try {
+        spans = SexpStreamParser::findTopLevelLists(source.view());
+    } catch (const std::runtime_error& e) {
+        std::cerr << "Error parsing KiCad PCB file: " << e.what() << std::endl;
+        return false;
+    }
+
+    // Items with byte-identical text are unchanged. Identical duplicates
+    // (e.g. gr_lines without a tstamp) are paired up in document order.
+    std::vector<std::pair<uint64_t, size_t>> oldByHash(items.size());
+    for (size_t i = 0; i < items.size(); ++i) {
+        oldByHash[i] = {items[i].hash, i};
+    }
+    std::sort(oldByHash.begin(), oldByHash.end());
+    const size_t noMatch = static_cast<size_t>(-1);
+    std::vector<bool> oldKept(items.size(), false);
+    std::vector<size_t> matchedOld(spans.size(), noMatch);
+    std::vector<size_t> newItemIndices;
+    for (size_t i = 0; i < spans.size(); ++i) {
+        const uint64_t hash = PcbDataCache::hashBytes(spans[i]);
+        auto it = std::lower_bound(oldByHash.begin(), oldByHash.end(), std::make_pair(hash, size_t(0)));
+        while (it != oldByHash.end() && it->first == hash && oldKept[it->second]) {
+            ++it;
+        }
+        if (it != oldByHash.end() && it->first == hash) {
+            oldKept[it->second] = true;
+            matchedOld[i] = it->second;
+        } else {
+            newItemIndices.push_back(i);
+        }
+    }
+
+    // Dropping an item that introduced a net, or adding one that introduces
+    // a new net, changes the net list; a full parse keeps its order the
+    // same as a fresh load. So does an edit to the layer table.
+    bool fullReload = false;
+    for (size_t i = 0; i < items.size() && !fullReload; ++i) {
+        fullReload = !oldKept[i] && items[i].netsAdded > 0;
+    }
+    for (size_t i = 0; i < newItemIndices.size() && !fullReload; ++i) {
+        fullReload = isLayerTable(spans[newItemIndices[i]]);
+    }
+
+    // Extract the new and edited items into a scratch fragment first, so a
+    // parse error leaves data untouched.
+    std::vector<PcbItemExtent> newItems(spans.size());
+    PcbData added;
+    copyLayerTable(data, added);
+    if (!fullReload) {
+        try {
+            PcbExtractHandler handler(added);
+            for (size_t i : newItemIndices) {
+                newItems[i] = extractItem(spans[i], handler, added);
+            }
+        } catch (const std::runtime_error& e) {
+            std::cerr << "Error parsing KiCad PCB file: " << e.what() << std::endl;
+            return false;
+        }
+        for (const auto& net : added.GetNets()) {
+            if (data.GetNetIdByName(net) < 0) {
+                fullReload = true;
+                break;
+            }
+        }
+    }
+
+    if (fullReload) {
+        auto fresh = parseParallel(filePath, &items);
+        if (!fresh) {
+            return false;
+        }
+        data = std::move(*fresh);
+        changes.fullReload = true;
+        return true;
+    }
+
+    // Remove what the vanished items produced.
+    std::unordered_map<std::string, int> removedIdentities;
+    int removedItems = 0;
+    for (size_t i = 0; i < items.size(); ++i) {
+        if (oldKept[i]) {
+            continue;
+        }
+        const PcbItemExtent& extent = items[i];
+        appendRange(changes.removedLines, extent.firstLine, extent.lineCount);
+        appendRange(changes.removedPads, extent.firstPad, extent.padCount);
+        appendRange(changes.removedVias, extent.firstVia, extent.viaCount);
+        appendRange(changes.removedZones, extent.firstZone, extent.zoneCount);
+        if (!extent.identity.empty()) {
+            removedIdentities[extent.identity]++;
+        }
+        removedItems++;
+    }
+    // Earlier reloads append edited items at the end, so extents are not in
+    // document order any more.
+    std::sort(changes.removedLines.begin(), changes.removedLines.end());
+    std::sort(changes.removedPads.begin(), changes.removedPads.end());
+    std::sort(changes.removedVias.begin(), changes.removedVias.end());
+    std::sort(changes.removedZones.begin(), changes.removedZones.end());
+    data.RemoveElements(changes.removedLines, changes.removedPads, changes.removedVias, changes.removedZones);
+
+    for (size_t i = 0; i < spans.size(); ++i) {
+        if (matchedOld[i] != noMatch) {
+            PcbItemExtent& extent = newItems[i];
+            extent = std::move(items[matchedOld[i]]);
+            extent.firstLine -= removedBefore(changes.removedLines, extent.firstLine);
+            extent.firstPad -= removedBefore(changes.removedPads, extent.firstPad);
+            extent.firstVia -= removedBefore(changes.removedVias, extent.firstVia);
+            extent.firstZone -= removedBefore(changes.removedZones, extent.firstZone);
+        }
+    }
+
+    // Append the new and edited items.
+    appendRange(changes.addedLines, static_cast<uint32_t>(data.GetLines().size()), static_cast<uint32_t>(added.GetLines().size()));
+    appendRange(changes.addedPads, static_cast<uint32_t>(data.GetPads().size()), static_cast<uint32_t>(added.GetPads().size()));
+    appendRange(changes.addedVias, static_cast<uint32_t>(data.GetVias().size()), static_cast<uint32_t>(added.GetVias().size()));
+    appendRange(changes.addedZones, static_cast<uint32_t>(data.GetZones().size()), static_cast<uint32_t>(added.GetZones().size()));
+    for (size_t i : newItemIndices) {
+        offsetExtent(newItems[i], data);
+        auto it = removedIdentities.find(newItems[i].identity);
+        if (it != removedIdentities.end() && it->second > 0) {
+            it->second--;
+            changes.itemsChanged++;
+        } else {
+            changes.itemsAdded++;
+        }
+    }
+    changes.itemsRemoved = removedItems - changes.itemsChanged;
+    // Kept items may have moved within the file.
+    for (size_t i = 0; i < spans.size(); ++i) {
+        setByteRange(newItems[i], spans[i], source.view());
+    }
+    data.Append(added);
+    data.BuildNetIndex();
+    items = std::move(newItems);
+
+    std::clog << "PcbData reloaded: " << changes.itemsAdded << " items added, " << changes.itemsRemoved << " removed, " << changes.itemsChanged << " changed." << std::endl;
+
+    return true;
+}
@@ -1,26 +1,106 @@
 #ifndef PCB_PARSER_H
 #define PCB_PARSER_H
 
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <vector>
 
 class PcbData; // Forward declaration
 class KicadPcb; // Forward declaration
+struct PcbChangeSet; // Forward declaration
+
+// Bookkeeping for one top-level item of a board file (a footprint, segment,
+// via, zone, net declaration, ...): what it was and which PcbData elements
+// it produced. Incremental reloads diff these against the new file.
+struct PcbItemExtent {
+    std::string identity;   // e.g. "segment:<uuid>"; empty if the item has no tstamp/uuid
+    uint64_t hash = 0;      // Hash of the item's text
+    uint64_t byteOffset = 0, byteSize = 0; // Where the item's text lies in the file
+    uint32_t netsAdded = 0; // Nets first seen in this item (may over-count, never under-counts)
+    uint32_t firstLine = 0, lineCount = 0;
+    uint32_t firstPad = 0, padCount = 0;
+    uint32_t firstVia = 0, viaCount = 0;
+    uint32_t firstZone = 0, zoneCount = 0;
+};
 
 class PcbParser {
 public:
+    enum class ParseMode {
+        Tree,     // Build the full S-expression tree, then walk it.
+        Streaming, // Extract in one pass from parser events, skipping uninteresting subtrees.
+        Parallel,  // Streaming extraction of the top-level items spread over worker threads.
+        Chunked    // Streaming extraction through a fixed-size read buffer; memory stays flat.
+    };
+
     PcbParser();
     ~PcbParser();
 
+    void setParseMode(ParseMode mode) { m_parseMode = mode; }
+    ParseMode getParseMode() const { return m_parseMode; }
+
+    /**
+     * @brief Sets the number of threads used by ParseMode::Parallel.
+     * @param count 0 picks one per hardware thread and parses small files on
+     *              the calling thread; any other value is used as given.
+     */
+    void setThreadCount(unsigned count) { m_threadCount = count; }
+
+    // Read buffer size for ParseMode::Chunked.
+    void setChunkSize(size_t bytes) { m_chunkSize = bytes; }
+
     /**
      * @brief Loads and parses a KiCad PCB file.
+     *
+     * Gzip-compressed boards (".kicad_pcb.gz") are always read with
+     * ParseMode::Chunked, which decompresses them on the fly.
      * @param filePath The path to the .kicad_pcb file.
      * @return A shared pointer to the populated PcbData object, or nullptr on failure.
      */
     std::shared_ptr<PcbData> parseFile(const std::string& filePath);
 
+    /**
+     * @brief Parses a file and records the extent of every top-level item,
+     *        for later use by reloadFile(). Always uses the parallel path.
+     * @param items Receives one entry per top-level item, in document order.
+     *              Left empty for compressed files, which can't be diffed in place.
+     */
+    std::shared_ptr<PcbData> parseFile(const std::string& filePath, std::vector<PcbItemExtent>& items);
+
+    /**
+     * @brief Reads only the board's net declarations, numbered as parseFile() numbers them.
+     *
+     * Uses a lazy parse that never expands footprints, tracks or zones, so
+     * it takes a fraction of the time of parseFile() on large boards.
+     * @param netNames Receives the net names.
+     * @return false if the file could not be read or parsed.
+     */
+    bool parseNetNames(const std::string& filePath, std::vector<std::string>& netNames);
+
+    /**
+     * @brief Brings data up to date with the file's current contents.
+     *
+     * Items whose text is unchanged are kept as they are; only removed and
+     * new or edited items are touched. Edits that would change the net list
+     * fall back to a full parse (reported through changes.fullReload).
+     * @param data The data produced by the previous parse or reload.
+     * @param items The item extents of that parse; updated in place.
+     * @param changes Receives what changed.
+     * @return false if the file could not be read or parsed; data and items are then unchanged.
+     */
+    bool reloadFile(const std::string& filePath, PcbData& data, std::vector<PcbItemExtent>& items, PcbChangeSet& changes);
+
 private:
+    std::shared_ptr<PcbData> parseTree(const std::string& filePath);
+    std::shared_ptr<PcbData> parseStreaming(const std::string& filePath);
+    std::shared_ptr<PcbData> parseParallel(const std::string& filePath, std::vector<PcbItemExtent>* items);
+    std::shared_ptr<PcbData> parseChunked(const std::string& filePath);
+
     std::unique_ptr<KicadPcb> m_kicadPcb;
+    ParseMode m_parseMode = ParseMode::Parallel;
+    unsigned m_threadCount = 0;
+    size_t m_chunkSize = 256 * 1024;
 };
 
 #endif // PCB_PARSER_H
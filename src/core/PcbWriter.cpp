@@ -0,0 +1,244 @@
+#include "core/PcbWriter.h"
+#include "core/PcbData.h"
+#include "core/PcbParser.h"
+#include "kicad/MappedFile.h"
+#include "kicad/SexpChunkedParser.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string_view>
+
+PcbWriter::PcbWriter() : m_source(std::make_unique<MappedFile>()) {}
+
+PcbWriter::~PcbWriter() = default;
+
+namespace {
+    bool isSpace(char c) {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+    }
+
+    // Appends nanometres as millimetres, with no trailing zeros and no
+    // rounding: every coordinate the parser reads writes back as it was.
+    void appendMm(std::string& out, PcbCoord nm) {
+        int64_t value = nm;
+        if (value < 0) {
+            out += '-';
+            value = -value;
+        }
+        out += std::to_string(value / 1000000);
+        int64_t fraction = value % 1000000;
+        if (fraction != 0) {
+            char digits[7] = {'.', '0', '0', '0', '0', '0', '0'};
+            int length = 7;
+            for (int i = 6; i > 0; --i) {
+                digits[i] = static_cast<char>('0' + fraction % 10);
+                fraction /= 10;
+            }
+            while (digits[length - 1] == '0') {
+                length--;
+            }
+            out.append(digits, length);
+        }
+    }
+
+    void appendPoint(std::string& out, const char* keyword, PcbPoint point) {
+        out += " (";
+        out += keyword;
+        out += ' ';
+        appendMm(out, point.x);
+        out += ' ';
+        appendMm(out, point.y);
+        out += ')';
+    }
+
+    void appendQuoted(std::string& out, const std::string& text) {
+        out += '"';
+        for (char c : text) {
+            if (c == '"' || c == '\\') {
+                out += '\\';
+            }
+            out += c;
+        }
+        out += '"';
+    }
+
+    // Each node goes on its own line, indented like the items KiCad writes.
+    void appendSegment(std::string& out, const PcbLine& line, const PcbData& data) {
+        out += "\n  (segment";
+        appendPoint(out, "start", line.start);
+        appendPoint(out, "end", line.end);
+        out += " (width ";
+        appendMm(out, line.width);
+        out += ") (layer ";
+        appendQuoted(out, data.GetLayerName(line.layer));
+        out += ") (net ";
+        out += std::to_string(line.netId);
+        out += "))";
+    }
+
+    void appendVia(std::string& out, const PcbVia& via, const PcbData& data) {
+        out += "\n  (via";
+        appendPoint(out, "at", via.pos);
+        out += " (size ";
+        appendMm(out, via.size);
+        out += ") (drill ";
+        appendMm(out, via.drill);
+        out += ") (layers ";
+        appendQuoted(out, data.GetLayerName(via.fromLayer));
+        out += ' ';
+        appendQuoted(out, data.GetLayerName(via.toLayer));
+        out += ") (net ";
+        out += std::to_string(via.netId);
+        out += "))";
+    }
+
+    // Where a removed item's line begins: its indentation and the line
+    // break before it go too, so no blank line is left behind.
+    uint64_t lineStart(std::string_view text, uint64_t offset, uint64_t floor) {
+        while (offset > floor && (text[offset - 1] == ' ' || text[offset - 1] == '\t')) {
+            offset--;
+        }
+        if (offset > floor && text[offset - 1] == '\n') {
+            offset--;
+            if (offset > floor && text[offset - 1] == '\r') {
+                offset--;
+            }
+        }
+        return offset;
+    }
+} // anonymous namespace
+
+bool PcbWriter::open(const std::string& sourcePath, const std::vector<PcbItemExtent>& items, const PcbDataCache::Key& key) {
+    m_items.clear();
+    m_sourcePath.clear();
+    if (SexpChunkedParser::isCompressedPath(sourcePath)) {
+        std::cerr << "PcbWriter can't splice into a compressed board: " << sourcePath << std::endl;
+        m_source->close();
+        return false;
+    }
+    if (!m_source->open(sourcePath)) {
+        std::cerr << "PcbWriter failed to load file: " << sourcePath << std::endl;
+        return false;
+    }
+    const std::string_view text = m_source->view();
+    if (text.size() != key.size || PcbDataCache::hashBytes(text) != key.hash) {
+        std::cerr << "PcbWriter: " << sourcePath << " changed since it was parsed" << std::endl;
+        m_source->close();
+        return false;
+    }
+    std::error_code ec;
+    m_sourceTime = std::filesystem::last_write_time(sourcePath, ec);
+    m_sourceSize = text.size();
+
+    m_items.reserve(items.size());
+    for (const PcbItemExtent& item : items) {
+        if (item.byteOffset + item.byteSize > text.size()) {
+            std::cerr << "PcbWriter: item extents don't match " << sourcePath << std::endl;
+            m_source->close();
+            m_items.clear();
+            return false;
+        }
+        m_items.push_back({item.byteOffset, item.byteSize});
+    }
+
+    if (!m_items.empty()) {
+        m_insertAt = m_items.back().offset + m_items.back().size;
+    } else {
+        // Back over the root's closing parenthesis and the space before it.
+        const size_t close = text.find_last_of(')');
+        if (close == std::string_view::npos) {
+            std::cerr << "PcbWriter: not a board file: " << sourcePath << std::endl;
+            m_source->close();
+            return false;
+        }
+        m_insertAt = close;
+        while (m_insertAt > 0 && isSpace(text[m_insertAt - 1])) {
+            m_insertAt--;
+        }
+    }
+    m_sourcePath = sourcePath;
+    return true;
+}
+
+bool PcbWriter::write(const std::string& outPath, const PcbData& data, const std::vector<PcbLine>& lines,
+                      const std::vector<PcbVia>& vias, const std::vector<size_t>& removedItems) const {
+    const std::string_view text = m_source->view();
+    if (text.empty() || m_sourcePath.empty()) {
+        std::cerr << "PcbWriter: no board is open." << std::endl;
+        return false;
+    }
+    // Rewritten in place the mapping would change under the copy, and
+    // replaced the extents would no longer describe it.
+    std::error_code ec;
+    const uint64_t size = std::filesystem::file_size(m_sourcePath, ec);
+    if (ec || size != m_sourceSize || std::filesystem::last_write_time(m_sourcePath, ec) != m_sourceTime) {
+        std::cerr << "PcbWriter: " << m_sourcePath << " changed on disk since it was opened" << std::endl;
+        return false;
+    }
+
+    // Format the new nodes up front, so a bad element leaves no half-written file.
+    std::string added;
+    added.reserve(lines.size() * 96 + vias.size() * 96);
+    for (const PcbLine& line : lines) {
+        if (data.GetLayerName(line.layer).empty()) {
+            std::cerr << "PcbWriter: segment on unknown layer " << static_cast<int>(line.layer) << std::endl;
+            return false;
+        }
+        appendSegment(added, line, data);
+    }
+    for (const PcbVia& via : vias) {
+        if (data.GetLayerName(via.fromLayer).empty() || data.GetLayerName(via.toLayer).empty()) {
+            std::cerr << "PcbWriter: via on unknown layer" << std::endl;
+            return false;
+        }
+        appendVia(added, via, data);
+    }
+
+    std::vector<size_t> removed = removedItems;
+    std::sort(removed.begin(), removed.end());
+    removed.erase(std::unique(removed.begin(), removed.end()), removed.end());
+    if (!removed.empty() && removed.back() >= m_items.size()) {
+        std::cerr << "PcbWriter: removed item " << removed.back() << " is out of range" << std::endl;
+        return false;
+    }
+
+    const std::string tempPath = outPath + ".tmp";
+    std::FILE* out = std::fopen(tempPath.c_str(), "wb");
+    if (!out) {
+        std::cerr << "PcbWriter failed to create file: " << tempPath << std::endl;
+        return false;
+    }
+
+    // Copy everything up to the splice point except the removed items, then
+    // the new nodes, then the rest of the file.
+    bool ok = true;
+    auto copy = [&](uint64_t from, uint64_t to) {
+        if (ok && to > from) {
+            ok = std::fwrite(text.data() + from, 1, to - from, out) == to - from;
+        }
+    };
+    uint64_t cursor = 0;
+    for (size_t item : removed) {
+        const ByteRange& range = m_items[item];
+        copy(cursor, lineStart(text, range.offset, cursor));
+        cursor = range.offset + range.size;
+    }
+    copy(cursor, m_insertAt);
+    if (ok && !added.empty()) {
+        ok = std::fwrite(added.data(), 1, added.size(), out) == added.size();
+    }
+    copy(std::max(cursor, m_insertAt), text.size());
+
+    ok = std::fclose(out) == 0 && ok;
+    if (ok) {
+        std::filesystem::rename(tempPath, outPath, ec);
+        ok = !ec;
+    }
+    if (!ok) {
+        std::cerr << "PcbWriter failed to write file: " << outPath << std::endl;
+        std::remove(tempPath.c_str());
+    }
+    return ok;
+}
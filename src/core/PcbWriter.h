@@ -0,0 +1,77 @@
+#ifndef PCB_WRITER_H
+#define PCB_WRITER_H
+
+#include "PcbDataCache.h"
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+class MappedFile; // Forward declaration
+class PcbData; // Forward declaration
+struct PcbItemExtent; // Forward declaration
+struct PcbLine; // Forward declaration
+struct PcbVia; // Forward declaration
+
+// Writes routed tracks back into the board file they were routed on.
+//
+// Nothing is re-serialized: the source's bytes are copied as they are and
+// the new (segment ...) and (via ...) nodes are spliced in after its last
+// top-level item, so everything the router doesn't touch round-trips
+// exactly. The source stays mapped between writes, and each write is one
+// pass of large sequential copies, so writing many routed variants of one
+// board is bound by the disk rather than by formatting.
+//
+// Output goes to a temporary file next to the target that is then renamed
+// over it, so the target can be the source itself and a failed write never
+// leaves a truncated board behind.
+class PcbWriter {
+public:
+    PcbWriter();
+    ~PcbWriter();
+
+    /**
+     * @brief Maps the board file the tracks are added to.
+     * @param items The extents parseFile() recorded for this file, which
+     *              locate the splice point and the items write() can leave
+     *              out. If empty the end of the board is found by scanning.
+     * @param key The key of the contents the board was parsed from (see
+     *            PcbDataCache::computeKey()); the extents only hold for those.
+     * @return false if the file can't be read or no longer has those
+     *         contents. Compressed boards can't be mapped and are rejected.
+     */
+    bool open(const std::string& sourcePath, const std::vector<PcbItemExtent>& items, const PcbDataCache::Key& key);
+
+    /**
+     * @brief Writes the source board with lines and vias added.
+     *
+     * Net ids are the file's net numbers, as the parser stores them. The
+     * nodes carry no uuid; KiCad assigns one when it loads the board.
+     * @param data The board parsed from the source (or a later version of
+     *             it), which names the layers.
+     * @param removedItems Indices into the items given to open() to leave
+     *                     out, e.g. tracks that were ripped up and rerouted.
+     * @return false if nothing is open, the source changed on disk since
+     *         it was opened (including by an earlier write over it), an
+     *         element is on a layer the board doesn't have, or the output
+     *         can't be written.
+     */
+    bool write(const std::string& outPath, const PcbData& data, const std::vector<PcbLine>& lines,
+               const std::vector<PcbVia>& vias, const std::vector<size_t>& removedItems = {}) const;
+
+private:
+    struct ByteRange {
+        uint64_t offset, size;
+    };
+
+    std::unique_ptr<MappedFile> m_source;
+    std::string m_sourcePath;
+    uint64_t m_sourceSize = 0;                        // When opened, to notice later changes
+    std::filesystem::file_time_type m_sourceTime{};
+    std::vector<ByteRange> m_items; // Of the items given to open()
+    uint64_t m_insertAt = 0;        // Just past the last top-level item
+};
+
+#endif // PCB_WRITER_H
@@ -0,0 +1,157 @@
+#include "PolygonRasterizer.h"
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define POLYGON_RASTERIZER_SSE2 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define POLYGON_RASTERIZER_NEON 1
+#endif
+
+namespace {
+    // Below this many rows or cells per thread, starting threads costs more
+    // than it saves.
+    constexpr int MinRowsPerBand = 64;
+    constexpr int64_t MinCellsPerBand = 64 * 1024;
+}
+
+void FillSpan(float* first, size_t count, float value)
+{
+    size_t i = 0;
+#if defined(POLYGON_RASTERIZER_SSE2)
+    const __m128 v = _mm_set1_ps(value);
+    for (; i + 8 <= count; i += 8) {
+        _mm_storeu_ps(first + i, v);
+        _mm_storeu_ps(first + i + 4, v);
+    }
+#elif defined(POLYGON_RASTERIZER_NEON)
+    const float32x4_t v = vdupq_n_f32(value);
+    for (; i + 4 <= count; i += 4) {
+        vst1q_f32(first + i, v);
+    }
+#endif
+    for (; i < count; ++i) {
+        first[i] = value;
+    }
+}
+
+PolygonRasterizer::PolygonRasterizer(int width, int height, double cellSize)
+    : m_width(width), m_height(height), m_cellSize(cellSize) {}
+
+void PolygonRasterizer::Fill(const std::vector<PcbPointSpan>& rings, float* cells, float value, bool outside) const
+{
+    if (m_width <= 0 || m_height <= 0) {
+        return;
+    }
+
+    // A row crosses an edge when its centre is in [top, bottom) of the edge,
+    // so a vertex shared by two edges is counted once.
+    std::vector<Edge> edges;
+    const double scale = 1.0 / (m_cellSize * PcbCoordsPerMillimetre);
+    for (const PcbPointSpan& ring : rings) {
+        for (size_t i = 0, j = ring.size() - 1; i < ring.size(); j = i++) {
+            double ax = (ring[j].x - m_origin.x) * scale, ay = (ring[j].y - m_origin.y) * scale;
+            double bx = (ring[i].x - m_origin.x) * scale, by = (ring[i].y - m_origin.y) * scale;
+            if (ay == by) continue;
+            if (ay > by) {
+                std::swap(ax, bx);
+                std::swap(ay, by);
+            }
+            Edge edge;
+            edge.rowFirst = static_cast<int>(std::ceil(ay));
+            edge.rowLast = static_cast<int>(std::ceil(by)) - 1;
+            edge.slope = (bx - ax) / (by - ay);
+            if (edge.rowFirst < 0) edge.rowFirst = 0;
+            if (edge.rowLast >= m_height) edge.rowLast = m_height - 1;
+            if (edge.rowFirst > edge.rowLast) continue;
+            edge.x = ax + (edge.rowFirst - ay) * edge.slope;
+            edges.push_back(edge);
+        }
+    }
+    if (edges.empty() && !outside) {
+        return;
+    }
+    std::sort(edges.begin(), edges.end(), [](const Edge& a, const Edge& b) { return a.rowFirst < b.rowFirst; });
+
+    // Only rows the polygon crosses need scanning; with outside the rows
+    // above and below it are filled whole, and they are contiguous.
+    int rowBegin = m_height, rowEnd = 0;
+    double left = m_width, right = 0;
+    for (const Edge& edge : edges) {
+        rowBegin = std::min(rowBegin, edge.rowFirst);
+        rowEnd = std::max(rowEnd, edge.rowLast + 1);
+        const double xLast = edge.x + (edge.rowLast - edge.rowFirst) * edge.slope;
+        left = std::min({left, edge.x, xLast});
+        right = std::max({right, edge.x, xLast});
+    }
+    if (rowBegin >= rowEnd) {
+        FillSpan(cells, static_cast<size_t>(m_width) * m_height, value);
+        return;
+    }
+    if (outside) {
+        FillSpan(cells, static_cast<size_t>(rowBegin) * m_width, value);
+        FillSpan(cells + static_cast<size_t>(rowEnd) * m_width, static_cast<size_t>(m_height - rowEnd) * m_width, value);
+    }
+
+    const int rows = rowEnd - rowBegin;
+    const int64_t columns = outside ? m_width : static_cast<int64_t>(std::clamp(right - left, 1.0, double(m_width)));
+    unsigned threadCount = m_threadCount ? m_threadCount : std::max(1u, std::thread::hardware_concurrency());
+    threadCount = std::min({threadCount, static_cast<unsigned>(rows / MinRowsPerBand),
+                            static_cast<unsigned>(rows * columns / MinCellsPerBand)});
+    if (threadCount <= 1) {
+        FillRows(edges, rowBegin, rowEnd, cells, value, outside);
+        return;
+    }
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < threadCount; ++t) {
+        const int bandBegin = rowBegin + static_cast<int>(int64_t(rows) * t / threadCount);
+        const int bandEnd = rowBegin + static_cast<int>(int64_t(rows) * (t + 1) / threadCount);
+        threads.emplace_back([&, bandBegin, bandEnd] { FillRows(edges, bandBegin, bandEnd, cells, value, outside); });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+void PolygonRasterizer::FillRows(const std::vector<Edge>& edges, int rowBegin, int rowEnd, float* cells, float value, bool outside) const
+{
+    // Each band walks the edges sorted by first row, so it only looks at
+    // the ones that have started and not yet ended.
+    std::vector<const Edge*> active;
+    std::vector<double> crossings;
+    size_t next = 0;
+    for (int row = rowBegin; row < rowEnd; ++row) {
+        while (next < edges.size() && edges[next].rowFirst <= row) {
+            if (edges[next].rowLast >= rowBegin) active.push_back(&edges[next]);
+            ++next;
+        }
+        active.erase(std::remove_if(active.begin(), active.end(), [row](const Edge* edge) { return edge->rowLast < row; }),
+                     active.end());
+
+        crossings.clear();
+        for (const Edge* edge : active) {
+            crossings.push_back(edge->x + (row - edge->rowFirst) * edge->slope);
+        }
+        std::sort(crossings.begin(), crossings.end());
+
+        // Cells whose centre is in [left, right) are inside.
+        float* rowCells = cells + static_cast<size_t>(row) * m_width;
+        int outsideFrom = 0;
+        for (size_t i = 0; i + 1 < crossings.size(); i += 2) {
+            const int first = static_cast<int>(std::clamp(std::ceil(crossings[i]), 0.0, double(m_width)));
+            const int last = static_cast<int>(std::clamp(std::ceil(crossings[i + 1]), 0.0, double(m_width)));
+            if (outside) {
+                if (first > outsideFrom) FillSpan(rowCells + outsideFrom, first - outsideFrom, value);
+                outsideFrom = std::max(outsideFrom, last);
+            } else if (last > first) {
+                FillSpan(rowCells + first, last - first, value);
+            }
+        }
+        if (outside && outsideFrom < m_width) {
+            FillSpan(rowCells + outsideFrom, m_width - outsideFrom, value);
+        }
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "PcbData.h"
+#include <cstddef>
+#include <vector>
+
+// Sets count floats to value, several per instruction where the target has
+// SSE2 or NEON.
+void FillSpan(float* first, size_t count, float value);
+
+// Scanline rasterization of polygons onto a row-major grid of cells laid
+// out as RoutingGrid's: cell (x, y) has its centre at origin + (x, y) *
+// cellSize millimetres. A cell is inside when its centre is, by the even-odd rule,
+// so holes can be separate rings or bridged into the outline as KiCad
+// fractures zones.
+//
+// Rows are independent, so the rows the polygon spans are cut into bands
+// that are filled on worker threads, or on the calling thread when the
+// polygon is small. Each band keeps an active edge list, sorts the
+// crossings of each row and fills the runs between them with FillSpan().
+class PolygonRasterizer
+{
+public:
+    PolygonRasterizer(int width, int height, double cellSize);
+
+    // Worker threads; 0 picks one per core.
+    void SetThreadCount(unsigned count) { m_threadCount = count; }
+    // Board position of cell (0, 0)'s centre.
+    void SetOrigin(PcbPoint origin) { m_origin = origin; }
+
+    // Sets the cells inside the rings to value, or with outside set every
+    // cell outside them, e.g. to block what lies beyond the board edge.
+    void Fill(const std::vector<PcbPointSpan>& rings, float* cells, float value, bool outside = false) const;
+
+private:
+    // A non-horizontal edge in cell units, clipped to the grid's rows.
+    struct Edge {
+        int rowFirst, rowLast; // Rows it crosses, both included
+        double x;              // x at rowFirst
+        double slope;          // dx per row
+    };
+
+    void FillRows(const std::vector<Edge>& edges, int rowBegin, int rowEnd, float* cells, float value, bool outside) const;
+
+    int m_width;
+    int m_height;
+    double m_cellSize; // mm per cell
+    PcbPoint m_origin{0, 0};
+    unsigned m_threadCount = 0;
+};
@@ -1,113 +1,991 @@
 #include "RoutingGrid.h"
+#include "PolygonRasterizer.h"
+#include <algorithm>
 #include <cmath>
 #include <limits>
+#include <map>
+#include <thread>
 
-// A* node structure for the priority queue
-struct AStarNode {
-    GridPoint pos;
-    double f_cost; // g_cost + h_cost
+namespace {
+    // The eight moves, indexed by the direction a cell records as its parent.
+    const int MoveX[8] = {1, 1, 0, -1, -1, -1, 0, 1};
+    const int MoveY[8] = {0, 1, 1, 1, 0, -1, -1, -1};
 
-    // For priority_queue (we want the one with the smallest f_cost)
-    bool operator>(const AStarNode& other) const {
-        return f_cost > other.f_cost;
+    // Past this many changed rectangles the jump table is rebuilt whole.
+    constexpr size_t MaxJumpTableChanges = 4096;
+
+    // Cells each side of a bidirectional search expands between looking
+    // for where the two have met.
+    constexpr size_t FrontierRound = 1024;
+
+    constexpr uint32_t NoCell = std::numeric_limits<uint32_t>::max();
+}
+
+void SearchWorkspace::Begin(size_t cellCount, bool jumps)
+{
+    if (m_generation.size() < cellCount) {
+        m_generation.resize(cellCount, 0);
+        m_cost.resize(cellCount);
+        m_state.resize(cellCount);
     }
-};
+    if (jumps && m_from.size() < cellCount) {
+        m_from.resize(cellCount);
+    }
+    if (++m_current == 0) {
+        // Wrapped around: stamps from 2^32 searches ago would read as current.
+        std::fill(m_generation.begin(), m_generation.end(), 0);
+        m_current = 1;
+    }
+    m_stats = SearchStats();
+}
+
+SearchWorkspace& SearchWorkspace::Reverse()
+{
+    if (!m_reverse) {
+        m_reverse = std::make_unique<SearchWorkspace>();
+    }
+    return *m_reverse;
+}
+
+SearchWorker& SearchWorkspace::Worker()
+{
+    if (!m_worker) {
+        m_worker = std::make_unique<SearchWorker>();
+    }
+    return *m_worker;
+}
+
+SearchWorker::SearchWorker() : m_thread(&SearchWorker::Run, this) {}
+
+SearchWorker::~SearchWorker()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_wake.notify_all();
+    m_thread.join();
+}
+
+void SearchWorker::Start(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_task = std::move(task);
+    }
+    m_wake.notify_all();
+}
+
+void SearchWorker::Wait()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_wake.wait(lock, [this] { return !m_task; });
+}
+
+void SearchWorker::Run()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        m_wake.wait(lock, [this] { return m_quit || m_task; });
+        if (m_quit) {
+            return;
+        }
+        lock.unlock();
+        m_task();
+        lock.lock();
+        m_task = nullptr;
+        m_wake.notify_all();
+    }
+}
 
 RoutingGrid::RoutingGrid(int width, int height, double resolution)
     : m_width(width), m_height(height), m_resolution(resolution)
 {
-    m_grid.resize(static_cast<size_t>(width) * height);
+    m_grid.resize(PlaneSize());
+}
+
+RoutingGrid::RoutingGrid(int width, int height, double resolution, const PcbData& layers)
+    : m_width(width), m_height(height), m_resolution(resolution)
+{
+    // Copper layers are listed in stack-up order, so their ids ascend from
+    // the top layer to the bottom one.
+    const std::vector<PcbLayer>& table = layers.GetLayers();
+    m_layerPlanes.assign(table.size(), -1);
+    for (PcbLayerId layer = 0; layer < table.size() && m_planeLayers.size() < 32; ++layer) {
+        if (table[layer].IsCopper()) {
+            m_layerPlanes[layer] = static_cast<int>(m_planeLayers.size());
+            m_planeLayers.push_back(layer);
+        }
+    }
+    m_layerCount = std::max<int>(1, static_cast<int>(m_planeLayers.size()));
+    m_grid.resize(PlaneSize() * m_layerCount);
+}
+
+void RoutingGrid::SetViaRules(const ViaRules& rules)
+{
+    m_viaRules = rules;
+    m_viaMapDirty = true;
+}
+
+int RoutingGrid::GetPlane(PcbLayerId layer) const
+{
+    if (m_planeLayers.empty()) {
+        return 0;
+    }
+    return layer < m_layerPlanes.size() ? m_layerPlanes[layer] : -1;
+}
+
+PcbLayerId RoutingGrid::GetLayerId(int plane) const
+{
+    return plane >= 0 && static_cast<size_t>(plane) < m_planeLayers.size() ? m_planeLayers[plane] : PcbNoLayer;
+}
+
+uint32_t RoutingGrid::GetViaPlanes(int from, int to) const
+{
+    const int first = std::min(from, to);
+    const int last = std::max(from, to);
+    const uint32_t all = m_layerCount >= 32 ? AllPlanes : (uint32_t(1) << m_layerCount) - 1;
+    const uint32_t upToLast = last >= 31 ? AllPlanes : (uint32_t(1) << (last + 1)) - 1;
+    const uint32_t span = upToLast & ~((uint32_t(1) << first) - 1);
+    const bool fromOuter = first == 0;
+    const bool toOuter = last == m_layerCount - 1;
+    if (fromOuter != toOuter && m_viaRules.allowBlind) {
+        return span;
+    }
+    if (!fromOuter && !toOuter && m_viaRules.allowBuried) {
+        return span;
+    }
+    return all; // Through the whole board
+}
+
+uint32_t RoutingGrid::PlanesOf(PcbLayerSet layers) const
+{
+    if (m_planeLayers.empty()) {
+        return 1;
+    }
+    uint32_t planes = 0;
+    for (size_t plane = 0; plane < m_planeLayers.size(); ++plane) {
+        if (layers & LayerBit(m_planeLayers[plane])) {
+            planes |= uint32_t(1) << plane;
+        }
+    }
+    return planes;
 }
 
 void RoutingGrid::AddPadObstacle(const PcbPad& pad, bool isStartOrEnd)
 {
     // Convert pad dimensions to grid coordinates
     GridPoint center = WorldToGrid(pad.pos);
-    int half_width = static_cast<int>(ceil((pad.size.m_x / 2.0) / m_resolution));
-    int half_height = static_cast<int>(ceil((pad.size.m_y / 2.0) / m_resolution));
+    int half_width = static_cast<int>(ceil((CoordToMillimetres(pad.size.x) / 2.0) / m_resolution));
+    int half_height = static_cast<int>(ceil((CoordToMillimetres(pad.size.y) / 2.0) / m_resolution));
+
+    // A start/end pad for the current route must be traversable; any other
+    // pad is an obstacle for it.
+    const uint32_t planes = PlanesOf(pad.layers | LayerBit(pad.layer));
+    FillRect(center, half_width, half_height, isStartOrEnd ? 1.0f : std::numeric_limits<float>::infinity(), planes);
+}
+
+void RoutingGrid::AddLineObstacle(const PcbLine& line, PcbCoord clearance)
+{
+    FillLine(line, clearance, std::numeric_limits<float>::infinity());
+}
+
+void RoutingGrid::OpenLine(const PcbLine& line)
+{
+    FillLine(line, 0, 1.0f);
+}
+
+void RoutingGrid::FillLine(const PcbLine& line, PcbCoord clearance, float cost)
+{
+    // The track as a rectangle around its centre line, extended by half
+    // its width at both ends, all grown by the clearance.
+    const double dx = static_cast<double>(line.end.x) - line.start.x;
+    const double dy = static_cast<double>(line.end.y) - line.start.y;
+    const double length = std::hypot(dx, dy);
+    const double half = line.width / 2.0 + clearance;
+    const double ux = length > 0 ? dx / length * half : half;
+    const double uy = length > 0 ? dy / length * half : 0.0;
+    auto corner = [](double x, double y) { return PcbPoint{static_cast<PcbCoord>(std::lround(x)), static_cast<PcbCoord>(std::lround(y))}; };
+    const std::vector<PcbPoint> ring = {
+        corner(line.start.x - ux + uy, line.start.y - uy - ux),
+        corner(line.end.x + ux + uy, line.end.y + uy - ux),
+        corner(line.end.x + ux - uy, line.end.y + uy + ux),
+        corner(line.start.x - ux - uy, line.start.y - uy + ux),
+    };
+    FillPolygon({PcbPointSpan(ring)}, false, &m_grid.data()->cost, PlanesOf(LayerBit(line.layer)), cost);
+}
 
-    for (int y = center.y - half_height; y <= center.y + half_height; ++y) {
-        for (int x = center.x - half_width; x <= center.x + half_width; ++x) {
+void RoutingGrid::AddViaObstacle(const PcbVia& via, PcbCoord clearance)
+{
+    const int half = static_cast<int>(ceil((CoordToMillimetres(via.size) / 2.0 + CoordToMillimetres(clearance)) / m_resolution));
+    FillRect(WorldToGrid(via.pos), half, half, std::numeric_limits<float>::infinity(),
+             PlanesOf(via.layers | LayerBit(via.fromLayer) | LayerBit(via.toLayer)));
+}
+
+void RoutingGrid::OpenVia(const PcbVia& via)
+{
+    const int half = static_cast<int>(ceil((CoordToMillimetres(via.size) / 2.0) / m_resolution));
+    FillRect(WorldToGrid(via.pos), half, half, 1.0f, PlanesOf(via.layers | LayerBit(via.fromLayer) | LayerBit(via.toLayer)));
+}
+
+void RoutingGrid::AddFootprintObstacles(const PcbData& data)
+{
+    const PcbFootprintView footprints = data.GetFootprints();
+    const PcbFootprintDefs& defs = data.GetFootprintDefs();
+    std::map<std::pair<uint32_t, double>, std::vector<StampCell>> stamps;
+    const size_t planeSize = PlaneSize();
+    for (const PcbFootprint& footprint : footprints) {
+        auto it = stamps.find({footprint.def, footprint.rotation});
+        if (it == stamps.end()) {
+            it = stamps.emplace(std::make_pair(footprint.def, footprint.rotation),
+                                FootprintStamp(*defs[footprint.def], footprint.rotation)).first;
+        }
+        const GridPoint origin = WorldToGrid(footprint.pos);
+        GridRect stamped = {m_width, m_height, -1, -1}; // On plane 0, for the jump table
+        for (const StampCell& stamp : it->second) {
+            const int x = origin.x + stamp.cell.x;
+            const int y = origin.y + stamp.cell.y;
             if (x >= 0 && x < m_width && y >= 0 && y < m_height) {
-                size_t index = static_cast<size_t>(y) * m_width + x;
-                if (isStartOrEnd) {
-                    // This is a start/end pad for the current route, so it must be traversable.
-                    m_grid[index].cost = 1.0f;
-                } else {
-                    // This is an obstacle for the current route.
-                    m_grid[index].cost = std::numeric_limits<float>::infinity();
+                const size_t cell = static_cast<size_t>(y) * m_width + x;
+                for (int plane = 0; plane < m_layerCount; ++plane) {
+                    if (stamp.planes & (uint32_t(1) << plane)) {
+                        m_grid[plane * planeSize + cell].cost = std::numeric_limits<float>::infinity();
+                    }
+                }
+                if (stamp.planes & 1) {
+                    stamped = {std::min(stamped.x0, x), std::min(stamped.y0, y), std::max(stamped.x1, x), std::max(stamped.y1, y)};
                 }
             }
         }
+        if (stamped.x1 >= 0) {
+            JumpTableChanged(stamped);
+        }
     }
+    m_viaMapDirty = true;
 }
 
-GridPoint RoutingGrid::WorldToGrid(const wxPoint2DDouble& worldPos) const
+std::vector<RoutingGrid::StampCell> RoutingGrid::FootprintStamp(const PcbFootprintDef& def, double rotation) const
 {
-    return { static_cast<int>(round(worldPos.m_x / m_resolution)),
-             static_cast<int>(round(worldPos.m_y / m_resolution)) };
+    // Each pad as AddPadObstacle() would mark it, for a footprint whose
+    // origin is on a cell centre.
+    std::vector<StampCell> cells;
+    for (const PcbPad& pad : def.pads) {
+        const PcbPoint offset = RotatePoint(pad.pos, rotation);
+        const GridPoint center = {static_cast<int>(round(CoordToMillimetres(offset.x) / m_resolution)),
+                                  static_cast<int>(round(CoordToMillimetres(offset.y) / m_resolution))};
+        int half_width = static_cast<int>(ceil((CoordToMillimetres(pad.size.x) / 2.0) / m_resolution));
+        int half_height = static_cast<int>(ceil((CoordToMillimetres(pad.size.y) / 2.0) / m_resolution));
+        const uint32_t planes = PlanesOf(pad.layers | LayerBit(pad.layer));
+        for (int y = center.y - half_height; y <= center.y + half_height; ++y) {
+            for (int x = center.x - half_width; x <= center.x + half_width; ++x) {
+                cells.push_back({{x, y}, planes});
+            }
+        }
+    }
+    // Pads of one footprint often overlap once their extent is rounded up.
+    std::sort(cells.begin(), cells.end(), [](const StampCell& a, const StampCell& b) { return a.cell < b.cell; });
+    size_t kept = 0;
+    for (size_t i = 0; i < cells.size(); ++i) {
+        if (kept > 0 && cells[kept - 1].cell == cells[i].cell) {
+            cells[kept - 1].planes |= cells[i].planes;
+        } else {
+            cells[kept++] = cells[i];
+        }
+    }
+    cells.resize(kept);
+    return cells;
 }
 
-std::vector<GridPoint> RoutingGrid::FindPath(GridPoint start, GridPoint end)
+void RoutingGrid::AddPolygonObstacle(const std::vector<PcbPointSpan>& rings, uint32_t planes)
+{
+    FillPolygon(rings, false, &m_grid.data()->cost, planes);
+}
+
+void RoutingGrid::AddKeepIn(const std::vector<PcbPointSpan>& rings)
 {
-    std::priority_queue<AStarNode, std::vector<AStarNode>, std::greater<AStarNode>> openSet;
-    std::map<GridPoint, GridPoint> cameFrom;
-    std::map<GridPoint, double> gScore;
+    FillPolygon(rings, true, &m_grid.data()->cost, AllPlanes);
+}
 
-    gScore[start] = 0;
-    openSet.push({start, CalculateHeuristic(start, end)});
+void RoutingGrid::AddZoneObstacles(const PcbData& data, int netId)
+{
+    AddKeepoutZones(data);
+    AddCopperZones(data, netId);
+}
 
-    while (!openSet.empty()) {
-        GridPoint current = openSet.top().pos;
-        openSet.pop();
+void RoutingGrid::AddCopperZones(const PcbData& data, int netId)
+{
+    for (const PcbZone& zone : data.GetZones()) {
+        if (!zone.keepout && zone.netId != netId) {
+            AddPolygonObstacle({zone.polygon}, PlanesOf(LayerBit(zone.layer)));
+        }
+    }
+}
 
-        if (current == end) {
-            return ReconstructPath(cameFrom, current);
+void RoutingGrid::AddKeepoutZones(const PcbData& data)
+{
+    for (const PcbZone& zone : data.GetZones()) {
+        const uint32_t planes = PlanesOf(LayerBit(zone.layer));
+        if (zone.keepout & PcbKeepoutTracks) {
+            AddPolygonObstacle({zone.polygon}, planes);
+        }
+        if (zone.keepout & PcbKeepoutVias) {
+            if (m_viaKeepout.empty()) {
+                m_viaKeepout.assign(m_grid.size(), 0.0f);
+            }
+            FillPolygon({zone.polygon}, false, m_viaKeepout.data(), planes);
         }
+    }
+}
 
-        // Check 8 neighbors
-        for (int dy = -1; dy <= 1; ++dy) {
-            for (int dx = -1; dx <= 1; ++dx) {
-                if (dx == 0 && dy == 0) continue;
-
-                GridPoint neighbor = {current.x + dx, current.y + dy};
-
-                if (neighbor.x < 0 || neighbor.x >= m_width || neighbor.y < 0 || neighbor.y >= m_height) continue;
-                
-                size_t neighbor_idx = static_cast<size_t>(neighbor.y) * m_width + neighbor.x;
-                if (m_grid[neighbor_idx].cost == std::numeric_limits<float>::infinity()) continue;
-
-                double move_cost = (dx != 0 && dy != 0) ? 1.414 : 1.0; // Diagonal vs straight
-                double tentative_gScore = gScore.at(current) + move_cost;
-
-                auto it = gScore.find(neighbor);
-                if (it == gScore.end() || tentative_gScore < it->second) {
-                    cameFrom[neighbor] = current;
-                    gScore[neighbor] = tentative_gScore;
-                    double fScore = tentative_gScore + CalculateHeuristic(neighbor, end);
-                    openSet.push({neighbor, fScore});
+void RoutingGrid::AddBoardOutline(const PcbData& data)
+{
+    const std::vector<std::vector<PcbPoint>> outline = data.GetBoardOutline();
+    if (outline.empty()) {
+        return; // No closed outline: nothing to keep in
+    }
+    std::vector<PcbPointSpan> rings(outline.begin(), outline.end());
+    AddKeepIn(rings);
+}
+
+bool RoutingGrid::IsBlocked(GridPoint point) const
+{
+    if (point.x < 0 || point.x >= m_width || point.y < 0 || point.y >= m_height || point.layer < 0 || point.layer >= m_layerCount) {
+        return true;
+    }
+    return m_grid[point.layer * PlaneSize() + static_cast<size_t>(point.y) * m_width + point.x].cost == std::numeric_limits<float>::infinity();
+}
+
+bool RoutingGrid::CanPlaceVia(GridPoint point, int toLayer) const
+{
+    if (IsBlocked(point) || IsBlocked({point.x, point.y, toLayer}) || point.layer == toLayer) {
+        return false;
+    }
+    EnsureViaMap();
+    return (m_viaBlocked[static_cast<size_t>(point.y) * m_width + point.x] & GetViaPlanes(point.layer, toLayer)) == 0;
+}
+
+void RoutingGrid::FillPolygon(const std::vector<PcbPointSpan>& rings, bool outside, float* cells, uint32_t planes, float cost)
+{
+    // The cells the fill can reach, for the overlay and the jump table.
+    GridRect reach = {0, 0, m_width - 1, m_height - 1};
+    if (!outside) {
+        PcbBox box;
+        for (const PcbPointSpan& ring : rings) {
+            for (const PcbPoint& point : ring) {
+                box.Union(point.x, point.y, point.x, point.y);
+            }
+        }
+        if (box.IsEmpty()) {
+            return;
+        }
+        const GridPoint low = WorldToGrid(PcbPoint{box.minX, box.minY});
+        const GridPoint high = WorldToGrid(PcbPoint{box.maxX, box.maxY});
+        reach = {low.x - 1, low.y - 1, high.x + 1, high.y + 1};
+    }
+    const bool grid = cells == &m_grid.data()->cost;
+    if (grid) {
+        SaveForOverlay(reach, planes);
+    }
+
+    // The rasterizer fills floats; a GridCell is exactly its cost.
+    static_assert(sizeof(GridCell) == sizeof(float), "GridCell must be a bare cost for span filling");
+    PolygonRasterizer rasterizer(m_width, m_height, m_resolution);
+    rasterizer.SetThreadCount(m_threadCount);
+    rasterizer.SetOrigin(m_origin);
+    for (int plane = 0; plane < m_layerCount; ++plane) {
+        if (planes & (uint32_t(1) << plane)) {
+            rasterizer.Fill(rings, cells + plane * PlaneSize(), cost, outside);
+        }
+    }
+    m_viaMapDirty = true;
+
+    if (grid && (planes & 1)) {
+        JumpTableChanged(reach);
+    }
+}
+
+void RoutingGrid::FillRect(GridPoint center, int halfWidth, int halfHeight, float cost, uint32_t planes)
+{
+    SaveForOverlay({center.x - halfWidth, center.y - halfHeight, center.x + halfWidth, center.y + halfHeight}, planes);
+    for (int plane = 0; plane < m_layerCount; ++plane) {
+        if (!(planes & (uint32_t(1) << plane))) continue;
+        GridCell* cells = m_grid.data() + plane * PlaneSize();
+        for (int y = center.y - halfHeight; y <= center.y + halfHeight; ++y) {
+            for (int x = center.x - halfWidth; x <= center.x + halfWidth; ++x) {
+                if (x >= 0 && x < m_width && y >= 0 && y < m_height) {
+                    cells[static_cast<size_t>(y) * m_width + x].cost = cost;
+                }
+            }
+        }
+    }
+    m_viaMapDirty = true;
+    if (planes & 1) {
+        JumpTableChanged({center.x - halfWidth, center.y - halfHeight, center.x + halfWidth, center.y + halfHeight});
+    }
+}
+
+void RoutingGrid::BeginOverlay()
+{
+    m_overlay.clear();
+    m_overlayOpen = true;
+}
+
+void RoutingGrid::RevertOverlay()
+{
+    // Newest first, so cells saved twice end up as they were at the start.
+    for (auto it = m_overlay.rbegin(); it != m_overlay.rend(); ++it) {
+        const int width = it->rect.x1 - it->rect.x0 + 1;
+        GridCell* plane = m_grid.data() + it->plane * PlaneSize();
+        for (int y = it->rect.y0; y <= it->rect.y1; ++y) {
+            std::copy_n(it->cells.begin() + static_cast<size_t>(y - it->rect.y0) * width, width,
+                        plane + static_cast<size_t>(y) * m_width + it->rect.x0);
+        }
+        if (it->plane == 0) {
+            JumpTableChanged(it->rect);
+        }
+    }
+    m_overlay.clear();
+    m_overlayOpen = false;
+    m_viaMapDirty = true;
+}
+
+void RoutingGrid::SaveForOverlay(GridRect rect, uint32_t planes)
+{
+    if (!m_overlayOpen) {
+        return;
+    }
+    rect = {std::max(rect.x0, 0), std::max(rect.y0, 0), std::min(rect.x1, m_width - 1), std::min(rect.y1, m_height - 1)};
+    if (rect.x0 > rect.x1 || rect.y0 > rect.y1) {
+        return;
+    }
+    const int width = rect.x1 - rect.x0 + 1;
+    for (int plane = 0; plane < m_layerCount; ++plane) {
+        if (!(planes & (uint32_t(1) << plane))) continue;
+        SavedCells saved{rect, plane, {}};
+        saved.cells.reserve(static_cast<size_t>(width) * (rect.y1 - rect.y0 + 1));
+        const GridCell* cells = m_grid.data() + plane * PlaneSize();
+        for (int y = rect.y0; y <= rect.y1; ++y) {
+            const GridCell* row = cells + static_cast<size_t>(y) * m_width + rect.x0;
+            saved.cells.insert(saved.cells.end(), row, row + width);
+        }
+        m_overlay.push_back(std::move(saved));
+    }
+}
+
+void RoutingGrid::JumpTableChanged(GridRect rect)
+{
+    std::lock_guard<std::mutex> lock(m_jumpTableMutex);
+    if (m_jumpTable.IsEmpty() || m_layerCount > 1) {
+        return;
+    }
+    rect = {std::max(rect.x0, 0), std::max(rect.y0, 0), std::min(rect.x1, m_width - 1), std::min(rect.y1, m_height - 1)};
+    if (rect.x0 > rect.x1 || rect.y0 > rect.y1) {
+        return;
+    }
+    m_jumpTableChanges.push_back(rect);
+    if (m_jumpTableChanges.size() > MaxJumpTableChanges) {
+        m_jumpTable = JumpPointTable();
+        m_jumpTableChanges.clear();
+    }
+}
+
+void RoutingGrid::EnsureJumpTable() const
+{
+    std::lock_guard<std::mutex> lock(m_jumpTableMutex);
+    if (m_jumpTable.IsEmpty()) {
+        m_jumpTable.Build(&m_grid.data()->cost, m_width, m_height);
+    } else if (!m_jumpTableChanges.empty()) {
+        m_jumpTable.Update(&m_grid.data()->cost, m_jumpTableChanges);
+    }
+    m_jumpTableChanges.clear();
+}
+
+void RoutingGrid::EnsureViaMap() const
+{
+    if (!m_viaMapDirty) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(m_viaMapMutex);
+    if (!m_viaMapDirty) {
+        return;
+    }
+
+    // A via at a cell is too close to an obstacle when one lies within its
+    // radius plus clearance. The square window is found with a sliding count
+    // along each row, then down each column, so the cost doesn't grow with
+    // the via's size.
+    const int radius = static_cast<int>(ceil((m_viaRules.diameter / 2.0 + m_viaRules.clearance) / m_resolution));
+    const size_t planeSize = PlaneSize();
+    m_viaBlocked.assign(planeSize, 0);
+    std::vector<uint8_t> rowHits(planeSize);
+    std::vector<int> columnCounts(m_width);
+    for (int plane = 0; plane < m_layerCount; ++plane) {
+        const GridCell* cells = m_grid.data() + plane * planeSize;
+        auto blocked = [&](size_t cell) { return cells[cell].cost == std::numeric_limits<float>::infinity(); };
+        for (int y = 0; y < m_height; ++y) {
+            const size_t row = static_cast<size_t>(y) * m_width;
+            int count = 0;
+            for (int x = 0; x < std::min(radius, m_width); ++x) {
+                count += blocked(row + x);
+            }
+            for (int x = 0; x < m_width; ++x) {
+                if (x + radius < m_width) count += blocked(row + x + radius);
+                if (x - radius - 1 >= 0) count -= blocked(row + x - radius - 1);
+                rowHits[row + x] = count > 0;
+            }
+        }
+        std::fill(columnCounts.begin(), columnCounts.end(), 0);
+        for (int y = 0; y < std::min(radius, m_height); ++y) {
+            for (int x = 0; x < m_width; ++x) columnCounts[x] += rowHits[static_cast<size_t>(y) * m_width + x];
+        }
+        const uint32_t bit = uint32_t(1) << plane;
+        for (int y = 0; y < m_height; ++y) {
+            const size_t row = static_cast<size_t>(y) * m_width;
+            const size_t below = static_cast<size_t>(y + radius) * m_width;
+            const size_t above = static_cast<size_t>(y - radius - 1) * m_width;
+            for (int x = 0; x < m_width; ++x) {
+                if (y + radius < m_height) columnCounts[x] += rowHits[below + x];
+                if (y - radius - 1 >= 0) columnCounts[x] -= rowHits[above + x];
+                const bool keepout = !m_viaKeepout.empty() && m_viaKeepout[plane * planeSize + row + x] != 0.0f;
+                if (columnCounts[x] > 0 || keepout) {
+                    m_viaBlocked[row + x] |= bit;
                 }
             }
         }
     }
+    m_viaMapDirty = false;
+}
+
+GridPoint RoutingGrid::WorldToGrid(double xMm, double yMm) const
+{
+    return { static_cast<int>(round((xMm - CoordToMillimetres(m_origin.x)) / m_resolution)),
+             static_cast<int>(round((yMm - CoordToMillimetres(m_origin.y)) / m_resolution)) };
+}
+
+GridPoint RoutingGrid::WorldToGrid(const PcbPoint& boardPos) const
+{
+    return WorldToGrid(CoordToMillimetres(boardPos.x), CoordToMillimetres(boardPos.y));
+}
+
+PcbPoint RoutingGrid::GridToWorld(GridPoint point) const
+{
+    return { m_origin.x + MillimetresToCoord(point.x * m_resolution),
+             m_origin.y + MillimetresToCoord(point.y * m_resolution) };
+}
+
+std::vector<GridPoint> RoutingGrid::FindPath(GridPoint start, GridPoint end)
+{
+    return FindPath(start, end, m_workspace);
+}
+
+std::vector<GridPoint> RoutingGrid::FindPath(GridPoint start, GridPoint end, SearchWorkspace& workspace) const
+{
+    return FindPath(start, end, workspace, m_searchMode);
+}
+
+std::vector<GridPoint> RoutingGrid::FindPath(GridPoint start, GridPoint end, SearchWorkspace& workspace, SearchMode mode) const
+{
+    if (mode == SearchMode::JumpPoint && m_layerCount == 1) {
+        return JumpSearch(start, end, workspace);
+    }
+    if (mode == SearchMode::Bidirectional) {
+        SearchWorkspace& reverse = workspace.Reverse();
+        if (m_openListPolicy == OpenListPolicy::Buckets) {
+            return BidirectionalSearch(start, end, workspace, workspace.Buckets(), reverse.Buckets());
+        }
+        return BidirectionalSearch(start, end, workspace, workspace.Heap(), reverse.Heap());
+    }
+    if (m_openListPolicy == OpenListPolicy::Buckets) {
+        return Search(start, end, workspace, workspace.Buckets());
+    }
+    return Search(start, end, workspace, workspace.Heap());
+}
+
+template <typename OpenList>
+std::vector<GridPoint> RoutingGrid::Search(GridPoint start, GridPoint end, SearchWorkspace& workspace, OpenList& openSet) const
+{
+    auto inside = [this](GridPoint p) { return p.x >= 0 && p.x < m_width && p.y >= 0 && p.y < m_height; };
+    auto onPlane = [this](int layer) { return layer >= 0 && layer < m_layerCount; };
+    if (!inside(start) || !inside(end) || !onPlane(start.layer) || !onPlane(end.layer)) {
+        return {};
+    }
+    if (m_layerCount > 1) {
+        EnsureViaMap();
+    }
+
+    // Cell index = plane * planeSize + y * width + x.
+    const size_t planeSize = PlaneSize();
+    const uint32_t viaCost = ViaCost();
+    workspace.Begin(m_grid.size());
+    SearchStats& stats = workspace.Stats();
+    openSet.Reset(m_layerCount > 1 ? std::max(DiagonalCost, viaCost) : DiagonalCost);
+    const uint32_t startCell = static_cast<uint32_t>(start.layer * planeSize + static_cast<size_t>(start.y) * m_width + start.x);
+    const uint32_t endCell = static_cast<uint32_t>(end.layer * planeSize + static_cast<size_t>(end.y) * m_width + end.x);
+    workspace.Visit(startCell, 0, SearchWorkspace::NoParent);
+    openSet.Push({CalculateHeuristic(start, end), 0, startCell});
+    stats.pushed++;
+
+    auto relax = [&](size_t neighbor_idx, GridPoint neighbor, uint32_t tentative_gScore, uint8_t parent) {
+        if (workspace.IsVisited(neighbor_idx) &&
+            (workspace.IsClosed(neighbor_idx) || tentative_gScore >= workspace.GetCost(neighbor_idx))) return;
+
+        workspace.Visit(neighbor_idx, tentative_gScore, parent);
+        openSet.Push({tentative_gScore + CalculateHeuristic(neighbor, end), tentative_gScore, static_cast<uint32_t>(neighbor_idx)});
+        stats.pushed++;
+    };
+
+    while (!openSet.Empty()) {
+        const OpenNode node = openSet.Pop();
+
+        // A cell is pushed again each time its cost improves. Entries with
+        // the older, higher cost are stale; the heuristic is consistent, so
+        // once the cell is closed nothing can improve it either.
+        if (node.g != workspace.GetCost(node.cell) || workspace.IsClosed(node.cell)) {
+            stats.stale++;
+            continue;
+        }
+        workspace.Close(node.cell);
+        stats.expanded++;
+
+        const size_t planeCell = node.cell % planeSize;
+        const GridPoint current = {static_cast<int>(planeCell % m_width), static_cast<int>(planeCell / m_width),
+                                   static_cast<int>(node.cell / planeSize)};
+        if (node.cell == endCell) {
+            return ReconstructPath(workspace, current);
+        }
+        const GridCell* plane = m_grid.data() + current.layer * planeSize;
+
+        // Check 8 neighbors
+        for (uint8_t dir = 0; dir < 8; ++dir) {
+            const GridPoint neighbor = {current.x + MoveX[dir], current.y + MoveY[dir], current.layer};
+            if (!inside(neighbor)) continue;
+
+            const size_t neighbor_cell = static_cast<size_t>(neighbor.y) * m_width + neighbor.x;
+            if (plane[neighbor_cell].cost == std::numeric_limits<float>::infinity()) continue;
+
+            const uint32_t move_cost = (dir & 1) ? DiagonalCost : StraightCost;
+            relax(current.layer * planeSize + neighbor_cell, neighbor, node.g + move_cost, dir);
+        }
+
+        // And the same cell on the other planes, through a via.
+        for (int layer = 0; layer < m_layerCount; ++layer) {
+            if (layer == current.layer) continue;
+            const size_t neighbor_idx = layer * planeSize + planeCell;
+            if (m_grid[neighbor_idx].cost == std::numeric_limits<float>::infinity()) continue;
+            if (m_viaBlocked[planeCell] & GetViaPlanes(current.layer, layer)) continue;
+            relax(neighbor_idx, {current.x, current.y, layer}, node.g + viaCost,
+                  static_cast<uint8_t>(SearchWorkspace::ViaParent + current.layer));
+        }
+    }
 
     return {}; // No path found
 }
 
-double RoutingGrid::CalculateHeuristic(GridPoint a, GridPoint b)
+uint32_t RoutingGrid::CalculateHeuristic(GridPoint a, GridPoint b) const
+{
+    // Diagonal distance (Octile distance), plus a via if the layers differ.
+    const uint32_t dx = static_cast<uint32_t>(std::abs(a.x - b.x));
+    const uint32_t dy = static_cast<uint32_t>(std::abs(a.y - b.y));
+    const uint32_t diagonal = std::min(dx, dy);
+    return StraightCost * (dx + dy - 2 * diagonal) + DiagonalCost * diagonal + (a.layer != b.layer ? ViaCost() : 0);
+}
+
+uint32_t RoutingGrid::ViaCost() const
+{
+    return static_cast<uint32_t>(std::lround(std::max(0.0f, m_viaRules.cost) * StraightCost));
+}
+
+std::vector<GridPoint> RoutingGrid::ReconstructPath(const SearchWorkspace& workspace, GridPoint current) const
+{
+    // Walk the parents back to the start, then put the path in order.
+    std::vector<GridPoint> total_path = {current};
+    uint8_t parent;
+    while ((parent = workspace.GetParent(current.layer * PlaneSize() + static_cast<size_t>(current.y) * m_width + current.x)) != SearchWorkspace::NoParent) {
+        if (parent >= SearchWorkspace::ViaParent) {
+            current.layer = parent - SearchWorkspace::ViaParent;
+        } else {
+            current = {current.x - MoveX[parent], current.y - MoveY[parent], current.layer};
+        }
+        total_path.push_back(current);
+    }
+    std::reverse(total_path.begin(), total_path.end());
+    return total_path;
+}
+
+std::vector<GridPoint> RoutingGrid::JumpSearch(GridPoint start, GridPoint end, SearchWorkspace& workspace) const
 {
-    // Diagonal distance (Octile distance)
-    int dx = std::abs(a.x - b.x);
-    int dy = std::abs(a.y - b.y);
-    return (dx + dy) + (1.414 - 2) * std::min(dx, dy);
+    auto inside = [this](GridPoint p) { return p.x >= 0 && p.x < m_width && p.y >= 0 && p.y < m_height; };
+    if (!inside(start) || !inside(end) || start.layer != 0 || end.layer != 0) {
+        return {};
+    }
+    EnsureJumpTable();
+
+    workspace.Begin(PlaneSize(), true);
+    SearchStats& stats = workspace.Stats();
+    HeapOpenList& openSet = workspace.Heap();
+    openSet.Reset(DiagonalCost);
+    const uint32_t startCell = static_cast<uint32_t>(static_cast<size_t>(start.y) * m_width + start.x);
+    const uint32_t endCell = static_cast<uint32_t>(static_cast<size_t>(end.y) * m_width + end.x);
+    workspace.Visit(startCell, 0, SearchWorkspace::NoParent);
+    openSet.Push({CalculateHeuristic(start, end), 0, startCell});
+    stats.pushed++;
+
+    auto blocked = [&](int x, int y) {
+        return !inside({x, y}) || m_grid[static_cast<size_t>(y) * m_width + x].cost == std::numeric_limits<float>::infinity();
+    };
+
+    while (!openSet.Empty()) {
+        const OpenNode node = openSet.Pop();
+        if (node.g != workspace.GetCost(node.cell) || workspace.IsClosed(node.cell)) {
+            stats.stale++;
+            continue;
+        }
+        workspace.Close(node.cell);
+        stats.expanded++;
+
+        const GridPoint current = {static_cast<int>(node.cell % m_width), static_cast<int>(node.cell / m_width)};
+        if (node.cell == endCell) {
+            return ReconstructJumpPath(workspace, current);
+        }
+
+        // The directions worth trying: onwards, the sides of a diagonal,
+        // and past any obstacle just passed. The start tries all eight.
+        const uint8_t parent = workspace.GetParent(node.cell);
+        unsigned dirs = 0xff;
+        if (parent != SearchWorkspace::NoParent) {
+            auto turn = [parent](int eighths) { return (parent + eighths) & 7; };
+            auto passed = [&](int eighths) { return blocked(current.x + MoveX[turn(eighths)], current.y + MoveY[turn(eighths)]); };
+            const int side = (parent & 1) ? 3 : 2;
+            dirs = 1u << parent;
+            if (parent & 1) {
+                dirs |= (1u << turn(-1)) | (1u << turn(1));
+            }
+            if (passed(side)) dirs |= 1u << turn(side - 1);
+            if (passed(-side)) dirs |= 1u << turn(1 - side);
+        }
+
+        for (uint8_t dir = 0; dir < 8; ++dir) {
+            if (!(dirs & (1u << dir))) continue;
+            const int distance = m_jumpTable.Distance(node.cell, dir);
+            // Progress towards the end along each axis of the direction.
+            const int toEndX = (end.x - current.x) * MoveX[dir];
+            const int toEndY = (end.y - current.y) * MoveY[dir];
+
+            // Stop short where the move passes the end, or in line with it
+            // for a diagonal, if that comes before the jump point or wall.
+            int steps = 0;
+            if (dir & 1) {
+                const int inLine = std::min(toEndX, toEndY);
+                if (inLine > 0 && inLine <= std::abs(distance)) steps = inLine;
+            } else {
+                const bool onRay = MoveX[dir] ? end.y == current.y : end.x == current.x;
+                const int along = MoveX[dir] ? toEndX : toEndY;
+                if (onRay && along > 0 && along <= std::abs(distance)) steps = along;
+            }
+            if (steps == 0 && distance > 0) steps = distance;
+            if (steps == 0) continue;
+
+            const GridPoint target = {current.x + MoveX[dir] * steps, current.y + MoveY[dir] * steps};
+            const size_t targetCell = static_cast<size_t>(target.y) * m_width + target.x;
+            const uint32_t tentative_gScore = node.g + steps * ((dir & 1) ? DiagonalCost : StraightCost);
+            if (workspace.IsVisited(targetCell) &&
+                (workspace.IsClosed(targetCell) || tentative_gScore >= workspace.GetCost(targetCell))) continue;
+
+            workspace.Visit(targetCell, tentative_gScore, dir);
+            workspace.SetFrom(targetCell, node.cell);
+            openSet.Push({tentative_gScore + CalculateHeuristic(target, end), tentative_gScore, static_cast<uint32_t>(targetCell)});
+            stats.pushed++;
+        }
+    }
+
+    return {}; // No path found
 }
 
-std::vector<GridPoint> RoutingGrid::ReconstructPath(const std::map<GridPoint, GridPoint>& cameFrom, GridPoint current)
+std::vector<GridPoint> RoutingGrid::ReconstructJumpPath(const SearchWorkspace& workspace, GridPoint current) const
 {
+    // Fill in the cells of each jump, so the path steps cell by cell as
+    // FindPath()'s always do.
     std::vector<GridPoint> total_path = {current};
-    while (cameFrom.count(current)) {
-        current = cameFrom.at(current);
-        total_path.insert(total_path.begin(), current);
+    size_t cell = static_cast<size_t>(current.y) * m_width + current.x;
+    uint8_t parent;
+    while ((parent = workspace.GetParent(cell)) != SearchWorkspace::NoParent) {
+        const uint32_t from = workspace.GetFrom(cell);
+        while (static_cast<size_t>(current.y) * m_width + current.x != from) {
+            current = {current.x - MoveX[parent], current.y - MoveY[parent]};
+            total_path.push_back(current);
+        }
+        cell = from;
     }
+    std::reverse(total_path.begin(), total_path.end());
     return total_path;
-}
\ No newline at end of file
+}
+
+struct RoutingGrid::Frontier {
+    Frontier(SearchWorkspace& workspace, GridPoint target, uint32_t enterOnly = NoCell)
+        : workspace(&workspace), target(target), enterOnly(enterOnly) {}
+
+    SearchWorkspace* workspace;
+    GridPoint target;              // Where its heuristic aims
+    uint32_t enterOnly;            // The start, for the search back from the end
+    std::vector<uint32_t> reached; // Cells whose cost it lowered this round
+    bool finished = false;         // Nothing left below the bound, or nothing left at all
+};
+
+template <typename OpenList>
+std::vector<GridPoint> RoutingGrid::BidirectionalSearch(GridPoint start, GridPoint end, SearchWorkspace& workspace,
+                                                        OpenList& forwardSet, OpenList& reverseSet) const
+{
+    auto inside = [this](GridPoint p) {
+        return p.x >= 0 && p.x < m_width && p.y >= 0 && p.y < m_height && p.layer >= 0 && p.layer < m_layerCount;
+    };
+    if (!inside(start) || !inside(end)) {
+        return {};
+    }
+    if (start == end) {
+        return {start};
+    }
+    // A* reaches the end only through a free cell, and leaves a blocked
+    // start but never enters it. The search back from the end follows the
+    // same moves reversed.
+    if (IsBlocked(end)) {
+        return {};
+    }
+    if (m_layerCount > 1) {
+        EnsureViaMap();
+    }
+
+    const size_t planeSize = PlaneSize();
+    auto cellOf = [&](GridPoint p) { return static_cast<uint32_t>(p.layer * planeSize + static_cast<size_t>(p.y) * m_width + p.x); };
+    auto pointOf = [&](uint32_t cell) {
+        const size_t planeCell = cell % planeSize;
+        return GridPoint{static_cast<int>(planeCell % m_width), static_cast<int>(planeCell / m_width), static_cast<int>(cell / planeSize)};
+    };
+    const uint32_t maxStep = m_layerCount > 1 ? std::max(DiagonalCost, ViaCost()) : DiagonalCost;
+
+    SearchWorkspace& reverse = workspace.Reverse();
+    Frontier forward(workspace, end);
+    Frontier backward(reverse, start, cellOf(start));
+    auto seed = [&](Frontier& side, OpenList& openSet, GridPoint root) {
+        side.workspace->Begin(m_grid.size());
+        openSet.Reset(maxStep);
+        side.workspace->Visit(cellOf(root), 0, SearchWorkspace::NoParent);
+        openSet.Push({CalculateHeuristic(root, side.target), 0, cellOf(root)});
+        side.workspace->Stats().pushed++;
+    };
+    seed(forward, forwardSet, start);
+    seed(backward, reverseSet, end);
+
+    // The cheapest path found so far runs through the cell where its
+    // halves meet. Each side's costs are those of real paths, so it only
+    // ever improves.
+    uint32_t best = std::numeric_limits<uint32_t>::max();
+    uint32_t meeting = NoCell;
+    auto meet = [&](const Frontier& side, const SearchWorkspace& other) {
+        for (uint32_t cell : side.reached) {
+            if (!other.IsVisited(cell)) continue;
+            const uint64_t cost = static_cast<uint64_t>(side.workspace->GetCost(cell)) + other.GetCost(cell);
+            if (cost < best) {
+                best = static_cast<uint32_t>(cost);
+                meeting = cell;
+            }
+        }
+    };
+
+    // The search back from the end runs on the workspace's worker thread.
+    const bool threaded = m_threadCount != 1 && std::thread::hardware_concurrency() > 1;
+    SearchWorker* worker = threaded ? &workspace.Worker() : nullptr;
+
+    // Once either side has nothing left whose f is below the best cost,
+    // no cheaper path exists: with a consistent heuristic every path
+    // keeps a cell in each open set whose f is at most its cost.
+    while (!forward.finished && !backward.finished) {
+        const uint32_t bound = best;
+        if (worker) {
+            worker->Start([&, bound] { ExpandFrontier(backward, reverseSet, bound); });
+            ExpandFrontier(forward, forwardSet, bound);
+            worker->Wait();
+        } else {
+            ExpandFrontier(forward, forwardSet, bound);
+            ExpandFrontier(backward, reverseSet, bound);
+        }
+        meet(forward, reverse);
+        meet(backward, workspace);
+    }
+
+    SearchStats& stats = workspace.Stats();
+    stats.pushed += reverse.GetStats().pushed;
+    stats.expanded += reverse.GetStats().expanded;
+    stats.stale += reverse.GetStats().stale;
+    if (meeting == NoCell) {
+        return {}; // No path found
+    }
+
+    // The start's half up to the meeting cell, then the end's half from it.
+    const GridPoint middle = pointOf(meeting);
+    std::vector<GridPoint> path = ReconstructPath(workspace, middle);
+    const std::vector<GridPoint> back = ReconstructPath(reverse, middle);
+    path.insert(path.end(), back.rbegin() + 1, back.rend());
+    return path;
+}
+
+template <typename OpenList>
+void RoutingGrid::ExpandFrontier(Frontier& side, OpenList& openSet, uint32_t bound) const
+{
+    SearchWorkspace& workspace = *side.workspace;
+    SearchStats& stats = workspace.Stats();
+    const size_t planeSize = PlaneSize();
+    const uint32_t viaCost = ViaCost();
+    const float blocked = std::numeric_limits<float>::infinity();
+    side.reached.clear();
+
+    auto relax = [&](size_t neighbor_idx, GridPoint neighbor, uint32_t tentative_gScore, uint8_t parent) {
+        if (workspace.IsVisited(neighbor_idx) &&
+            (workspace.IsClosed(neighbor_idx) || tentative_gScore >= workspace.GetCost(neighbor_idx))) return;
+
+        workspace.Visit(neighbor_idx, tentative_gScore, parent);
+        openSet.Push({tentative_gScore + CalculateHeuristic(neighbor, side.target), tentative_gScore, static_cast<uint32_t>(neighbor_idx)});
+        stats.pushed++;
+        side.reached.push_back(static_cast<uint32_t>(neighbor_idx));
+    };
+    // A blocked start can be stepped back onto, but not moved on from.
+    auto enterable = [&](size_t cell) { return m_grid[cell].cost != blocked || cell == side.enterOnly; };
+
+    for (size_t expanded = 0; expanded < FrontierRound;) {
+        if (openSet.Empty()) {
+            side.finished = true;
+            return;
+        }
+        const OpenNode node = openSet.Pop();
+        if (node.g != workspace.GetCost(node.cell) || workspace.IsClosed(node.cell)) {
+            stats.stale++;
+            continue;
+        }
+        if (node.f >= bound) {
+            side.finished = true;
+            return;
+        }
+        workspace.Close(node.cell);
+        stats.expanded++;
+        expanded++;
+        if (node.cell == side.enterOnly) continue;
+
+        const size_t planeCell = node.cell % planeSize;
+        const GridPoint current = {static_cast<int>(planeCell % m_width), static_cast<int>(planeCell / m_width),
+                                   static_cast<int>(node.cell / planeSize)};
+        for (uint8_t dir = 0; dir < 8; ++dir) {
+            const GridPoint neighbor = {current.x + MoveX[dir], current.y + MoveY[dir], current.layer};
+            if (neighbor.x < 0 || neighbor.x >= m_width || neighbor.y < 0 || neighbor.y >= m_height) continue;
+            const size_t neighbor_idx = current.layer * planeSize + static_cast<size_t>(neighbor.y) * m_width + neighbor.x;
+            if (!enterable(neighbor_idx)) continue;
+            relax(neighbor_idx, neighbor, node.g + ((dir & 1) ? DiagonalCost : StraightCost), dir);
+        }
+        for (int layer = 0; layer < m_layerCount; ++layer) {
+            if (layer == current.layer) continue;
+            const size_t neighbor_idx = layer * planeSize + planeCell;
+            if (!enterable(neighbor_idx)) continue;
+            if (m_viaBlocked[planeCell] & GetViaPlanes(current.layer, layer)) continue;
+            relax(neighbor_idx, {current.x, current.y, layer}, node.g + viaCost,
+                  static_cast<uint8_t>(SearchWorkspace::ViaParent + current.layer));
+        }
+    }
+}
@@ -1,9 +1,17 @@
 #pragma once
 
+#include "JumpPointTable.h"
+#include "OpenList.h"
 #include "PcbData.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <vector>
-#include <queue>
-#include <map>
 
 // Represents a single cell in the routing grid.
 struct GridCell {
@@ -14,42 +22,325 @@ struct GridCell {
 };
 
 // Simple struct for integer coordinates, needed for map keys and general tidiness.
+// layer is the grid's plane (see RoutingGrid), not a board layer id.
 struct GridPoint {
     int x, y;
+    int layer = 0;
     bool operator==(const GridPoint& other) const {
-        return x == other.x && y == other.y;
+        return x == other.x && y == other.y && layer == other.layer;
     }
+    bool operator!=(const GridPoint& other) const { return !(*this == other); }
     // Needed for using GridPoint as a key in std::map
     bool operator<(const GridPoint& other) const {
-        if (x < other.x) return true;
-        if (x > other.x) return false;
-        return y < other.y;
+        if (x != other.x) return x < other.x;
+        if (y != other.y) return y < other.y;
+        return layer < other.layer;
     }
 };
 
-// Represents the 2D routing grid.
+// Where a route may change layers and what it pays to.
+struct ViaRules {
+    float cost = 10.0f;     // Added to the path cost per via, in straight cell steps
+    double diameter = 0.6;  // mm
+    double clearance = 0.2; // mm from the via's pad to any obstacle
+    // A via that isn't allowed to stop short is drilled through the whole
+    // board and must be clear on every layer. Blind vias join an outer
+    // layer to an inner one, buried vias two inner layers.
+    bool allowBlind = false;
+    bool allowBuried = false;
+};
+
+// How FindPath() searches. All find paths of the same, optimal cost.
+enum class SearchMode : uint8_t {
+    AStar,         // Expands cell by cell
+    JumpPoint,     // Jumps across open areas (JPS+); single-plane grids only
+    Bidirectional, // Expands cell by cell from both ends at once
+};
+
+// What one search did, for tuning and tests.
+struct SearchStats {
+    uint64_t pushed = 0;   // Entries added to the open set
+    uint64_t expanded = 0; // Cells taken from the open set and expanded
+    uint64_t stale = 0;    // Entries skipped because their cell had been reached more cheaply since
+};
+
+// A thread kept by a SearchWorkspace that runs one task at a time, the
+// search back from the end of a bidirectional search, so that searches
+// don't each start a thread of their own.
+class SearchWorker
+{
+public:
+    SearchWorker();
+    ~SearchWorker();
+    SearchWorker(const SearchWorker&) = delete;
+    SearchWorker& operator=(const SearchWorker&) = delete;
+
+    // Hands the thread a task; the previous one must have been waited for.
+    void Start(std::function<void()> task);
+    // Blocks until the task has finished.
+    void Wait();
+
+private:
+    void Run();
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::function<void()> m_task; // Empty when idle
+    bool m_quit = false;
+    std::thread m_thread;
+};
+
+// Per-cell scratch state of an A* search, in flat arrays indexed like the
+// grid: the best cost found so far, the direction the cell was reached from
+// and whether it is closed, packed into one byte.
+//
+// Cells are stamped with the generation of the search that last touched
+// them, and anything stamped by an earlier search reads as unvisited, so
+// starting a search doesn't clear the arrays. A workspace is reused across
+// searches; give each thread its own.
+class SearchWorkspace
+{
+public:
+    // Parents 0-7 are the planar moves; ViaParent + p means the cell was
+    // reached through a via from plane p.
+    static constexpr uint8_t NoParent = 8;
+    static constexpr uint8_t ViaParent = 16;
+
+    // Starts a new search over cellCount cells. O(1) unless the arrays grow
+    // or the generation counter wraps around. With jumps set the search
+    // also records which cell each one was reached from (see SetFrom()).
+    void Begin(size_t cellCount, bool jumps = false);
+
+    bool IsVisited(size_t cell) const { return m_generation[cell] == m_current; }
+    uint32_t GetCost(size_t cell) const { return m_cost[cell]; }
+    uint8_t GetParent(size_t cell) const { return m_state[cell] & ParentMask; }
+    bool IsClosed(size_t cell) const { return (m_state[cell] & ClosedFlag) != 0; }
+
+    // Records a (better) cost for the cell, reached from parent.
+    void Visit(size_t cell, uint32_t cost, uint8_t parent)
+    {
+        m_generation[cell] = m_current;
+        m_cost[cell] = cost;
+        m_state[cell] = parent;
+    }
+    void Close(size_t cell) { m_state[cell] |= ClosedFlag; }
+    // For searches whose moves span several cells in the parent's direction.
+    void SetFrom(size_t cell, uint32_t from) { m_from[cell] = from; }
+    uint32_t GetFrom(size_t cell) const { return m_from[cell]; }
+
+    // The open sets, one per policy; FindPath() uses the one it is set to.
+    HeapOpenList& Heap() { return m_heap; }
+    BucketOpenList& Buckets() { return m_buckets; }
+
+    SearchStats& Stats() { return m_stats; }
+    const SearchStats& GetStats() const { return m_stats; }
+
+    // A second workspace for the search back from the end in a
+    // bidirectional search, made on first use.
+    SearchWorkspace& Reverse();
+    // Its worker thread, started on first use.
+    SearchWorker& Worker();
+
+private:
+    static constexpr uint8_t ParentMask = 0x7f;
+    static constexpr uint8_t ClosedFlag = 0x80;
+
+    std::vector<uint32_t> m_generation;
+    std::vector<uint32_t> m_cost;
+    std::vector<uint8_t> m_state;
+    std::vector<uint32_t> m_from; // Only allocated by searches that jump
+    HeapOpenList m_heap;
+    BucketOpenList m_buckets;
+    SearchStats m_stats;
+    uint32_t m_current = 0;
+    std::unique_ptr<SearchWorkspace> m_reverse;
+    std::unique_ptr<SearchWorker> m_worker;
+};
+
+// The routing grid: one plane of cells per copper layer, all with the
+// same size and origin. Cell (x, y) has its centre at origin + (x, y) *
+// resolution. A route moves to its 8 neighbours on a plane or, through a
+// via, to the same cell on another plane (see ViaRules).
 class RoutingGrid
 {
 public:
+    // A single plane that every layer's obstacles go on.
     RoutingGrid(int width, int height, double resolution);
+    // One plane per copper layer of the board, in stack-up order.
+    RoutingGrid(int width, int height, double resolution, const PcbData& layers);
+
+    // Board position of cell (0, 0)'s centre; set it before adding obstacles.
+    void SetOrigin(PcbPoint origin) { m_origin = origin; }
+    void SetViaRules(const ViaRules& rules);
 
-    // Methods to populate the grid from PcbData
+    int GetLayerCount() const { return m_layerCount; }
+    // The plane a copper layer routes on, or -1 if the grid has none for it.
+    int GetPlane(PcbLayerId layer) const;
+    // The board layer of a plane; PcbNoLayer for a single-plane grid.
+    PcbLayerId GetLayerId(int plane) const;
+    // The planes a via between two planes occupies under the via rules.
+    uint32_t GetViaPlanes(int from, int to) const;
+
+    // Methods to populate the grid from PcbData. Elements block the planes
+    // of their copper layers. Tracks and vias are grown by clearance on
+    // every side, so route centre lines keep that far from their copper.
     void AddPadObstacle(const PcbPad& pad, bool isStartOrEnd = false);
+    void AddLineObstacle(const PcbLine& line, PcbCoord clearance = 0);
+    void AddViaObstacle(const PcbVia& via, PcbCoord clearance = 0);
+    // Opens the cells under a track or via again, for routing its own net
+    // on a grid that has it as an obstacle.
+    void OpenLine(const PcbLine& line);
+    void OpenVia(const PcbVia& via);
+    // Marks the pads of every footprint as obstacles. The cells a footprint
+    // covers are worked out once per definition and rotation, then stamped
+    // at each instance.
+    void AddFootprintObstacles(const PcbData& data);
+    // Marks the inside of a polygon as an obstacle, e.g. a zone of another
+    // net or a keepout. Holes are further rings (see PolygonRasterizer).
+    void AddPolygonObstacle(const std::vector<PcbPointSpan>& rings, uint32_t planes = AllPlanes);
+    // Marks every cell outside the rings as an obstacle on every plane, so
+    // routes stay within them.
+    void AddKeepIn(const std::vector<PcbPointSpan>& rings);
+    // Zones of nets other than netId and keepouts that forbid tracks
+    // become obstacles on their layer, keepouts that forbid vias keep vias
+    // off that layer, and the board outline, if closed, a keep-in. The
+    // zone obstacles are AddKeepoutZones() and AddCopperZones() together.
+    void AddZoneObstacles(const PcbData& data, int netId);
+    void AddKeepoutZones(const PcbData& data);
+    void AddCopperZones(const PcbData& data, int netId);
+    void AddBoardOutline(const PcbData& data);
+
+    // From BeginOverlay() on, the cells that obstacles and openings change
+    // are saved first, and RevertOverlay() puts them back. A grid built once
+    // for a whole board can so be given one net's view of it (its own
+    // copper open, other nets' zones blocked) and then be reused for the
+    // next. Footprints and via keepouts added meanwhile are not reverted.
+    void BeginOverlay();
+    void RevertOverlay();
 
-    // A* pathfinding
+    // Worker threads for rasterizing polygons; 0 picks one per core. With
+    // 1 a bidirectional search also keeps both ends on the calling thread.
+    void SetThreadCount(unsigned count) { m_threadCount = count; }
+
+    bool IsBlocked(GridPoint point) const;
+    // Whether a via from one plane to another can be placed at the point.
+    bool CanPlaceVia(GridPoint point, int toLayer) const;
+
+    // A* pathfinding over 8-connected cells and via moves. The first form
+    // reuses the grid's own workspace; concurrent searches pass one each.
+    // Paths are optimal for a cost of 10 per straight step, 14 per
+    // diagonal one and the via rules' cost (times 10) per via.
     std::vector<GridPoint> FindPath(GridPoint start, GridPoint end);
+    std::vector<GridPoint> FindPath(GridPoint start, GridPoint end, SearchWorkspace& workspace) const;
+    // With a search mode for this one connection, e.g. bidirectional for
+    // one that ends deep in a pin field.
+    std::vector<GridPoint> FindPath(GridPoint start, GridPoint end, SearchWorkspace& workspace, SearchMode mode) const;
+    // The grid's own workspace, e.g. for the statistics of the last search.
+    const SearchWorkspace& GetWorkspace() const { return m_workspace; }
+
+    // The open set FindPath() uses; both give paths of the same cost.
+    void SetOpenListPolicy(OpenListPolicy policy) { m_openListPolicy = policy; }
+    OpenListPolicy GetOpenListPolicy() const { return m_openListPolicy; }
+    // Jump point search prunes every cell it can prove an equally short
+    // path avoids, and jumps between the few it keeps using a table of
+    // jump distances (see JumpPointTable) built on the first such search and
+    // patched as obstacles are added. A via can be placed almost anywhere,
+    // which leaves nothing to prune, so grids with several planes always
+    // search cell by cell. Jumps are too long for the bucket queue; these
+    // searches use the binary heap.
+    //
+    // A bidirectional search expands from the start and back from the end
+    // in rounds, the two on separate threads unless the thread count is 1.
+    // Between rounds the cells both have reached give the cheapest path
+    // found so far, and once either side has nothing left below its cost
+    // that path is optimal. It pays off where one end is boxed in, say by
+    // a BGA's pins, and a search from the other floods everything the
+    // heuristic points at before finding the way in.
+    void SetSearchMode(SearchMode mode) { m_searchMode = mode; }
+    SearchMode GetSearchMode() const { return m_searchMode; }
+
+    static constexpr uint32_t StraightCost = 10;
+    static constexpr uint32_t DiagonalCost = 14;
 
     // Coordinate conversion and accessors
-    GridPoint WorldToGrid(const wxPoint2DDouble& worldPos) const;
+    GridPoint WorldToGrid(double xMm, double yMm) const;
+    GridPoint WorldToGrid(const PcbPoint& boardPos) const;
+    PcbPoint GridToWorld(GridPoint point) const;
     double GetResolution() const { return m_resolution; }
 
+    static constexpr uint32_t AllPlanes = ~uint32_t(0);
+
 private:
+    // The cells a footprint's pads cover, relative to its origin's cell,
+    // with the planes each cell is blocked on.
+    struct StampCell {
+        GridPoint cell;
+        uint32_t planes;
+    };
+    std::vector<StampCell> FootprintStamp(const PcbFootprintDef& def, double rotation) const;
+    void FillRect(GridPoint center, int halfWidth, int halfHeight, float cost, uint32_t planes);
+    void FillLine(const PcbLine& line, PcbCoord clearance, float cost);
+    uint32_t PlanesOf(PcbLayerSet layers) const;
+    size_t PlaneSize() const { return static_cast<size_t>(m_width) * m_height; }
+
     // A* helper methods
-    double CalculateHeuristic(GridPoint a, GridPoint b);
-    std::vector<GridPoint> ReconstructPath(const std::map<GridPoint, GridPoint>& cameFrom, GridPoint current);
+    template <typename OpenList>
+    std::vector<GridPoint> Search(GridPoint start, GridPoint end, SearchWorkspace& workspace, OpenList& openSet) const;
+    uint32_t CalculateHeuristic(GridPoint a, GridPoint b) const;
+    uint32_t ViaCost() const;
+    std::vector<GridPoint> ReconstructPath(const SearchWorkspace& workspace, GridPoint current) const;
+    std::vector<GridPoint> JumpSearch(GridPoint start, GridPoint end, SearchWorkspace& workspace) const;
+    std::vector<GridPoint> ReconstructJumpPath(const SearchWorkspace& workspace, GridPoint current) const;
+    struct Frontier; // One side of a bidirectional search
+    template <typename OpenList>
+    std::vector<GridPoint> BidirectionalSearch(GridPoint start, GridPoint end, SearchWorkspace& workspace,
+                                               OpenList& forwardSet, OpenList& reverseSet) const;
+    template <typename OpenList>
+    void ExpandFrontier(Frontier& side, OpenList& openSet, uint32_t bound) const;
+
+    void FillPolygon(const std::vector<PcbPointSpan>& rings, bool outside, float* cells, uint32_t planes,
+                     float cost = std::numeric_limits<float>::infinity());
+    // Saves the grid's cells in rect on the planes for RevertOverlay(), if
+    // an overlay is open.
+    void SaveForOverlay(GridRect rect, uint32_t planes);
+    void EnsureViaMap() const;
+    void EnsureJumpTable() const;
+    // Notes cells of the first plane that changed, for the jump table.
+    void JumpTableChanged(GridRect rect);
 
     int m_width;
     int m_height;
     double m_resolution; // mm per grid cell
-    std::vector<GridCell> m_grid;
-};
\ No newline at end of file
+    PcbPoint m_origin{0, 0};
+    unsigned m_threadCount = 0;
+    int m_layerCount = 1;
+    std::vector<PcbLayerId> m_planeLayers; // By plane; empty for a single-plane grid
+    std::vector<int> m_layerPlanes;        // By board layer id; -1 if not routed
+    ViaRules m_viaRules;
+    OpenListPolicy m_openListPolicy = OpenListPolicy::Buckets;
+    SearchMode m_searchMode = SearchMode::AStar;
+    std::vector<GridCell> m_grid;          // Plane after plane
+    std::vector<float> m_viaKeepout;       // Like m_grid; allocated by the first via keepout
+    // Cells saved since BeginOverlay(), oldest first.
+    struct SavedCells {
+        GridRect rect;
+        int plane;
+        std::vector<GridCell> cells; // Row by row
+    };
+    std::vector<SavedCells> m_overlay;
+    bool m_overlayOpen = false;
+    SearchWorkspace m_workspace;
+
+    // Per cell, the planes a via there would come too close to an
+    // obstacle on. Built on the first search after obstacles change.
+    mutable std::vector<uint32_t> m_viaBlocked;
+    mutable std::atomic<bool> m_viaMapDirty{true};
+    mutable std::mutex m_viaMapMutex;
+
+    // Jump distances of the first plane, for single-plane grids. Empty
+    // until the first jump point search; after that obstacles note the
+    // cells they change, and the next search patches just those.
+    mutable JumpPointTable m_jumpTable;
+    mutable std::vector<GridRect> m_jumpTableChanges;
+    mutable std::mutex m_jumpTableMutex;
+};
@@ -0,0 +1,299 @@
+#include "SpatialIndex.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    // Elements touching more cells than this go on the large-item list.
+    const int LargeCellCount = 64;
+
+    // Keeps the grid to a few million cells on sparse or huge boards.
+    const int MaxCellsPerAxis = 2048;
+
+    // Below this pitch the cells get smaller than the elements themselves.
+    const PcbCoord MinCellSize = 50000; // 0.05 mm
+
+    bool overlaps(const PcbBox& a, const PcbBox& b)
+    {
+        return a.minX <= b.maxX && b.minX <= a.maxX && a.minY <= b.maxY && b.minY <= a.maxY;
+    }
+
+    PcbBox centredBox(PcbPoint centre, double halfWidth, double halfHeight)
+    {
+        PcbBox box;
+        box.Union(static_cast<PcbCoord>(std::floor(centre.x - halfWidth)), static_cast<PcbCoord>(std::floor(centre.y - halfHeight)),
+                  static_cast<PcbCoord>(std::ceil(centre.x + halfWidth)), static_cast<PcbCoord>(std::ceil(centre.y + halfHeight)));
+        return box;
+    }
+}
+
+void SpatialIndex::Clear()
+{
+    *this = SpatialIndex();
+}
+
+void SpatialIndex::Build(const PcbData& data, PcbCoord cellSize)
+{
+    Clear();
+
+    const size_t count = data.GetLines().size() + data.GetPads().size() + data.GetVias().size() + data.GetZones().size();
+    const PcbBox& bounds = data.GetBounds();
+    if (!bounds.IsEmpty()) {
+        const double width = double(bounds.maxX) - bounds.minX + 1;
+        const double height = double(bounds.maxY) - bounds.minY + 1;
+        if (cellSize <= 0) {
+            // About four elements per cell for an even spread.
+            cellSize = static_cast<PcbCoord>(std::sqrt(width * height / std::max<size_t>(count, 1)) * 2);
+            cellSize = std::max(cellSize, MinCellSize);
+        }
+        cellSize = std::max({cellSize, static_cast<PcbCoord>(width / MaxCellsPerAxis) + 1,
+                             static_cast<PcbCoord>(height / MaxCellsPerAxis) + 1});
+        m_originX = bounds.minX;
+        m_originY = bounds.minY;
+        m_cellSize = cellSize;
+        m_columns = static_cast<int>(width / cellSize) + 1;
+        m_rows = static_cast<int>(height / cellSize) + 1;
+    }
+    m_cells.assign(static_cast<size_t>(m_columns) * m_rows, {});
+
+    m_entries.reserve(count);
+    m_slots.reserve(count);
+    auto insertAll = [&](PcbItemKind kind, size_t size) {
+        for (size_t i = 0; i < size; ++i) {
+            Insert(data, {kind, static_cast<uint32_t>(i)});
+        }
+    };
+    insertAll(PcbItemKind::Zone, data.GetZones().size());
+    insertAll(PcbItemKind::Line, data.GetLines().size());
+    insertAll(PcbItemKind::Pad, data.GetPads().size());
+    insertAll(PcbItemKind::Via, data.GetVias().size());
+}
+
+void SpatialIndex::Insert(const PcbData& data, PcbItemRef item)
+{
+    Entry entry;
+    entry.item = item;
+    switch (item.kind) {
+        case PcbItemKind::Line: {
+            const PcbLine line = data.GetLines()[item.index];
+            entry.isSegment = true;
+            entry.start = line.start;
+            entry.end = line.end;
+            entry.halfWidth = line.width / 2;
+            entry.box.Union(std::min(line.start.x, line.end.x) - entry.halfWidth, std::min(line.start.y, line.end.y) - entry.halfWidth,
+                            std::max(line.start.x, line.end.x) + entry.halfWidth, std::max(line.start.y, line.end.y) + entry.halfWidth);
+            entry.layers = LayerBit(line.layer);
+            break;
+        }
+        case PcbItemKind::Pad: {
+            const PcbPad pad = data.GetPads()[item.index];
+            double halfWidth = pad.size.x / 2.0;
+            double halfHeight = pad.size.y / 2.0;
+            if (std::fmod(pad.rotation, 180.0) != 0.0) {
+                // Any rotation fits inside the circle through the corners.
+                halfWidth = halfHeight = std::hypot(halfWidth, halfHeight);
+            }
+            entry.box = centredBox(pad.pos, halfWidth, halfHeight);
+            entry.layers = pad.layers | LayerBit(pad.layer);
+            break;
+        }
+        case PcbItemKind::Via: {
+            const PcbVia via = data.GetVias()[item.index];
+            entry.box = centredBox(via.pos, via.size / 2.0, via.size / 2.0);
+            entry.layers = via.layers | LayerBit(via.fromLayer) | LayerBit(via.toLayer);
+            break;
+        }
+        case PcbItemKind::Zone: {
+            const PcbZone zone = data.GetZones()[item.index];
+            for (const PcbPoint& pt : zone.polygon) {
+                entry.box.Union(pt.x, pt.y, pt.x, pt.y);
+            }
+            entry.layers = LayerBit(zone.layer);
+            break;
+        }
+    }
+
+    Remove(item); // Re-inserting an element updates it
+    if (m_cells.empty()) {
+        m_cells.resize(1);
+    }
+    uint32_t slot;
+    if (!m_freeEntries.empty()) {
+        slot = m_freeEntries.back();
+        m_freeEntries.pop_back();
+        m_entries[slot] = entry;
+    } else {
+        slot = static_cast<uint32_t>(m_entries.size());
+        m_entries.push_back(entry);
+    }
+    m_slots[Key(item)] = slot;
+    File(slot);
+}
+
+bool SpatialIndex::Remove(PcbItemRef item)
+{
+    auto it = m_slots.find(Key(item));
+    if (it == m_slots.end()) {
+        return false;
+    }
+    const uint32_t slot = it->second;
+    m_slots.erase(it);
+
+    auto unfile = [slot](std::vector<uint32_t>& slots) {
+        auto pos = std::find(slots.begin(), slots.end(), slot);
+        if (pos != slots.end()) {
+            *pos = slots.back();
+            slots.pop_back();
+        }
+    };
+    const PcbBox& box = m_entries[slot].box;
+    if (IsLarge(box)) {
+        unfile(m_large);
+    } else {
+        for (int y = CellY(box.minY); y <= CellY(box.maxY); ++y) {
+            for (int x = CellX(box.minX); x <= CellX(box.maxX); ++x) {
+                unfile(m_cells[static_cast<size_t>(y) * m_columns + x]);
+            }
+        }
+    }
+    m_freeEntries.push_back(slot);
+    return true;
+}
+
+void SpatialIndex::File(uint32_t slot)
+{
+    const PcbBox& box = m_entries[slot].box;
+    if (IsLarge(box)) {
+        m_large.push_back(slot);
+        return;
+    }
+    for (int y = CellY(box.minY); y <= CellY(box.maxY); ++y) {
+        for (int x = CellX(box.minX); x <= CellX(box.maxX); ++x) {
+            m_cells[static_cast<size_t>(y) * m_columns + x].push_back(slot);
+        }
+    }
+}
+
+void SpatialIndex::Query(const PcbBox& area, PcbLayerSet layers, std::vector<PcbItemRef>& items) const
+{
+    if (area.IsEmpty()) {
+        return;
+    }
+    for (uint32_t slot : m_large) {
+        const Entry& entry = m_entries[slot];
+        if (Matches(entry, layers) && overlaps(entry.box, area)) {
+            items.push_back(entry.item);
+        }
+    }
+
+    const int x0 = CellX(area.minX), x1 = CellX(area.maxX);
+    const int y0 = CellY(area.minY), y1 = CellY(area.maxY);
+    for (int y = y0; y <= y1; ++y) {
+        for (int x = x0; x <= x1; ++x) {
+            for (uint32_t slot : m_cells[static_cast<size_t>(y) * m_columns + x]) {
+                const Entry& entry = m_entries[slot];
+                // An element filed in several cells is reported only from the
+                // first cell that both it and the query cover.
+                if (x != std::max(CellX(entry.box.minX), x0) || y != std::max(CellY(entry.box.minY), y0)) {
+                    continue;
+                }
+                if (Matches(entry, layers) && overlaps(entry.box, area)) {
+                    items.push_back(entry.item);
+                }
+            }
+        }
+    }
+}
+
+bool SpatialIndex::Nearest(PcbPoint point, PcbLayerSet layers, PcbItemRef& item, double maxDistance) const
+{
+    bool found = false;
+    double best = maxDistance;
+    auto consider = [&](uint32_t slot) {
+        const Entry& entry = m_entries[slot];
+        if (!Matches(entry, layers)) {
+            return;
+        }
+        const double distance = Distance(entry, point);
+        if (distance < best || (!found && distance <= best)) {
+            best = distance;
+            item = entry.item;
+            found = true;
+        }
+    };
+    for (uint32_t slot : m_large) {
+        consider(slot);
+    }
+
+    // Search rings of cells outwards from the point's cell. Anything in ring
+    // r is at least (r - 1) cells away, which bounds the search.
+    const int cx = CellX(point.x);
+    const int cy = CellY(point.y);
+    const int maxRing = std::max(m_columns, m_rows);
+    auto visit = [&](int x, int y) {
+        if (x >= 0 && x < m_columns && y >= 0 && y < m_rows) {
+            for (uint32_t slot : m_cells[static_cast<size_t>(y) * m_columns + x]) {
+                consider(slot);
+            }
+        }
+    };
+    for (int ring = 0; ring <= maxRing; ++ring) {
+        if (ring > 0 && double(ring - 1) * m_cellSize > best) {
+            break;
+        }
+        if (ring == 0) {
+            visit(cx, cy);
+            continue;
+        }
+        for (int x = cx - ring; x <= cx + ring; ++x) {
+            visit(x, cy - ring);
+            visit(x, cy + ring);
+        }
+        for (int y = cy - ring + 1; y <= cy + ring - 1; ++y) {
+            visit(cx - ring, y);
+            visit(cx + ring, y);
+        }
+    }
+    return found;
+}
+
+int SpatialIndex::CellX(PcbCoord x) const
+{
+    const int64_t cell = (int64_t(x) - m_originX) / m_cellSize;
+    return static_cast<int>(std::clamp<int64_t>(cell, 0, m_columns - 1));
+}
+
+int SpatialIndex::CellY(PcbCoord y) const
+{
+    const int64_t cell = (int64_t(y) - m_originY) / m_cellSize;
+    return static_cast<int>(std::clamp<int64_t>(cell, 0, m_rows - 1));
+}
+
+bool SpatialIndex::IsLarge(const PcbBox& box) const
+{
+    const int64_t columns = CellX(box.maxX) - CellX(box.minX) + 1;
+    const int64_t rows = CellY(box.maxY) - CellY(box.minY) + 1;
+    return columns * rows > LargeCellCount;
+}
+
+bool SpatialIndex::Matches(const Entry& entry, PcbLayerSet layers)
+{
+    return layers == PcbAllLayers || (entry.layers & layers) != 0;
+}
+
+double SpatialIndex::Distance(const Entry& entry, PcbPoint point)
+{
+    if (entry.isSegment) {
+        const double dx = double(entry.end.x) - entry.start.x;
+        const double dy = double(entry.end.y) - entry.start.y;
+        const double lengthSquared = dx * dx + dy * dy;
+        double t = 0.0;
+        if (lengthSquared > 0.0) {
+            t = std::clamp(((double(point.x) - entry.start.x) * dx + (double(point.y) - entry.start.y) * dy) / lengthSquared, 0.0, 1.0);
+        }
+        const double distance = std::hypot(entry.start.x + t * dx - point.x, entry.start.y + t * dy - point.y);
+        return std::max(0.0, distance - entry.halfWidth);
+    }
+    const double dx = std::max({double(entry.box.minX) - point.x, 0.0, double(point.x) - entry.box.maxX});
+    const double dy = std::max({double(entry.box.minY) - point.y, 0.0, double(point.y) - entry.box.maxY});
+    return std::hypot(dx, dy);
+}
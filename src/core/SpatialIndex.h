@@ -0,0 +1,108 @@
+#pragma once
+
+#include "PcbData.h"
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+enum class PcbItemKind : uint8_t {
+    Line,
+    Pad,
+    Via,
+    Zone,
+};
+
+// Names one element of a PcbData by kind and index.
+struct PcbItemRef {
+    PcbItemKind kind = PcbItemKind::Line;
+    uint32_t index = 0;
+
+    bool operator==(const PcbItemRef& other) const { return kind == other.kind && index == other.index; }
+    bool operator!=(const PcbItemRef& other) const { return !(*this == other); }
+    bool operator<(const PcbItemRef& other) const {
+        return kind != other.kind ? kind < other.kind : index < other.index;
+    }
+};
+
+// Matches every item in a query, including those on layers outside the
+// first 64 of the table.
+constexpr PcbLayerSet PcbAllLayers = ~PcbLayerSet(0);
+
+// A uniform bucket grid over a board's elements. Each element is filed
+// under every cell its bounding box touches, so a rectangle query only
+// looks at the elements near it. Elements that would span a large part of
+// the grid (zones, long outline edges) are kept on a separate list that
+// every query checks, instead of being copied into thousands of cells.
+//
+// Queries don't modify the index and may run on several threads at once.
+class SpatialIndex
+{
+public:
+    SpatialIndex() = default;
+
+    /**
+     * @brief Indexes every line, pad, via and zone of a board, replacing the current contents.
+     * @param cellSize The grid pitch in board units, or 0 to pick one from the board's size and element count.
+     */
+    void Build(const PcbData& data, PcbCoord cellSize = 0);
+    void Clear();
+
+    // Adds or removes one element, e.g. a routed track that was appended
+    // to the board. The index stores element indices, so it has to be
+    // rebuilt after PcbData::RemoveElements(), which renumbers survivors.
+    // Elements outside the grid built by Build() are filed in its edge cells.
+    void Insert(const PcbData& data, PcbItemRef item);
+    bool Remove(PcbItemRef item);
+
+    /**
+     * @brief Finds the elements whose bounds overlap a rectangle on any of the given layers.
+     * @param items Receives each matching element once, in no particular order.
+     */
+    void Query(const PcbBox& area, PcbLayerSet layers, std::vector<PcbItemRef>& items) const;
+
+    /**
+     * @brief Finds the element closest to a point on any of the given layers.
+     *
+     * Distance is measured to a line's copper (the segment widened by half
+     * its width) and to the bounding box of other elements.
+     * @return false if no element lies within maxDistance.
+     */
+    bool Nearest(PcbPoint point, PcbLayerSet layers, PcbItemRef& item,
+                 double maxDistance = std::numeric_limits<double>::infinity()) const;
+
+    size_t size() const { return m_slots.size(); }
+    PcbCoord GetCellSize() const { return m_cellSize; }
+
+private:
+    struct Entry {
+        PcbBox box;
+        PcbLayerSet layers = 0;
+        PcbItemRef item;
+        // Lines are measured by their centre line for Nearest().
+        bool isSegment = false;
+        PcbPoint start, end;
+        PcbCoord halfWidth = 0;
+    };
+
+    int CellX(PcbCoord x) const;
+    int CellY(PcbCoord y) const;
+    bool IsLarge(const PcbBox& box) const;
+    static bool Matches(const Entry& entry, PcbLayerSet layers);
+    static double Distance(const Entry& entry, PcbPoint point);
+    static uint64_t Key(PcbItemRef item) { return (uint64_t(item.kind) << 32) | item.index; }
+    void File(uint32_t slot);
+
+    // Grid geometry. A default index is one cell covering everything.
+    PcbCoord m_originX = 0;
+    PcbCoord m_originY = 0;
+    PcbCoord m_cellSize = 1000000;
+    int m_columns = 1;
+    int m_rows = 1;
+
+    std::vector<Entry> m_entries;
+    std::vector<uint32_t> m_freeEntries;
+    std::vector<std::vector<uint32_t>> m_cells; // Entry indices, row-major
+    std::vector<uint32_t> m_large;
+    std::unordered_map<uint64_t, uint32_t> m_slots; // Item key to entry index
+};
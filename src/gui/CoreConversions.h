@@ -0,0 +1,40 @@
+#ifndef CORE_CONVERSIONS_H
+#define CORE_CONVERSIONS_H
+
+// The core works on plain C++ types (UTF-8 std::string, PcbRect in
+// millimetres, std::vector<int> net indices). These convert them to and
+// from the wxWidgets types the GUI uses.
+
+#include <wx/dynarray.h>
+#include <wx/geometry.h>
+#include <wx/string.h>
+#include <string>
+#include <vector>
+#include "../core/PcbData.h"
+
+inline wxString ToWxString(const std::string& utf8)
+{
+    return wxString::FromUTF8(utf8.data(), utf8.size());
+}
+
+inline std::vector<wxString> ToWxStrings(const std::vector<std::string>& utf8)
+{
+    std::vector<wxString> strings;
+    strings.reserve(utf8.size());
+    for (const std::string& text : utf8) {
+        strings.push_back(ToWxString(text));
+    }
+    return strings;
+}
+
+inline wxRect2DDouble ToWxRect(const PcbRect& rect)
+{
+    return wxRect2DDouble(rect.x, rect.y, rect.width, rect.height);
+}
+
+inline std::vector<int> ToIndexVector(const wxArrayInt& indices)
+{
+    return std::vector<int>(indices.begin(), indices.end());
+}
+
+#endif // CORE_CONVERSIONS_H
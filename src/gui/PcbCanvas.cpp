@@ -3,6 +3,8 @@
 #include <wx/textfile.h> // For wxTextFile
 #include <wx/settings.h> // For wxSystemSettings
 #include "../core/AutorouterCore.h"
+#include <algorithm>
+#include <limits>
 
 // Define the custom event type
 wxDEFINE_EVENT(EVT_ZOOM_AREA_COMPLETE, wxCommandEvent);
@@ -210,11 +212,50 @@ void PcbCanvas::OnDraw(wxDC& dc)
         wxBrush oldBrush = dc.GetBrush();
         wxPen oldPen = dc.GetPen();
 
+        // Coordinates are nanometres; pcb_scale is per millimetre.
+        const double scale = pcb_scale / PcbCoordsPerMillimetre;
+
+        // Resolve visibility and colour once per layer; per element it is a bit test.
+        const PcbData& data = *m_pcbDataPtr;
+        const size_t layerCount = data.GetLayers().size();
+        PcbLayerSet visibleLayers = 0;
+        std::vector<wxColour> layerColour(layerCount);
+        for (size_t i = 0; i < layerCount; ++i) {
+            const wxString name = ToWxString(data.GetLayers()[i].name);
+            if (m_layerColors.IsVisible(name)) {
+                visibleLayers |= LayerBit(static_cast<PcbLayerId>(i));
+            }
+            layerColour[i] = m_layerColors.GetColour(name, m_isNightMode);
+        }
+        const PcbLayerId edgeCuts = data.GetLayerId("Edge.Cuts");
+
+        // Only draw what the window shows. Zoomed in on a large board this is
+        // a small fraction of it; zoomed out it is everything.
+        auto toCoord = [scale, this](double logical) {
+            const double coord = logical / m_scale / scale;
+            return static_cast<PcbCoord>(std::clamp<double>(coord, std::numeric_limits<PcbCoord>::min(), std::numeric_limits<PcbCoord>::max()));
+        };
+        const wxPoint viewStart = GetViewStart();
+        const wxSize clientSize = GetClientSize();
+        PcbBox visibleArea;
+        visibleArea.Union(toCoord(viewStart.x), toCoord(viewStart.y),
+                          toCoord(viewStart.x + clientSize.x), toCoord(viewStart.y + clientSize.y));
+        std::vector<PcbItemRef> visibleItems;
+        m_spatialIndex.Query(visibleArea, PcbAllLayers, visibleItems);
+        std::sort(visibleItems.begin(), visibleItems.end()); // Keeps file order within each pass
+        auto forEachVisible = [&visibleItems](PcbItemKind kind, auto&& draw) {
+            auto first = std::lower_bound(visibleItems.begin(), visibleItems.end(), PcbItemRef{kind, 0});
+            for (auto it = first; it != visibleItems.end() && it->kind == kind; ++it) {
+                draw(it->index);
+            }
+        };
+
         // --- 1. Draw Zones (Copper Pours) ---
         dc.SetPen(*wxTRANSPARENT_PEN); // No outline for zones
-        for (const auto& zone : m_pcbDataPtr->GetZones()) {
-            if (!m_layerColors.IsVisible(zone.layer)) continue;
-            wxColour zoneColour = m_layerColors.GetColour(zone.layer, m_isNightMode);
+        forEachVisible(PcbItemKind::Zone, [&](uint32_t index) {
+            const PcbZone zone = data.GetZones()[index];
+            if (!(visibleLayers & LayerBit(zone.layer))) return;
+            const wxColour& zoneColour = layerColour[zone.layer];
             // Make it semi-transparent for a "pour" look
             wxColour pourColour(zoneColour.Red(), zoneColour.Green(), zoneColour.Blue(), 80);
             dc.SetBrush(wxBrush(pourColour, wxBRUSHSTYLE_SOLID));
@@ -222,71 +263,79 @@ void PcbCanvas::OnDraw(wxDC& dc)
             std::vector<wxPoint> points;
             points.reserve(zone.polygon.size());
             for (const auto& pt : zone.polygon) {
-                points.emplace_back(pt.m_x * pcb_scale, pt.m_y * pcb_scale);
+                points.emplace_back(pt.x * scale, pt.y * scale);
             }
             if (!points.empty()) {
                 dc.DrawPolygon(points.size(), points.data());
             }
-        }
+        });
 
         // --- 2. Draw Traces (Copper Segments) ---
-        for (const auto& line : m_pcbDataPtr->GetLines())
-        {
+        // Read straight from the columns; a board can have hundreds of thousands.
+        const PcbLineColumns& lines = data.GetLines().columns();
+        forEachVisible(PcbItemKind::Line, [&](uint32_t i) {
+            const PcbLayerId layer = lines.layer[i];
             // Skip board outline for now, we'll draw it last
-            if (!m_layerColors.IsVisible(line.layer) || line.layer == "Edge.Cuts") continue;
-            dc.SetPen(wxPen(m_layerColors.GetColour(line.layer, m_isNightMode), line.width * pcb_scale, wxPENSTYLE_SOLID));
-            dc.DrawLine(line.start.m_x * pcb_scale, line.start.m_y * pcb_scale, line.end.m_x * pcb_scale, line.end.m_y * pcb_scale);
-        }
+            if (!(visibleLayers & LayerBit(layer)) || layer == edgeCuts) return;
+            dc.SetPen(wxPen(layerColour[layer], lines.width[i] * scale, wxPENSTYLE_SOLID));
+            dc.DrawLine(lines.startX[i] * scale, lines.startY[i] * scale, lines.endX[i] * scale, lines.endY[i] * scale);
+        });
 
         // --- 3. Draw Pads ---
         dc.SetPen(*wxTRANSPARENT_PEN); // No outline for pads
-        for (const auto& pad : m_pcbDataPtr->GetPads())
-        {
+        const bool holesVisible = m_layerColors.IsVisible("Hole");
+        forEachVisible(PcbItemKind::Pad, [&](uint32_t index) {
+            const PcbPad pad = data.GetPads()[index];
             // Handle non-plated through-holes
-            if (pad.shape == "np_thru_hole") {
-                 if (!m_layerColors.IsVisible("Hole")) continue;
-                 double drill_size = pad.size.m_x; // For npth, size is the drill size
+            if (pad.shape == PcbPadShape::NpThruHole) {
+                 if (!holesVisible) return;
+                 double drill_size = pad.size.x; // For npth, size is the drill size
                  dc.SetBrush(*wxBLACK_BRUSH);
                  dc.SetPen(wxPen(m_layerColors.GetColour("Hole", m_isNightMode), 1));
-                 dc.DrawCircle(pad.pos.m_x * pcb_scale, pad.pos.m_y * pcb_scale, (drill_size / 2.0) * pcb_scale);
-                 continue;
+                 dc.DrawCircle(pad.pos.x * scale, pad.pos.y * scale, (drill_size / 2.0) * scale);
+                 return;
             }
 
-            dc.SetBrush(wxBrush(m_layerColors.GetColour(pad.layer, m_isNightMode)));
-            if (!m_layerColors.IsVisible(pad.layer)) continue;
+            // A through-hole pad stays visible while any of its layers is,
+            // and takes the colour of the first visible one.
+            const PcbLayerId padLayer = FirstLayer((pad.layers | LayerBit(pad.layer)) & visibleLayers);
+            if (padLayer == PcbNoLayer) return;
+            dc.SetBrush(wxBrush(layerColour[padLayer]));
 
             // KiCad 'at' is center, wxWidgets drawing is top-left. Convert and scale.
-            double x = (pad.pos.m_x - pad.size.m_x / 2.0) * pcb_scale;
-            double y = (pad.pos.m_y - pad.size.m_y / 2.0) * pcb_scale;
-            double w = pad.size.m_x * pcb_scale;
-            double h = pad.size.m_y * pcb_scale;
+            double x = (pad.pos.x - pad.size.x / 2.0) * scale;
+            double y = (pad.pos.y - pad.size.y / 2.0) * scale;
+            double w = pad.size.x * scale;
+            double h = pad.size.y * scale;
 
-            if (pad.shape == "rect")
+            if (pad.shape == PcbPadShape::Rect)
             {
                 dc.DrawRectangle(wxPoint(x, y), wxSize(w, h));
             }
-            else if (pad.shape == "circle" || pad.shape == "oval")
+            else if (pad.shape == PcbPadShape::Circle || pad.shape == PcbPadShape::Oval)
             {
                 dc.DrawEllipse(wxPoint(x, y), wxSize(w, h));
             }
-        }
+        });
 
         // --- 4. Draw Vias (on top of pads/traces) ---
         dc.SetPen(*wxTRANSPARENT_PEN);
         dc.SetBrush(wxBrush(m_layerColors.GetColour("Via", m_isNightMode)));
         if (m_layerColors.IsVisible("Via")) {
-            for (const auto& via : m_pcbDataPtr->GetVias()) {
-                dc.DrawCircle(via.pos.m_x * pcb_scale, via.pos.m_y * pcb_scale, (via.size / 2.0) * pcb_scale);
-            }
+            const PcbViaColumns& vias = data.GetVias().columns();
+            forEachVisible(PcbItemKind::Via, [&](uint32_t i) {
+                dc.DrawCircle(vias.x[i] * scale, vias.y[i] * scale, (vias.diameter[i] / 2.0) * scale);
+            });
         }
 
         // --- 5. Draw the PCB outline (last, so it's on top of everything) ---
         dc.SetPen(wxPen(m_layerColors.GetColour("Edge.Cuts", m_isNightMode), 2 / m_scale)); // Bright yellow for outline, scale pen width
-        for (const auto& line : m_pcbDataPtr->GetLines())
-        {
-            if (line.layer == "Edge.Cuts" && m_layerColors.IsVisible("Edge.Cuts")) {
-                dc.DrawLine(line.start.m_x * pcb_scale, line.start.m_y * pcb_scale, line.end.m_x * pcb_scale, line.end.m_y * pcb_scale);
-            }
+        if (visibleLayers & LayerBit(edgeCuts)) {
+            forEachVisible(PcbItemKind::Line, [&](uint32_t i) {
+                if (lines.layer[i] == edgeCuts) {
+                    dc.DrawLine(lines.startX[i] * scale, lines.startY[i] * scale, lines.endX[i] * scale, lines.endY[i] * scale);
+                }
+            });
         }
         dc.SetBrush(oldBrush);
         dc.SetPen(oldPen);
@@ -309,9 +358,14 @@ void PcbCanvas::OnDraw(wxDC& dc)
     }
 }
 
-void PcbCanvas::SetPcbData(const PcbData* data)
+void PcbCanvas::SetPcbData(std::shared_ptr<const PcbData> data)
 {
-    m_pcbDataPtr = data;
+    m_pcbDataPtr = std::move(data);
+    if (m_pcbDataPtr) {
+        m_spatialIndex.Build(*m_pcbDataPtr);
+    } else {
+        m_spatialIndex.Clear();
+    }
     UpdateVirtualSize();
     Refresh();
 }
@@ -320,7 +374,7 @@ void PcbCanvas::ZoomToFit()
 {
     if (!m_pcbDataPtr || m_pcbDataPtr->GetBoundingBox().IsEmpty()) return;
 
-    wxRect2DDouble bbox = m_pcbDataPtr->GetBoundingBox();
+    wxRect2DDouble bbox = ToWxRect(m_pcbDataPtr->GetBoundingBox());
     wxSize clientSize = GetClientSize();
 
     // Add some padding
@@ -347,7 +401,7 @@ void PcbCanvas::UpdateVirtualSize()
     if (!m_pcbDataPtr) return;
 
     const double pcb_scale = 10.0; // Scale factor: 10 pixels per mm
-    wxRect2DDouble bbox = m_pcbDataPtr->GetBoundingBox();
+    wxRect2DDouble bbox = ToWxRect(m_pcbDataPtr->GetBoundingBox());
     bbox.m_x -= 10.0; bbox.m_y -= 10.0;
     bbox.m_width += 20.0; bbox.m_height += 20.0;
     SetVirtualSize(bbox.GetRight() * pcb_scale, bbox.GetBottom() * pcb_scale);
@@ -2,8 +2,11 @@
 
 #include <wx/wx.h>
 #include <wx/scrolwin.h>
+#include <memory>
+#include "CoreConversions.h"
 #include "LayerColors.h"
 #include "../core/PcbData.h" // Include the refactored data header
+#include "../core/SpatialIndex.h"
 
 // Structure to hold session state when loading/saving
 struct SessionState
@@ -32,7 +35,8 @@ public:
     void ApplySessionState(const SessionState& state);
     void SetNightMode(bool nightMode);
 
-    void SetPcbData(const PcbData* data);
+    // Pins one version of the board; it is drawn until the next call.
+    void SetPcbData(std::shared_ptr<const PcbData> data);
     void UpdateVirtualSize();
     void ZoomIn();
     void ZoomOut();
@@ -59,7 +63,8 @@ private:
     wxPoint m_panStartPos;
     wxPoint m_mouseLogicalPos; // For status bar updates
 
-    const PcbData* m_pcbDataPtr;
+    std::shared_ptr<const PcbData> m_pcbDataPtr;
+    SpatialIndex m_spatialIndex; // Rebuilt by SetPcbData() whenever the board changes
     // Theming
     wxColour m_bgColour;
     wxColour m_gridColour;
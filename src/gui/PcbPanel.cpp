@@ -88,7 +88,7 @@ void PcbPanel::ZoomToFit()
         return;
     }
 
-    wxRect2DDouble bbox = m_pcbData->GetBoundingBox();
+    wxRect2DDouble bbox = ToWxRect(m_pcbData->GetBoundingBox());
     wxSize clientSize = GetClientSize();
 
     if (bbox.GetWidth() <= 0 || bbox.GetHeight() <= 0 || clientSize.x <= 0 || clientSize.y <= 0)
@@ -2,6 +2,7 @@
 
 #include <wx/wx.h>
 #include <wx/scrolwin.h>
+#include "CoreConversions.h"
 #include "../core/PcbData.h"
 
 class PcbPanel : public wxScrolledWindow
@@ -6,12 +6,16 @@
 #include <wx/aboutdlg.h>
 #include <wx/cmdline.h>
 #include <wx/artprov.h>
+#include <wx/filename.h>
+#include <wx/fswatcher.h>
+#include <wx/timer.h>
 
 #include "LayerControlPanel.h"
 #include "PcbCanvas.h" // Includes PcbData.h transitively
 #include "AutorouterDialog.h"
 #include "../core/AutorouterCore.h"
 #include <memory>
+#include <vector>
 
 enum
 {
@@ -20,7 +24,8 @@ enum
     ID_Autorouter,
     ID_ZoomToArea,
     ID_LayerVisibilityChanged,
-    ID_ZoomAreaComplete
+    ID_ZoomAreaComplete,
+    ID_ReloadTimer
 };
 
 // Define a new application type, derived from wxApp
@@ -53,6 +58,13 @@ private:
     wxMenuItem* m_saveMenuItem;
     wxMenuItem* m_saveAsMenuItem;
 
+    // Watches the open board's directory so saves from KiCad are picked up.
+    std::unique_ptr<wxFileSystemWatcher> m_watcher;
+    wxFileName m_pcbFileName;
+    wxTimer m_reloadTimer;
+
+    void WatchPcbFile(const wxString& path);
+
     // Event handlers
     void OnOpenKicad(wxCommandEvent& event);
     void OnOpenRoutingSession(wxCommandEvent& event);
@@ -68,6 +80,8 @@ private:
     void OnZoomToArea(wxCommandEvent& event);
     void OnLayerVisibilityChanged(wxCommandEvent& event);
     void OnAbout(wxCommandEvent& event);
+    void OnFileSystemEvent(wxFileSystemWatcherEvent& event);
+    void OnReloadTimer(wxTimerEvent& event);
 
 public:
     void SetNightMode(bool nightMode);
@@ -130,10 +144,10 @@ bool MyApp::RunHeadlessTest()
     }
 
     RoutingSettings settings;
-    wxArrayInt netsToRoute; // Route all nets for now
+    std::vector<int> netsToRoute; // Route all nets for now
     const auto& allNets = core.getPcbData()->GetNets();
     for (size_t i = 0; i < allNets.size(); ++i) {
-        netsToRoute.Add(i);
+        netsToRoute.push_back(static_cast<int>(i));
     }
 
     RoutingResult result = core.Route(settings, netsToRoute);
@@ -149,7 +163,9 @@ bool MyApp::RunHeadlessTest()
     else
         wxPrintf("  \"completion_rate_pct\": 0.0,\n");
     wxPrintf("  \"total_track_length_mm\": %.2f,\n", result.total_track_length);
-    wxPrintf("  \"via_count\": %d\n", result.via_count);
+    wxPrintf("  \"via_count\": %d,\n", result.via_count);
+    wxPrintf("  \"connections_total\": %d,\n", result.connections_total);
+    wxPrintf("  \"nets_complete\": %d\n", result.nets_complete);
     wxPrintf("}\n");
 
     // returning false from OnInit prevents the main loop
@@ -158,7 +174,8 @@ bool MyApp::RunHeadlessTest()
 
 // MyFrame constructor
 MyFrame::MyFrame()
-    : wxFrame(NULL, wxID_ANY, "PCB Autorouter GUI Test")
+    : wxFrame(NULL, wxID_ANY, "PCB Autorouter GUI Test"),
+      m_reloadTimer(this, ID_ReloadTimer)
 {
     m_core = std::make_unique<AutorouterCore>();
     m_isNightMode = false; // Default to light mode
@@ -244,12 +261,14 @@ MyFrame::MyFrame()
     Bind(EVT_ZOOM_AREA_COMPLETE, [this](wxCommandEvent&) { m_toolBar->ToggleTool(ID_ZoomToArea, false); });
     Bind(wxEVT_MENU, &MyFrame::OnAbout, this, wxID_ABOUT);
     Bind(wxEVT_MENU, &MyFrame::OnExit, this, wxID_EXIT);
+    Bind(wxEVT_FSWATCHER, &MyFrame::OnFileSystemEvent, this);
+    Bind(wxEVT_TIMER, &MyFrame::OnReloadTimer, this, ID_ReloadTimer);
 }
 
 void MyFrame::OnOpenKicad(wxCommandEvent& event)
 {
     wxFileDialog openFileDialog(this, "Open KiCad PCB file", "", "",
-                               "KiCad PCB files (*.kicad_pcb)|*.kicad_pcb",
+                               "KiCad PCB files (*.kicad_pcb;*.kicad_pcb.gz)|*.kicad_pcb;*.kicad_pcb.gz",
                                wxFD_OPEN | wxFD_FILE_MUST_EXIST);
 
     if (openFileDialog.ShowModal() == wxID_CANCEL)
@@ -257,11 +276,11 @@ void MyFrame::OnOpenKicad(wxCommandEvent& event)
 
     if (m_core->loadPcbFile(openFileDialog.GetPath().ToStdString()))
     {
-        m_canvas->SetPcbData(m_core->getPcbData().get());
+        m_canvas->SetPcbData(m_core->getPcbData());
         m_canvas->ZoomToFit();
 
         // Populate the layer control panel
-        auto layerNames = m_core->getPcbData()->GetUniqueLayerNames();
+        auto layerNames = ToWxStrings(m_core->getPcbData()->GetUniqueLayerNames());
         m_layerPanel->PopulateLayers(layerNames);
         m_canvas->GetLayerColors().PopulateFromLayers(layerNames);
 
@@ -270,7 +289,60 @@ void MyFrame::OnOpenKicad(wxCommandEvent& event)
         m_saveMenuItem->Enable(true);
         m_saveAsMenuItem->Enable(true);
         SetTitle(wxString::Format("PCB Autorouter - %s", openFileDialog.GetPath()));
+        WatchPcbFile(openFileDialog.GetPath());
+    }
+}
+
+void MyFrame::WatchPcbFile(const wxString& path)
+{
+    // The watcher needs a running event loop, so it is created on first use.
+    // KiCad saves by writing a new file and renaming it over the old one,
+    // which a watch on the file itself would lose; watch the directory.
+    if (!m_watcher)
+    {
+        m_watcher = std::make_unique<wxFileSystemWatcher>();
+        m_watcher->SetOwner(this);
     }
+    m_watcher->RemoveAll();
+    m_pcbFileName = wxFileName(path);
+    m_pcbFileName.MakeAbsolute();
+    m_watcher->Add(wxFileName::DirName(m_pcbFileName.GetPath()),
+                   wxFSW_EVENT_CREATE | wxFSW_EVENT_MODIFY | wxFSW_EVENT_RENAME);
+}
+
+void MyFrame::OnFileSystemEvent(wxFileSystemWatcherEvent& event)
+{
+    wxFileName changed = event.GetChangeType() == wxFSW_EVENT_RENAME ? event.GetNewPath() : event.GetPath();
+    changed.MakeAbsolute();
+    if (changed != m_pcbFileName)
+        return;
+
+    // A save arrives as a burst of events; reload once it has settled.
+    m_reloadTimer.StartOnce(250);
+}
+
+void MyFrame::OnReloadTimer(wxTimerEvent& event)
+{
+    PcbChangeSet changes;
+    if (!m_core->reloadPcbFile(&changes))
+    {
+        SetStatusText("Could not reload the board; keeping the previous version.", 0);
+        return;
+    }
+    if (changes.empty())
+        return;
+
+    // The reload committed a new version of the board; hand it to the
+    // canvas, which also rebuilds its spatial index for it.
+    m_canvas->SetPcbData(m_core->getPcbData());
+    if (changes.fullReload)
+    {
+        auto layerNames = ToWxStrings(m_core->getPcbData()->GetUniqueLayerNames());
+        m_layerPanel->PopulateLayers(layerNames);
+        m_canvas->GetLayerColors().PopulateFromLayers(layerNames);
+    }
+    SetStatusText(wxString::Format("Board reloaded: %d added, %d removed, %d changed.",
+                                   changes.itemsAdded, changes.itemsRemoved, changes.itemsChanged), 0);
 }
 
 void MyFrame::OnOpenRoutingSession(wxCommandEvent& event)
@@ -349,7 +421,33 @@ void MyFrame::OnToggleNightMode(wxCommandEvent& event)
 
 void MyFrame::OnAutorouter(wxCommandEvent& event)
 {
-    const auto& nets = m_core->getPcbData()->GetNets();
+    // Without a loaded board, pick one and list only its nets, which is
+    // quick even for large boards. The geometry is loaded once the user
+    // actually starts routing.
+    wxString boardToLoad;
+    std::vector<wxString> nets;
+    if (m_core->getPcbData())
+    {
+        nets = ToWxStrings(m_core->getPcbData()->GetNets());
+    }
+    else
+    {
+        wxFileDialog openFileDialog(this, "Open KiCad PCB file to route", "", "",
+                                   "KiCad PCB files (*.kicad_pcb;*.kicad_pcb.gz)|*.kicad_pcb;*.kicad_pcb.gz",
+                                   wxFD_OPEN | wxFD_FILE_MUST_EXIST);
+        if (openFileDialog.ShowModal() == wxID_CANCEL)
+            return;
+
+        boardToLoad = openFileDialog.GetPath();
+        std::vector<std::string> netNames;
+        if (!m_core->readNetNames(boardToLoad.ToStdString(), netNames))
+        {
+            wxMessageBox("Could not read the nets of the selected board.", "Error", wxOK | wxICON_ERROR, this);
+            return;
+        }
+        nets = ToWxStrings(netNames);
+    }
+
     if (nets.empty())
     {
         wxMessageBox("Please open a KiCad PCB file with defined nets first.", "No Nets Loaded", wxOK | wxICON_INFORMATION, this);
@@ -368,8 +466,24 @@ void MyFrame::OnAutorouter(wxCommandEvent& event)
         wxArrayInt selections = dlg.GetSelectedNets();
         int passes = dlg.GetRoutingPasses();
 
+        if (!boardToLoad.IsEmpty())
+        {
+            if (!m_core->loadPcbFile(boardToLoad.ToStdString()))
+            {
+                wxMessageBox("Could not load the selected board.", "Error", wxOK | wxICON_ERROR, this);
+                return;
+            }
+            m_canvas->SetPcbData(m_core->getPcbData());
+            m_canvas->ZoomToFit();
+            auto layerNames = ToWxStrings(m_core->getPcbData()->GetUniqueLayerNames());
+            m_layerPanel->PopulateLayers(layerNames);
+            m_canvas->GetLayerColors().PopulateFromLayers(layerNames);
+            SetTitle(wxString::Format("PCB Autorouter - %s", boardToLoad));
+            WatchPcbFile(boardToLoad);
+        }
+
         RoutingSettings settings{passes};
-        m_core->Route(settings, selections); // In a real app, this should be in a thread
+        m_core->Route(settings, ToIndexVector(selections)); // In a real app, this should be in a thread
         SetStatusText("Routing complete.", 0);
     }
 }
@@ -1,8 +1,6 @@
 #include "kicad/KicadPcb.h"
 #include "kicad/SexpParser.h"
-#include <fstream>
 #include <iostream>
-#include <sstream>
 #include <stdexcept>
 
 KicadPcb::KicadPcb()
@@ -13,37 +11,42 @@ KicadPcb::~KicadPcb()
 {
 }
 
-bool KicadPcb::loadFromFile(const std::string& filename)
+bool KicadPcb::loadFromFile(const std::string& filename, bool lazy)
 {
-    std::ifstream file(filename);
-    if (!file.is_open())
+    // Drop the old tree before its source buffer goes away.
+    m_document.clear();
+
+    if (!m_source.open(filename))
     {
         std::cerr << "Error: Could not open file " << filename << std::endl;
         return false;
     }
 
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    file.close();
-    std::string contents = buffer.str();
-
-    std::cout << "Successfully opened " << filename << ". Parsing..." << std::endl;
+    std::clog << "Successfully opened " << filename << ". Parsing..." << std::endl;
 
     try
     {
-        m_rootNode = SexpParser::parse(contents);
+        if (lazy)
+        {
+            SexpParser::parseLazy(m_source.view(), m_document);
+        }
+        else
+        {
+            SexpParser::parse(m_source.view(), m_document);
+        }
     }
     catch (const std::runtime_error& e)
     {
         std::cerr << "Error parsing KiCad PCB file: " << e.what() << std::endl;
+        m_source.close();
         return false;
     }
 
-    std::cout << "File successfully parsed." << std::endl;
+    std::clog << "File successfully parsed." << std::endl;
     return true;
 }
 
 const SexpNode& KicadPcb::getRootNode() const
 {
-    return m_rootNode;
+    return m_document.getRoot();
 }
\ No newline at end of file
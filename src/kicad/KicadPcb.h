@@ -3,6 +3,7 @@
 
 #include <string>
 #include "kicad/Sexp.h"
+#include "kicad/MappedFile.h"
 
 // Forward declarations for KiCad data structures can go here later.
 
@@ -14,15 +15,22 @@ public:
 
     /**
      * @brief Loads a KiCad PCB file and parses its contents.
+     * The file is memory-mapped and parsed in place; pass "-" to read the
+     * board from standard input instead.
      * @param filename The path to the .kicad_pcb file.
+     * @param lazy Parse with SexpParser::parseLazy(), for callers that only
+     *             look at a few parts of the board (nets, layers, metadata).
      * @return true if loading and parsing was successful, false otherwise.
      */
-    bool loadFromFile(const std::string& filename);
+    bool loadFromFile(const std::string& filename, bool lazy = false);
 
     const SexpNode& getRootNode() const;
 
 private:
-    SexpNode m_rootNode;
+    // The document's atoms point into m_source, so the mapping is kept for
+    // as long as the tree is.
+    MappedFile m_source;
+    SexpDocument m_document;
 
     // We will add member variables to store PCB data here as we parse it.
     // For example:
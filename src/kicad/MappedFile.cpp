@@ -0,0 +1,175 @@
+#include "kicad/MappedFile.h"
+#include <utility>
+
+#ifdef _WIN32
+    #ifndef WIN32_LEAN_AND_MEAN
+        #define WIN32_LEAN_AND_MEAN
+    #endif
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+MappedFile::MappedFile() : m_data(nullptr), m_size(0), m_mapped(false)
+{
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : m_data(nullptr), m_size(0), m_mapped(false)
+{
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other)
+    {
+        close();
+        m_mapped = other.m_mapped;
+        m_size = other.m_size;
+        m_buffer = std::move(other.m_buffer);
+        // A fallback buffer moves with the string, so re-point at our copy.
+        m_data = m_mapped ? other.m_data : m_buffer.data();
+
+        other.m_data = nullptr;
+        other.m_size = 0;
+        other.m_mapped = false;
+        other.m_buffer.clear();
+    }
+    return *this;
+}
+
+bool MappedFile::open(const std::string& filename)
+{
+    close();
+
+    if (filename == "-")
+    {
+        return readStream(stdin);
+    }
+
+    if (map(filename))
+    {
+        return true;
+    }
+
+    // Not mappable (pipe, FIFO, empty file, ...). Read it the slow way.
+    std::FILE* stream = std::fopen(filename.c_str(), "rb");
+    if (!stream)
+    {
+        return false;
+    }
+    bool ok = readStream(stream);
+    std::fclose(stream);
+    return ok;
+}
+
+void MappedFile::close()
+{
+    if (m_mapped && m_data)
+    {
+#ifdef _WIN32
+        UnmapViewOfFile(m_data);
+#else
+        munmap(const_cast<char*>(m_data), m_size);
+#endif
+    }
+    m_data = nullptr;
+    m_size = 0;
+    m_mapped = false;
+    m_buffer.clear();
+    m_buffer.shrink_to_fit();
+}
+
+bool MappedFile::map(const std::string& filename)
+{
+#ifdef _WIN32
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (GetFileType(file) != FILE_TYPE_DISK || !GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (!mapping)
+    {
+        return false;
+    }
+
+    // The view keeps the mapping object alive, so the handle can go now.
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!view)
+    {
+        return false;
+    }
+
+    m_data = static_cast<const char*>(view);
+    m_size = static_cast<size_t>(fileSize.QuadPart);
+#else
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    void* view = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (view == MAP_FAILED)
+    {
+        return false;
+    }
+
+    // The parser makes a single forward pass over the file.
+    madvise(view, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+
+    m_data = static_cast<const char*>(view);
+    m_size = static_cast<size_t>(st.st_size);
+#endif
+    m_mapped = true;
+    return true;
+}
+
+bool MappedFile::readStream(std::FILE* stream)
+{
+    char chunk[64 * 1024];
+    size_t n;
+    while ((n = std::fread(chunk, 1, sizeof(chunk), stream)) > 0)
+    {
+        m_buffer.append(chunk, n);
+    }
+    if (std::ferror(stream))
+    {
+        m_buffer.clear();
+        return false;
+    }
+
+    m_data = m_buffer.data();
+    m_size = m_buffer.size();
+    m_mapped = false;
+    return true;
+}
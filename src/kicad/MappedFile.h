@@ -0,0 +1,52 @@
+#ifndef KICAD_MAPPED_FILE_H
+#define KICAD_MAPPED_FILE_H
+
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+// A read-only view over the contents of a file.
+//
+// Regular files are memory-mapped so the parser can read them in place without
+// copying them into a std::string first. Sources that cannot be mapped (pipes,
+// character devices, stdin via the special name "-") fall back to being read
+// into an owned buffer, so callers always get a contiguous string_view.
+
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    /**
+     * @brief Opens a file and exposes its contents through view().
+     * @param filename The path to the file, or "-" to read standard input.
+     * @return true if the contents are available, false otherwise.
+     */
+    bool open(const std::string& filename);
+
+    /**
+     * @brief Releases the mapping (or fallback buffer). view() becomes empty.
+     */
+    void close();
+
+    std::string_view view() const { return std::string_view(m_data, m_size); }
+    size_t size() const { return m_size; }
+    bool isMapped() const { return m_mapped; }
+
+private:
+    bool map(const std::string& filename);
+    bool readStream(std::FILE* stream);
+
+    const char* m_data;
+    size_t m_size;
+    bool m_mapped;
+    std::string m_buffer; // Used when the source could not be mapped.
+};
+
+#endif // KICAD_MAPPED_FILE_H
@@ -0,0 +1,80 @@
+#include "kicad/Sexp.h"
+#include "kicad/SexpParser.h"
+
+void SexpNode::expand() const
+{
+    size_t count = 0;
+    const SexpNode* children = SexpParser::parseLazyChildren(*m_lazy, count);
+    m_children = children;
+    m_size = static_cast<uint32_t>(count);
+    m_isLazy = false;
+}
+
+template <typename T>
+T* SexpArena::allocate(std::vector<Block<T>>& blocks, size_t maxSize, size_t count)
+{
+    if (blocks.empty() || blocks.back().capacity - blocks.back().used < count) {
+        // A request larger than a whole block gets a block of its own.
+        Block<T> block;
+        block.capacity = nextCapacity(blocks, maxSize, count);
+        block.data.reset(new T[block.capacity]);
+        m_bytesReserved += block.capacity * sizeof(T);
+        blocks.push_back(std::move(block));
+    }
+
+    Block<T>& block = blocks.back();
+    T* dest = block.data.get() + block.used;
+    block.used += count;
+    return dest;
+}
+
+template <typename T>
+void SexpArena::resetBlocks(std::vector<Block<T>>& blocks)
+{
+    if (blocks.size() > 1) {
+        blocks.resize(1);
+    }
+    if (!blocks.empty()) {
+        blocks.front().used = 0;
+        m_bytesReserved += blocks.front().capacity * sizeof(T);
+    }
+}
+
+const SexpNode* SexpArena::storeNodes(const SexpNode* nodes, size_t count)
+{
+    if (count == 0) {
+        return nullptr;
+    }
+
+    SexpNode* dest = allocate(m_nodeBlocks, NodeBlockSize, count);
+    std::copy(nodes, nodes + count, dest);
+    return dest;
+}
+
+char* SexpArena::allocateChars(size_t count)
+{
+    return allocate(m_charBlocks, CharBlockSize, count);
+}
+
+const SexpLazySpan* SexpArena::storeLazySpan(std::string_view text)
+{
+    SexpLazySpan* span = allocate(m_spanBlocks, SpanBlockSize, 1);
+    *span = SexpLazySpan{text.data(), text.size(), this};
+    return span;
+}
+
+void SexpArena::clear()
+{
+    m_nodeBlocks.clear();
+    m_charBlocks.clear();
+    m_spanBlocks.clear();
+    m_bytesReserved = 0;
+}
+
+void SexpArena::reset()
+{
+    m_bytesReserved = 0;
+    resetBlocks(m_nodeBlocks);
+    resetBlocks(m_charBlocks);
+    resetBlocks(m_spanBlocks);
+}
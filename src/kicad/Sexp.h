@@ -1,29 +1,219 @@
 #ifndef KICAD_SEXP_H
 #define KICAD_SEXP_H
 
-#include <string>
+#include "kicad/SexpKeywords.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
 #include <vector>
-#include <variant>
 
 // An S-expression can be either an atom (a string) or a list of other S-expressions.
+//
+// Nodes are small fixed-size records that live in an SexpArena owned by an
+// SexpDocument. The children of a list are stored contiguously, so a list is
+// just a pointer and a count into the arena. Atoms are views into the source
+// text; only quoted atoms that contain escape sequences are decoded into
+// arena-owned storage. The source buffer must therefore outlive the document.
+//
+// Unquoted atoms that are known keywords carry their SexpKeyword ID, and a
+// list carries the ID of its head atom, so "is this a (layer ...) node" is a
+// single integer compare.
+//
+// Documents parsed with SexpParser::parseLazy() start out with unexpanded
+// lists that know only their head keyword and where their text is. The
+// first getList() on such a node parses one level of children (which are
+// unexpanded in turn) into the document's arena. Expansion mutates the
+// node, so a lazy document must not be read from several threads at once.
 
-class SexpNode; // Forward declaration
+class SexpList; // Forward declaration
+class SexpArena; // Forward declaration
 
-using SexpList = std::vector<SexpNode>;
-using SexpAtom = std::string;
+// The source text of an unexpanded list and the arena its children go to.
+struct SexpLazySpan {
+    const char* text;
+    size_t size;
+    SexpArena* arena;
+};
+
+using SexpAtom = std::string_view;
 
 class SexpNode {
 public:
-    // A node can hold either an atom or a list of child nodes.
-    std::variant<SexpAtom, SexpList> value;
+    SexpNode() : m_text(nullptr), m_size(0), m_keyword(SexpKeyword::Unknown), m_isList(true), m_isLazy(false) {}
+
+    static SexpNode makeAtom(SexpAtom text, SexpKeyword keyword = SexpKeyword::Unknown) {
+        SexpNode node;
+        node.m_text = text.data();
+        node.m_size = static_cast<uint32_t>(text.size());
+        node.m_keyword = keyword;
+        node.m_isList = false;
+        return node;
+    }
+
+    static SexpNode makeList(const SexpNode* children, size_t count) {
+        SexpNode node;
+        node.m_children = children;
+        node.m_size = static_cast<uint32_t>(count);
+        node.m_keyword = (count > 0 && children[0].isAtom()) ? children[0].m_keyword : SexpKeyword::Unknown;
+        node.m_isList = true;
+        return node;
+    }
+
+    // A list whose children are parsed from span on first access.
+    static SexpNode makeLazyList(const SexpLazySpan* span, SexpKeyword keyword) {
+        SexpNode node;
+        node.m_lazy = span;
+        node.m_keyword = keyword;
+        node.m_isLazy = true;
+        return node;
+    }
 
     // Convenience functions to check the type
-    bool isAtom() const { return std::holds_alternative<SexpAtom>(value); }
-    bool isList() const { return std::holds_alternative<SexpList>(value); }
+    bool isAtom() const { return !m_isList; }
+    bool isList() const { return m_isList; }
+
+    // Convenience functions to get the value. An atom asked for its list (or
+    // vice versa) yields an empty value rather than throwing.
+    SexpAtom getAtom() const { return m_isList ? SexpAtom() : SexpAtom(m_text, m_size); }
+    SexpList getList() const;
+
+    // The atom's keyword, or for a list the keyword of its head atom.
+    SexpKeyword getKeyword() const { return m_keyword; }
+
+    // True for a list from a lazy parse whose children haven't been read yet.
+    bool isExpanded() const { return !m_isLazy; }
+
+private:
+    // Parses the children of an unexpanded list. Throws std::runtime_error
+    // on malformed input.
+    void expand() const;
+
+    // Expansion fills in the children of a node that is logically const.
+    union {
+        mutable const char* m_text;         // Atom: first character
+        mutable const SexpNode* m_children; // List: first child in the arena
+        mutable const SexpLazySpan* m_lazy; // Unexpanded list: its source text
+    };
+    mutable uint32_t m_size; // Atom length or child count
+    SexpKeyword m_keyword;
+    bool m_isList;
+    mutable bool m_isLazy;
+};
+
+// A read-only view over the children of a list node.
+class SexpList {
+public:
+    using const_iterator = const SexpNode*;
+
+    SexpList() : m_begin(nullptr), m_size(0) {}
+    SexpList(const SexpNode* begin, size_t size) : m_begin(begin), m_size(size) {}
+
+    const SexpNode* begin() const { return m_begin; }
+    const SexpNode* end() const { return m_begin + m_size; }
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    const SexpNode& operator[](size_t index) const { return m_begin[index]; }
+    const SexpNode& front() const { return m_begin[0]; }
+
+private:
+    const SexpNode* m_begin;
+    size_t m_size;
+};
+
+inline SexpList SexpNode::getList() const {
+    if (m_isLazy) {
+        expand();
+    }
+    return m_isList ? SexpList(m_children, m_size) : SexpList();
+}
+
+// Block allocator backing a parsed document. Blocks never move once
+// allocated, so pointers handed out stay valid for the arena's lifetime.
+class SexpArena {
+public:
+    SexpArena() = default;
+    SexpArena(const SexpArena&) = delete;
+    SexpArena& operator=(const SexpArena&) = delete;
+    SexpArena(SexpArena&&) noexcept = default;
+    SexpArena& operator=(SexpArena&&) noexcept = default;
+
+    // Copies a run of sibling nodes into contiguous arena storage.
+    const SexpNode* storeNodes(const SexpNode* nodes, size_t count);
+
+    // Reserves space for decoded atom text. The caller fills in the bytes.
+    char* allocateChars(size_t count);
+
+    // Records the source span of an unexpanded list.
+    const SexpLazySpan* storeLazySpan(std::string_view text);
+
+    void clear();
+
+    // Forgets all allocations but keeps the first block of each kind for reuse.
+    void reset();
+
+    // Total bytes held in arena blocks.
+    size_t bytesReserved() const { return m_bytesReserved; }
+
+private:
+    template <typename T>
+    struct Block {
+        std::unique_ptr<T[]> data;
+        size_t capacity = 0;
+        size_t used = 0;
+    };
+
+    // Blocks start small and double up to the maximum, so parsing a single
+    // element doesn't pay for a megabyte-sized first block.
+    static constexpr size_t MinBlockSize = 256;
+    static constexpr size_t NodeBlockSize = 64 * 1024;
+    static constexpr size_t CharBlockSize = 64 * 1024;
+
+    static constexpr size_t SpanBlockSize = 16 * 1024;
+
+    template <typename T>
+    static size_t nextCapacity(const std::vector<Block<T>>& blocks, size_t maxSize, size_t count) {
+        size_t capacity = blocks.empty() ? MinBlockSize : std::min(maxSize, blocks.back().capacity * 2);
+        return capacity < count ? count : capacity;
+    }
+
+    // Returns room for count elements, starting a new block when the last one is full.
+    template <typename T>
+    T* allocate(std::vector<Block<T>>& blocks, size_t maxSize, size_t count);
+
+    template <typename T>
+    void resetBlocks(std::vector<Block<T>>& blocks);
+
+    std::vector<Block<SexpNode>> m_nodeBlocks;
+    std::vector<Block<char>> m_charBlocks;
+    std::vector<Block<SexpLazySpan>> m_spanBlocks;
+    size_t m_bytesReserved = 0;
+};
+
+// A parsed S-expression tree together with the arena that owns its nodes.
+// The arena lives on the heap so that the lazy spans pointing at it stay
+// valid when the document is moved.
+class SexpDocument {
+public:
+    SexpDocument() : m_arena(std::make_unique<SexpArena>()) {}
+    SexpDocument(SexpDocument&&) noexcept = default;
+    SexpDocument& operator=(SexpDocument&&) noexcept = default;
+
+    const SexpNode& getRoot() const { return m_root; }
+
+    void clear() {
+        m_arena->clear();
+        m_root = SexpNode();
+    }
+
+    size_t bytesReserved() const { return m_arena->bytesReserved(); }
+
+private:
+    friend class SexpParser;
 
-    // Convenience functions to get the value (with checks)
-    const SexpAtom& getAtom() const { return std::get<SexpAtom>(value); }
-    const SexpList& getList() const { return std::get<SexpList>(value); }
+    std::unique_ptr<SexpArena> m_arena;
+    SexpNode m_root;
 };
 
-#endif // KICAD_SEXP_H
\ No newline at end of file
+#endif // KICAD_SEXP_H
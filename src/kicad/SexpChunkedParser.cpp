@@ -0,0 +1,243 @@
+#include "kicad/SexpChunkedParser.h"
+#include "kicad/SexpParser.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <zlib.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+    bool isAtomChar(char c) {
+        return !isspace(static_cast<unsigned char>(c)) && c != '(' && c != ')';
+    }
+}
+
+SexpChunkedParser::SexpChunkedParser(size_t chunkSize)
+    : m_buffer(std::max<size_t>(chunkSize, 1)) {}
+
+SexpChunkedParser::~SexpChunkedParser()
+{
+    close();
+}
+
+bool SexpChunkedParser::isCompressedPath(const std::string& path)
+{
+    return path.size() >= 3 && path.compare(path.size() - 3, 3, ".gz") == 0;
+}
+
+bool SexpChunkedParser::open(const std::string& path)
+{
+    close();
+    if (path == "-") {
+        // gzclose() closes the descriptor, so give zlib its own copy.
+#ifdef _WIN32
+        m_file = gzdopen(_dup(_fileno(stdin)), "rb");
+#else
+        m_file = gzdopen(dup(fileno(stdin)), "rb");
+#endif
+    } else {
+        m_file = gzopen(path.c_str(), "rb");
+    }
+    if (!m_file) {
+        return false;
+    }
+    gzbuffer(m_file, static_cast<unsigned>(std::min<size_t>(m_buffer.size(), 1 << 20)));
+    m_pos = m_end = 0;
+    return true;
+}
+
+void SexpChunkedParser::close()
+{
+    if (m_file) {
+        gzclose(m_file);
+        m_file = nullptr;
+    }
+    m_pos = m_end = 0;
+    m_tokenStart = m_listStart = NoPosition;
+}
+
+bool SexpChunkedParser::refill()
+{
+    if (!m_file) {
+        return false;
+    }
+
+    // Keep the unread bytes and anything a partial token or capture still needs.
+    const size_t keep = std::min({m_pos, m_tokenStart, m_listStart});
+    if (keep > 0) {
+        std::memmove(m_buffer.data(), m_buffer.data() + keep, m_end - keep);
+        m_end -= keep;
+        m_pos -= keep;
+        if (m_tokenStart != NoPosition) {
+            m_tokenStart -= keep;
+        }
+        if (m_listStart != NoPosition) {
+            m_listStart -= keep;
+        }
+    }
+    if (m_end == m_buffer.size()) {
+        // Everything in the buffer is still needed.
+        m_buffer.resize(m_buffer.size() * 2);
+    }
+
+    const size_t wanted = std::min<size_t>(m_buffer.size() - m_end, 1u << 30);
+    const int count = gzread(m_file, m_buffer.data() + m_end, static_cast<unsigned>(wanted));
+    if (count < 0) {
+        int error = Z_OK;
+        const char* message = gzerror(m_file, &error);
+        throw std::runtime_error(std::string("Error reading input: ") + message);
+    }
+    m_end += static_cast<size_t>(count);
+    return m_pos < m_end;
+}
+
+void SexpChunkedParser::parse(SexpEventHandler& handler)
+{
+    int depth = 0;
+    while (true) {
+        skipWhitespace();
+        if (!more()) {
+            break;
+        }
+
+        char c = m_buffer[m_pos];
+        if (c == '(') {
+            // Pinned until the handler decides, in case it captures the list.
+            m_listStart = m_pos++;
+            skipWhitespace();
+            SexpAtom head;
+            if (more() && isAtomChar(m_buffer[m_pos])) {
+                head = readAtom();
+            }
+
+            switch (handler.enterList(head)) {
+                case SexpEventHandler::Action::Descend:
+                    m_listStart = NoPosition;
+                    depth++;
+                    break;
+                case SexpEventHandler::Action::Skip:
+                    m_listStart = NoPosition;
+                    skipToListEnd();
+                    break;
+                case SexpEventHandler::Action::Capture: {
+                    skipToListEnd();
+                    const std::string_view text(m_buffer.data() + m_listStart, m_pos - m_listStart);
+                    m_listStart = NoPosition;
+                    SexpParser::parse(text, m_capture);
+                    handler.capturedList(m_capture.getRoot());
+                    break;
+                }
+            }
+        } else if (c == ')') {
+            if (depth == 0) {
+                throw std::runtime_error("Unexpected closing parenthesis.");
+            }
+            m_pos++;
+            depth--;
+            handler.leaveList();
+        } else {
+            handler.atom(readAtom());
+        }
+    }
+
+    if (depth != 0) {
+        throw std::runtime_error("Unmatched opening parenthesis.");
+    }
+}
+
+// Reads an atom (quoted or unquoted) at the current position.
+SexpAtom SexpChunkedParser::readAtom()
+{
+    m_tokenStart = m_pos;
+    if (m_buffer[m_pos] == '"') {
+        m_pos++;
+        bool hasEscapes = false;
+        while (true) {
+            if (!more()) {
+                throw std::runtime_error("Unmatched quote in string literal.");
+            }
+            const char c = m_buffer[m_pos];
+            if (c == '"') {
+                break;
+            }
+            if (c == '\\') {
+                hasEscapes = true;
+                m_pos++;
+                if (!more()) {
+                    throw std::runtime_error("Unmatched quote in string literal.");
+                }
+            }
+            m_pos++;
+        }
+        const std::string_view raw(m_buffer.data() + m_tokenStart + 1, m_pos - m_tokenStart - 1);
+        m_pos++; // Closing '"'
+        m_tokenStart = NoPosition;
+        if (hasEscapes) {
+            m_decoded.resize(raw.size());
+            m_decoded.resize(SexpParser::decodeEscapes(raw, &m_decoded[0]));
+            return m_decoded;
+        }
+        return raw;
+    }
+
+    while (more() && isAtomChar(m_buffer[m_pos])) {
+        m_pos++;
+    }
+    const std::string_view atom(m_buffer.data() + m_tokenStart, m_pos - m_tokenStart);
+    m_tokenStart = NoPosition;
+    return atom;
+}
+
+void SexpChunkedParser::skipWhitespace()
+{
+    while (more() && isspace(static_cast<unsigned char>(m_buffer[m_pos]))) {
+        m_pos++;
+    }
+}
+
+// Skips a quoted atom whose opening '"' is at the current position.
+void SexpChunkedParser::skipQuoted()
+{
+    m_pos++; // Opening '"'
+    while (true) {
+        if (!more()) {
+            throw std::runtime_error("Unmatched quote in string literal.");
+        }
+        const char c = m_buffer[m_pos++];
+        if (c == '"') {
+            return;
+        }
+        if (c == '\\') {
+            if (!more()) {
+                throw std::runtime_error("Unmatched quote in string literal.");
+            }
+            m_pos++;
+        }
+    }
+}
+
+// Moves past the ')' closing the list whose head has just been read.
+void SexpChunkedParser::skipToListEnd()
+{
+    int depth = 1;
+    while (more()) {
+        const char c = m_buffer[m_pos];
+        if (c == '"') {
+            skipQuoted();
+            continue;
+        }
+        m_pos++;
+        if (c == '(') {
+            depth++;
+        } else if (c == ')' && --depth == 0) {
+            return;
+        }
+    }
+    throw std::runtime_error("Unmatched opening parenthesis.");
+}
@@ -0,0 +1,79 @@
+#ifndef KICAD_SEXP_CHUNKED_PARSER_H
+#define KICAD_SEXP_CHUNKED_PARSER_H
+
+#include "kicad/Sexp.h"
+#include "kicad/SexpStreamParser.h"
+#include <string>
+#include <vector>
+
+struct gzFile_s; // zlib's file handle
+
+// An event-driven S-expression parser that reads its input through a
+// fixed-size buffer instead of needing it all in memory. It reports the
+// same events as SexpStreamParser, so the same handlers work with both.
+//
+// Files are read through zlib, which decompresses gzip files (such as an
+// archived .kicad_pcb.gz) on the fly and passes plain files through.
+//
+// Memory use is the buffer plus the largest list a handler captures: a
+// captured list is kept contiguous until it closes, and a single token or
+// captured list longer than the buffer grows it. Skipped and descended
+// lists never hold more than the buffer.
+class SexpChunkedParser {
+public:
+    static constexpr size_t DefaultChunkSize = 256 * 1024;
+
+    explicit SexpChunkedParser(size_t chunkSize = DefaultChunkSize);
+    ~SexpChunkedParser();
+
+    SexpChunkedParser(const SexpChunkedParser&) = delete;
+    SexpChunkedParser& operator=(const SexpChunkedParser&) = delete;
+
+    /**
+     * @brief Opens a plain or gzip-compressed file; "-" reads standard input.
+     * @return false if the file could not be opened.
+     */
+    bool open(const std::string& path);
+
+    void close();
+
+    /**
+     * @brief Reads the whole input and reports its structure to the handler.
+     *
+     * Atom views and captured nodes passed to the handler point into the
+     * read buffer and are only valid until the handler returns.
+     * @throws std::runtime_error on parsing or read errors.
+     */
+    void parse(SexpEventHandler& handler);
+
+    // Current size of the read buffer; stays at the chunk size unless a
+    // token or captured list needed more.
+    size_t bufferSize() const { return m_buffer.size(); }
+
+    // True if the path names a gzip-compressed file (ends in ".gz").
+    static bool isCompressedPath(const std::string& path);
+
+private:
+    static constexpr size_t NoPosition = static_cast<size_t>(-1);
+
+    // Makes m_buffer[m_pos] readable, refilling from the file if needed.
+    // Returns false at the end of the input.
+    bool more() { return m_pos < m_end || refill(); }
+    bool refill();
+
+    SexpAtom readAtom();
+    void skipWhitespace();
+    void skipToListEnd();
+    void skipQuoted();
+
+    gzFile_s* m_file = nullptr;
+    std::vector<char> m_buffer;
+    size_t m_pos = 0;        // Read position in m_buffer
+    size_t m_end = 0;        // End of the valid bytes in m_buffer
+    size_t m_tokenStart = NoPosition; // Start of the atom being read, kept across refills
+    size_t m_listStart = NoPosition;  // Start of the list being captured, kept across refills
+    std::string m_decoded;   // Decoded text of the last escaped atom
+    SexpDocument m_capture;  // Reused for every captured list
+};
+
+#endif // KICAD_SEXP_CHUNKED_PARSER_H
@@ -0,0 +1,54 @@
+#include "kicad/SexpKeywords.h"
+#include <algorithm>
+#include <iterator>
+
+namespace {
+    // Indexed by keyword ID - 1. Sorted, because the X-macro list is.
+    constexpr std::string_view keywordNames[] = {
+#define KICAD_SEXP_KEYWORD_NAME(name) #name,
+        KICAD_SEXP_KEYWORDS(KICAD_SEXP_KEYWORD_NAME)
+#undef KICAD_SEXP_KEYWORD_NAME
+    };
+
+    constexpr bool keywordsSorted() {
+        for (size_t i = 1; i < std::size(keywordNames); ++i) {
+            if (!(keywordNames[i - 1] < keywordNames[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+    static_assert(keywordsSorted(), "KICAD_SEXP_KEYWORDS must be sorted for lookupKeyword().");
+
+    constexpr size_t maxKeywordLength() {
+        size_t longest = 0;
+        for (std::string_view name : keywordNames) {
+            longest = name.size() > longest ? name.size() : longest;
+        }
+        return longest;
+    }
+}
+
+SexpKeyword lookupKeyword(std::string_view text)
+{
+    // Every keyword starts with a lowercase letter. This rejects numbers,
+    // which are the bulk of the atoms in a board file, without a search.
+    if (text.empty() || text.size() > maxKeywordLength() || text[0] < 'a' || text[0] > 'z') {
+        return SexpKeyword::Unknown;
+    }
+
+    auto it = std::lower_bound(std::begin(keywordNames), std::end(keywordNames), text);
+    if (it == std::end(keywordNames) || *it != text) {
+        return SexpKeyword::Unknown;
+    }
+    return static_cast<SexpKeyword>(std::distance(std::begin(keywordNames), it) + 1);
+}
+
+std::string_view keywordName(SexpKeyword keyword)
+{
+    size_t index = static_cast<size_t>(keyword);
+    if (index == 0 || index >= static_cast<size_t>(SexpKeyword::Count)) {
+        return std::string_view();
+    }
+    return keywordNames[index - 1];
+}
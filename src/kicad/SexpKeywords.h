@@ -0,0 +1,99 @@
+#ifndef KICAD_SEXP_KEYWORDS_H
+#define KICAD_SEXP_KEYWORDS_H
+
+#include <cstdint>
+#include <string_view>
+
+// Keywords of the KiCad board format that the parsers care about. Unquoted
+// atoms are looked up in this table once, at tokenize time, so consumers can
+// compare small integers instead of strings. Anything not listed here (and
+// every quoted atom) maps to SexpKeyword::Unknown.
+//
+// Keep the list sorted; it is the single source for the enum and the names.
+#define KICAD_SEXP_KEYWORDS(X) \
+    X(angle)                   \
+    X(arc)                     \
+    X(at)                      \
+    X(center)                  \
+    X(circle)                  \
+    X(copperpour)              \
+    X(dimension)               \
+    X(drill)                   \
+    X(effects)                 \
+    X(end)                     \
+    X(footprint)               \
+    X(footprints)              \
+    X(fp_arc)                  \
+    X(fp_circle)               \
+    X(fp_curve)                \
+    X(fp_line)                 \
+    X(fp_poly)                 \
+    X(fp_rect)                 \
+    X(fp_text)                 \
+    X(fp_text_box)             \
+    X(general)                 \
+    X(gr_arc)                  \
+    X(gr_circle)               \
+    X(gr_curve)                \
+    X(gr_line)                 \
+    X(gr_poly)                 \
+    X(gr_rect)                 \
+    X(gr_text)                 \
+    X(gr_text_box)             \
+    X(keepout)                 \
+    X(kicad_pcb)               \
+    X(layer)                   \
+    X(layers)                  \
+    X(mid)                     \
+    X(model)                   \
+    X(module)                  \
+    X(net)                     \
+    X(net_name)                \
+    X(not_allowed)             \
+    X(np_thru_hole)            \
+    X(oval)                    \
+    X(pad)                     \
+    X(pads)                    \
+    X(paper)                   \
+    X(polygon)                 \
+    X(property)                \
+    X(pts)                     \
+    X(rect)                    \
+    X(roundrect)               \
+    X(segment)                 \
+    X(setup)                   \
+    X(size)                    \
+    X(smd)                     \
+    X(start)                   \
+    X(stroke)                  \
+    X(thru_hole)               \
+    X(title_block)             \
+    X(tracks)                  \
+    X(tstamp)                  \
+    X(uuid)                    \
+    X(via)                     \
+    X(vias)                    \
+    X(width)                   \
+    X(xy)                      \
+    X(zone)
+
+enum class SexpKeyword : uint16_t {
+    Unknown = 0,
+#define KICAD_SEXP_KEYWORD_ENUM(name) name,
+    KICAD_SEXP_KEYWORDS(KICAD_SEXP_KEYWORD_ENUM)
+#undef KICAD_SEXP_KEYWORD_ENUM
+    Count
+};
+
+/**
+ * @brief Maps an atom's text to its keyword ID.
+ * @return The keyword, or SexpKeyword::Unknown if the text is not a keyword.
+ */
+SexpKeyword lookupKeyword(std::string_view text);
+
+/**
+ * @brief Returns the text of a keyword, or an empty view for Unknown.
+ */
+std::string_view keywordName(SexpKeyword keyword);
+
+#endif // KICAD_SEXP_KEYWORDS_H
@@ -1,13 +1,60 @@
 #include "kicad/SexpParser.h"
+#include "kicad/SexpStreamParser.h"
+#include <cctype>
 
 // Public static method
-SexpNode SexpParser::parse(const std::string& input) {
-    SexpParser parser(input);
-    return parser.parseNode();
+SexpDocument SexpParser::parse(std::string_view input) {
+    SexpDocument document;
+    SexpParser parser(input, *document.m_arena);
+    document.m_root = parser.parseNode();
+    return document;
+}
+
+void SexpParser::parse(std::string_view input, SexpDocument& document) {
+    document.m_arena->reset();
+    document.m_root = SexpNode();
+    SexpParser parser(input, *document.m_arena);
+    document.m_root = parser.parseNode();
+}
+
+SexpDocument SexpParser::parseLazy(std::string_view input) {
+    SexpDocument document;
+    parseLazy(input, document);
+    return document;
+}
+
+void SexpParser::parseLazy(std::string_view input, SexpDocument& document) {
+    document.m_arena->reset();
+    document.m_root = SexpNode();
+    SexpParser parser(input, *document.m_arena);
+    parser.skipWhitespace();
+    if (parser.eof()) {
+        throw std::runtime_error("Unexpected end of input while parsing node.");
+    }
+    document.m_root = parser.parseLazyNode();
+}
+
+const SexpNode* SexpParser::parseLazyChildren(const SexpLazySpan& span, size_t& count) {
+    SexpParser parser(std::string_view(span.text, span.size), *span.arena);
+    parser.get(); // Consume '('
+    while (true) {
+        parser.skipWhitespace();
+        if (parser.eof()) {
+            throw std::runtime_error("Unmatched opening parenthesis.");
+        }
+        if (parser.peek() == ')') {
+            break;
+        }
+        parser.m_pending.push_back(parser.parseLazyNode());
+    }
+
+    count = parser.m_pending.size();
+    return span.arena->storeNodes(parser.m_pending.data(), count);
 }
 
 // Private constructor
-SexpParser::SexpParser(const std::string& input) : m_input(input), m_pos(0) {}
+SexpParser::SexpParser(std::string_view input, SexpArena& arena)
+    : m_input(input), m_pos(0), m_arena(arena) {}
 
 // Main parsing routine for a single node
 SexpNode SexpParser::parseNode() {
@@ -17,16 +64,16 @@ SexpNode SexpParser::parseNode() {
     }
 
     if (peek() == '(') {
-        return SexpNode{parseList()};
+        return parseList();
     } else {
-        return SexpNode{parseAtom()};
+        return parseAtom();
     }
 }
 
 // Parses a list starting with '('
-SexpList SexpParser::parseList() {
+SexpNode SexpParser::parseList() {
     get(); // Consume '('
-    SexpList list;
+    const size_t first = m_pending.size();
     while (true) {
         skipWhitespace();
         if (eof()) {
@@ -36,43 +83,105 @@ SexpList SexpParser::parseList() {
             get(); // Consume ')'
             break;
         }
-        list.push_back(parseNode());
+        SexpNode child = parseNode();
+        m_pending.push_back(child);
     }
-    return list;
+
+    const size_t count = m_pending.size() - first;
+    const SexpNode* children = m_arena.storeNodes(m_pending.data() + first, count);
+    m_pending.resize(first);
+    return SexpNode::makeList(children, count);
+}
+
+// Parses an atom, or records a list's span and head keyword without
+// descending into it.
+SexpNode SexpParser::parseLazyNode() {
+    if (peek() != '(') {
+        return parseAtom();
+    }
+
+    // Finding the end validates the nesting and quoting of the whole
+    // subtree, so expanding it later can't fail on those.
+    const size_t start = m_pos;
+    const size_t end = SexpStreamParser::findListEnd(m_input, start);
+
+    m_pos++; // Consume '('
+    skipWhitespace();
+    SexpKeyword keyword = SexpKeyword::Unknown;
+    if (peek() != '"' && peek() != '(' && peek() != ')') {
+        const size_t headStart = m_pos;
+        while (!eof() && !isspace(static_cast<unsigned char>(peek())) && peek() != '(' && peek() != ')') {
+            m_pos++;
+        }
+        keyword = lookupKeyword(m_input.substr(headStart, m_pos - headStart));
+    }
+
+    m_pos = end;
+    return SexpNode::makeLazyList(m_arena.storeLazySpan(m_input.substr(start, end - start)), keyword);
 }
 
 // Parses an atom (quoted or unquoted string)
-SexpAtom SexpParser::parseAtom() {
+SexpNode SexpParser::parseAtom() {
     skipWhitespace();
     if (peek() == '"') {
         // Quoted string
         get(); // Consume opening '"'
-        std::string atom;
+        size_t start = m_pos;
+        bool hasEscapes = false;
         while (!eof() && peek() != '"') {
-            // KiCad format doesn't seem to use escape sequences like \",
-            // so we'll keep it simple for now.
-            atom += get();
+            if (peek() == '\\') {
+                // Skip the escaped character so an escaped quote doesn't end the atom.
+                hasEscapes = true;
+                m_pos++;
+            }
+            m_pos++;
         }
         if (eof()) {
             throw std::runtime_error("Unmatched quote in string literal.");
         }
+        std::string_view raw = m_input.substr(start, m_pos - start);
         get(); // Consume closing '"'
-        return atom;
+        if (hasEscapes) {
+            // Decoding never makes the text longer, so the raw size is enough.
+            char* decoded = m_arena.allocateChars(raw.size());
+            return SexpNode::makeAtom(SexpAtom(decoded, decodeEscapes(raw, decoded)));
+        }
+        return SexpNode::makeAtom(raw);
     } else {
         // Unquoted atom
-        std::string atom;
-        while (!eof() && !isspace(peek()) && peek() != '(' && peek() != ')') {
-            atom += get();
+        size_t start = m_pos;
+        while (!eof() && !isspace(static_cast<unsigned char>(peek())) && peek() != '(' && peek() != ')') {
+            m_pos++;
         }
-        if (atom.empty()) {
+        if (m_pos == start) {
             throw std::runtime_error("Expected an atom but found none.");
         }
-        return atom;
+        SexpAtom atom = m_input.substr(start, m_pos - start);
+        return SexpNode::makeAtom(atom, lookupKeyword(atom));
+    }
+}
+
+// Decodes backslash escapes of a quoted atom.
+size_t SexpParser::decodeEscapes(std::string_view raw, char* out) {
+    size_t length = 0;
+    for (size_t i = 0; i < raw.size(); ++i) {
+        char c = raw[i];
+        if (c == '\\' && i + 1 < raw.size()) {
+            c = raw[++i];
+            switch (c) {
+                case 'n': c = '\n'; break;
+                case 'r': c = '\r'; break;
+                case 't': c = '\t'; break;
+                default: break; // \" and \\ (and anything unknown) map to the character itself.
+            }
+        }
+        out[length++] = c;
     }
+    return length;
 }
 
 void SexpParser::skipWhitespace() {
-    while (!eof() && isspace(peek())) {
+    while (!eof() && isspace(static_cast<unsigned char>(peek()))) {
         m_pos++;
     }
 }
@@ -89,4 +198,4 @@ char SexpParser::get() {
 
 bool SexpParser::eof() {
     return m_pos >= m_input.length();
-}
\ No newline at end of file
+}
@@ -3,30 +3,67 @@
 
 #include "kicad/Sexp.h"
 #include <string>
+#include <string_view>
 #include <stdexcept>
+#include <vector>
 
 class SexpParser {
 public:
     /**
      * @brief Parses a string containing an S-expression into a node tree.
-     * @param input The string to parse.
-     * @return The root SexpNode of the parsed tree.
+     * @param input The text to parse. Atoms in the returned document point
+     *              into this buffer, so it must outlive the document.
+     * @return The parsed document; its root is available through getRoot().
      * @throws std::runtime_error on parsing errors.
      */
-    static SexpNode parse(const std::string& input);
+    static SexpDocument parse(std::string_view input);
+
+    /**
+     * @brief Parses into an existing document, reusing its arena blocks.
+     *
+     * Useful when many small inputs are parsed one after another.
+     */
+    static void parse(std::string_view input, SexpDocument& document);
+
+    /**
+     * @brief Parses lazily: lists are expanded one level at a time, on first getList().
+     *
+     * The input is scanned once up front so that unbalanced parentheses and
+     * unterminated strings are still reported here. Subtrees that are never
+     * visited cost nothing beyond that scan.
+     * @throws std::runtime_error on parsing errors.
+     */
+    static SexpDocument parseLazy(std::string_view input);
+    static void parseLazy(std::string_view input, SexpDocument& document);
+
+    /**
+     * @brief Decodes the backslash escapes of a quoted atom's raw text.
+     * @param out Receives the decoded text; needs room for raw.size() characters.
+     * @return The length of the decoded text.
+     */
+    static size_t decodeEscapes(std::string_view raw, char* out);
 
 private:
-    SexpParser(const std::string& input);
+    friend class SexpNode; // Expands lazy lists through parseLazyChildren().
+
+    static const SexpNode* parseLazyChildren(const SexpLazySpan& span, size_t& count);
+
+    SexpParser(std::string_view input, SexpArena& arena);
     SexpNode parseNode();
-    SexpList parseList();
-    SexpAtom parseAtom();
+    SexpNode parseList();
+    SexpNode parseLazyNode();
+    SexpNode parseAtom();
     void skipWhitespace();
     char peek();
     char get();
     bool eof();
 
-    const std::string& m_input;
+    std::string_view m_input;
     size_t m_pos;
+    SexpArena& m_arena;
+    // Children of the lists currently being parsed, innermost last. A list's
+    // children are moved into the arena as one contiguous run when it closes.
+    std::vector<SexpNode> m_pending;
 };
 
-#endif // KICAD_SEXP_PARSER_H
\ No newline at end of file
+#endif // KICAD_SEXP_PARSER_H
@@ -0,0 +1,166 @@
+#include "kicad/SexpStreamParser.h"
+#include "kicad/SexpParser.h"
+#include <cctype>
+
+namespace {
+    bool isAtomChar(char c) {
+        return !isspace(static_cast<unsigned char>(c)) && c != '(' && c != ')';
+    }
+}
+
+// Public static method
+void SexpStreamParser::parse(std::string_view input, SexpEventHandler& handler) {
+    SexpStreamParser parser(input, handler);
+    parser.run();
+}
+
+size_t SexpStreamParser::findListEnd(std::string_view input, size_t start) {
+    int depth = 0;
+    size_t pos = start;
+    while (pos < input.size()) {
+        char c = input[pos++];
+        if (c == '"') {
+            // Parentheses inside quoted atoms don't count.
+            while (pos < input.size() && input[pos] != '"') {
+                pos += (input[pos] == '\\') ? 2 : 1;
+            }
+            if (pos >= input.size()) {
+                throw std::runtime_error("Unmatched quote in string literal.");
+            }
+            pos++; // Closing '"'
+        } else if (c == '(') {
+            depth++;
+        } else if (c == ')') {
+            if (--depth == 0) {
+                return pos;
+            }
+        }
+    }
+    throw std::runtime_error("Unmatched opening parenthesis.");
+}
+
+std::vector<std::string_view> SexpStreamParser::findTopLevelLists(std::string_view input) {
+    std::vector<std::string_view> lists;
+    int depth = 0;
+    size_t childStart = 0;
+    size_t pos = 0;
+    while (pos < input.size()) {
+        char c = input[pos++];
+        if (c == '"') {
+            while (pos < input.size() && input[pos] != '"') {
+                pos += (input[pos] == '\\') ? 2 : 1;
+            }
+            if (pos >= input.size()) {
+                throw std::runtime_error("Unmatched quote in string literal.");
+            }
+            pos++; // Closing '"'
+        } else if (c == '(') {
+            if (++depth == 2) {
+                childStart = pos - 1;
+            }
+        } else if (c == ')') {
+            if (depth == 0) {
+                throw std::runtime_error("Unexpected closing parenthesis.");
+            }
+            if (--depth == 1) {
+                lists.push_back(input.substr(childStart, pos - childStart));
+            } else if (depth == 0) {
+                return lists; // End of the root list
+            }
+        }
+    }
+    if (depth != 0) {
+        throw std::runtime_error("Unmatched opening parenthesis.");
+    }
+    return lists;
+}
+
+// Private constructor
+SexpStreamParser::SexpStreamParser(std::string_view input, SexpEventHandler& handler)
+    : m_input(input), m_pos(0), m_handler(handler) {}
+
+void SexpStreamParser::run() {
+    int depth = 0;
+    while (true) {
+        skipWhitespace();
+        if (eof()) {
+            break;
+        }
+
+        char c = m_input[m_pos];
+        if (c == '(') {
+            const size_t listStart = m_pos++;
+            skipWhitespace();
+            SexpAtom head;
+            if (!eof() && isAtomChar(m_input[m_pos])) {
+                head = readAtom();
+            }
+
+            switch (m_handler.enterList(head)) {
+                case SexpEventHandler::Action::Descend:
+                    depth++;
+                    break;
+                case SexpEventHandler::Action::Skip:
+                    m_pos = findListEnd(m_input, listStart);
+                    break;
+                case SexpEventHandler::Action::Capture: {
+                    m_pos = findListEnd(m_input, listStart);
+                    SexpParser::parse(m_input.substr(listStart, m_pos - listStart), m_capture);
+                    m_handler.capturedList(m_capture.getRoot());
+                    break;
+                }
+            }
+        } else if (c == ')') {
+            if (depth == 0) {
+                throw std::runtime_error("Unexpected closing parenthesis.");
+            }
+            m_pos++;
+            depth--;
+            m_handler.leaveList();
+        } else {
+            m_handler.atom(readAtom());
+        }
+    }
+
+    if (depth != 0) {
+        throw std::runtime_error("Unmatched opening parenthesis.");
+    }
+}
+
+// Reads an atom (quoted or unquoted) at the current position.
+SexpAtom SexpStreamParser::readAtom() {
+    if (m_input[m_pos] == '"') {
+        size_t start = ++m_pos;
+        bool hasEscapes = false;
+        while (!eof() && m_input[m_pos] != '"') {
+            if (m_input[m_pos] == '\\') {
+                hasEscapes = true;
+                m_pos++;
+            }
+            m_pos++;
+        }
+        if (eof()) {
+            throw std::runtime_error("Unmatched quote in string literal.");
+        }
+        std::string_view raw = m_input.substr(start, m_pos - start);
+        m_pos++; // Closing '"'
+        if (hasEscapes) {
+            m_decoded.resize(raw.size());
+            m_decoded.resize(SexpParser::decodeEscapes(raw, &m_decoded[0]));
+            return m_decoded;
+        }
+        return raw;
+    }
+
+    size_t start = m_pos;
+    while (!eof() && isAtomChar(m_input[m_pos])) {
+        m_pos++;
+    }
+    return m_input.substr(start, m_pos - start);
+}
+
+void SexpStreamParser::skipWhitespace() {
+    while (!eof() && isspace(static_cast<unsigned char>(m_input[m_pos]))) {
+        m_pos++;
+    }
+}
@@ -0,0 +1,84 @@
+#ifndef KICAD_SEXP_STREAM_PARSER_H
+#define KICAD_SEXP_STREAM_PARSER_H
+
+#include "kicad/Sexp.h"
+#include <string>
+#include <string_view>
+#include <stdexcept>
+#include <vector>
+
+// Receives events from SexpStreamParser as it walks the input.
+class SexpEventHandler {
+public:
+    enum class Action {
+        Descend, // Report the list's remaining children as events, then leaveList().
+        Skip,    // Jump over the list without tokenizing it. No leaveList() follows.
+        Capture  // Build a small tree for just this list and pass it to capturedList().
+    };
+
+    virtual ~SexpEventHandler() = default;
+
+    /**
+     * @brief Called when a list opens.
+     * @param head The list's first element if it is an atom (its keyword), empty otherwise.
+     *             The head is consumed here and is not reported again through atom().
+     * @return What the parser should do with the rest of the list.
+     */
+    virtual Action enterList(SexpAtom head) = 0;
+
+    // Called for each atom inside a list the handler descended into.
+    virtual void atom(SexpAtom /*value*/) {}
+
+    // Called when a list the handler descended into closes.
+    virtual void leaveList() {}
+
+    // Called with the tree of a captured list. The node is only valid during the call.
+    virtual void capturedList(const SexpNode& /*node*/) {}
+};
+
+// An event-driven (SAX-style) S-expression parser. Unlike SexpParser it never
+// builds a tree for the whole input, so memory use is independent of the
+// input size and uninteresting subtrees cost only a parenthesis scan.
+//
+// Atom views passed to the handler point into the input, or into a scratch
+// buffer for quoted atoms with escapes; either way they are only guaranteed
+// valid until the handler returns.
+class SexpStreamParser {
+public:
+    /**
+     * @brief Parses the input and reports its structure to the handler.
+     * @throws std::runtime_error on parsing errors.
+     */
+    static void parse(std::string_view input, SexpEventHandler& handler);
+
+    /**
+     * @brief Returns the offset just past the ')' closing the list that opens at 'start'.
+     * @throws std::runtime_error if the list is not terminated.
+     */
+    static size_t findListEnd(std::string_view input, size_t start);
+
+    /**
+     * @brief Finds the lists directly inside the input's root list.
+     *
+     * This only scans parentheses and quotes, so it is much cheaper than a full
+     * parse. Each returned view covers one child list, '(' to ')' inclusive, in
+     * document order; atoms at that level are not returned.
+     * @throws std::runtime_error if the root list is malformed.
+     */
+    static std::vector<std::string_view> findTopLevelLists(std::string_view input);
+
+private:
+    SexpStreamParser(std::string_view input, SexpEventHandler& handler);
+    void run();
+    SexpAtom readAtom();
+    void skipWhitespace();
+    bool eof() const { return m_pos >= m_input.size(); }
+
+    std::string_view m_input;
+    size_t m_pos;
+    SexpEventHandler& m_handler;
+    std::string m_decoded;    // Decoded text of the last escaped atom
+    SexpDocument m_capture;   // Reused for every captured list
+};
+
+#endif // KICAD_SEXP_STREAM_PARSER_H
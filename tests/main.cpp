@@ -1,137 +1,156 @@
-// This tells Catch2 that we will provide our own main() function.
-#define CATCH_CONFIG_RUNNER
+// Catch2 provides main(); the core needs no toolkit initialization.
+#define CATCH_CONFIG_MAIN
 #include "catch2/catch.hpp"
 
 #include "../src/core/AutorouterCore.h"
+#include "../src/core/Connectivity.h"
+#include "../src/core/JumpPointTable.h"
+#include "../src/core/OpenList.h"
 #include "../src/core/PcbData.h"
-#include <wx/app.h>
-#include <wx/filename.h>
-#include <wx/dir.h>
+#include "../src/core/PcbParser.h"
+#include "../src/core/PcbDataCache.h"
+#include "../src/core/PcbDataVersions.h"
+#include "../src/core/PcbWriter.h"
+#include "../src/core/PolygonRasterizer.h"
+#include "../src/core/RoutingGrid.h"
+#include "../src/core/SpatialIndex.h"
+#include "../src/kicad/SexpParser.h"
+#include "../src/kicad/SexpChunkedParser.h"
+#include "../src/kicad/SexpStreamParser.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
 
 // This macro is defined by CMake in tests/CMakeLists.txt
 #ifndef PCB_FILES_PATH
     #error "PCB_FILES_PATH is not defined. Check your CMake configuration."
 #endif
 
-// We need a dummy wxApp object for the test executable because wxWidgets
-// functions (like those used in AutorouterCore) expect one to exist.
-class TestApp : public wxApp
-{
-public:
-    virtual bool OnInit()
-    {
-        // Don't create any windows or run an event loop.
-        // Return true to indicate successful initialization.
-        return true;
-    }
-};
-
-
-// This is the entry point for the test executable.
-// We need to initialize wxWidgets before running the tests.
-int main(int argc, char* argv[])
-{
-    // Create a wxWidgets application instance.
-    wxApp::SetInstance(new TestApp());
-
-    // wxEntryStart is a platform-specific function that initializes wxWidgets.
-    if (!wxEntryStart(argc, argv))
-    {
-        // Handle initialization failure
-        return 1;
-    }
-
-    // Run the Catch2 test suite.
-    int result = Catch::Session().run(argc, argv);
-
-    // Clean up wxWidgets resources.
-    wxEntryCleanup();
-
-    return result;
-}
-
-// Helper class to recursively find files
-class PcbFileTraverser : public wxDirTraverser
+// Helper function to discover all .kicad_pcb files
+std::vector<std::string> discoverPcbFiles()
 {
-public:
-    PcbFileTraverser(wxArrayString& files) : m_files(files) {}
-    virtual wxDirTraverseResult OnFile(const wxString& filename) override
-    {
-        m_files.Add(filename);
-        return wxDIR_CONTINUE;
-    }
-    virtual wxDirTraverseResult OnDir(const wxString& dirname) override
+    const std::filesystem::path pcbFilesPath(PCB_FILES_PATH);
+    // Check if the directory exists before trying to traverse it. This helps debug path issues.
+    INFO("Searching for PCB files in: " << pcbFilesPath.string());
+    REQUIRE(std::filesystem::is_directory(pcbFilesPath));
+    // Discover all .kicad_pcb files in the test directory, recursively.
+    std::vector<std::string> pcbFiles;
+    for (auto it = std::filesystem::recursive_directory_iterator(pcbFilesPath);
+         it != std::filesystem::recursive_directory_iterator(); ++it)
     {
+        const std::filesystem::path& path = it->path();
         // To make the test suite robust, explicitly ignore version control directories.
-        wxFileName fn(dirname);
-        if (fn.GetFullName() == ".git" || fn.GetFullName() == ".svn")
+        if (it->is_directory() && (path.filename() == ".git" || path.filename() == ".svn"))
+        {
+            it.disable_recursion_pending();
+            continue;
+        }
+        if (it->is_regular_file() && path.extension() == ".kicad_pcb")
         {
-            return wxDIR_IGNORE;
+            pcbFiles.push_back(path.string());
         }
-        return wxDIR_CONTINUE;
     }
-private:
-    wxArrayString& m_files;
-};
-
-// Helper function to discover all .kicad_pcb files
-wxArrayString discoverPcbFiles()
-{
-    const wxString pcbFilesPath = wxString(PCB_FILES_PATH);
-    // Check if the directory exists before trying to traverse it. This helps debug path issues.
-    INFO("Searching for PCB files in: " << pcbFilesPath);
-    REQUIRE(wxDir::Exists(pcbFilesPath));
-    // Discover all .kicad_pcb files in the test directory, recursively.
-    wxArrayString pcbFiles;
-    PcbFileTraverser traverser(pcbFiles);
-
-    wxDir dir(pcbFilesPath);
-    // flag is for newer wxWidgets versions and is not needed here.
-    dir.Traverse(traverser, "*.kicad_pcb", wxDIR_FILES | wxDIR_DIRS | wxDIR_HIDDEN);
+    std::sort(pcbFiles.begin(), pcbFiles.end());
 
     // This check is important. If it fails, it means the test runner's
-    REQUIRE(pcbFiles.GetCount() > 0);
-    INFO("Found " << pcbFiles.GetCount() << " PCB files.");
+    REQUIRE(pcbFiles.size() > 0);
+    INFO("Found " << pcbFiles.size() << " PCB files.");
     return pcbFiles;
 }
 
 // Helper function to create a descriptive test name from a file path.
 // e.g., "c:/.../pcb_files/category/board.kicad_pcb" -> "category / board.kicad_pcb"
-wxString getTestNameForPcbFile(const wxString& pcbFile)
+std::string getTestNameForPcbFile(const std::string& pcbFile)
 {
-    wxFileName fn(pcbFile);
-    wxArrayString dirs = fn.GetDirs();
+    const std::filesystem::path path(pcbFile);
+    const std::filesystem::path dir = path.parent_path();
 
     // Create a more descriptive name based on the folder structure.
-    if (dirs.GetCount() > 1) {
+    if (dir != std::filesystem::path(PCB_FILES_PATH)) {
         // It's in a category subdirectory, e.g., pcb_files/high_density_smd/
         // We want a name like "high_density_smd / board.kicad_pcb"
-        return dirs.Last() + wxT(" / ") + fn.GetFullName();
+        return dir.filename().string() + " / " + path.filename().string();
     }
 
     // It's directly in pcb_files, e.g., pcb_files/simple.kicad_pcb
-    return fn.GetFullName();
+    return path.filename().string();
+}
+
+// A path in the temp directory for a file named like name, with a random
+// suffix before the extension so parallel or repeated runs don't share it.
+// Tests remove what they create there when done.
+std::filesystem::path uniqueTempPath(const std::string& name)
+{
+    static std::mt19937_64 random(std::random_device{}() ^
+                                  static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count()));
+    const std::filesystem::path path(name);
+    char suffix[24];
+    std::snprintf(suffix, sizeof(suffix), "_%016llx", static_cast<unsigned long long>(random()));
+    return std::filesystem::temp_directory_path() / (path.stem().string() + suffix + path.extension().string());
+}
+
+// Repeatable pseudo-random numbers in [0, 0x7fff] for the randomized search
+// tests, so a failing board can be reproduced.
+class TestRandom
+{
+public:
+    explicit TestRandom(uint32_t seed) : m_seed(seed) {}
+    uint32_t operator()()
+    {
+        m_seed = m_seed * 1103515245 + 12345;
+        return (m_seed >> 16) & 0x7fff;
+    }
+
+private:
+    uint32_t m_seed;
+};
+
+// Cost of a grid path as the searches count it, to compare paths that tie.
+uint32_t pathCost(const std::vector<GridPoint>& path)
+{
+    uint32_t cost = 0;
+    for (size_t i = 1; i < path.size(); ++i) {
+        if (path[i].layer != path[i - 1].layer) {
+            cost += 100; // The default via cost of 10 steps
+        } else {
+            cost += (path[i].x != path[i - 1].x && path[i].y != path[i - 1].y) ? RoutingGrid::DiagonalCost : RoutingGrid::StraightCost;
+        }
+    }
+    return cost;
 }
 
 TEST_CASE("PCB File Loading and Routing Metrics", "[core][filesystem]")
 {
-    const wxArrayString pcbFiles = discoverPcbFiles();
+    const std::vector<std::string> pcbFiles = discoverPcbFiles();
     INFO("PCB Files:");
-    for (const wxString& pcbFile : pcbFiles) {
+    for (const std::string& pcbFile : pcbFiles) {
         INFO("- " << pcbFile);
     }
 
     // This loop creates a dynamic section for each file found.
-    for (const wxString& pcbFile : pcbFiles)
+    for (const std::string& pcbFile : pcbFiles)
     {
         // Use the helper function to get the test name and avoid duplicating code.
-        wxString testName = getTestNameForPcbFile(pcbFile);
-        SECTION(testName.ToStdString())
+        std::string testName = getTestNameForPcbFile(pcbFile);
+        SECTION(testName)
         {
             AutorouterCore core;
-            REQUIRE(core.loadPcbFile(pcbFile.ToStdString()));
+            // Always parse; the cache has its own test and must not leave
+            // snapshots next to the fixtures.
+            core.setCacheEnabled(false);
+            REQUIRE(core.loadPcbFile(pcbFile));
 
-            const auto& allNets = core.getPcbData()->GetNets();
+            // Route() commits a new version; keep the one whose nets are listed.
+            const std::shared_ptr<const PcbData> board = core.getPcbData();
+            const auto& allNets = board->GetNets();
             if (allNets.empty()) {
                 // It's valid for a PCB to have no nets. We can't test routing,
                 // but successfully loading it is a pass.
@@ -139,9 +158,9 @@ TEST_CASE("PCB File Loading and Routing Metrics", "[core][filesystem]")
                 continue; // Skip to the next file.
             }
 
-            wxArrayInt netsToRoute;
+            std::vector<int> netsToRoute;
             for (size_t i = 0; i < allNets.size(); ++i) {
-                netsToRoute.Add(i);
+                netsToRoute.push_back(static_cast<int>(i));
             }
 
             RoutingSettings settings;
@@ -158,13 +177,20 @@ TEST_CASE("PCB File Loading and Routing Metrics", "[core][filesystem]")
             CHECK(result.nets_routed <= result.nets_total);
 
             // 3. Track length must be non-negative. If something was routed, it should be positive.
+            // Nets that existing copper already joins count as routed without new tracks.
             CHECK(result.total_track_length >= 0.0);
-            if (result.nets_routed > 0) {
+            CHECK(result.nets_routed >= result.nets_complete);
+            if (result.nets_routed > result.nets_complete) {
                 CHECK(result.total_track_length > 0.0);
             }
 
-            // 4. Via count is not implemented yet.
-            CHECK(result.via_count == 0);
+            // 4. Every via Route() places is counted. The one connection
+            // simple_2layer still needs has both ends on F.Cu, so it needs none.
+            CHECK(result.via_count == static_cast<int>(core.getRoutedVias().size()));
+            if (pcbFile.find("simple_2layer") != std::string::npos) {
+                CHECK(result.connections_total == 1);
+                CHECK(result.via_count == 0);
+            }
 
             // 5. Log the results for manual inspection.
             INFO("Routed " << result.nets_routed << "/" << result.nets_total << " nets in " << result.time_ms << "ms. Total length: " << result.total_track_length << "mm.");
@@ -174,19 +200,24 @@ TEST_CASE("PCB File Loading and Routing Metrics", "[core][filesystem]")
 
 TEST_CASE("Per-Net A* Routing", "[core][routing]")
 {
-    const wxArrayString pcbFiles = discoverPcbFiles();
+    const std::vector<std::string> pcbFiles = discoverPcbFiles();
 
-    for (const wxString& pcbFile : pcbFiles)
+    for (const std::string& pcbFile : pcbFiles)
     {
         // Use the helper function here as well.
-        wxString boardTestName = getTestNameForPcbFile(pcbFile);
+        std::string boardTestName = getTestNameForPcbFile(pcbFile);
         // Create a test section for the entire board
-        SECTION("Board: " + boardTestName.ToStdString())
+        SECTION("Board: " + boardTestName)
         {
             AutorouterCore core;
-            REQUIRE(core.loadPcbFile(pcbFile.ToStdString()));
+            // Always parse; the cache has its own test and must not leave
+            // snapshots next to the fixtures.
+            core.setCacheEnabled(false);
+            REQUIRE(core.loadPcbFile(pcbFile));
 
-            const auto& allNets = core.getPcbData()->GetNets();
+            // Route() commits a new version; keep the one whose nets are listed.
+            const std::shared_ptr<const PcbData> board = core.getPcbData();
+            const auto& allNets = board->GetNets();
             if (allNets.empty()) {
                 SUCCEED("Skipping board with no nets.");
                 continue;
@@ -201,8 +232,7 @@ TEST_CASE("Per-Net A* Routing", "[core][routing]")
 
                 SECTION(netTestName)
                 {
-                    wxArrayInt netsToRoute;
-                    netsToRoute.Add(i);
+                    const std::vector<int> netsToRoute = {static_cast<int>(i)};
 
                     RoutingSettings settings; // Use default A* settings
                     RoutingResult result = core.Route(settings, netsToRoute);
@@ -212,15 +242,1656 @@ TEST_CASE("Per-Net A* Routing", "[core][routing]")
                     // Routed can only be 0 or 1
                     CHECK((result.nets_routed == 0 || result.nets_routed == 1));
 
-                    if (result.nets_routed == 1) {
+                    if (result.nets_routed == 1 && result.nets_complete == 0) {
                         INFO("Successfully routed net " << i);
                         CHECK(result.total_track_length > 0.0);
                     } else {
-                        INFO("Failed to route net " << i);
+                        INFO((result.nets_complete ? "Already complete: net " : "Failed to route net ") << i);
                         CHECK(result.total_track_length == 0.0);
                     }
                 }
             }
         }
     }
-}
\ No newline at end of file
+}
+
+TEST_CASE("S-expression Parsing", "[kicad][sexp]")
+{
+    const std::string text = "(kicad_pcb (net 1 \"A\\\"B\") (empty) gr)";
+    SexpDocument doc = SexpParser::parse(text);
+
+    const SexpList root = doc.getRoot().getList();
+    REQUIRE(root.size() == 4);
+    CHECK(root[0].getAtom() == "kicad_pcb");
+
+    // Children of a list are contiguous and plain atoms point into the source text.
+    const SexpList net = root[1].getList();
+    REQUIRE(net.size() == 3);
+    CHECK(net[1].getAtom() == "1");
+    CHECK(net[1].getAtom().data() >= text.data());
+    CHECK(net[1].getAtom().data() < text.data() + text.size());
+
+    // Escaped quotes are decoded and don't terminate the atom.
+    CHECK(net[2].getAtom() == "A\"B");
+
+    CHECK(root[2].isList());
+    CHECK(root[2].getList().size() == 1);
+    CHECK(root[3].getAtom() == "gr");
+
+    // Keywords are interned at tokenize time; lists carry their head's keyword.
+    CHECK(root[0].getKeyword() == SexpKeyword::kicad_pcb);
+    CHECK(root[1].getKeyword() == SexpKeyword::net);
+    CHECK(net[1].getKeyword() == SexpKeyword::Unknown);
+    CHECK(root[3].getKeyword() == SexpKeyword::Unknown);
+    CHECK(lookupKeyword("layers") == SexpKeyword::layers);
+    CHECK(keywordName(SexpKeyword::layers) == "layers");
+    CHECK(SexpParser::parse("(\"net\" 1)").getRoot().getKeyword() == SexpKeyword::Unknown);
+
+    CHECK_THROWS_AS(SexpParser::parse("(unterminated (list)"), std::runtime_error);
+
+    // An unterminated string is reported as one, not as a missing parenthesis.
+    std::string message;
+    try {
+        SexpStreamParser::findListEnd("(net 1 \"GND)", 0);
+    } catch (const std::runtime_error& e) {
+        message = e.what();
+    }
+    CHECK(message == "Unmatched quote in string literal.");
+}
+
+TEST_CASE("Lazy S-expression Parsing", "[kicad][sexp]")
+{
+    const std::string text = "(kicad_pcb (net 1 \"A\\\"B\") (footprint \"R\" (pad 1 smd (at 1 2))) gr)";
+    SexpDocument doc = SexpParser::parseLazy(text);
+
+    // Only the head keyword is known until the list is first read.
+    const SexpNode& root = doc.getRoot();
+    CHECK(root.getKeyword() == SexpKeyword::kicad_pcb);
+    CHECK_FALSE(root.isExpanded());
+
+    const SexpList children = root.getList();
+    CHECK(root.isExpanded());
+    REQUIRE(children.size() == 4);
+    CHECK(children[1].getKeyword() == SexpKeyword::net);
+    CHECK(children[2].getKeyword() == SexpKeyword::footprint);
+    CHECK_FALSE(children[2].isExpanded());
+    CHECK(children[3].getAtom() == "gr");
+
+    CHECK(children[1].getList()[2].getAtom() == "A\"B");
+    CHECK_FALSE(children[2].isExpanded());
+
+    // Deeper levels expand on demand and match an eager parse.
+    const SexpNode& at = children[2].getList()[2].getList()[3];
+    CHECK(at.getKeyword() == SexpKeyword::at);
+    CHECK(at.getList()[2].getAtom() == "2");
+
+    // Moving the document keeps unexpanded subtrees readable.
+    SexpDocument moved = SexpParser::parseLazy(text);
+    SexpDocument target = std::move(moved);
+    CHECK(target.getRoot().getList()[2].getList()[1].getAtom() == "R");
+
+    CHECK_THROWS_AS(SexpParser::parseLazy("(unterminated (list)"), std::runtime_error);
+
+    // Listing nets through the lazy path matches a full parse.
+    for (const std::string& pcbFile : discoverPcbFiles())
+    {
+        PcbParser parser;
+        std::vector<std::string> netNames;
+        REQUIRE(parser.parseNetNames(pcbFile, netNames));
+        auto pcbData = parser.parseFile(pcbFile);
+        REQUIRE(pcbData);
+        CHECK(netNames == pcbData->GetNets());
+    }
+}
+
+TEST_CASE("Streaming, Parallel and Tree Extraction Agree", "[core][parser]")
+{
+    const std::vector<std::string> pcbFiles = discoverPcbFiles();
+
+    for (const std::string& pcbFile : pcbFiles)
+    {
+        SECTION(getTestNameForPcbFile(pcbFile))
+        {
+            PcbParser treeParser;
+            treeParser.setParseMode(PcbParser::ParseMode::Tree);
+            auto treeData = treeParser.parseFile(pcbFile);
+
+            PcbParser streamParser;
+            streamParser.setParseMode(PcbParser::ParseMode::Streaming);
+            auto streamData = streamParser.parseFile(pcbFile);
+
+            // Force several workers even though the test boards are small.
+            PcbParser parallelParser;
+            parallelParser.setParseMode(PcbParser::ParseMode::Parallel);
+            parallelParser.setThreadCount(4);
+            auto parallelData = parallelParser.parseFile(pcbFile);
+
+            REQUIRE(treeData);
+            REQUIRE(streamData);
+            REQUIRE(parallelData);
+            CHECK(parallelData->GetNets() == treeData->GetNets());
+            REQUIRE(parallelData->GetLines().size() == treeData->GetLines().size());
+            for (size_t i = 0; i < treeData->GetLines().size(); ++i) {
+                CHECK(parallelData->GetLines()[i].start.x == treeData->GetLines()[i].start.x);
+                CHECK(parallelData->GetLines()[i].netId == treeData->GetLines()[i].netId);
+            }
+            CHECK(parallelData->GetPads().size() == treeData->GetPads().size());
+            CHECK(streamData->GetNets() == treeData->GetNets());
+            CHECK(streamData->GetLines().size() == treeData->GetLines().size());
+            CHECK(streamData->GetVias().size() == treeData->GetVias().size());
+            CHECK(streamData->GetZones().size() == treeData->GetZones().size());
+
+            REQUIRE(streamData->GetPads().size() == treeData->GetPads().size());
+            for (size_t i = 0; i < treeData->GetPads().size(); ++i) {
+                const PcbPad& a = treeData->GetPads()[i];
+                const PcbPad& b = streamData->GetPads()[i];
+                CHECK(a.pos == b.pos);
+                CHECK(treeData->GetLayerName(a.layer) == streamData->GetLayerName(b.layer));
+                CHECK(a.netId == b.netId);
+            }
+        }
+    }
+}
+
+TEST_CASE("Column Storage", "[core][data]")
+{
+    // Coordinates are exact nanometres and layers are interned per PcbData.
+    PcbParser parser;
+    auto parsed = parser.parseFile(std::string(PCB_FILES_PATH) + "/simple_2layer/simple_2layer.kicad_pcb");
+    REQUIRE(parsed);
+    REQUIRE_FALSE(parsed->GetVias().empty());
+    const PcbVia via = parsed->GetVias()[0];
+    CHECK(via.pos == PcbPoint{20000000, 10000000});
+    CHECK(via.size == 800000);
+    CHECK(parsed->GetLayerName(via.fromLayer) == "F.Cu");
+    CHECK(parsed->GetLayerId("F.Cu") == via.fromLayer);
+    CHECK(parsed->GetLayerId("No.Such.Layer") == PcbNoLayer);
+
+    const std::vector<PcbPoint> outline = {{0, 0}, {MillimetresToCoord(5.5), 0}, {0, MillimetresToCoord(-2.25)}};
+    PcbData a;
+    const PcbLayerId fCu = a.AddLayer("F.Cu");
+    CHECK(a.AddLayer("F.Cu") == fCu);
+    a.AddLine({{0, 0}, {1000000, 0}, 250000, fCu, 1});
+    a.AddZone({2, fCu, PcbPointSpan(outline)});
+
+    PcbData b;
+    const PcbLayerId bCu = b.AddLayer("B.Cu");
+    b.AddLayer("F.Cu");
+    b.AddZone({3, bCu, PcbPointSpan(outline.data(), 2)});
+    b.AddPad({{-3000000, 0}, {2000000, 1000000}, PcbPadShape::Rect, 0.0, b.GetLayerId("F.Cu"), 4});
+
+    a.Append(b);
+    REQUIRE(a.GetZones().size() == 2);
+    CHECK(a.GetLayerName(a.GetZones()[1].layer) == "B.Cu");
+    CHECK(a.GetZones()[1].polygon.size() == 2);
+    CHECK(a.GetPads()[0].layer == fCu);
+    CHECK(a.GetBounds().minX == -4000000);
+    CHECK(a.GetBounds().minY == -2250000);
+    CHECK(a.GetBoundingBox().width == Approx(9.5));
+
+    // Removing a zone packs the remaining outlines and shrinks the bounds.
+    a.RemoveElements({}, {0}, {}, {0});
+    REQUIRE(a.GetZones().size() == 1);
+    CHECK(a.GetZones()[0].netId == 3);
+    CHECK(std::equal(a.GetZones()[0].polygon.begin(), a.GetZones()[0].polygon.end(), outline.begin(), outline.begin() + 2));
+    CHECK(a.GetBounds().minX == 0);
+    CHECK(a.GetBounds().maxX == 5500000);
+    CHECK(a.GetBounds().minY == 0);
+}
+
+TEST_CASE("Layer Table", "[core][layers]")
+{
+    // The header declares the layers in stack-up order; pads and vias get
+    // their layers as sets, with wildcards expanded.
+    const std::filesystem::path boardPath = uniqueTempPath("autorouter_layers_test.kicad_pcb");
+    std::ofstream(boardPath, std::ios::binary | std::ios::trunc) <<
+        "(kicad_pcb (version 20221018)\n"
+        "  (layers (0 \"F.Cu\" signal) (1 \"In1.Cu\" power) (2 \"In2.Cu\" signal) (31 \"B.Cu\" signal)\n"
+        "    (37 \"F.SilkS\" user \"F.Silkscreen\") (38 \"B.Mask\" user) (39 \"F.Mask\" user) (44 \"Edge.Cuts\" user))\n"
+        "  (net 0 \"\") (net 1 \"GND\")\n"
+        "  (footprint \"TH\" (layer \"F.Cu\") (at 10 10)\n"
+        "    (pad \"1\" thru_hole circle (at 0 0) (size 1 1) (drill 0.5) (layers \"*.Cu\" \"*.Mask\") (net 1 \"GND\"))\n"
+        "    (pad \"2\" smd rect (at 2 0) (size 1 1) (layers \"B.Cu\" \"B.Mask\") (net 1 \"GND\")))\n"
+        "  (via (at 5 5) (size 0.6) (drill 0.3) (layers \"F.Cu\" \"B.Cu\") (net 1))\n"
+        "  (via blind (at 6 5) (size 0.6) (drill 0.3) (layers \"In1.Cu\" \"F.Cu\") (net 1))\n"
+        ")\n";
+
+    for (auto mode : {PcbParser::ParseMode::Tree, PcbParser::ParseMode::Parallel}) {
+        PcbParser parser;
+        parser.setParseMode(mode);
+        parser.setThreadCount(4);
+        auto data = parser.parseFile(boardPath.string());
+        REQUIRE(data);
+
+        REQUIRE(data->GetLayers().size() == 8);
+        CHECK(data->GetLayers()[3].name == "B.Cu");
+        CHECK(data->GetLayers()[3].number == 31);
+        CHECK(data->GetLayers()[1].type == PcbLayerType::Power);
+        const PcbLayerSet copper = data->GetCopperLayers();
+        CHECK(copper == 0x0F);
+
+        REQUIRE(data->GetPads().size() == 2);
+        const PcbPad throughHole = data->GetPads()[0];
+        CHECK((throughHole.layers & copper) == copper);
+        CHECK((throughHole.layers & LayerBit(data->GetLayerId("F.Mask"))) != 0);
+        CHECK((throughHole.layers & LayerBit(data->GetLayerId("F.SilkS"))) == 0);
+        CHECK(throughHole.layer == data->GetLayerId("F.Cu"));
+        CHECK(data->GetPads()[1].layer == data->GetLayerId("B.Cu"));
+
+        REQUIRE(data->GetVias().size() == 2);
+        CHECK(data->GetVias()[0].layers == copper);
+        CHECK(data->GetVias()[1].layers == (LayerBit(data->GetLayerId("F.Cu")) | LayerBit(data->GetLayerId("In1.Cu"))));
+
+        CHECK(data->GetUniqueLayerNames() == std::vector<std::string>{"B.Cu", "F.Cu", "Via"});
+    }
+    std::filesystem::remove(boardPath);
+
+    // Without a header, wildcards fall back to the outer layers.
+    PcbParser parser;
+    auto simple = parser.parseFile(std::string(PCB_FILES_PATH) + "/simple_2layer/simple_2layer.kicad_pcb");
+    REQUIRE(simple);
+    CHECK(simple->GetLayerId("*.Cu") == PcbNoLayer);
+    CHECK(simple->GetUniqueLayerNames() == std::vector<std::string>{"B.Cu", "Edge.Cuts", "F.Cu", "Hole", "Via"});
+}
+
+TEST_CASE("Net Table", "[core][nets]")
+{
+    PcbParser parser;
+    auto data = parser.parseFile(std::string(PCB_FILES_PATH) + "/simple_2layer/simple_2layer.kicad_pcb");
+    REQUIRE(data);
+
+    // Net 0 is "no net" and gets no index; the rest are dense.
+    CHECK(data->GetNets() == std::vector<std::string>{"GND", "/VCC", "SIG"});
+    CHECK(data->GetNetIndex(0) == -1);
+    CHECK(data->GetNetIndex(3) == 2);
+    CHECK(data->GetNetIndex(99) == -1);
+    CHECK(data->GetNetNumber(1) == 2);
+    CHECK(data->GetNetIdByName("SIG") == 2);
+    CHECK(data->GetNetIdByName("NoSuchNet") == -1);
+
+    const int gnd = data->GetNetIdByName("GND");
+    CHECK(data->GetNetPads(gnd).size() == 2);
+    for (uint32_t pad : data->GetNetPads(gnd)) {
+        CHECK(data->GetPads()[pad].netId == 1);
+    }
+    CHECK(data->GetNetLines(gnd).size() == 2);
+    CHECK(data->GetNetVias(gnd).size() == 1);
+    CHECK(data->GetNetPads(data->GetNetIdByName("SIG")).size() == 1);
+    CHECK(data->GetNetLines(data->GetNetIdByName("/VCC")).empty());
+    CHECK(data->GetNetPads(-1).empty());
+}
+
+TEST_CASE("Footprint Instances", "[core][footprints]")
+{
+    // The fixture's two "R_0402" footprints have different pads, so they
+    // are two definitions; pads are placed by their footprint's position
+    // and rotation.
+    PcbParser parser;
+    auto board = parser.parseFile(std::string(PCB_FILES_PATH) + "/simple_2layer/simple_2layer.kicad_pcb");
+    REQUIRE(board);
+    REQUIRE(board->GetFootprints().size() == 2);
+    CHECK(board->GetFootprintDefs().size() == 2);
+    CHECK(board->GetFootprintDefs()[0]->name == "R_0402");
+    const PcbPad rotated = board->GetPads()[0];
+    CHECK(rotated.pos == PcbPoint{10000000, 10500000});
+    CHECK(rotated.rotation == 90.0);
+    CHECK(board->GetPads()[1].pos == PcbPoint{10000000, 9500000});
+    CHECK(board->GetPads()[2].pos == PcbPoint{29500000, 20000000});
+    CHECK(board->GetPads()[4].pos == PcbPoint{32000000, 22000000});
+
+    // Placing one definition many times stores it once; each instance has
+    // its own nets.
+    PcbData data;
+    const PcbLayerId fCu = data.AddLayer("F.Cu");
+    PcbFootprintDef def;
+    def.name = "R_0402";
+    def.pads.push_back({{-500000, 0}, {600000, 500000}, PcbPadShape::Rect, 0.0, fCu, LayerBit(fCu)});
+    def.pads.push_back({{500000, 0}, {600000, 500000}, PcbPadShape::Rect, 0.0, fCu, LayerBit(fCu)});
+    for (int i = 0; i < 100; ++i) {
+        PcbFootprint footprint;
+        footprint.def = data.AddFootprintDef(def);
+        footprint.pos = {MillimetresToCoord(5.0 * (i % 10) + 2.0), MillimetresToCoord(5.0 * (i / 10) + 2.0)};
+        footprint.rotation = i % 2 ? 90.0 : 0.0;
+        footprint.layer = fCu;
+        const int32_t nets[] = {2 * i + 1, 2 * i + 2};
+        data.AddFootprint(footprint, PcbSpan<int32_t>(nets, 2));
+    }
+    REQUIRE(data.GetFootprintDefs().size() == 1);
+    REQUIRE(data.GetPads().size() == 200);
+    CHECK(data.GetPads()[3].netId == 4);
+    CHECK(data.GetPads()[3].pos == PcbPoint{7000000, 1500000});
+    CHECK(data.GetBounds().minX == 1200000);
+
+    // Removing both pads of an instance removes the instance.
+    PcbData removed = data;
+    removed.RemoveElements({}, {0, 1}, {}, {});
+    CHECK(removed.GetFootprints().size() == 99);
+    CHECK(removed.GetPads()[0].pos == data.GetPads()[2].pos);
+
+    // Stamped obstacles block the pads' cells like per-pad obstacles do,
+    // and a start or end pad can still be opened again.
+    RoutingGrid grid(60, 60, 0.5);
+    grid.AddFootprintObstacles(data);
+    CHECK(grid.FindPath({0, 0}, grid.WorldToGrid(data.GetPads()[0].pos)).empty());
+    CHECK(grid.FindPath({0, 0}, grid.WorldToGrid(data.GetPads()[3].pos)).empty());
+    grid.AddPadObstacle(data.GetPads()[3], true);
+    CHECK_FALSE(grid.FindPath({0, 0}, grid.WorldToGrid(data.GetPads()[3].pos)).empty());
+}
+
+TEST_CASE("A* Search Workspace", "[core][routing]")
+{
+    // A wall across the grid with one gap near the bottom.
+    RoutingGrid grid(200, 100, 0.1);
+    PcbPad wall;
+    wall.pos = {MillimetresToCoord(10.0), MillimetresToCoord(4.0)};
+    wall.size = {MillimetresToCoord(0.3), MillimetresToCoord(8.4)};
+    grid.AddPadObstacle(wall);
+    REQUIRE(grid.IsBlocked({100, 40}));
+    REQUIRE(grid.IsBlocked({100, 82}));
+    REQUIRE_FALSE(grid.IsBlocked({100, 83}));
+
+    auto pathLength = [](const std::vector<GridPoint>& path) {
+        double length = 0.0;
+        for (size_t i = 1; i < path.size(); ++i) {
+            const int dx = std::abs(path[i].x - path[i - 1].x);
+            const int dy = std::abs(path[i].y - path[i - 1].y);
+            REQUIRE(std::max(dx, dy) == 1); // Consecutive cells are neighbours
+            length += (dx && dy) ? 1.414 : 1.0;
+        }
+        return length;
+    };
+
+    const std::vector<GridPoint> path = grid.FindPath({10, 10}, {190, 10});
+    REQUIRE(path.size() > 1);
+    CHECK(path.front() == GridPoint{10, 10});
+    CHECK(path.back() == GridPoint{190, 10});
+    for (const GridPoint& cell : path) {
+        CHECK_FALSE(grid.IsBlocked(cell));
+    }
+    // The wall covers rows 0-82: 73 rows down to the gap diagonally, along
+    // it, and diagonally back up.
+    CHECK(pathLength(path) == Approx(2 * 73 * 1.414 + 34).epsilon(1e-4));
+
+    // Unobstructed: the octile distance.
+    CHECK(pathLength(grid.FindPath({0, 0}, {50, 20})) == Approx(20 * 1.414 + 30).epsilon(1e-4));
+    CHECK(grid.FindPath({5, 5}, {5, 5}).size() == 1);
+    CHECK(grid.FindPath({-1, 5}, {5, 5}).empty());
+
+    // A workspace carries no state from one search to the next.
+    SearchWorkspace workspace;
+    for (int i = 0; i < 50; ++i) {
+        CHECK(grid.FindPath({10, 10}, {190, 10}, workspace) == path);
+    }
+
+    // Searches on a shared grid run concurrently with a workspace each.
+    std::vector<std::vector<GridPoint>> results(4);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < results.size(); ++t) {
+        threads.emplace_back([&, t]() {
+            SearchWorkspace own;
+            for (int i = 0; i < 20; ++i) {
+                results[t] = grid.FindPath({10, 10}, {190, 10}, own);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (const auto& result : results) {
+        CHECK(result == path);
+    }
+}
+
+TEST_CASE("Layered Routing Grid", "[core][routing]")
+{
+    PcbData layers;
+    for (const char* name : {"F.Cu", "In1.Cu", "In2.Cu", "B.Cu", "Edge.Cuts"}) {
+        layers.AddLayer(std::string(name));
+    }
+    const PcbLayerId front = layers.GetLayerId("F.Cu");
+    const PcbLayerId inner1 = layers.GetLayerId("In1.Cu");
+    const PcbLayerId back = layers.GetLayerId("B.Cu");
+
+    RoutingGrid grid(100, 40, 0.1, layers);
+    REQUIRE(grid.GetLayerCount() == 4);
+    CHECK(grid.GetPlane(back) == 3);
+    CHECK(grid.GetPlane(layers.GetLayerId("Edge.Cuts")) == -1);
+    CHECK(grid.GetLayerId(1) == inner1);
+
+    // Through vias occupy every layer unless blind or buried ones are allowed.
+    CHECK(grid.GetViaPlanes(0, 1) == 0xF);
+    ViaRules rules;
+    rules.allowBlind = true;
+    rules.allowBuried = true;
+    grid.SetViaRules(rules);
+    CHECK(grid.GetViaPlanes(1, 0) == 0x3);
+    CHECK(grid.GetViaPlanes(1, 2) == 0x6);
+    CHECK(grid.GetViaPlanes(0, 3) == 0xF);
+    rules.allowBuried = false;
+    grid.SetViaRules(rules);
+    CHECK(grid.GetViaPlanes(1, 2) == 0xF);
+
+    // A wall across F.Cu: the route dives to the next layer and comes back.
+    grid.AddLineObstacle({{MillimetresToCoord(5.0), 0}, {MillimetresToCoord(5.0), MillimetresToCoord(4.0)},
+                          MillimetresToCoord(0.3), front, 1});
+    CHECK(grid.IsBlocked({50, 20, 0}));
+    CHECK_FALSE(grid.IsBlocked({50, 20, 1}));
+    std::vector<GridPoint> path = grid.FindPath({10, 20, 0}, {90, 20, 0});
+    REQUIRE_FALSE(path.empty());
+    int viaCount = 0;
+    for (size_t i = 1; i < path.size(); ++i) {
+        viaCount += path[i].layer != path[i - 1].layer;
+        CHECK_FALSE(grid.IsBlocked(path[i]));
+    }
+    CHECK(viaCount == 2);
+    CHECK(path.front() == GridPoint{10, 20, 0});
+    CHECK(path.back() == GridPoint{90, 20, 0});
+
+    // Vias keep their clearance from copper on the layers they pass through.
+    // A blind via to In1 ignores B.Cu; a through via doesn't.
+    PcbVia other;
+    other.pos = {MillimetresToCoord(2.0), MillimetresToCoord(2.0)};
+    other.size = MillimetresToCoord(0.4);
+    other.fromLayer = back;
+    other.toLayer = back;
+    other.layers = LayerBit(back);
+    grid.AddViaObstacle(other);
+    CHECK(grid.CanPlaceVia({25, 20, 0}, 1));
+    CHECK(grid.CanPlaceVia({25, 20, 1}, 0));
+    CHECK_FALSE(grid.CanPlaceVia({25, 20, 0}, 3)); // Within 0.3 + 0.2 mm of the other via's copper
+    rules.allowBlind = false;
+    grid.SetViaRules(rules);
+    CHECK_FALSE(grid.CanPlaceVia({25, 20, 0}, 1));
+    CHECK_FALSE(grid.CanPlaceVia({27, 20, 0}, 1));
+    CHECK(grid.CanPlaceVia({28, 20, 0}, 1));
+
+    // Keepouts that forbid vias.
+    PcbData board = layers;
+    const std::vector<PcbPoint> area = {{MillimetresToCoord(7.0), 0}, {MillimetresToCoord(9.0), 0},
+                                        {MillimetresToCoord(9.0), MillimetresToCoord(4.0)}, {MillimetresToCoord(7.0), MillimetresToCoord(4.0)}};
+    PcbZone keepout;
+    keepout.layer = inner1;
+    keepout.polygon = area;
+    keepout.keepout = PcbKeepoutVias;
+    board.AddZone(keepout);
+    grid.AddZoneObstacles(board, 1);
+    CHECK_FALSE(grid.IsBlocked({80, 20, 1})); // Tracks may still cross it
+    CHECK_FALSE(grid.CanPlaceVia({80, 20, 0}, 1));
+    CHECK(grid.CanPlaceVia({65, 20, 0}, 1));
+
+    // Clearance inflates tracks, and an overlay puts back whatever it changed.
+    const PcbLine track{{MillimetresToCoord(2.0), MillimetresToCoord(1.0)}, {MillimetresToCoord(2.0), MillimetresToCoord(3.0)},
+                        MillimetresToCoord(0.2), inner1, 2};
+    grid.AddLineObstacle(track, MillimetresToCoord(0.3));
+    CHECK(grid.IsBlocked({20, 20, 1}));
+    CHECK(grid.IsBlocked({17, 20, 1}));
+    CHECK_FALSE(grid.IsBlocked({15, 20, 1}));
+    grid.BeginOverlay();
+    grid.OpenLine(track);
+    CHECK_FALSE(grid.IsBlocked({20, 20, 1}));
+    CHECK(grid.IsBlocked({17, 20, 1})); // Only the track itself is opened
+    grid.AddLineObstacle({{0, MillimetresToCoord(0.5)}, {MillimetresToCoord(10.0), MillimetresToCoord(0.5)},
+                          MillimetresToCoord(0.2), front, 3});
+    CHECK(grid.IsBlocked({70, 5, 0}));
+    grid.RevertOverlay();
+    CHECK(grid.IsBlocked({20, 20, 1}));
+    CHECK_FALSE(grid.IsBlocked({70, 5, 0}));
+    CHECK(grid.IsBlocked({50, 20, 0}));
+}
+
+TEST_CASE("Routing Across Layers", "[core][routing]")
+{
+    // Two SMD pads of one net on opposite sides of the board.
+    const std::filesystem::path boardPath = uniqueTempPath("autorouter_via_route_test.kicad_pcb");
+    std::ofstream(boardPath, std::ios::binary | std::ios::trunc) <<
+        "(kicad_pcb (version 20221018)\n"
+        "  (layers (0 \"F.Cu\" signal) (31 \"B.Cu\" signal) (44 \"Edge.Cuts\" user))\n"
+        "  (net 0 \"\") (net 1 \"A\") (net 2 \"B\")\n"
+        "  (gr_line (start 0 0) (end 20 0) (layer \"Edge.Cuts\") (width 0.1))\n"
+        "  (gr_line (start 20 0) (end 20 10) (layer \"Edge.Cuts\") (width 0.1))\n"
+        "  (gr_line (start 20 10) (end 0 10) (layer \"Edge.Cuts\") (width 0.1))\n"
+        "  (gr_line (start 0 10) (end 0 0) (layer \"Edge.Cuts\") (width 0.1))\n"
+        "  (footprint \"P\" (layer \"F.Cu\") (at 3 5)\n"
+        "    (pad \"1\" smd rect (at 0 0) (size 1 1) (layers \"F.Cu\") (net 1 \"A\")))\n"
+        "  (footprint \"P\" (layer \"B.Cu\") (at 17 5)\n"
+        "    (pad \"1\" smd rect (at 0 0) (size 1 1) (layers \"B.Cu\") (net 1 \"A\")))\n"
+        "  (segment (start 10 1) (end 10 9) (width 0.25) (layer \"F.Cu\") (net 2))\n"
+        ")\n";
+
+    AutorouterCore core;
+    core.setCacheEnabled(false);
+    REQUIRE(core.loadPcbFile(boardPath.string()));
+    const int net = core.getPcbData()->GetNetIdByName("A");
+    const std::shared_ptr<const PcbData> before = core.getPcbData();
+
+    RoutingSettings settings;
+    const RoutingResult result = core.Route(settings, {net});
+    CHECK(result.success);
+    CHECK(result.connections_total == 1);
+    CHECK(result.nets_routed == 1);
+    CHECK(result.via_count == 1);
+    CHECK(result.total_track_length >= 14.0);
+
+    REQUIRE(core.getRoutedVias().size() == 1);
+    const PcbVia via = core.getRoutedVias()[0];
+    CHECK(via.netId == 1);
+    CHECK(via.layers == before->GetCopperLayers());
+    for (const PcbLine& line : core.getRoutedLines()) {
+        CHECK(line.netId == 1);
+        CHECK((line.layer == before->GetLayerId("F.Cu") || line.layer == before->GetLayerId("B.Cu")));
+    }
+    // The tracks are committed as a new version, which completes the net.
+    const std::shared_ptr<const PcbData> after = core.getPcbData();
+    CHECK(after->GetVersion() == before->GetVersion() + 1);
+    CHECK(after->GetVias().size() == 1);
+    Connectivity connectivity;
+    connectivity.Build(*after, {net});
+    CHECK(connectivity.IsComplete(net));
+
+    std::filesystem::remove(boardPath);
+}
+
+TEST_CASE("Open List Policies", "[core][routing]")
+{
+    // The bucket queue hands nodes out by f, whatever order they came in.
+    BucketOpenList buckets;
+    buckets.Reset(14);
+    buckets.Push({30, 0, 1});
+    buckets.Push({44, 0, 2});
+    buckets.Push({30, 10, 3});
+    buckets.Push({58, 0, 4});
+    CHECK(buckets.Pop().cell == 3);
+    CHECK(buckets.Pop().cell == 1);
+    buckets.Push({35, 0, 5});
+    CHECK(buckets.Pop().cell == 5);
+    CHECK(buckets.Pop().cell == 2);
+    CHECK(buckets.Pop().cell == 4);
+    CHECK(buckets.Empty());
+
+    // Scattered obstacles on two layers; both open sets find paths of the
+    // same cost.
+    PcbData layers;
+    layers.AddLayer(std::string("F.Cu"));
+    layers.AddLayer(std::string("B.Cu"));
+    RoutingGrid grid(120, 120, 0.1, layers);
+    TestRandom next(12345);
+    for (int i = 0; i < 300; ++i) {
+        PcbPad pad;
+        pad.pos = {MillimetresToCoord((next() % 1200) / 100.0), MillimetresToCoord((next() % 1200) / 100.0)};
+        pad.size = {MillimetresToCoord(0.2 + (next() % 10) / 10.0), MillimetresToCoord(0.2 + (next() % 10) / 10.0)};
+        pad.layers = LayerBit(static_cast<PcbLayerId>(next() % 2));
+        grid.AddPadObstacle(pad);
+    }
+
+    SearchWorkspace workspace;
+    int found = 0;
+    for (int i = 0; i < 40; ++i) {
+        const GridPoint start = {static_cast<int>(next() % 120), static_cast<int>(next() % 120), static_cast<int>(next() % 2)};
+        const GridPoint end = {static_cast<int>(next() % 120), static_cast<int>(next() % 120), static_cast<int>(next() % 2)};
+        if (grid.IsBlocked(start) || grid.IsBlocked(end)) continue;
+
+        grid.SetOpenListPolicy(OpenListPolicy::BinaryHeap);
+        const std::vector<GridPoint> heapPath = grid.FindPath(start, end, workspace);
+        const SearchStats heapStats = workspace.GetStats();
+        grid.SetOpenListPolicy(OpenListPolicy::Buckets);
+        const std::vector<GridPoint> bucketPath = grid.FindPath(start, end, workspace);
+        const SearchStats bucketStats = workspace.GetStats();
+
+        REQUIRE(heapPath.empty() == bucketPath.empty());
+        if (heapPath.empty()) continue;
+        found++;
+        CHECK(bucketPath.front() == start);
+        CHECK(bucketPath.back() == end);
+        CHECK(pathCost(heapPath) == pathCost(bucketPath));
+        // Every entry is either expanded, stale, or still open at the end.
+        CHECK(heapStats.expanded + heapStats.stale <= heapStats.pushed);
+        CHECK(bucketStats.expanded + bucketStats.stale <= bucketStats.pushed);
+        CHECK(bucketStats.expanded > 0);
+    }
+    CHECK(found >= 10);
+}
+
+TEST_CASE("Jump Point Search", "[core][routing]")
+{
+    RoutingGrid grid(150, 150, 0.1);
+    TestRandom next(777);
+    auto addPads = [&](int count) {
+        for (int i = 0; i < count; ++i) {
+            PcbPad pad;
+            pad.pos = {MillimetresToCoord((next() % 1500) / 100.0), MillimetresToCoord((next() % 1500) / 100.0)};
+            pad.size = {MillimetresToCoord(0.1 + (next() % 6) / 10.0), MillimetresToCoord(0.1 + (next() % 6) / 10.0)};
+            grid.AddPadObstacle(pad);
+        }
+    };
+    // Jump point paths are as short as A*'s, and step cell by cell through
+    // free cells like them.
+    auto compare = [&](int pairs) {
+        int found = 0;
+        for (int i = 0; i < pairs; ++i) {
+            const GridPoint start = {static_cast<int>(next() % 150), static_cast<int>(next() % 150)};
+            const GridPoint end = {static_cast<int>(next() % 150), static_cast<int>(next() % 150)};
+            if (grid.IsBlocked(start) || grid.IsBlocked(end)) continue;
+            grid.SetSearchMode(SearchMode::AStar);
+            const std::vector<GridPoint> cellPath = grid.FindPath(start, end);
+            grid.SetSearchMode(SearchMode::JumpPoint);
+            const std::vector<GridPoint> jumpPath = grid.FindPath(start, end);
+            REQUIRE(cellPath.empty() == jumpPath.empty());
+            if (jumpPath.empty()) continue;
+            found++;
+            CHECK(jumpPath.front() == start);
+            CHECK(jumpPath.back() == end);
+            CHECK(pathCost(jumpPath) == pathCost(cellPath));
+            bool steps = true;
+            for (size_t j = 1; j < jumpPath.size(); ++j) {
+                steps = steps && std::max(std::abs(jumpPath[j].x - jumpPath[j - 1].x), std::abs(jumpPath[j].y - jumpPath[j - 1].y)) == 1 &&
+                        !grid.IsBlocked(jumpPath[j]);
+            }
+            CHECK(steps);
+        }
+        return found;
+    };
+
+    // Across open space a jump point search expands a handful of cells.
+    grid.SetSearchMode(SearchMode::AStar);
+    grid.FindPath({2, 5}, {140, 130});
+    const uint64_t cellExpanded = grid.GetWorkspace().GetStats().expanded;
+    grid.SetSearchMode(SearchMode::JumpPoint);
+    const std::vector<GridPoint> open = grid.FindPath({2, 5}, {140, 130});
+    REQUIRE(open.size() == 139);
+    CHECK(grid.GetWorkspace().GetStats().expanded < 5);
+    CHECK(cellExpanded > 100);
+
+    addPads(150);
+    CHECK(compare(40) >= 20);
+
+    // Obstacles added after the jump table is built patch it: tracks across
+    // the board, a wall of pads and a zone.
+    for (int i = 0; i < 6; ++i) {
+        PcbLine line;
+        line.start = {MillimetresToCoord((next() % 1500) / 100.0), MillimetresToCoord((next() % 1500) / 100.0)};
+        line.end = {MillimetresToCoord((next() % 1500) / 100.0), MillimetresToCoord((next() % 1500) / 100.0)};
+        line.width = MillimetresToCoord(0.25);
+        grid.AddLineObstacle(line);
+    }
+    addPads(40);
+    std::vector<PcbPoint> zone = {{MillimetresToCoord(4.0), MillimetresToCoord(9.0)}, {MillimetresToCoord(8.0), MillimetresToCoord(9.0)},
+                                  {MillimetresToCoord(6.0), MillimetresToCoord(12.0)}};
+    grid.AddPolygonObstacle({PcbPointSpan(zone)});
+    CHECK(compare(40) >= 15);
+
+    // So do footprints: a pad wall across the board cuts it in two.
+    PcbData footprints;
+    PcbFootprintDef wall;
+    PcbPad wallPad;
+    wallPad.size = {MillimetresToCoord(0.3), MillimetresToCoord(16.0)};
+    wall.pads.push_back(wallPad);
+    PcbFootprint placed;
+    placed.def = footprints.AddFootprintDef(wall);
+    placed.pos = {MillimetresToCoord(11.0), MillimetresToCoord(7.5)};
+    footprints.AddFootprint(placed, {});
+    grid.AddFootprintObstacles(footprints);
+    grid.SetSearchMode(SearchMode::JumpPoint);
+    CHECK(grid.FindPath({105, 2}, {145, 2}).empty());
+    CHECK(compare(40) >= 10);
+
+    // A patched table matches one built from scratch.
+    const int size = 60;
+    std::vector<float> cells(size * size, 1.0f);
+    for (int i = 0; i < 500; ++i) cells[next() % cells.size()] = std::numeric_limits<float>::infinity();
+    JumpPointTable patched;
+    patched.Build(cells.data(), size, size);
+    std::vector<GridRect> changed;
+    for (int i = 0; i < 5; ++i) {
+        const int x = next() % size, y = next() % size, w = next() % 8, h = next() % 8;
+        for (int cy = y; cy <= std::min(y + h, size - 1); ++cy) {
+            for (int cx = x; cx <= std::min(x + w, size - 1); ++cx) {
+                cells[cy * size + cx] = (next() % 3) ? std::numeric_limits<float>::infinity() : 1.0f;
+            }
+        }
+        changed.push_back({x, y, std::min(x + w, size - 1), std::min(y + h, size - 1)});
+    }
+    patched.Update(cells.data(), changed);
+    JumpPointTable rebuilt;
+    rebuilt.Build(cells.data(), size, size);
+    int mismatches = 0;
+    for (size_t cell = 0; cell < cells.size(); ++cell) {
+        for (int dir = 0; dir < 8; ++dir) mismatches += patched.Distance(cell, dir) != rebuilt.Distance(cell, dir);
+    }
+    CHECK(mismatches == 0);
+
+    // Grids with several planes keep searching cell by cell.
+    PcbData layers;
+    layers.AddLayer(std::string("F.Cu"));
+    layers.AddLayer(std::string("B.Cu"));
+    RoutingGrid layered(40, 40, 0.1, layers);
+    layered.SetSearchMode(SearchMode::JumpPoint);
+    CHECK(layered.FindPath({1, 1, 0}, {30, 20, 1}).size() > 1);
+    CHECK(layered.GetWorkspace().GetStats().expanded > 20);
+}
+
+TEST_CASE("Bidirectional Search", "[core][routing]")
+{
+    // A pin boxed in by other nets' tracks, open only on the side away
+    // from the start. A* floods everything in front of the box first.
+    RoutingGrid boxed(200, 120, 0.1);
+    auto track = [&](double x0, double y0, double x1, double y1) {
+        PcbLine line;
+        line.start = {MillimetresToCoord(x0), MillimetresToCoord(y0)};
+        line.end = {MillimetresToCoord(x1), MillimetresToCoord(y1)};
+        line.width = MillimetresToCoord(0.2);
+        boxed.AddLineObstacle(line);
+    };
+    track(13.0, 3.0, 13.0, 9.0);
+    track(13.0, 3.0, 15.0, 3.0);
+    track(13.0, 9.0, 15.0, 9.0);
+    const GridPoint start = {20, 60};
+    const GridPoint pin = {140, 60};
+
+    const std::vector<GridPoint> direct = boxed.FindPath(start, pin);
+    const uint64_t directExpanded = boxed.GetWorkspace().GetStats().expanded;
+    REQUIRE_FALSE(direct.empty());
+    SearchWorkspace workspace;
+    for (unsigned threads : {0u, 1u}) {
+        boxed.SetThreadCount(threads);
+        const std::vector<GridPoint> both = boxed.FindPath(start, pin, workspace, SearchMode::Bidirectional);
+        REQUIRE_FALSE(both.empty());
+        CHECK(both.front() == start);
+        CHECK(both.back() == pin);
+        CHECK(pathCost(both) == pathCost(direct));
+        CHECK(workspace.GetStats().expanded * 2 < directExpanded);
+    }
+    // The workspace keeps its worker thread from one search to the next.
+    const SearchWorker* worker = &workspace.Worker();
+    boxed.SetThreadCount(0);
+    CHECK(pathCost(boxed.FindPath(start, pin, workspace, SearchMode::Bidirectional)) == pathCost(direct));
+    CHECK(&workspace.Worker() == worker);
+
+    // Scattered obstacles on two layers: from both ends the paths cost the
+    // same as from one, with either open set, on one thread or two.
+    PcbData layers;
+    layers.AddLayer(std::string("F.Cu"));
+    layers.AddLayer(std::string("B.Cu"));
+    RoutingGrid grid(100, 100, 0.1, layers);
+    TestRandom next(4242);
+    for (int i = 0; i < 150; ++i) {
+        PcbPad pad;
+        pad.pos = {MillimetresToCoord((next() % 1000) / 100.0), MillimetresToCoord((next() % 1000) / 100.0)};
+        pad.size = {MillimetresToCoord(0.2 + (next() % 8) / 10.0), MillimetresToCoord(0.2 + (next() % 8) / 10.0)};
+        pad.layers = LayerBit(static_cast<PcbLayerId>(next() % 2));
+        grid.AddPadObstacle(pad);
+    }
+    int found = 0;
+    for (int i = 0; i < 40; ++i) {
+        const GridPoint from = {static_cast<int>(next() % 100), static_cast<int>(next() % 100), static_cast<int>(next() % 2)};
+        const GridPoint to = {static_cast<int>(next() % 100), static_cast<int>(next() % 100), static_cast<int>(next() % 2)};
+        if (grid.IsBlocked(from) || grid.IsBlocked(to)) continue;
+        grid.SetOpenListPolicy(i % 2 ? OpenListPolicy::Buckets : OpenListPolicy::BinaryHeap);
+        grid.SetThreadCount(i % 3 ? 0 : 1);
+        const std::vector<GridPoint> one = grid.FindPath(from, to, workspace, SearchMode::AStar);
+        const std::vector<GridPoint> both = grid.FindPath(from, to, workspace, SearchMode::Bidirectional);
+        REQUIRE(one.empty() == both.empty());
+        if (both.empty()) continue;
+        found++;
+        CHECK(both.front() == from);
+        CHECK(both.back() == to);
+        CHECK(pathCost(both) == pathCost(one));
+        bool steps = true;
+        for (size_t j = 1; j < both.size(); ++j) {
+            const bool via = both[j].layer != both[j - 1].layer;
+            steps = steps && !grid.IsBlocked(both[j]) &&
+                    (via ? both[j].x == both[j - 1].x && both[j].y == both[j - 1].y
+                         : std::max(std::abs(both[j].x - both[j - 1].x), std::abs(both[j].y - both[j - 1].y)) == 1);
+        }
+        CHECK(steps);
+    }
+    CHECK(found >= 15);
+}
+
+TEST_CASE("Polygon Rasterizer", "[core][raster]")
+{
+    // A star-shaped outline with a square cutout bridged in, as parsed zones
+    // have them. Every cell must match an even-odd test of its centre, on one
+    // thread or several.
+    const double cellSize = 0.1;
+    const int size = 400;
+    std::vector<PcbPoint> polygon;
+    for (int i = 0; i < 14; ++i) {
+        const double radius = i % 2 ? 8.0 : 19.0;
+        const double angle = i * 3.14159265358979 / 7;
+        polygon.push_back({MillimetresToCoord(20.03 + radius * std::cos(angle)), MillimetresToCoord(20.07 + radius * std::sin(angle))});
+    }
+    const std::vector<PcbPoint> hole = {{MillimetresToCoord(17.01), MillimetresToCoord(17.02)}, {MillimetresToCoord(23.04), MillimetresToCoord(17.02)},
+                                        {MillimetresToCoord(23.04), MillimetresToCoord(23.03)}, {MillimetresToCoord(17.01), MillimetresToCoord(23.03)}};
+    polygon.push_back(polygon.front());
+    polygon.insert(polygon.end(), hole.begin(), hole.end());
+    polygon.push_back(hole.front());
+    polygon.push_back(polygon.front());
+
+    auto centreInside = [&](int x, int y) {
+        const double px = x * cellSize, py = y * cellSize;
+        bool inside = false;
+        for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++) {
+            const double ax = CoordToMillimetres(polygon[i].x), ay = CoordToMillimetres(polygon[i].y);
+            const double bx = CoordToMillimetres(polygon[j].x), by = CoordToMillimetres(polygon[j].y);
+            if ((ay > py) != (by > py) && px < (bx - ax) * (py - ay) / (by - ay) + ax) {
+                inside = !inside;
+            }
+        }
+        return inside;
+    };
+
+    for (unsigned threads : {1u, 4u}) {
+        PolygonRasterizer rasterizer(size, size, cellSize);
+        rasterizer.SetThreadCount(threads);
+        std::vector<float> inside(size * size, 0.0f);
+        std::vector<float> outside(size * size, 0.0f);
+        rasterizer.Fill({PcbPointSpan(polygon)}, inside.data(), 1.0f);
+        rasterizer.Fill({PcbPointSpan(polygon)}, outside.data(), 1.0f, true);
+        int mismatches = 0;
+        int filled = 0;
+        for (int y = 0; y < size; ++y) {
+            for (int x = 0; x < size; ++x) {
+                const bool expected = centreInside(x, y);
+                mismatches += (inside[y * size + x] == 1.0f) != expected;
+                mismatches += (outside[y * size + x] == 1.0f) == expected;
+                filled += expected;
+            }
+        }
+        CHECK(mismatches == 0);
+        CHECK(filled > 10000);
+        CHECK(inside[200 * size + 200] == 0.0f); // In the cutout
+    }
+
+    // Only the rows a polygon spans are scanned; with outside, the rows
+    // above and below it are still filled whole.
+    {
+        const std::vector<PcbPoint> square = {{MillimetresToCoord(10.05), MillimetresToCoord(20.05)}, {MillimetresToCoord(12.05), MillimetresToCoord(20.05)},
+                                              {MillimetresToCoord(12.05), MillimetresToCoord(22.05)}, {MillimetresToCoord(10.05), MillimetresToCoord(22.05)}};
+        PolygonRasterizer rasterizer(size, size, cellSize);
+        rasterizer.SetThreadCount(4);
+        std::vector<float> inside(size * size, 0.0f);
+        std::vector<float> outside(size * size, 0.0f);
+        rasterizer.Fill({PcbPointSpan(square)}, inside.data(), 1.0f);
+        rasterizer.Fill({PcbPointSpan(square)}, outside.data(), 1.0f, true);
+        int insideCount = 0;
+        int mismatches = 0;
+        for (int y = 0; y < size; ++y) {
+            for (int x = 0; x < size; ++x) {
+                const bool expected = x > 100 && x <= 120 && y > 200 && y <= 220;
+                insideCount += inside[y * size + x] == 1.0f;
+                mismatches += (inside[y * size + x] == 1.0f) != expected;
+                mismatches += (outside[y * size + x] == 1.0f) == expected;
+            }
+        }
+        CHECK(insideCount == 400);
+        CHECK(mismatches == 0);
+    }
+
+    // Parsed zones keep their cutouts and keepout rules; a rule area on two
+    // layers becomes a zone on each.
+    const std::filesystem::path boardPath = uniqueTempPath("autorouter_zones_test.kicad_pcb");
+    std::ofstream(boardPath, std::ios::binary | std::ios::trunc) <<
+        "(kicad_pcb (version 20221018)\n"
+        "  (layers (0 \"F.Cu\" signal) (31 \"B.Cu\" signal) (44 \"Edge.Cuts\" user))\n"
+        "  (net 0 \"\") (net 1 \"GND\")\n"
+        "  (gr_line (start 0 0) (end 10 0) (layer \"Edge.Cuts\") (width 0.1))\n"
+        "  (gr_line (start 10 10) (end 10 0) (layer \"Edge.Cuts\") (width 0.1))\n"
+        "  (gr_line (start 10 10) (end 0 10) (layer \"Edge.Cuts\") (width 0.1))\n"
+        "  (gr_line (start 0 0) (end 0 10) (layer \"Edge.Cuts\") (width 0.1))\n"
+        "  (gr_line (start 20 0) (end 30 0) (layer \"Edge.Cuts\") (width 0.1))\n"
+        "  (zone (net 1) (net_name \"GND\") (layer \"F.Cu\") (hatch edge 0.5)\n"
+        "    (polygon (pts (xy 1 1) (xy 9 1) (xy 9 9) (xy 1 9)))\n"
+        "    (polygon (pts (xy 4 4) (xy 6 4) (xy 6 6) (xy 4 6))))\n"
+        "  (zone (layers \"F.Cu\" \"B.Cu\") (hatch edge 0.5)\n"
+        "    (keepout (tracks not_allowed) (vias not_allowed) (pads allowed) (copperpour allowed) (footprints allowed))\n"
+        "    (polygon (pts (xy 2 2) (xy 3 2) (xy 3 3) (xy 2 3))))\n"
+        ")\n";
+    PcbParser parser;
+    auto board = parser.parseFile(boardPath.string());
+    std::filesystem::remove(boardPath);
+    REQUIRE(board);
+    REQUIRE(board->GetZones().size() == 3);
+    CHECK(board->GetZones()[0].keepout == 0);
+    CHECK(board->GetZones()[0].polygon.size() == 11);
+    CHECK(board->GetZones()[1].keepout == (PcbKeepoutTracks | PcbKeepoutVias));
+    CHECK(board->GetZones()[2].layer == board->GetLayerId("B.Cu"));
+
+    // The open Edge.Cuts line is not part of the outline.
+    const auto outline = board->GetBoardOutline();
+    REQUIRE(outline.size() == 1);
+    CHECK(outline[0].size() == 4);
+
+    RoutingGrid grid(120, 120, 0.1);
+    grid.AddBoardOutline(*board);
+    grid.AddZoneObstacles(*board, 2);
+    CHECK(grid.IsBlocked({110, 50}));   // Beyond the board edge
+    CHECK(grid.IsBlocked({20, 50}));    // GND zone, another net
+    CHECK_FALSE(grid.IsBlocked({50, 50})); // Its cutout
+    CHECK_FALSE(grid.IsBlocked({5, 50}));  // Between the edge and the zone
+
+    RoutingGrid gndGrid(120, 120, 0.1);
+    gndGrid.AddZoneObstacles(*board, 1);
+    CHECK_FALSE(gndGrid.IsBlocked({20, 50}));
+    CHECK(gndGrid.IsBlocked({25, 25})); // The keepout forbids tracks
+
+    // KiCad 7 and later nest the width in (stroke ...) and draw outlines
+    // with arcs, rectangles, polygons and circles as well as lines.
+    const std::filesystem::path kicad7Path = uniqueTempPath("autorouter_outline_test.kicad_pcb");
+    std::ofstream(kicad7Path, std::ios::binary | std::ios::trunc) <<
+        "(kicad_pcb (version 20221018)\n"
+        "  (layers (0 \"F.Cu\" signal) (31 \"B.Cu\" signal) (44 \"Edge.Cuts\" user))\n"
+        "  (gr_line (start 0 0) (end 8 0) (stroke (width 0.1) (type default)) (layer \"Edge.Cuts\") (tstamp a1))\n"
+        "  (gr_arc (start 8 0) (mid 9.414214 0.585786) (end 10 2) (stroke (width 0.1) (type default)) (layer \"Edge.Cuts\") (tstamp a2))\n"
+        "  (gr_line (start 10 2) (end 10 10) (stroke (width 0.1) (type default)) (layer \"Edge.Cuts\") (tstamp a3))\n"
+        "  (gr_line (start 10 10) (end 0 10) (stroke (width 0.1) (type default)) (layer \"Edge.Cuts\") (tstamp a4))\n"
+        "  (gr_line (start 0 10) (end 0 0) (stroke (width 0.1) (type default)) (layer \"Edge.Cuts\") (tstamp a5))\n"
+        "  (gr_poly (pts (xy 4 4) (xy 6 4) (xy 6 6) (xy 4 6)) (stroke (width 0.1) (type solid)) (fill none) (layer \"Edge.Cuts\") (tstamp a6))\n"
+        "  (gr_circle (center 2 8) (end 2.5 8) (stroke (width 0.1) (type default)) (fill none) (layer \"Edge.Cuts\") (tstamp a7))\n"
+        "  (gr_rect (start 1 1) (end 2 2) (stroke (width 0.1) (type default)) (fill none) (layer \"Edge.Cuts\") (tstamp a8))\n"
+        "  (gr_rect (start 1 1) (end 2 2) (stroke (width 0.1) (type default)) (fill none) (layer \"F.SilkS\") (tstamp a9))\n"
+        ")\n";
+    for (PcbParser::ParseMode mode : {PcbParser::ParseMode::Tree, PcbParser::ParseMode::Streaming}) {
+        PcbParser kicad7Parser;
+        kicad7Parser.setParseMode(mode);
+        auto kicad7 = kicad7Parser.parseFile(kicad7Path.string());
+        REQUIRE(kicad7);
+        const auto rings = kicad7->GetBoardOutline();
+        REQUIRE(rings.size() == 4);
+        std::vector<size_t> sizes;
+        for (const auto& ring : rings) sizes.push_back(ring.size());
+        std::sort(sizes.begin(), sizes.end());
+        CHECK(sizes[0] == 4);  // The rectangle
+        CHECK(sizes[1] == 4);  // The polygon
+        CHECK(sizes[2] >= 16); // The circle
+        CHECK(sizes[3] > 5);   // The board, its corner rounded
+        for (size_t i = 0; i < kicad7->GetLines().size(); ++i) {
+            CHECK(kicad7->GetLines()[i].width == MillimetresToCoord(0.1));
+        }
+
+        RoutingGrid edgeGrid(120, 120, 0.1);
+        edgeGrid.AddBoardOutline(*kicad7);
+        CHECK_FALSE(edgeGrid.IsBlocked({50, 20}));
+        CHECK_FALSE(edgeGrid.IsBlocked({95, 15})); // Inside the rounded corner
+        CHECK(edgeGrid.IsBlocked({99, 0}));        // Cut away by it
+        CHECK(edgeGrid.IsBlocked({50, 50}));       // The polygon cutout
+        CHECK(edgeGrid.IsBlocked({20, 80}));       // The circle
+        CHECK(edgeGrid.IsBlocked({15, 15}));       // The rectangle
+        CHECK(edgeGrid.IsBlocked({110, 50}));
+    }
+    std::filesystem::remove(kicad7Path);
+}
+
+TEST_CASE("Spatial Index", "[core][spatial]")
+{
+    // A 20x20 grid of short tracks on alternating layers, a pad beside each,
+    // and one zone covering the whole board.
+    PcbData data;
+    const PcbLayerId fCu = data.AddLayer("F.Cu");
+    const PcbLayerId bCu = data.AddLayer("B.Cu");
+    for (int row = 0; row < 20; ++row) {
+        for (int col = 0; col < 20; ++col) {
+            const PcbCoord x = col * 2000000, y = row * 2000000;
+            data.AddLine({{x, y}, {x + 1000000, y + 500000}, 200000, (row + col) % 2 ? bCu : fCu, 1});
+            PcbPad pad;
+            pad.pos = {x + 1500000, y + 1500000};
+            pad.size = {400000, 400000};
+            pad.layer = fCu;
+            pad.layers = LayerBit(fCu) | LayerBit(bCu);
+            data.AddPad(pad);
+        }
+    }
+    const std::vector<PcbPoint> outline = {{0, 0}, {40000000, 0}, {40000000, 40000000}, {0, 40000000}};
+    data.AddZone({2, bCu, PcbPointSpan(outline)});
+
+    SpatialIndex index;
+    index.Build(data, 1000000);
+    CHECK(index.size() == 801);
+
+    auto sorted = [](std::vector<PcbItemRef> items) {
+        std::sort(items.begin(), items.end());
+        return items;
+    };
+    auto lineBox = [&](uint32_t i) {
+        const PcbLine line = data.GetLines()[i];
+        PcbBox box;
+        box.Union(std::min(line.start.x, line.end.x) - line.width / 2, std::min(line.start.y, line.end.y) - line.width / 2,
+                  std::max(line.start.x, line.end.x) + line.width / 2, std::max(line.start.y, line.end.y) + line.width / 2);
+        return box;
+    };
+    auto overlaps = [](const PcbBox& a, const PcbBox& b) {
+        return a.minX <= b.maxX && b.minX <= a.maxX && a.minY <= b.maxY && b.minY <= a.maxY;
+    };
+
+    // Rectangle queries match a brute-force scan, each element reported once.
+    PcbBox area;
+    area.Union(3100000, 2900000, 9000000, 7000000);
+    std::vector<PcbItemRef> found;
+    index.Query(area, LayerBit(fCu), found);
+    std::vector<PcbItemRef> expected;
+    for (uint32_t i = 0; i < data.GetLines().size(); ++i) {
+        if (data.GetLines()[i].layer == fCu && overlaps(lineBox(i), area)) expected.push_back({PcbItemKind::Line, i});
+    }
+    for (uint32_t i = 0; i < data.GetPads().size(); ++i) {
+        PcbBox box;
+        const PcbPad pad = data.GetPads()[i];
+        box.Union(pad.pos.x - 200000, pad.pos.y - 200000, pad.pos.x + 200000, pad.pos.y + 200000);
+        if (overlaps(box, area)) expected.push_back({PcbItemKind::Pad, i});
+    }
+    REQUIRE_FALSE(expected.empty());
+    CHECK(sorted(found) == sorted(expected));
+
+    // The zone is only on B.Cu, and a query outside the board finds nothing but it.
+    found.clear();
+    index.Query(area, LayerBit(bCu), found);
+    CHECK(std::count(found.begin(), found.end(), PcbItemRef{PcbItemKind::Zone, 0}) == 1);
+    found.clear();
+    PcbBox outside;
+    outside.Union(-5000000, -5000000, -4000000, -4000000);
+    index.Query(outside, PcbAllLayers, found);
+    CHECK(found.empty());
+
+    // Nearest measures to the track's copper, not its centre line.
+    PcbItemRef nearest;
+    REQUIRE(index.Nearest({10000000, 9700000}, LayerBit(fCu), nearest));
+    CHECK(nearest == PcbItemRef{PcbItemKind::Line, 5 * 20 + 5});
+    CHECK_FALSE(index.Nearest({-10000000, -10000000}, LayerBit(fCu), nearest, 1000000.0));
+    REQUIRE(index.Nearest({-10000000, -10000000}, LayerBit(fCu), nearest));
+    CHECK(nearest == PcbItemRef{PcbItemKind::Line, 0});
+
+    // A track added after the build is found; removed elements are not.
+    data.AddLine({{-3000000, -3000000}, {-2000000, -3000000}, 200000, fCu, 1});
+    const PcbItemRef added{PcbItemKind::Line, static_cast<uint32_t>(data.GetLines().size() - 1)};
+    index.Insert(data, added);
+    REQUIRE(index.Nearest({-10000000, -10000000}, LayerBit(fCu), nearest));
+    CHECK(nearest == added);
+    CHECK(index.Remove(added));
+    CHECK_FALSE(index.Remove(added));
+    REQUIRE(index.Nearest({-10000000, -10000000}, LayerBit(fCu), nearest));
+    CHECK(nearest == PcbItemRef{PcbItemKind::Line, 0});
+    CHECK(index.size() == 801);
+}
+
+TEST_CASE("Connectivity and Ratsnest", "[core][connectivity]")
+{
+    PcbParser parser;
+    auto board = parser.parseFile(std::string(PCB_FILES_PATH) + "/simple_2layer/simple_2layer.kicad_pcb");
+    REQUIRE(board);
+
+    // GND's track, via, second track and B.Cu zone all touch.
+    Connectivity connectivity;
+    connectivity.Build(*board);
+    const int gnd = board->GetNetIdByName("GND");
+    const int copperIsland = connectivity.GetIsland({PcbItemKind::Via, board->GetNetVias(gnd)[0]});
+    CHECK(copperIsland >= 0);
+    for (uint32_t line : board->GetNetLines(gnd)) {
+        CHECK(connectivity.GetIsland({PcbItemKind::Line, line}) == copperIsland);
+    }
+    CHECK(connectivity.GetIsland({PcbItemKind::Zone, 0}) == copperIsland);
+    CHECK(connectivity.GetNetConnections(gnd).size() == static_cast<size_t>(connectivity.GetIslandCount(gnd) - 1));
+    // Nets with a single pad are complete.
+    CHECK(connectivity.IsComplete(board->GetNetIdByName("SIG")));
+    CHECK(connectivity.GetNetConnections(board->GetNetIdByName("SIG")).empty());
+
+    // Two F.Cu pads joined by a track, one B.Cu pad reached through a via,
+    // and two pads on their own.
+    PcbData data;
+    const PcbLayerId fCu = data.AddLayer("F.Cu");
+    const PcbLayerId bCu = data.AddLayer("B.Cu");
+    data.AddNet(1, "A");
+    data.AddNet(2, "B");
+    auto addPad = [&](PcbCoord x, PcbCoord y, PcbLayerId layer, int net) {
+        PcbPad pad;
+        pad.pos = {x, y};
+        pad.size = {1000000, 1000000};
+        pad.layer = layer;
+        pad.layers = LayerBit(layer);
+        pad.netId = net;
+        data.AddPad(pad);
+    };
+    addPad(0, 0, fCu, 1);
+    addPad(10000000, 0, fCu, 1);
+    addPad(10000000, 10000000, bCu, 1);
+    addPad(30000000, 0, fCu, 1);
+    addPad(0, 20000000, fCu, 1);
+    data.AddLine({{0, 0}, {10000000, 0}, 250000, fCu, 1});
+    data.AddLine({{10000000, 0}, {10000000, 5000000}, 250000, fCu, 1});
+    data.AddVia({{10000000, 5000000}, 600000, 300000, fCu, bCu, LayerBit(fCu) | LayerBit(bCu), 1});
+    data.AddLine({{10000000, 5000000}, {10000000, 10000000}, 250000, bCu, 1});
+    data.AddLine({{50000000, 50000000}, {51000000, 50000000}, 250000, fCu, 1}); // Stray copper
+    data.BuildNetIndex();
+
+    connectivity.Build(data, {0});
+    CHECK(connectivity.GetIslandCount(0) == 3);
+    CHECK(connectivity.GetIslandCount(1) == -1);
+    CHECK(connectivity.GetIsland({PcbItemKind::Pad, 2}) == connectivity.GetIsland({PcbItemKind::Pad, 0}));
+    CHECK(connectivity.GetIsland({PcbItemKind::Pad, 3}) != connectivity.GetIsland({PcbItemKind::Pad, 0}));
+    CHECK(connectivity.GetIsland({PcbItemKind::Line, 3}) >= 3);
+    const auto connections = connectivity.GetNetConnections(0);
+    REQUIRE(connections.size() == 2);
+    // The spare pads connect to the nearest copper of the big island, not to each other.
+    CHECK(connections[0].length == Approx(std::hypot(10000000.0, 10000000.0)));
+    CHECK(connections[0].to == PcbItemRef{PcbItemKind::Pad, 4});
+    CHECK(connections[1].length == Approx(20000000));
+    CHECK(connections[1].toPos == PcbPoint{30000000, 0});
+
+    // A large net goes through the triangulation and must still give a
+    // minimum spanning tree: compare its length with Prim's over all pairs.
+    PcbData grid;
+    const PcbLayerId layer = grid.AddLayer("F.Cu");
+    grid.AddNet(1, "GRID");
+    std::vector<PcbPoint> points;
+    for (int i = 0; i < 300; ++i) {
+        const PcbPoint pos{(i * 7919 % 211) * 250000, (i * 104729 % 199) * 250000};
+        points.push_back(pos);
+        PcbPad pad;
+        pad.pos = pos;
+        pad.size = {100000, 100000};
+        pad.layer = layer;
+        pad.layers = LayerBit(layer);
+        pad.netId = 1;
+        grid.AddPad(pad);
+    }
+    grid.BuildNetIndex();
+    connectivity.SetThreadCount(4);
+    connectivity.Build(grid);
+    REQUIRE(connectivity.GetIslandCount(0) == 300);
+    REQUIRE(connectivity.GetConnections().size() == 299);
+    double ratsnestLength = 0.0;
+    for (const PcbConnection& connection : connectivity.GetConnections()) {
+        ratsnestLength += connection.length;
+    }
+    std::vector<double> distance(points.size(), std::numeric_limits<double>::infinity());
+    std::vector<bool> inTree(points.size(), false);
+    double treeLength = 0.0;
+    distance[0] = 0.0;
+    for (size_t step = 0; step < points.size(); ++step) {
+        size_t next = 0;
+        double best = std::numeric_limits<double>::infinity();
+        for (size_t i = 0; i < points.size(); ++i) {
+            if (!inTree[i] && distance[i] < best) {
+                best = distance[i];
+                next = i;
+            }
+        }
+        inTree[next] = true;
+        treeLength += best;
+        for (size_t i = 0; i < points.size(); ++i) {
+            distance[i] = std::min(distance[i], std::hypot(double(points[i].x) - points[next].x, double(points[i].y) - points[next].y));
+        }
+    }
+    CHECK(ratsnestLength == Approx(treeLength));
+}
+
+TEST_CASE("Versioned Snapshots", "[core][versions]")
+{
+    AutorouterCore core;
+    core.setCacheEnabled(false);
+    CHECK_FALSE(core.getPcbData());
+    CHECK(core.commitTracks({}, {}) == 0);
+    REQUIRE(core.loadPcbFile(std::string(PCB_FILES_PATH) + "/simple_2layer/simple_2layer.kicad_pcb"));
+    const std::shared_ptr<const PcbData> before = core.getPcbData();
+    const size_t lineCount = before->GetLines().size();
+
+    // Committing tracks publishes a new version and leaves the pinned one alone.
+    const PcbLayerId fCu = before->GetLayerId("F.Cu");
+    const int sig = before->GetNetNumber(before->GetNetIdByName("SIG"));
+    const uint64_t version = core.commitTracks({{{1000000, 1000000}, {2000000, 1000000}, 200000, fCu, sig}}, {});
+    CHECK(version == before->GetVersion() + 1);
+    const std::shared_ptr<const PcbData> after = core.getPcbData();
+    CHECK(after->GetVersion() == version);
+    CHECK(before->GetLines().size() == lineCount);
+    REQUIRE(after->GetLines().size() == lineCount + 1);
+    CHECK(after->GetLines()[lineCount].end == PcbPoint{2000000, 1000000});
+    CHECK(after->GetNetLines(after->GetNetIdByName("SIG")).size() == before->GetNetLines(before->GetNetIdByName("SIG")).size() + 1);
+
+    // Columns share chunks between copies; a write copies only its chunk.
+    PcbColumn<int> column;
+    for (int i = 0; i < 3 * static_cast<int>(PcbColumn<int>::ChunkSize); ++i) {
+        column.push_back(i);
+    }
+    PcbColumn<int> copy = column;
+    CHECK(copy.ChunkData(0) == column.ChunkData(0));
+    copy.Mutable(PcbColumn<int>::ChunkSize + 5) = -1;
+    CHECK(copy.ChunkData(0) == column.ChunkData(0));
+    CHECK(copy.ChunkData(1) != column.ChunkData(1));
+    CHECK(copy.ChunkData(2) == column.ChunkData(2));
+    CHECK(column[PcbColumn<int>::ChunkSize + 5] == static_cast<int>(PcbColumn<int>::ChunkSize + 5));
+    CHECK(copy[PcbColumn<int>::ChunkSize + 5] == -1);
+    copy.resize(10);
+    CHECK(copy.size() == 10);
+    CHECK(std::equal(copy.begin(), copy.end(), column.begin()));
+    CHECK(column.size() == 3 * PcbColumn<int>::ChunkSize);
+
+    // Net and footprint tables are shared until a copy adds to them.
+    CHECK(after->GetNets().data() == before->GetNets().data());
+    CHECK(after->GetFootprintDefs().data() == before->GetFootprintDefs().data());
+    PcbData renamed = *after;
+    renamed.AddNet(99, "NEW");
+    CHECK(renamed.GetNets().data() != after->GetNets().data());
+    CHECK(renamed.GetNetIndex(99) == static_cast<int>(after->GetNets().size()));
+    CHECK(after->GetNetIdByName("NEW") == -1);
+    CHECK(after->GetNetIndex(99) == -1);
+    CHECK(renamed.GetNetIdByName("SIG") == after->GetNetIdByName("SIG"));
+
+    // Readers see whole versions while a writer commits.
+    PcbDataVersions versions;
+    PcbData board;
+    board.AddLayer("F.Cu");
+    versions.Commit(PcbData(board));
+    std::atomic<bool> done{false};
+    std::atomic<bool> consistent{true};
+    std::thread reader([&]() {
+        while (!done) {
+            const auto pinned = versions.Current();
+            // Version n holds n - 1 lines, each ending at x = its index.
+            const PcbLineView lines = pinned->GetLines();
+            if (lines.size() != pinned->GetVersion() - 1) consistent = false;
+            for (size_t i = 0; i < lines.size(); ++i) {
+                if (lines[i].end.x != static_cast<PcbCoord>(i)) consistent = false;
+            }
+        }
+    });
+    for (int i = 0; i < 200; ++i) {
+        PcbData next = *versions.Current();
+        next.AddLine({{0, 0}, {i, 0}, 1, 0, 0});
+        versions.Commit(std::move(next));
+    }
+    done = true;
+    reader.join();
+    CHECK(consistent);
+    CHECK(versions.Current()->GetLines().size() == 200);
+}
+
+TEST_CASE("PCB Data Cache Round Trip", "[core][cache]")
+{
+    const std::vector<std::string> pcbFiles = discoverPcbFiles();
+    const std::filesystem::path cacheDir = uniqueTempPath("autorouter_test_cache");
+    std::filesystem::remove_all(cacheDir);
+    std::filesystem::create_directories(cacheDir);
+
+    for (const std::string& pcbFile : pcbFiles)
+    {
+        SECTION(getTestNameForPcbFile(pcbFile))
+        {
+            // The first load parses and writes a snapshot, the second reads it back.
+            AutorouterCore parsed;
+            parsed.setCacheDirectory(cacheDir.string());
+            REQUIRE(parsed.loadPcbFile(pcbFile));
+            CHECK_FALSE(parsed.loadedFromCache());
+
+            AutorouterCore cached;
+            cached.setCacheDirectory(cacheDir.string());
+            REQUIRE(cached.loadPcbFile(pcbFile));
+            CHECK(cached.loadedFromCache());
+
+            const PcbData& a = *parsed.getPcbData();
+            const PcbData& b = *cached.getPcbData();
+            CHECK(b.GetNets() == a.GetNets());
+            REQUIRE(b.GetPads().size() == a.GetPads().size());
+            for (size_t i = 0; i < a.GetPads().size(); ++i) {
+                CHECK(b.GetPads()[i].pos == a.GetPads()[i].pos);
+                CHECK(b.GetPads()[i].shape == a.GetPads()[i].shape);
+                CHECK(b.GetPads()[i].netId == a.GetPads()[i].netId);
+            }
+            REQUIRE(b.GetLines().size() == a.GetLines().size());
+            for (size_t i = 0; i < a.GetLines().size(); ++i) {
+                CHECK(b.GetLines()[i].end == a.GetLines()[i].end);
+                CHECK(b.GetLayerName(b.GetLines()[i].layer) == a.GetLayerName(a.GetLines()[i].layer));
+            }
+            CHECK(b.GetVias().size() == a.GetVias().size());
+            REQUIRE(b.GetZones().size() == a.GetZones().size());
+            for (size_t i = 0; i < a.GetZones().size(); ++i) {
+                CHECK(std::equal(b.GetZones()[i].polygon.begin(), b.GetZones()[i].polygon.end(),
+                                 a.GetZones()[i].polygon.begin(), a.GetZones()[i].polygon.end()));
+            }
+            CHECK(b.GetBoundingBox().width == a.GetBoundingBox().width);
+            REQUIRE(b.GetLayers().size() == a.GetLayers().size());
+            for (size_t i = 0; i < a.GetLayers().size(); ++i) {
+                CHECK(b.GetLayers()[i].name == a.GetLayers()[i].name);
+                CHECK(b.GetLayers()[i].number == a.GetLayers()[i].number);
+            }
+            CHECK(b.GetUniqueLayerNames() == a.GetUniqueLayerNames());
+        }
+    }
+
+    // A different key (as after the board is edited) must not hit the old snapshot.
+    PcbDataCache cache;
+    cache.setDirectory(cacheDir.string());
+    PcbDataCache::Key staleKey;
+    REQUIRE(PcbDataCache::computeKey(pcbFiles[0], staleKey));
+    staleKey.size += 1;
+    CHECK_FALSE(cache.load(pcbFiles[0], staleKey));
+
+    // Snapshots depend only on the data: two parses give the same bytes.
+    {
+        PcbParser parser;
+        PcbDataCache::Key key;
+        REQUIRE(PcbDataCache::computeKey(pcbFiles.back(), key));
+        auto readSnapshot = [&](const std::string& name) {
+            const std::filesystem::path dir = cacheDir / name;
+            PcbDataCache store;
+            store.setDirectory(dir.string());
+            auto data = parser.parseFile(pcbFiles.back());
+            REQUIRE(data);
+            REQUIRE(store.store(pcbFiles.back(), key, *data));
+            std::ifstream in(std::filesystem::directory_iterator(dir)->path(), std::ios::binary);
+            return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        };
+        const std::string first = readSnapshot("first");
+        CHECK(first.size() > sizeof(PcbDataCache::Key));
+        CHECK(readSnapshot("second") == first);
+    }
+
+    // Nothing is written next to the boards unless asked for.
+    CHECK_FALSE(PcbDataCache().getDirectory().empty());
+    for (const std::string& pcbFile : pcbFiles) {
+        CHECK_FALSE(std::filesystem::exists(pcbFile + ".pcbcache"));
+    }
+
+    std::filesystem::remove_all(cacheDir);
+}
+
+TEST_CASE("Incremental Reload", "[core][reload]")
+{
+    const std::string fixture = std::string(PCB_FILES_PATH) + "/simple_2layer/simple_2layer.kicad_pcb";
+    const std::filesystem::path boardPath = uniqueTempPath("autorouter_reload_test.kicad_pcb");
+    std::filesystem::copy_file(fixture, boardPath, std::filesystem::copy_options::overwrite_existing);
+
+    auto readBoard = [&]() {
+        std::ifstream in(boardPath, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    };
+    auto writeBoard = [&](const std::string& text) {
+        std::ofstream(boardPath, std::ios::binary | std::ios::trunc) << text;
+    };
+    auto replace = [](std::string& text, const std::string& from, const std::string& to) {
+        const size_t pos = text.find(from);
+        REQUIRE(pos != std::string::npos);
+        text.replace(pos, from.size(), to);
+    };
+
+    AutorouterCore core;
+    core.setCacheEnabled(false);
+    REQUIRE(core.loadPcbFile(boardPath.string()));
+    std::shared_ptr<const PcbData> data = core.getPcbData();
+
+    // Unchanged file: nothing to do.
+    PcbChangeSet changes;
+    REQUIRE(core.reloadPcbFile(&changes));
+    CHECK(changes.empty());
+
+    // Edit one segment, delete the via and add a segment.
+    std::string board = readBoard();
+    replace(board, "(end 20 10) (width 0.25) (layer \"F.Cu\") (net 1) (tstamp s1)",
+                   "(end 25 10) (width 0.25) (layer \"F.Cu\") (net 1) (tstamp s1)");
+    replace(board, "(via (at 20 10) (size 0.8) (drill 0.4) (layers \"F.Cu\" \"B.Cu\") (net 1) (tstamp v1))",
+                   "(segment (start 1 2) (end 3 4) (width 0.2) (layer \"B.Cu\") (net 3) (tstamp s3))");
+    writeBoard(board);
+
+    REQUIRE(core.reloadPcbFile(&changes));
+    CHECK_FALSE(changes.fullReload);
+    CHECK(changes.itemsChanged == 1);
+    CHECK(changes.itemsRemoved == 1);
+    CHECK(changes.itemsAdded == 1);
+    CHECK(changes.removedLines.size() == 1);
+    CHECK(changes.removedVias == std::vector<size_t>{0});
+    CHECK(changes.addedLines.size() == 2);
+    // The reload is a new version; the one held from before is unchanged.
+    CHECK(data->GetVias().size() == 1);
+    CHECK(core.getPcbData()->GetVersion() == data->GetVersion() + 1);
+    data = core.getPcbData();
+
+    // The result holds the same elements as a fresh parse; only the order differs.
+    PcbParser parser;
+    auto fresh = parser.parseFile(boardPath.string());
+    REQUIRE(fresh);
+    auto lineKeys = [](const PcbData& pcb) {
+        std::vector<std::pair<PcbCoord, PcbCoord>> keys;
+        for (const auto& line : pcb.GetLines()) {
+            keys.emplace_back(line.start.x + line.start.y, line.end.x + line.end.y);
+        }
+        std::sort(keys.begin(), keys.end());
+        return keys;
+    };
+    CHECK(lineKeys(*data) == lineKeys(*fresh));
+    CHECK(data->GetPads().size() == fresh->GetPads().size());
+    CHECK(data->GetVias().empty());
+    CHECK(data->GetNets() == fresh->GetNets());
+    CHECK(data->GetBoundingBox().width == fresh->GetBoundingBox().width);
+    CHECK(data->GetNetVias(data->GetNetIdByName("GND")).empty());
+    CHECK(data->GetNetLines(data->GetNetIdByName("SIG")).size() == 1);
+
+    // A reload after a reload diffs against the updated extents.
+    board = readBoard();
+    replace(board, "(tstamp s2)", "(tstamp s2b)");
+    writeBoard(board);
+    REQUIRE(core.reloadPcbFile(&changes));
+    CHECK(changes.itemsAdded == 1);
+    CHECK(changes.itemsRemoved == 1);
+    data = core.getPcbData();
+    CHECK(lineKeys(*data) == lineKeys(*fresh));
+
+    // A new net changes the net list, which forces a full parse.
+    board = readBoard();
+    replace(board, "(net 3 \"SIG\")", "(net 3 \"SIG\")\n  (net 4 \"NEW\")");
+    writeBoard(board);
+    REQUIRE(core.reloadPcbFile(&changes));
+    CHECK(changes.fullReload);
+    CHECK(data->GetNetIdByName("NEW") == -1);
+    CHECK(core.getPcbData()->GetNetIdByName("NEW") >= 0);
+
+    std::filesystem::remove(boardPath);
+}
+
+TEST_CASE("Writing Routed Tracks", "[core][writer]")
+{
+    const std::string fixture = std::string(PCB_FILES_PATH) + "/simple_2layer/simple_2layer.kicad_pcb";
+    const std::filesystem::path outPath = uniqueTempPath("autorouter_writer_test.kicad_pcb");
+    auto readFile = [](const std::filesystem::path& path) {
+        std::ifstream in(path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    };
+    const std::string original = readFile(fixture);
+    PcbDataCache::Key key;
+    REQUIRE(PcbDataCache::computeKey(fixture, key));
+
+    PcbParser parser;
+    std::vector<PcbItemExtent> items;
+    auto data = parser.parseFile(fixture, items);
+    REQUIRE(data);
+    for (const PcbItemExtent& item : items) {
+        REQUIRE(item.byteOffset + item.byteSize <= original.size());
+        CHECK(original[item.byteOffset] == '(');
+        CHECK(original[item.byteOffset + item.byteSize - 1] == ')');
+    }
+
+    const PcbLayerId front = data->GetLayerId("F.Cu");
+    const PcbLayerId back = data->GetLayerId("B.Cu");
+    const std::vector<PcbLine> lines = {{{30500000, 20000000}, {40000000, 25125000}, 200000, front, 3}};
+    const std::vector<PcbVia> vias = {{{40000000, 25125000}, 600000, 300000, front, back, 0, 3}};
+
+    SECTION("Tracks are spliced in after the last item")
+    {
+        PcbWriter writer;
+        REQUIRE(writer.open(fixture, items, key));
+        REQUIRE(writer.write(outPath.string(), *data, lines, vias));
+        const std::string written = readFile(outPath);
+        const uint64_t splice = items.back().byteOffset + items.back().byteSize;
+        CHECK(written.compare(0, splice, original, 0, splice) == 0);
+        CHECK(written.substr(splice, written.size() - original.size()) ==
+              "\n  (segment (start 30.5 20) (end 40 25.125) (width 0.2) (layer \"F.Cu\") (net 3))"
+              "\n  (via (at 40 25.125) (size 0.6) (drill 0.3) (layers \"F.Cu\" \"B.Cu\") (net 3))");
+        CHECK(written.compare(written.size() - (original.size() - splice), std::string::npos, original, splice) == 0);
+
+        auto routed = parser.parseFile(outPath.string());
+        REQUIRE(routed);
+        CHECK(routed->GetLines().size() == data->GetLines().size() + 1);
+        CHECK(routed->GetVias().size() == data->GetVias().size() + 1);
+        const PcbLine added = routed->GetLines()[data->GetLines().size()];
+        CHECK(added.start == lines[0].start);
+        CHECK(added.end == lines[0].end);
+        CHECK(added.width == lines[0].width);
+        CHECK(added.layer == front);
+        CHECK(routed->GetNetLines(routed->GetNetIdByName("SIG")).size() == 1);
+    }
+
+    SECTION("Without extents the end of the board is found by scanning")
+    {
+        PcbWriter scanned, spliced;
+        REQUIRE(scanned.open(fixture, {}, key));
+        REQUIRE(spliced.open(fixture, items, key));
+        REQUIRE(scanned.write(outPath.string(), *data, lines, vias));
+        const std::string fromScan = readFile(outPath);
+        REQUIRE(spliced.write(outPath.string(), *data, lines, vias));
+        CHECK(fromScan == readFile(outPath));
+    }
+
+    SECTION("Removed items are left out with their line")
+    {
+        size_t viaItem = items.size();
+        for (size_t i = 0; i < items.size(); ++i) {
+            if (items[i].identity == "via:v1") viaItem = i;
+        }
+        REQUIRE(viaItem < items.size());
+        PcbWriter writer;
+        REQUIRE(writer.open(fixture, items, key));
+        REQUIRE(writer.write(outPath.string(), *data, {}, {}, {viaItem}));
+        const std::string written = readFile(outPath);
+        CHECK(written.find("(via") == std::string::npos);
+        CHECK(written.find("(tstamp s2))\n  (zone") != std::string::npos);
+
+        auto routed = parser.parseFile(outPath.string());
+        REQUIRE(routed);
+        CHECK(routed->GetVias().empty());
+        CHECK(routed->GetLines().size() == data->GetLines().size());
+    }
+
+    SECTION("Elements on unknown layers are rejected")
+    {
+        PcbWriter writer;
+        REQUIRE(writer.open(fixture, items, key));
+        std::vector<PcbLine> bad = lines;
+        bad[0].layer = PcbNoLayer;
+        CHECK_FALSE(writer.write(outPath.string(), *data, bad, {}));
+    }
+
+    SECTION("Extents recorded from other contents are rejected")
+    {
+        PcbDataCache::Key stale = key;
+        stale.hash ^= 1;
+        PcbWriter writer;
+        CHECK_FALSE(writer.open(fixture, items, stale));
+        CHECK_FALSE(writer.write(outPath.string(), *data, lines, vias));
+    }
+
+    SECTION("The loaded board can be written over")
+    {
+        PcbWriter writer;
+        REQUIRE(writer.open(fixture, items, key));
+        REQUIRE(writer.write(outPath.string(), *data, lines, vias));
+        const std::string expected = readFile(outPath);
+
+        const std::filesystem::path boardPath = uniqueTempPath("autorouter_writer_over.kicad_pcb");
+        std::filesystem::copy_file(fixture, boardPath, std::filesystem::copy_options::overwrite_existing);
+        AutorouterCore core;
+        core.setCacheEnabled(false);
+        REQUIRE(core.loadPcbFile(boardPath.string()));
+        REQUIRE(core.writePcbFile(boardPath.string(), lines, vias));
+        CHECK(readFile(boardPath) == expected);
+        CHECK_FALSE(std::filesystem::exists(boardPath.string() + ".tmp"));
+
+        // The file no longer matches what was loaded until it is reloaded.
+        CHECK_FALSE(core.writePcbFile(outPath.string(), lines, vias));
+        REQUIRE(core.reloadPcbFile());
+        CHECK(core.getPcbData()->GetLines().size() == data->GetLines().size() + 1);
+        CHECK(core.getPcbData()->GetVias().size() == data->GetVias().size() + 1);
+        REQUIRE(core.writePcbFile(outPath.string(), {}, {}));
+        CHECK(readFile(outPath) == expected);
+
+        std::filesystem::remove(boardPath);
+    }
+
+    SECTION("A board changed on disk after loading is not written")
+    {
+        const std::filesystem::path boardPath = uniqueTempPath("autorouter_writer_changed.kicad_pcb");
+        std::filesystem::copy_file(fixture, boardPath, std::filesystem::copy_options::overwrite_existing);
+        AutorouterCore core;
+        core.setCacheEnabled(false);
+        REQUIRE(core.loadPcbFile(boardPath.string()));
+        {
+            std::ofstream out(boardPath, std::ios::binary | std::ios::app);
+            out << "\n";
+        }
+        CHECK_FALSE(core.writePcbFile(boardPath.string(), lines, vias));
+        CHECK(readFile(boardPath) == original + "\n");
+
+        std::filesystem::remove(boardPath);
+    }
+
+    std::filesystem::remove(outPath);
+}
+
+TEST_CASE("Chunked and Compressed Reading", "[kicad][chunked]")
+{
+    // Tiny chunks force atoms, quoted strings and captured lists across buffer refills.
+    for (const std::string& pcbFile : discoverPcbFiles())
+    {
+        SECTION(getTestNameForPcbFile(pcbFile))
+        {
+            PcbParser streaming;
+            streaming.setParseMode(PcbParser::ParseMode::Streaming);
+            auto expected = streaming.parseFile(pcbFile);
+            REQUIRE(expected);
+
+            PcbParser chunked;
+            chunked.setParseMode(PcbParser::ParseMode::Chunked);
+            chunked.setChunkSize(7);
+            auto actual = chunked.parseFile(pcbFile);
+            REQUIRE(actual);
+
+            CHECK(actual->GetNets() == expected->GetNets());
+            REQUIRE(actual->GetPads().size() == expected->GetPads().size());
+            for (size_t i = 0; i < expected->GetPads().size(); ++i) {
+                CHECK(actual->GetPads()[i].pos == expected->GetPads()[i].pos);
+                CHECK(actual->GetLayerName(actual->GetPads()[i].layer) == expected->GetLayerName(expected->GetPads()[i].layer));
+            }
+            CHECK(actual->GetLines().size() == expected->GetLines().size());
+            CHECK(actual->GetVias().size() == expected->GetVias().size());
+            CHECK(actual->GetZones().size() == expected->GetZones().size());
+        }
+    }
+
+    // A compressed board reads the same as the plain one.
+    const std::string plainPath = std::string(PCB_FILES_PATH) + "/simple_2layer/simple_2layer.kicad_pcb";
+    PcbParser parser;
+    auto plain = parser.parseFile(plainPath);
+    auto compressed = parser.parseFile(plainPath + ".gz");
+    REQUIRE(plain);
+    REQUIRE(compressed);
+    CHECK(compressed->GetNets() == plain->GetNets());
+    CHECK(compressed->GetPads().size() == plain->GetPads().size());
+    CHECK(compressed->GetLines().size() == plain->GetLines().size());
+    CHECK(compressed->GetBoundingBox().width == plain->GetBoundingBox().width);
+
+    std::vector<std::string> netNames;
+    REQUIRE(parser.parseNetNames(plainPath + ".gz", netNames));
+    CHECK(netNames == plain->GetNets());
+
+    // Lists that are skipped never grow the buffer past the chunk size.
+    struct SkipAll : SexpEventHandler {
+        int depth = 0;
+        Action enterList(SexpAtom) override { return depth++ == 0 ? Action::Descend : Action::Skip; }
+    } skipAll;
+    SexpChunkedParser reader(64);
+    REQUIRE(reader.open(plainPath + ".gz"));
+    reader.parse(skipAll);
+    CHECK(reader.bufferSize() == 64);
+
+    std::string unterminated = uniqueTempPath("autorouter_unterminated.kicad_pcb").string();
+    std::ofstream(unterminated) << "(kicad_pcb (net 1 \"open";
+    REQUIRE(reader.open(unterminated));
+    skipAll.depth = 0;
+    CHECK_THROWS_AS(reader.parse(skipAll), std::runtime_error);
+    reader.close();
+    std::filesystem::remove(unterminated);
+}